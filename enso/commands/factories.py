@@ -49,65 +49,14 @@
 # Imports
 # ----------------------------------------------------------------------------
 
-import re
+import time
 
 from enso.commands.suggestions import AutoCompletion, Suggestion
 from enso.commands.interfaces import AbstractCommandFactory, CommandObject
+from enso.commands.matching import getMatcher, makePostfixIndex
 from enso.messages import displayMessage
 
 
-# ----------------------------------------------------------------------------
-# Private Utility Functions
-# ----------------------------------------------------------------------------
-
-def _equivalizeChars( userText ):
-    """
-    Returns a regular expression in which certain characters are
-    replaced with equivalent character sets, e.g., "2" by "[2@]".
-    """
-    
-    # TODO: These appear to only be equivalent characters for US
-    # keyboard layouts.
-
-    EQUIVALENT_CHARS = {
-        "1" : "1!",
-        "2" : "2@",
-        "3" : "3#",
-        "4" : "4$",
-        "5" : "5%",
-        "6" : "6^",
-        "7" : "7&",
-        "8" : "8*",
-        "9" : "9(",
-        "0" : "0)",
-        "-" : "-_",
-        "=" : "=+",
-        ";" : ":;",
-        "-" : "-_",
-        "'" : "'\"",
-        }
-    
-    searchText = re.escape( userText )
-    for char in EQUIVALENT_CHARS.keys():
-        expr = EQUIVALENT_CHARS[char]
-        expr = re.escape( expr )
-        expr = "[%s]" % expr
-        char = re.escape(char)
-        searchText = searchText.replace( char, expr )
-
-    # {{{searchText}}} is a pattern that may contain spaces.  To
-    # determine whether a string matches searchText, we want any
-    # number of spaces in the string to match a single space in
-    # searchText.  Therefore, we replace each space in searchText with
-    # a "multispace" match RE, i.e., a regular expression that will
-    # match one or more spaces.
-    space = re.escape( " " )
-    multiSpace = "[%s]+" % space
-    searchText = searchText.replace( space, multiSpace )
-
-    return searchText
-
-
 # ----------------------------------------------------------------------------
 # Prefix Command Factory
 # ----------------------------------------------------------------------------
@@ -139,6 +88,15 @@ class GenericPrefixFactory( AbstractCommandFactory ):
     # not been displayed.
     DESCRIPTION_TEXT = None
 
+    # How often, in seconds, update() is called while the factory is
+    # being queried: 0 means on every query, which is needed if
+    # update() is the only way the factory finds out about changes
+    # to its postfixes.  None means never; such factories change
+    # their postfixes themselves (through the _postfixes property,
+    # _addPostfix() and _removePostfix(), or by modifying them and
+    # calling markChanged()), and cost nothing while idle.
+    UPDATE_INTERVAL = 0
+
     def __init__( self ):
         """
         Instantiantes the command factory.
@@ -154,7 +112,17 @@ class GenericPrefixFactory( AbstractCommandFactory ):
         self.__postfixes = []
         self.__postfixesChanged = False
 
-        self.__searchString = ""
+        # An index of the postfixes, which is (re)built lazily when
+        # the postfixes are changed; __indexedPostfixes is a copy
+        # of the postfixes it was built from.
+        self.__indexedPostfixes = []
+        self.__postfixIndex = makePostfixIndex( [] )
+
+        # Incremented whenever the postfixes really change.
+        self.__generation = 0
+
+        # The time at which update() was last called, or None.
+        self.__lastUpdateTime = None
 
     def getPostfixes( self ):
         return self.__postfixes 
@@ -171,12 +139,44 @@ class GenericPrefixFactory( AbstractCommandFactory ):
     # modifying the postfix list themselves, because modifying the list
     # in place will not invoke the property set method, which means
     # postfixesChanged won't get updated, which is bad.
+    #
+    # Each of these copies the whole list, so subclasses that add or
+    # remove many postfixes at once should use _addPostfixes and
+    # _removePostfixes, which only copy it once.
     def _addPostfix( self, cmdName ):
-        self._postfixes = self._postfixes[:] + [cmdName]
+        self._addPostfixes( [cmdName] )
 
     def _removePostfix( self, cmdExpr ):
-        newPostfixes = self._postfixes[:]
-        newPostfixes.remove( cmdExpr )
+        self._removePostfixes( [cmdExpr] )
+
+    def _addPostfixes( self, cmdNames ):
+        self._postfixes = self._postfixes[:] + list( cmdNames )
+
+    def _removePostfixes( self, cmdExprs ):
+        """
+        Removes the first occurrence of each of cmdExprs from the
+        postfixes; raises a ValueError, without removing any of them,
+        if they're not all there.
+        """
+
+        # Count the occurrences to remove of each postfix, so that
+        # the postfixes only need to be scanned once.
+        toRemove = {}
+        for cmdExpr in cmdExprs:
+            toRemove[cmdExpr] = toRemove.get( cmdExpr, 0 ) + 1
+
+        newPostfixes = []
+        for postfix in self._postfixes:
+            count = toRemove.get( postfix, 0 )
+            if count > 0:
+                toRemove[postfix] = count - 1
+            else:
+                newPostfixes.append( postfix )
+
+        missing = [ cmdExpr for cmdExpr in toRemove.keys()
+                    if toRemove[cmdExpr] > 0 ]
+        if missing:
+            raise ValueError( "Postfixes not found: %s" % missing )
         self._postfixes = newPostfixes
 
     def getCommandList( self ):
@@ -185,32 +185,68 @@ class GenericPrefixFactory( AbstractCommandFactory ):
         most recently set list of postfixes.
         """
 
-        self.update()
+        self.__poll()
         return [ self.PREFIX + post for post in self._postfixes ]
-        
+
+
+    def markChanged( self ):
+        """
+        Tells the factory that its postfixes have changed, e.g.
+        because a subclass modified the list in place; a factory
+        that polls update() calls it on the next query, whatever its
+        UPDATE_INTERVAL.
+        """
+
+        self.__postfixesChanged = True
+        self.__lastUpdateTime = None
+        # Force the index to be rebuilt, even if the postfixes appear
+        # to be the same.
+        self.__indexedPostfixes = None
+
+
+    def __poll( self ):
+        """
+        Calls update(), as often as UPDATE_INTERVAL allows.
+        """
+
+        if self.UPDATE_INTERVAL == 0:
+            self.update()
+        elif self.UPDATE_INTERVAL != None:
+            now = time.time()
+            if self.__lastUpdateTime == None or \
+                   now < self.__lastUpdateTime or \
+                   now - self.__lastUpdateTime >= self.UPDATE_INTERVAL:
+                self.__lastUpdateTime = now
+                self.update()
+
 
     def __update( self ):
         """
-        Private method for maintaining a search-string structure.
+        Private method for maintaining the postfix index.
         """
 
-        self.update()
+        self.__poll()
         
         if self.__postfixesChanged:
             self.__postfixesChanged = False
-            self.__searchString = "\n".join( self.__postfixes )
+            # Many subclasses set the same postfixes on every update;
+            # only rebuild the index if they're actually different.
+            postfixes = list( self.__postfixes )
+            if postfixes != self.__indexedPostfixes:
+                self.__indexedPostfixes = postfixes
+                self.__postfixIndex = makePostfixIndex( postfixes )
+                self.__generation += 1
             
 
-    # LONGTERM TODO: This is not the greatest design.  Perhaps in
-    # Mehitabel Core 2.0 this can be replaced with an Observer pattern.
     def update( self ):
         """
         Template Method - Designed to allow sub-classes to update the
         class's interal command/postfix information.
 
-        NOTE: BE CAREFUL! This function gets called on every keystroke
-        while the user has typed something that might match this
-        factory.  If you don't need to update that often, then do
+        NOTE: BE CAREFUL! Unless UPDATE_INTERVAL says otherwise, this
+        function gets called on every keystroke while the user has
+        typed something that might match this factory.  If you don't
+        need to update that often, then set UPDATE_INTERVAL, or do
         something to get out of this function quickly!
         """
 
@@ -229,27 +265,66 @@ class GenericPrefixFactory( AbstractCommandFactory ):
         This returns a list of Suggestion objects.
         """
 
-        pattern = userText[len(self.PREFIX):]
-        pattern = _equivalizeChars( pattern )
+        return [ Suggestion( userText, suggestedText, helpText )
+                 for suggestedText, helpText
+                 in self.retrieveCandidates( userText ) ]
 
-        # Match any command that contains the user postfix (i.e.,
-        # any characters followed by the user postfix).
-        pattern = ".*" + pattern
-        
-        matches = self.__findMatches( pattern )
 
-        suggestions = [ Suggestion( userText, self.PREFIX + m )
-                        for m in matches ]
+    def retrieveCandidates( self, userText ):
+        """
+        Like retrieveSuggestions(), but returns ( suggestedText,
+        helpText ) tuples.
+        """
+
+        # Match any command that contains the user postfix.
+        userPostfix = userText[len(self.PREFIX):]
+        self.__update()
+        matches = self.__postfixIndex.findSubstringMatches( userPostfix )
+
+        if len( self.PREFIX ) == 0:
+            # The matches are the command names themselves; there's
+            # no need to copy them.
+            candidates = [ ( m, None ) for m in matches ]
+        else:
+            candidates = [ ( self.PREFIX + m, None ) for m in matches ]
 
         if self.PREFIX.startswith( userText ):
             # If seed text is all or part of the prefix, then
             # autocomplete with help text.
-            suggestions.insert(
-                0,
-                Suggestion( userText, self.PREFIX, self.HELP_TEXT )
-                )
+            candidates.insert( 0, ( self.PREFIX, self.HELP_TEXT ) )
 
-        return suggestions
+        return candidates
+
+
+    def refineCandidates( self, userText, candidates ):
+        """
+        Narrows down candidates, which were retrieved for a prefix of
+        userText, to the ones that match userText.
+        """
+
+        # Any command containing the user postfix must also contain
+        # any prefix of it, so the commands matching userText are a
+        # subset of the ones that were suggested.
+        matcher = getMatcher( userText[len(self.PREFIX):] )
+        start = len( self.PREFIX )
+
+        newCandidates = [ candidate for candidate in candidates
+                          if len( candidate[0] ) > start and \
+                          matcher.search( candidate[0], start ) >= 0 ]
+
+        if self.PREFIX.startswith( userText ):
+            newCandidates.insert( 0, ( self.PREFIX, self.HELP_TEXT ) )
+
+        return newCandidates
+
+
+    def getGeneration( self ):
+        """
+        Returns a number which changes whenever the postfixes change.
+        """
+
+        self.__update()
+        return self.__generation
 
 
     def autoComplete( self, userText ):
@@ -268,16 +343,16 @@ class GenericPrefixFactory( AbstractCommandFactory ):
         elif not userText.startswith( self.PREFIX ):
             return None
 
-        pattern = userText[len(self.PREFIX):]
-        pattern = _equivalizeChars( pattern )
-        matches = self.__findMatches( pattern )
+        userPostfix = userText[len(self.PREFIX):]
+        self.__update()
+        matches = self.__postfixIndex.findPrefixMatches( userPostfix )
         if len( self.PREFIX ) > 0 and len( matches ) == 0:
             # We have a real prefix; look for beginings of words.
-            matches = self.__findMatches( ".*\\b" + pattern )
+            matches = self.__postfixIndex.findWordStartMatches( userPostfix )
         if len(matches) < 1:
             return None
         match = matches[0]
-        matchLocation = re.search( pattern, match ).start()
+        matchLocation = getMatcher( userPostfix ).search( match )
 
         newUserText = self.PREFIX
         start = matchLocation
@@ -287,35 +362,6 @@ class GenericPrefixFactory( AbstractCommandFactory ):
         return completion
 
 
-    def __findMatches( self, pattern ):
-        """
-        Finds all command names that:
-          (1) start with the correct prefix, and
-          (2) match pattern.
-        """
-        
-        self.__update()
-
-        # This part works by using regular expressions to quickly grab
-        # all the new-line delimited substrings that contain
-        # the pattern.  NOTE: This will allow us to modify the pattern
-        # into a more advanced regexp, allowing ( for example ) the
-        # user text "open boo 9temp0" to match to the command named
-        # "open boo (temp)".  
-
-        # ^ matches begining of line or begining of string
-        # $ matches end of line or end of string
-        # .* matches any number of any character, except newlines
-
-        # re.M means that "multiline mode" is used, so "." does not
-        # match newlines.
-        matches = re.findall( pattern = "^" + pattern +".*$",
-                              string = self.__searchString,
-                              flags = re.M )
-        matches = [ m for m in matches if len(m) > 0 ]
-        matches.sort()
-        return matches
-
     def getCommandObj( self, commandName ):
         """
         Returns the command object that matches commandName, if any.
@@ -351,6 +397,9 @@ class ArbitraryPostfixFactory( GenericPrefixFactory ):
     commands, and other command families that can take any argument.
     """
 
+    # This factory doesn't use its postfixes.
+    UPDATE_INTERVAL = None
+
     def autoComplete( self, seedText ):
         """
         Returns an autocompletion for seedText if seedText begins
@@ -389,6 +438,26 @@ class ArbitraryPostfixFactory( GenericPrefixFactory ):
             return []
 
 
+    def retrieveCandidates( self, userText ):
+        """
+        Returns the candidates for userText.
+        """
+
+        if userText in self.PREFIX:
+            return [ ( self.PREFIX, self.HELP_TEXT ) ]
+        else:
+            return []
+
+
+    def refineCandidates( self, userText, candidates ):
+        """
+        Returns the candidates for userText; this is cheap enough
+        that there is no point in narrowing down earlier ones.
+        """
+
+        return self.retrieveCandidates( userText )
+
+
     def update( self ):
         """
         Updates the available command list.
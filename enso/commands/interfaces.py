@@ -207,6 +207,64 @@ class AbstractCommandFactory( _CommandImpl ):
         raise NotImplementedError()
 
         
+    def retrieveCandidates( self, userText ):
+        """
+        Like retrieveSuggestions(), but returns a list of
+        ( suggestedText, helpText ) tuples, in the same order.  This
+        allows the (usually few) suggestions that are eventually
+        displayed to be picked without creating a Suggestion object
+        for every candidate.
+
+        Subclasses that produce many suggestions should override
+        this; by default, it calls retrieveSuggestions().
+        """
+
+        return [ ( s.toText(), s.getHelpText() )
+                 for s in self.retrieveSuggestions( userText ) ]
+
+
+    def refineCandidates( self, userText, candidates ):
+        """
+        Returns the same list as retrieveCandidates( userText ), given
+        the list of candidates that retrieveCandidates() returned for
+        some prefix of userText, while getGeneration() returned the
+        same value as it does now.
+
+        Subclasses can override this to narrow down the given
+        candidates, which is usually much cheaper than retrieving
+        them from scratch; by default, it just calls
+        retrieveCandidates().
+        """
+
+        return self.retrieveCandidates( userText )
+
+
+    def getGeneration( self ):
+        """
+        Returns a value which changes whenever the set of commands
+        this factory produces may have changed, so that the results
+        of its methods can be reused for as long as it stays the same.
+
+        Returns None if the factory can't tell, which is the default;
+        nothing is ever reused in this case.
+        """
+
+        return None
+
+
+    def markChanged( self ):
+        """
+        Notifies the factory that the set of commands it produces has
+        changed, so that getGeneration() changes too.
+
+        Subclasses that can't otherwise detect such changes should
+        call this whenever they happen; by default, this does nothing,
+        since getGeneration() returns None anyway.
+        """
+
+        pass
+
+        
     def autoComplete( self, userText ):
         """
         If this factory can produce a match to userText, then returns
@@ -79,45 +79,122 @@ class CommandManager:
             self.CMD_KEY : self.__cmdObjReg,
             }
 
+        # Maps the name of each registered command factory to a list
+        # of its command expressions (usually just one), in the order
+        # in which they were registered.
+        self.__cmdFactoryExprs = {}
+
+        # Routes user text to the command expressions that can match
+        # it, so that queries don't need to visit every factory.
+        self.__cmdExprTrie = PrefixTrie()
+        self.__cmdExprTrie.add( self.CMD_KEY.getPrefix(), self.CMD_KEY )
+
+        # Incremented whenever a command factory is registered or
+        # unregistered.
+        self.__generation = 0
+
 
     def registerCommand( self, cmdName, cmdObj ):
         """
         Called to register a new command with the command manager.
         """
 
-        try:
-            cmdExpr = CommandExpression( cmdName )
-        except AssertionError, why:
-            logging.error( "Could not register %s : %s "
-                           % ( cmdName, why ) )
-            raise
-
-        if cmdExpr.hasArgument():
-            # The command expression has an argument; it is a command
-            # with an argument.
-            assert isinstance( cmdObj, AbstractCommandFactory )
-            assert not self.__cmdFactoryDict.has_key( cmdExpr )
+        self.registerCommands( [ ( cmdName, cmdObj ) ] )
+
+    def registerCommands( self, commands ):
+        """
+        Registers each ( cmdName, cmdObj ) pair in commands, as with
+        registerCommand(), but updating the command registry and its
+        search structures only once; this should be used to register
+        large numbers of commands.
+
+        If any of the simple commands is already registered, raises a
+        CommandAlreadyRegisteredError without registering any of the
+        commands.
+        """
+
+        factories = []
+        cmdObjs = []
+        for cmdName, cmdObj in commands:
+            try:
+                cmdExpr = CommandExpression( cmdName )
+            except AssertionError, why:
+                logging.error( "Could not register %s : %s "
+                               % ( cmdName, why ) )
+                raise
+
+            if cmdExpr.hasArgument():
+                # The command expression has an argument; it is a
+                # command with an argument.
+                assert isinstance( cmdObj, AbstractCommandFactory )
+                assert not self.__cmdFactoryDict.has_key( cmdExpr )
+                factories.append( ( cmdExpr, cmdObj ) )
+            else:
+                # The command expression has no argument; it is a
+                # simple command with an exact name.
+                assert isinstance( cmdObj, CommandObject ), \
+                       "Could not register %s" % cmdName
+                cmdObjs.append( ( cmdObj, cmdExpr ) )
+
+        # This is the only step that can fail, so do it first.
+        if cmdObjs:
+            self.__cmdObjReg.addCommandObjs( cmdObjs )
+
+        for cmdExpr, cmdObj in factories:
             self.__cmdFactoryDict[ cmdExpr ] = cmdObj
-        else:
-            # The command expression has no argument; it is a
-            # simple command with an exact name.
-            assert isinstance( cmdObj, CommandObject ), \
-                   "Could not register %s" % cmdName
-            self.__cmdObjReg.addCommandObj( cmdObj, cmdExpr )
+            self.__cmdFactoryExprs.setdefault( str(cmdExpr), [] ).append(
+                cmdExpr
+                )
+            self.__cmdExprTrie.add( cmdExpr.getPrefix(), cmdExpr )
+        if factories:
+            self.__generation += 1
+
+    def unregisterCommands( self, cmdNames ):
+        """
+        Unregisters the commands with each of the names in cmdNames,
+        as with unregisterCommand(), but in a single pass.
 
-    def unregisterCommand( self, cmdName ):
-        cmdFound = False
-        for cmdExpr in self.__cmdFactoryDict.keys():
-            if str(cmdExpr) == cmdName:
+        If any of the simple commands isn't registered, raises a
+        RuntimeError without unregistering any of the commands.
+        """
+
+        # Find the command factories to remove; the other names must
+        # be those of simple commands.
+        factoryCounts = {}
+        cmdObjNames = []
+        for cmdName in cmdNames:
+            count = factoryCounts.get( cmdName, 0 )
+            if count < len( self.__cmdFactoryExprs.get( cmdName, [] ) ):
+                factoryCounts[cmdName] = count + 1
+            else:
+                cmdObjNames.append( cmdName )
+
+        # This is the only step that can fail, so do it first.
+        if cmdObjNames:
+            self.__cmdObjReg.removeCommandObjs( cmdObjNames )
+
+        for cmdName, count in factoryCounts.items():
+            cmdExprs = self.__cmdFactoryExprs[cmdName]
+            for cmdExpr in cmdExprs[:count]:
                 del self.__cmdFactoryDict[cmdExpr]
-                cmdFound = True
-                break
+                self.__cmdExprTrie.remove( cmdExpr.getPrefix(), cmdExpr )
+            if count == len( cmdExprs ):
+                del self.__cmdFactoryExprs[cmdName]
+            else:
+                del cmdExprs[:count]
+        if factoryCounts:
+            self.__generation += 1
+
+    def unregisterCommand( self, cmdName ):
+        self.unregisterCommands( [ cmdName ] )
+
+    def __getMatchingExprs( self, userText ):
+        """
+        Returns a list of the registered command expressions that
+        match userText (see CommandExpression.matches()).
+        """
 
-        if not cmdFound:
-            self.__cmdObjReg.removeCommandObj( cmdName )
-            cmdFound = True
-        if not cmdFound:
-            raise RuntimeError( "Command '%s' does not exist." % cmdName )
+        return self.__cmdExprTrie.findCompatible( userText )
 
     def getCommandExpression( self, commandName ):
         """
@@ -129,18 +206,17 @@ class CommandManager:
 
         commands = []
 
-        for expr in self.__cmdFactoryDict.iterkeys():
-            if expr.matches( commandName ):
-                # This expression matches commandName; try to fetch a
-                # command object from the corresponding factory.
-                cmd = self.__cmdFactoryDict[expr].getCommandObj( commandName )
-                if expr == self.CMD_KEY and cmd != None:
-                    commands.append( ( commandName, commandName ) )
-                elif cmd != None:
-                    # The factory returned a non-nil command object.
-                    # Make sure that nothing else has matched this
-                    # commandName.
-                    commands.append( (expr.getPrefix(), expr) )
+        for expr in self.__getMatchingExprs( commandName ):
+            # This expression matches commandName; try to fetch a
+            # command object from the corresponding factory.
+            cmd = self.__cmdFactoryDict[expr].getCommandObj( commandName )
+            if expr == self.CMD_KEY and cmd != None:
+                commands.append( ( commandName, commandName ) )
+            elif cmd != None:
+                # The factory returned a non-nil command object.
+                # Make sure that nothing else has matched this
+                # commandName.
+                commands.append( (expr.getPrefix(), expr) )
 
         if len(commands) == 0:
             return None
@@ -161,14 +237,13 @@ class CommandManager:
 
         commands = []
 
-        for expr in self.__cmdFactoryDict.iterkeys():
-            if expr.matches( commandName ):
-                # This expression matches commandName; try to fetch a
-                # command object from the corresponding factory.
-                cmd = self.__cmdFactoryDict[expr].getCommandObj( commandName )
-                if cmd != None:
-                    # The factory returned a non-nil command object.
-                    commands.append( ( expr, cmd ) )
+        for expr in self.__getMatchingExprs( commandName ):
+            # This expression matches commandName; try to fetch a
+            # command object from the corresponding factory.
+            cmd = self.__cmdFactoryDict[expr].getCommandObj( commandName )
+            if cmd != None:
+                # The factory returned a non-nil command object.
+                commands.append( ( expr, cmd ) )
 
         if len( commands ) == 0:
             return None
@@ -188,12 +263,11 @@ class CommandManager:
         completions = []
 
         # Check each of the command factories for a match.
-        for expr in self.__cmdFactoryDict.iterkeys():
-            if expr.matches( userText ):
-                cmdFact = self.__cmdFactoryDict[expr]
-                completion = cmdFact.autoComplete( userText )
-                if completion != None:
-                    completions.append( completion )
+        for expr in self.__getMatchingExprs( userText ):
+            cmdFact = self.__cmdFactoryDict[expr]
+            completion = cmdFact.autoComplete( userText )
+            if completion != None:
+                completions.append( completion )
 
         if len( completions ) == 0:
             return None
@@ -209,22 +283,97 @@ class CommandManager:
 
         suggestions = []
         # Extend the suggestions using each of the command factories
-        for expr in self.__cmdFactoryDict.iterkeys():
-            if expr.matches( userText ):
-                factory = self.__cmdFactoryDict[expr]
-                suggestions += factory.retrieveSuggestions( userText )
+        for expr in self.__getMatchingExprs( userText ):
+            factory = self.__cmdFactoryDict[expr]
+            suggestions += factory.retrieveSuggestions( userText )
 
         return suggestions
 
 
+    def retrieveSuggestionGroups( self, userText ):
+        """
+        Like retrieveSuggestions(), but returns suggestion candidates
+        (see AbstractCommandFactory.retrieveCandidates()) grouped by
+        the command factory that produced them, in an opaque form
+        that can be passed to refineSuggestionGroups() and
+        areSuggestionGroupsCurrent(), and flattened into a list of
+        candidates with getCandidatesFromGroups().
+        """
+
+        groups = []
+        for expr in self.__getMatchingExprs( userText ):
+            factory = self.__cmdFactoryDict[expr]
+            generation = factory.getGeneration()
+            candidates = factory.retrieveCandidates( userText )
+            groups.append( ( expr, factory, generation, candidates ) )
+
+        return ( self.__generation, groups )
+
+
+    def refineSuggestionGroups( self, userText, suggestionGroups ):
+        """
+        Returns the suggestion groups for userText, given current
+        suggestion groups (see areSuggestionGroupsCurrent()) for a
+        prefix of userText.
+
+        Only the command factories that were part of the given groups
+        can match userText, so only those are asked to refine their
+        candidates.
+        """
+
+        generation, groups = suggestionGroups
+
+        newGroups = []
+        for expr, factory, factoryGeneration, candidates in groups:
+            if expr.matches( userText ):
+                candidates = factory.refineCandidates( userText, candidates )
+                newGroups.append(
+                    ( expr, factory, factoryGeneration, candidates )
+                    )
+
+        return ( generation, newGroups )
+
+
+    def areSuggestionGroupsCurrent( self, suggestionGroups ):
+        """
+        Returns whether none of the command factories involved in the
+        given suggestion groups has changed since they were retrieved.
+        """
+
+        generation, groups = suggestionGroups
+
+        if generation != self.__generation:
+            return False
+        for expr, factory, factoryGeneration, candidates in groups:
+            if factoryGeneration == None or \
+                   factory.getGeneration() != factoryGeneration:
+                return False
+        return True
+
+
+    def getCandidatesFromGroups( self, suggestionGroups ):
+        """
+        Returns the unsorted list of suggestion candidates in the
+        given suggestion groups.
+        """
+
+        generation, groups = suggestionGroups
+
+        candidates = []
+        for expr, factory, factoryGeneration, factoryCandidates in groups:
+            candidates += factoryCandidates
+        return candidates
+
+
     def getCommands( self ):
         """
         Returns a dictionary of command expression strings and their
         associated implementations (command objects or factories).
         """
 
-        # Get a dictionary form of the command object registry:
-        cmdDict = self.__cmdObjReg.getDict()
+        # Get a dictionary form of the command object registry (a
+        # copy, since it's about to be extended):
+        cmdDict = self.__cmdObjReg.getDict().copy()
 
         # Extend the dictionary to cover the command factories.
         for expr in self.__cmdFactoryDict.keys():
@@ -238,6 +387,99 @@ class CommandManager:
         return cmdDict
         
         
+# ----------------------------------------------------------------------------
+# Prefix Trie
+# ----------------------------------------------------------------------------
+
+class PrefixTrie:
+    """
+    Maps string keys to values, and efficiently finds the values
+    whose keys are "compatible" with a given string, i.e., that are
+    a prefix of it or that it is a prefix of.
+
+    This is exactly the test that CommandExpression.matches() makes
+    against the prefix of a command expression, so the command
+    manager uses this to find the command expressions matching some
+    user text without testing each of them in turn.
+    """
+
+    def __init__( self ):
+        """
+        Initializes the trie to be empty.
+        """
+
+        self.__root = self.__makeNode()
+
+    def __makeNode( self ):
+        """
+        Returns a new trie node, which is a pair of a dictionary
+        mapping characters to child nodes and a list of the values
+        whose key ends at the node.
+        """
+
+        return ( {}, [] )
+
+    def add( self, key, value ):
+        """
+        Adds value to the trie under key.  A key can have several
+        values.
+        """
+
+        node = self.__root
+        for char in key:
+            children = node[0]
+            if not children.has_key( char ):
+                children[char] = self.__makeNode()
+            node = children[char]
+        node[1].append( value )
+
+    def remove( self, key, value ):
+        """
+        Removes value from under key; raises a ValueError if it isn't
+        there.
+        """
+
+        path = []
+        node = self.__root
+        for char in key:
+            path.append( ( node, char ) )
+            node = node[0].get( char )
+            if node == None:
+                raise ValueError( "%r is not in the trie." % key )
+        node[1].remove( value )
+
+        # Prune the nodes that no longer lead to any value.
+        while path and not node[0] and not node[1]:
+            parent, char = path.pop()
+            del parent[0][char]
+            node = parent
+
+    def findCompatible( self, text ):
+        """
+        Returns a list of the values whose keys are a prefix of text,
+        or start with text.
+        """
+
+        # The values of every node along the path spelled by text
+        # have keys that are a prefix of text...
+        node = self.__root
+        values = list( node[1] )
+        for char in text:
+            node = node[0].get( char )
+            if node == None:
+                return values
+            values.extend( node[1] )
+
+        # ...and the values of every node below the end of that path
+        # have keys that start with text.
+        stack = node[0].values()
+        while stack:
+            node = stack.pop()
+            values.extend( node[1] )
+            stack.extend( node[0].values() )
+        return values
+
+
 # ----------------------------------------------------------------------------
 # A CommandObject Registry
 # ----------------------------------------------------------------------------
@@ -260,6 +502,9 @@ class CommandObjectRegistry( GenericPrefixFactory ):
 
     PREFIX = ""
 
+    # Commands are added and removed through the _postfixes property.
+    UPDATE_INTERVAL = None
+
     def __init__( self ):
         """
         Initialize the command registry.
@@ -270,9 +515,6 @@ class CommandObjectRegistry( GenericPrefixFactory ):
         self.__cmdObjDict = {}
         self.__dictTouched = False
 
-    def update( self ):
-        pass
-
     def getDict( self ):
         return self.__cmdObjDict
 
@@ -281,29 +523,67 @@ class CommandObjectRegistry( GenericPrefixFactory ):
         Adds command to the registry under the name str(cmdExpr).
         """
 
-        assert isinstance( cmdExpr, CommandExpression )
-        assert not cmdExpr.hasArgument()
+        self.addCommandObjs( [ ( command, cmdExpr ) ] )
+
+
+    def addCommandObjs( self, commands ):
+        """
+        Adds each ( command, cmdExpr ) pair in commands to the
+        registry, as with addCommandObj(), in a single pass.
+
+        If any of the names is already taken, raises a
+        CommandAlreadyRegisteredError without adding any of them.
+        """
+
+        newCmdObjDict = {}
+        cmdNames = []
+        for command, cmdExpr in commands:
+            assert isinstance( cmdExpr, CommandExpression )
+            assert not cmdExpr.hasArgument()
 
-        cmdName = str(cmdExpr)
-        if self.__cmdObjDict.has_key( cmdName ):
-            raise CommandAlreadyRegisteredError()
+            cmdName = str(cmdExpr)
+            if self.__cmdObjDict.has_key( cmdName ) or \
+                   newCmdObjDict.has_key( cmdName ):
+                raise CommandAlreadyRegisteredError()
 
-        self.__cmdObjDict[ cmdName ] = command
+            newCmdObjDict[ cmdName ] = command
+            cmdNames.append( cmdName )
+
+        self.__cmdObjDict.update( newCmdObjDict )
         self.__dictTouched = True
 
-        self._addPostfix( cmdName )
+        self._addPostfixes( cmdNames )
 
 
     def removeCommandObj( self, cmdExpr ):
-        cmdFound = False
-        if self.__cmdObjDict.has_key( cmdExpr ):
+        self.removeCommandObjs( [ cmdExpr ] )
+
+
+    def removeCommandObjs( self, cmdExprs ):
+        """
+        Removes the commands with each of the names in cmdExprs from
+        the registry, in a single pass.
+
+        If any of them isn't registered, or appears more than once
+        (so that it wouldn't be registered by the time it was removed
+        again), raises a RuntimeError without removing any of them.
+        """
+
+        cmdExprs = list( cmdExprs )
+        seen = {}
+        for cmdExpr in cmdExprs:
+            if not self.__cmdObjDict.has_key( cmdExpr ):
+                raise RuntimeError( "Command object '%s' not found."
+                                    % cmdExpr )
+            if seen.has_key( cmdExpr ):
+                raise RuntimeError( "Command object '%s' given twice."
+                                    % cmdExpr )
+            seen[cmdExpr] = True
+
+        for cmdExpr in cmdExprs:
             del self.__cmdObjDict[cmdExpr]
-            cmdFound = True
-        if cmdFound:
-            self.__dictTouched = True
-            self._removePostfix( cmdExpr )
-        else:
-            raise RuntimeError( "Command object '%s' not found." % cmdExpr )
+        self.__dictTouched = True
+        self._removePostfixes( cmdExprs )
             
             
 
@@ -0,0 +1,279 @@
+# Copyright (c) 2008, Humanized, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#    1. Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#
+#    2. Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#
+#    3. Neither the name of Enso nor the names of its contributors may
+#       be used to endorse or promote products derived from this
+#       software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# ----------------------------------------------------------------------------
+#
+#   enso.commands.matching
+#
+# ----------------------------------------------------------------------------
+
+"""
+    Matching of user text against command postfixes.
+
+    User text matches a postfix "loosely": certain characters match
+    their equivalent characters (e.g., "2" also matches "@"), and a
+    space matches any number of spaces.
+
+    A postfix index answers the three kinds of queries that
+    GenericPrefixFactory makes on every keystroke:
+
+      index.findPrefixMatches( userText )
+        Postfixes that start with userText.
+
+      index.findSubstringMatches( userText )
+        Postfixes that contain userText.
+
+      index.findWordStartMatches( userText )
+        Postfixes that contain userText at the start of a word.
+
+    Each returns a sorted list of the non-empty postfixes that match.
+
+    A matcher, returned by getMatcher(), finds user text in a single
+    string:
+
+      matcher.search( text, start=0 )
+        The position of the first match of userText in text, at or
+        after start, or -1.
+
+    Both are implemented natively in the _postfixindex extension
+    module (the index is a trie and trigram index, which makes queries
+    fast even for very large numbers of postfixes); if that module
+    isn't available, regular expression-based implementations are
+    used.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import re
+
+from enso.utils.lrucache import LruCache
+
+try:
+    from enso.commands import _postfixindex
+except ImportError:
+    _postfixindex = None
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# Characters that match sets of equivalent characters, e.g., typing
+# "2" will match "2" or "@".
+
+# TODO: These appear to only be equivalent characters for US
+# keyboard layouts.
+
+EQUIVALENT_CHARS = {
+    "1" : "1!",
+    "2" : "2@",
+    "3" : "3#",
+    "4" : "4$",
+    "5" : "5%",
+    "6" : "6^",
+    "7" : "7&",
+    "8" : "8*",
+    "9" : "9(",
+    "0" : "0)",
+    "-" : "-_",
+    "=" : "=+",
+    ";" : ":;",
+    "'" : "'\"",
+    }
+
+# The maximum number of compiled matchers and regular expressions to
+# keep around; a few of these are needed for every keystroke.
+MAX_CACHED_MATCHERS = 128
+
+
+# ----------------------------------------------------------------------------
+# Functions
+# ----------------------------------------------------------------------------
+
+def _makeCharPatterns():
+    """
+    Returns a dictionary mapping each ASCII character to the regular
+    expression that it stands for in user text.
+    """
+
+    charPatterns = {}
+    for i in range( 128 ):
+        char = chr( i )
+        charPatterns[char] = re.escape( char )
+
+    for char, equivalentChars in EQUIVALENT_CHARS.items():
+        charPatterns[char] = "[%s]" % re.escape( equivalentChars )
+
+    # We want any number of spaces in the text to match a single
+    # space in the user text.  Therefore, each space is replaced with
+    # a "multispace" match RE, i.e., a regular expression that will
+    # match one or more spaces.
+    charPatterns[" "] = "[%s]+" % re.escape( " " )
+
+    return charPatterns
+
+_CHAR_PATTERNS = _makeCharPatterns()
+
+def equivalizeChars( userText ):
+    """
+    Returns a regular expression in which certain characters are
+    replaced with equivalent character sets, e.g., "2" by "[2@]".
+    """
+
+    # Joining with an empty string of the same type as userText makes
+    # the result a unicode object if userText is one.
+    charPatterns = _CHAR_PATTERNS
+    return userText[:0].join( [ charPatterns.get( char ) or re.escape( char )
+                                for char in userText ] )
+
+
+_matcherCache = LruCache( MAX_CACHED_MATCHERS )
+
+def getMatcher( userText ):
+    """
+    Returns a matcher for userText (see above); matchers are cached,
+    so this is cheap to call on every keystroke.
+    """
+
+    key = ( userText, "matcher" )
+    matcher = _matcherCache.get( key )
+    if matcher == None:
+        if _postfixindex is not None:
+            matcher = _postfixindex.Matcher( userText, EQUIVALENT_CHARS )
+        else:
+            matcher = RegexMatcher( userText )
+        _matcherCache[key] = matcher
+    return matcher
+
+
+def getRegex( userText, pattern = "%s", flags = 0 ):
+    """
+    Returns a compiled regular expression that is pattern, with "%s"
+    replaced by equivalizeChars( userText ); regular expressions are
+    cached, so this is cheap to call on every keystroke.
+    """
+
+    key = ( userText, pattern, flags )
+    regex = _matcherCache.get( key )
+    if regex == None:
+        regex = re.compile( pattern % equivalizeChars( userText ), flags )
+        _matcherCache[key] = regex
+    return regex
+
+
+def makePostfixIndex( postfixes ):
+    """
+    Returns a postfix index for the given list of postfixes, using
+    the native implementation if possible.
+    """
+
+    if _postfixindex is not None:
+        try:
+            return _postfixindex.PostfixIndex( postfixes, EQUIVALENT_CHARS )
+        except (UnicodeError, ValueError):
+            # The native index only handles postfixes that can be
+            # converted to unicode, and which don't contain newlines;
+            # the regular expression-based index handles everything.
+            pass
+    return RegexPostfixIndex( postfixes )
+
+
+# ----------------------------------------------------------------------------
+# Regular Expression-Based Matcher
+# ----------------------------------------------------------------------------
+
+class RegexMatcher:
+    """
+    Pure-Python matcher, used when the native one is not available.
+    """
+
+    def __init__( self, userText ):
+        self.__regex = re.compile( equivalizeChars( userText ) )
+
+    def search( self, text, start = 0 ):
+        match = self.__regex.search( text, start )
+        if match == None:
+            return -1
+        else:
+            return match.start()
+
+
+# ----------------------------------------------------------------------------
+# Regular Expression-Based Postfix Index
+# ----------------------------------------------------------------------------
+
+class RegexPostfixIndex:
+    """
+    Pure-Python postfix index, used when the native one is not
+    available.
+    """
+
+    def __init__( self, postfixes ):
+        """
+        Creates the index for the given list of postfixes.
+        """
+
+        self.__searchString = "\n".join( postfixes )
+
+    def findPrefixMatches( self, userText ):
+        return self.__findMatches( userText, "%s" )
+
+    def findSubstringMatches( self, userText ):
+        # Match any postfix that contains the user text (i.e., any
+        # characters followed by the user text).
+        return self.__findMatches( userText, ".*%s" )
+
+    def findWordStartMatches( self, userText ):
+        return self.__findMatches( userText, ".*\\b%s" )
+
+    def __findMatches( self, userText, pattern ):
+        """
+        Finds all postfixes that match pattern, in which "%s" stands
+        for the user text.
+        """
+
+        # This part works by using regular expressions to quickly grab
+        # all the new-line delimited substrings that contain
+        # the pattern.  NOTE: This will allow us to modify the pattern
+        # into a more advanced regexp, allowing ( for example ) the
+        # user text "open boo 9temp0" to match to the command named
+        # "open boo (temp)".
+
+        # ^ matches begining of line or begining of string
+        # $ matches end of line or end of string
+        # .* matches any number of any character, except newlines
+
+        # re.M means that "multiline mode" is used, so "." does not
+        # match newlines.
+        regex = getRegex( userText, "^" + pattern + ".*$", re.M )
+        matches = regex.findall( self.__searchString )
+        matches = [ m for m in matches if len(m) > 0 ]
+        matches.sort()
+        return matches
@@ -34,14 +34,37 @@
 
 """
     Classes for encapsulating suggestions (including auto-completions).
+
+    Marking up a suggestion means aligning it with the original text,
+    which is done natively by the _suggestionmarkup extension module
+    if it's available.  Since the same suggestions are marked up over
+    and over again as the user types, the results are cached.
 """
 
 # ----------------------------------------------------------------------------
 # Imports
 # ----------------------------------------------------------------------------
 
+import heapq
+
 import enso.utils.strings
 import enso.utils.xml_tools
+from enso.utils.lrucache import LruCache
+
+try:
+    from enso.commands import _suggestionmarkup
+except ImportError:
+    _suggestionmarkup = None
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The maximum number of marked-up suggestions to remember; this
+# should comfortably exceed the number of suggestions displayed at
+# once.
+MAX_CACHED_MARKUPS = 256
 
 
 # ----------------------------------------------------------------------------
@@ -274,111 +297,9 @@ class Suggestion:
 
 
     def __transform( self ):
-        
-        # We are going to "use up" both the source string and the
-        # suggestion
-        unusedSource = self.__source[:]
-        unusedSuggestion = self.__suggestion[:]
-        
-        # The xml representation
-        xmlText = ""
-
-        # The "to the next word" completion.
-        completion = ""
-        
-
-        # If we cannot match an initial substring of unusedSource,
-        # then we are going to peel off characters one-by-one into
-        # this variable.  These characters have been lost in the
-        # suggestion, and will cause "insertions" to instead be
-        # "alterations".
-        unmatchedChars = ""
-        
-        # BEGIN SOURCE-STRING LOOP
-
-        # Each iteration of this loop should reduce the length of
-        # unusedSource, and this loop ends when unusedSource is empty.
-        while len(unusedSource)>0:
-            # Save a copy of unusedSource, so we know if it changes.
-            oldUnusedSource = unusedSource[:]
-
-            # Loop from the full length of unusedSource down to one
-            # character
-            for i in range( len(unusedSource), 0, -1 ):
-                # The initial substring we are trying to locate.
-                target = unusedSource[:i]
-                
-                # BEGIN TARGET-FOUND CONDITION
-                if target in unusedSuggestion:
-                    index = unusedSuggestion.find( target )
-                    if index > 0:
-                        if len(unmatchedChars) > 0:
-                            # There were unused characters in the
-                            # source, and there were characters in the
-                            # unused suggestion before the target, so
-                            # the next "inserted" portion of the
-                            # suggestion becomes an "alteration"
-                            # instead.
-                            xmlFormat = "<alt>%s</alt>"
-                        else:
-                            xmlFormat = "<ins>%s</ins>"
-                        xmlText += xmlFormat % enso.utils.xml_tools.escape_xml(
-                            unusedSuggestion[:index]
-                            )
-                        # NOTE: Do not add inserted characters to the
-                        # 'next word' completion.
-                    # Whether or not there were characters between
-                    # the start of the unused suggestion and "here",
-                    # any unmatched chars are now defunct.
-                    unmatchedChars = ""
-                    xmlText += enso.utils.xml_tools.escape_xml( target )
-                    completion += target
-                    unusedSuggestion = unusedSuggestion[index+len(target):]
-                    unusedSource = unusedSource[i:]
-                    # The target was found and unusedSource was
-                    # modified; we exit the for-loop (to be entered
-                    # again if unusedSource is still nonempty).
-                    break
-                # END TARGET-FOUND CONDITION
-                    
-            # Either unusedSource is smaller, or it is the same as
-            # oldUnusedSource.  If it is the same as old unusedSource,
-            # then there was no match of a begining substring, so we
-            # remove the first character and store it as an "unused
-            # character", which will become part of an "altered
-            # substring", if there is a match to a later substring.
-            if unusedSource == oldUnusedSource:
-                unmatchedChars += unusedSource[0]
-                unusedSource = unusedSource[1:]
-
-            assert len( unusedSource ) < len( oldUnusedSource ), \
-                   "Potential infinite loop condition; failed to reduce"\
-                   " the length of the unused portion of the source string"\
-                   " in toXml()"
-        # END SOURCE-STRING LOOP
-        
-        # The source-string loop above only guarantees to use up the
-        # source string; there may be an unused portion of the
-        # suggestion left.  We append it to the xml string as an
-        # insertion (or alteration, if appropriate).
-        if len( unusedSuggestion ) > 0:
-            if len( unmatchedChars ) > 0:
-                format = "<alt>%s</alt>" 
-            else:
-                format = "<ins>%s</ins>"
-            unusedXml = enso.utils.xml_tools.escape_xml( unusedSuggestion )
-            xmlText += format % unusedXml
-
-            completion += unusedSuggestion.split(" ")[0]
-            if unusedSuggestion.find( " " ) > -1:
-                completion += " "
-                
-        # Finally, add the help text, if it exists.
-        if self.__helpText != None:
-            xmlText += "<help>%s</help>" % self.__helpText
-
-        self.__xml = xmlText
-        self.__completion = completion
+        self.__xml, self.__completion = getMarkup( self.__source,
+                                                   self.__suggestion,
+                                                   self.__helpText )
 
 
 class AutoCompletion( Suggestion ):
@@ -414,3 +335,199 @@ class AutoCompletion( Suggestion ):
         # so initialize self as a Suggestion.
         
         Suggestion.__init__( self, originalText, suggestedText, helpText )
+
+
+# ----------------------------------------------------------------------------
+# Functions
+# ----------------------------------------------------------------------------
+
+def selectBestSuggestions( originalText, candidates, maxCount ):
+    """
+    Returns a list of Suggestion objects for the (at most) maxCount
+    candidates that are nearest to originalText, nearest first;
+    candidates that are equally near stay in their original order.
+    This is the same as creating Suggestion objects for every
+    candidate, sorting them, and keeping the first maxCount.
+
+    candidates is an iterable of ( suggestedText, helpText ) tuples.
+    This is done in a single pass, keeping only the best candidates
+    so far in a heap, and Suggestion objects are only created for the
+    candidates that make the cut.
+
+    Example:
+
+      >>> candidates = [ ( 'foo', None ), ( 'fob', None ),
+      ...                ( 'foobar', None ), ( 'fo', 'help' ) ]
+      >>> [ s.toText() for s in selectBestSuggestions( 'fo', candidates, 3 ) ]
+      ['fo', 'foo', 'fob']
+    """
+
+    if maxCount <= 0:
+        return []
+
+    # The heap holds ( nearness, -index, suggestedText, helpText )
+    # tuples, so its smallest element is the worst candidate kept so
+    # far: the least near, and of those, the last one.
+    heap = []
+    index = 0
+    for suggestedText, helpText in candidates:
+        nearness = enso.utils.strings.stringRatio( originalText,
+                                                   suggestedText )
+        if len( heap ) < maxCount:
+            heapq.heappush( heap, ( nearness, -index, suggestedText,
+                                    helpText ) )
+        elif nearness > heap[0][0]:
+            # An equally near candidate never makes the cut, since
+            # it comes after every candidate in the heap.
+            heapq.heapreplace( heap, ( nearness, -index, suggestedText,
+                                       helpText ) )
+        index += 1
+
+    heap.sort()
+    heap.reverse()
+    return [ Suggestion( originalText, suggestedText, helpText )
+             for nearness, negIndex, suggestedText, helpText in heap ]
+
+
+_markupCache = LruCache( MAX_CACHED_MARKUPS )
+
+def getMarkup( originalText, suggestedText, helpText = None ):
+    """
+    Returns an ( xmlText, completion ) tuple for the suggestion of
+    suggestedText for originalText, with the given help text: these
+    are what Suggestion.toXml() and Suggestion.toNextWord() return.
+    Results are cached.
+
+    Example:
+
+      >>> getMarkup( 'fo', 'foo bar', 'help' )
+      ('fo<ins>o bar</ins><help>help</help>', 'foo ')
+    """
+
+    # Equal strings and unicode objects are equal keys, but their
+    # markups are different types, so the types are part of the key.
+    key = ( originalText, suggestedText, helpText, type( originalText ),
+            type( suggestedText ), type( helpText ) )
+    result = _markupCache.get( key )
+    if result == None:
+        result = _makeMarkup( originalText, suggestedText, helpText )
+        _markupCache[key] = result
+    return result
+
+
+def _findMatchingBlocksInPython( source, suggestion ):
+    """
+    Aligns suggestion with source, returning a list of ( sourceIndex,
+    suggestionIndex, length ) tuples, each of which means that
+    source[sourceIndex:sourceIndex+length] was matched to the same
+    text at suggestionIndex in suggestion; see Suggestion.toXml() for
+    a description of the alignment.  This is the pure Python
+    implementation of findMatchingBlocks().
+
+    Each step matches the longest initial substring of what's left of
+    the source to its first occurrence in what's left of the
+    suggestion.  Since every initial substring of one that occurs in
+    the suggestion also occurs in it, the longest one is found by a
+    binary search on its length.
+    """
+
+    blocks = []
+    sourceIndex = 0
+    suggestionIndex = 0
+
+    while sourceIndex < len( source ) and \
+              suggestionIndex < len( suggestion ):
+        unusedSuggestion = suggestion[suggestionIndex:]
+
+        # An initial substring of length low occurs in the unused
+        # suggestion, and none longer than high does.
+        low = 0
+        high = len( source ) - sourceIndex
+        while low < high:
+            middle = ( low + high + 1 ) // 2
+            if source[sourceIndex:sourceIndex+middle] in unusedSuggestion:
+                low = middle
+            else:
+                high = middle - 1
+
+        if low == 0:
+            # Not even the first character occurs in the unused
+            # suggestion, so it's skipped.
+            sourceIndex += 1
+            continue
+
+        target = source[sourceIndex:sourceIndex+low]
+        index = suggestionIndex + unusedSuggestion.find( target )
+        blocks.append( ( sourceIndex, index, low ) )
+        sourceIndex += low
+        suggestionIndex = index + low
+
+    return blocks
+
+
+if _suggestionmarkup != None:
+    findMatchingBlocks = _suggestionmarkup.findMatchingBlocks
+else:
+    findMatchingBlocks = _findMatchingBlocksInPython
+
+
+def _makeMarkup( source, suggestion, helpText ):
+    """
+    Does the actual work of getMarkup().
+    """
+
+    escape = enso.utils.xml_tools.escape_xml
+
+    xmlParts = []
+    completionParts = []
+
+    # The ends of the previous match in the source and the
+    # suggestion.
+    sourceIndex = 0
+    suggestionIndex = 0
+
+    for blockSourceIndex, blockSuggestionIndex, length in \
+            findMatchingBlocks( source, suggestion ):
+        if blockSuggestionIndex > suggestionIndex:
+            if blockSourceIndex > sourceIndex:
+                # There were unmatched characters in the source, and
+                # there are characters in the suggestion before this
+                # match, so the "inserted" portion of the suggestion
+                # becomes an "alteration" instead.
+                xmlFormat = "<alt>%s</alt>"
+            else:
+                xmlFormat = "<ins>%s</ins>"
+            xmlParts.append( xmlFormat % escape(
+                suggestion[suggestionIndex:blockSuggestionIndex]
+                ) )
+            # NOTE: Do not add inserted characters to the 'next word'
+            # completion.
+
+        target = source[blockSourceIndex:blockSourceIndex+length]
+        xmlParts.append( escape( target ) )
+        completionParts.append( target )
+        sourceIndex = blockSourceIndex + length
+        suggestionIndex = blockSuggestionIndex + length
+
+    # The alignment only guarantees to use up the source string;
+    # there may be an unused portion of the suggestion left.  We
+    # append it to the xml string as an insertion (or alteration, if
+    # appropriate).
+    unusedSuggestion = suggestion[suggestionIndex:]
+    if len( unusedSuggestion ) > 0:
+        if sourceIndex < len( source ):
+            xmlFormat = "<alt>%s</alt>"
+        else:
+            xmlFormat = "<ins>%s</ins>"
+        xmlParts.append( xmlFormat % escape( unusedSuggestion ) )
+
+        completionParts.append( unusedSuggestion.split(" ")[0] )
+        if unusedSuggestion.find( " " ) > -1:
+            completionParts.append( " " )
+
+    # Finally, add the help text, if it exists.
+    if helpText != None:
+        xmlParts.append( "<help>%s</help>" % helpText )
+
+    return "".join( xmlParts ), "".join( completionParts )
+
@@ -22,6 +22,11 @@ QUASIMODE_SUGGESTION_DELAY = 0.2
 # The maximum number of suggestions to display in the quasimode.
 QUASIMODE_MAX_SUGGESTIONS = 6
 
+# Whether to draw all the lines of the quasimode into a single
+# window, presented once per redraw, rather than into a window per
+# line.
+QUASIMODE_COMPOSITOR = False
+
 # The minimum number of characters the user must type before the
 # auto-completion mechanism engages.
 QUASIMODE_MIN_AUTOCOMPLETE_CHARS = 2
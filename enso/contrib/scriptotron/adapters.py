@@ -88,6 +88,11 @@ class ArbitraryArgFuncCommand( ArbitraryPostfixFactory, ArgFuncMixin ):
     _generateCommandObj = ArgFuncMixin._generateCommandObj
 
 class BoundedArgFuncCommand( GenericPrefixFactory, ArgFuncMixin ):
+    # Scripts may change valid_args at any time, e.g. from an
+    # on_quasimode_start generator that keeps running while the
+    # quasimode is up, so it's looked at on every query.
+    UPDATE_INTERVAL = 0
+
     def __init__( self, *args, **kwargs ):
         GenericPrefixFactory.__init__( self )
         ArgFuncMixin.__init__( self, *args, **kwargs )
@@ -15,7 +15,9 @@ SCRIPTS_FILE_NAME = ".ensocommands"
 
 class ScriptCommandTracker:
     def __init__( self, commandManager, eventManager ):
-        self._cmdExprs = []
+        # Maps the command expression of each registered command to a
+        # ( signature, command ) pair; see _getSignature().
+        self._commands = {}
         self._cmdMgr = commandManager
         self._genMgr = concurrency.GeneratorManager( eventManager )
         self._qmStartEvents = EventResponderList(
@@ -34,31 +36,84 @@ class ScriptCommandTracker:
         for handler in self._qmStartEvents:
             self._callHandler( handler )
 
-    def _clearCommands( self ):
-        for cmdExpr in self._cmdExprs:
-            self._cmdMgr.unregisterCommand( cmdExpr )
-        self._cmdExprs = []
-        self._qmStartEvents[:] = []
-        self._genMgr.reset()
+    def _getSignature( self, info ):
+        """
+        Returns everything about the command described by info that
+        its adapter depends on, except for the function itself; if
+        this doesn't change when a script is reloaded, the command's
+        adapter can be kept, and just given the new function.
+
+        (Every function is new after a reload, even if its code isn't,
+        since it's bound to the script's new globals.)
+        """
 
-    def _registerCommand( self, cmdObj, cmdExpr ):
+        return ( info["cmdType"], info["cmdName"], info["argName"],
+                 info["desc"], info["help"], info["isArgRequired"] )
+
+    def _registerCommand( self, cmdObj, cmdExpr, signature ):
         try:
             self._cmdMgr.registerCommand( cmdExpr, cmdObj )
-            self._cmdExprs.append( cmdExpr )
+            self._commands[cmdExpr] = ( signature, cmdObj )
         except CommandAlreadyRegisteredError:
             logging.warn( "Command already registered: %s" % cmdExpr )
 
     def registerNewCommands( self, commandInfoList ):
-        self._clearCommands()
+        """
+        Makes the registered commands those described by
+        commandInfoList, only unregistering and registering the
+        commands that were removed, added or changed since the last
+        call.
+        """
+
+        self._qmStartEvents[:] = []
+        self._genMgr.reset()
+
+        infos = {}
         for info in commandInfoList:
             if hasattr( info["func"], "on_quasimode_start" ):
                 self._qmStartEvents.append( info["func"].on_quasimode_start )
+            cmdExpr = info["cmdExpr"]
+            if infos.has_key( cmdExpr ):
+                logging.warn( "Command already registered: %s" % cmdExpr )
+            else:
+                infos[cmdExpr] = info
+
+        # Find the commands that have been removed or changed, and
+        # rebind the unchanged ones to their new functions.
+        oldCmdExprs = []
+        for cmdExpr, ( signature, cmd ) in self._commands.items():
+            info = infos.get( cmdExpr )
+            if info == None or self._getSignature( info ) != signature:
+                oldCmdExprs.append( cmdExpr )
+            else:
+                cmd.func = info["func"]
+                del infos[cmdExpr]
+
+        self._cmdMgr.unregisterCommands( oldCmdExprs )
+        for cmdExpr in oldCmdExprs:
+            del self._commands[cmdExpr]
+
+        # Whatever is left is new.
+        commands = []
+        for cmdExpr, info in infos.items():
             cmd = adapters.makeCommandFromInfo(
                 info,
                 ensoapi.EnsoApi(),
                 self._genMgr
                 )
-            self._registerCommand( cmd, info["cmdExpr"] )
+            commands.append( ( cmdExpr, cmd, self._getSignature( info ) ) )
+
+        try:
+            self._cmdMgr.registerCommands(
+                [ ( cmdExpr, cmd ) for cmdExpr, cmd, signature in commands ]
+                )
+            for cmdExpr, cmd, signature in commands:
+                self._commands[cmdExpr] = ( signature, cmd )
+        except CommandAlreadyRegisteredError:
+            # Nothing was registered; register the commands one at a
+            # time to find out which ones clash.
+            for cmdExpr, cmd, signature in commands:
+                self._registerCommand( cmd, cmdExpr, signature )
 
 class ScriptTracker:
     def __init__( self, eventManager, commandManager ):
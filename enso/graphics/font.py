@@ -49,6 +49,16 @@ from enso import cairo
 from enso.utils.memoize import memoized
 
 
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The characters whose glyphs are loaded, all at once, as soon as a
+# font is created: printable ASCII and Latin-1.
+PREFETCHED_CHARS = u"".join( [ unichr( i ) for i in range( 0x20, 0x7f ) +
+                               range( 0xa0, 0x100 ) ] )
+
+
 # ----------------------------------------------------------------------------
 # Fonts
 # ----------------------------------------------------------------------------
@@ -92,11 +102,16 @@ class Font:
           self.height,
           self.maxXAdvance,
           self.maxYAdvance ) = self.cairoContext.font_extents()
+
+        # The glyphs of the font that have been loaded so far, keyed
+        # by character.
+        self.__glyphs = {}
+        self.__prefetchGlyphs( PREFETCHED_CHARS )
         
         self.cairoContext.restore()
 
     @classmethod
-    @memoized
+    @memoized( maxsize = 64 )
     def get( cls, name, size, isItalic ):
         """
         Retrieves the Font object with the given properties.
@@ -107,24 +122,38 @@ class Font:
 
         return cls( name, size, isItalic )
 
-    @memoized
     def getGlyph( self, char ):
         """
         Returns a glyph of the font corresponding to the given Unicode
         character.
         """
 
-        return FontGlyph( char, self, self.cairoContext )
+        glyph = self.__glyphs.get( char )
+        if glyph == None:
+            glyph = FontGlyph( char, self, self.cairoContext )
+            self.__glyphs[char] = glyph
+        return glyph
 
-    def getKerningDistance( self, charLeft, charRight ):
+    def __prefetchGlyphs( self, chars ):
         """
-        Returns the kerning distance (in points) between the two
-        Unicode characters for this font face.
+        Loads the glyphs of all the given characters with a single
+        call to cairo, if the cairo bindings support it; the font
+        must be loaded into the font's cairo context.
         """
 
-        # LONGTERM TODO: Get this to work. This may involve modifying
-        # the source code of Cairo.
-        return 0.0
+        scaledFont = _getScaledFont( self.cairoContext )
+        if not hasattr( scaledFont, "glyph_metrics" ):
+            return
+
+        allMetrics = scaledFont.glyph_metrics( chars.encode( "UTF-8" ) )
+        if len( allMetrics ) != len( chars ):
+            # Some character doesn't map to exactly one glyph, so we
+            # can't tell which metrics belong to which character.
+            return
+
+        for char, metrics in zip( chars, allMetrics ):
+            self.__glyphs[char] = FontGlyph( char, self, self.cairoContext,
+                                             metrics )
 
     def loadInto( self, cairoContext ):
         """
@@ -161,11 +190,15 @@ class FontGlyph:
     Encapsulates a glyph of a font face.
     """
     
-    def __init__( self, char, font, cairoContext ):
+    def __init__( self, char, font, cairoContext, metrics = None ):
         """
         Creates the font glyph corresponding to the given Unicode
         character, using the font specified by the given Font object
         and the given cairo context.
+
+        If given, metrics is the ( index, xBearing, yBearing, width,
+        height, xAdvance, yAdvance ) tuple of the glyph, as returned
+        by ScaledFont.glyph_metrics(); otherwise, it is looked up.
         """
         
         # Encode the character to UTF-8 because that's what the cairo
@@ -174,18 +207,24 @@ class FontGlyph:
         self.char = char
         self.font = font
 
-        cairoContext.save()
-        
-        self.font.loadInto( cairoContext )
+        if metrics == None:
+            cairoContext.save()
+            self.font.loadInto( cairoContext )
+            metrics = _getGlyphMetrics( cairoContext, self.charAsUtf8 )
+            cairoContext.restore()
 
         # Make our font glyph metrics information visible to the client.
 
-        ( xBearing,
+        # The index of the glyph in the font, which lets a run of
+        # glyphs be drawn with a single call to show_glyphs(), or None
+        # if it isn't known.
+        ( self.index,
+          xBearing,
           yBearing,
           width,
           height,
           xAdvance,
-          yAdvance ) = cairoContext.text_extents( self.charAsUtf8 )
+          yAdvance ) = metrics
 
         # The xMin, xMax, yMin, yMax, and advance attributes are used
         # here to correspond to their values in this image:
@@ -196,5 +235,59 @@ class FontGlyph:
         self.yMin = -yBearing + height
         self.yMax = -yBearing
         self.advance = xAdvance
-        
-        cairoContext.restore()
+
+
+def _getScaledFont( cairoContext ):
+    """
+    Returns the scaled font currently used by the given cairo
+    context.
+    """
+
+    if hasattr( cairoContext, "get_scaled_font" ):
+        return cairoContext.get_scaled_font()
+
+    # Versions of cairo before 1.4 don't provide the scaled font, but
+    # it can be recreated from the context's settings.
+    return cairo.ScaledFont( cairoContext.get_font_face(),
+                             cairoContext.get_font_matrix(),
+                             cairoContext.get_matrix(),
+                             cairoContext.get_font_options() )
+
+
+def _getGlyphMetrics( cairoContext, charAsUtf8 ):
+    """
+    Returns the ( index, xBearing, yBearing, width, height, xAdvance,
+    yAdvance ) tuple of the glyph that the given UTF-8 encoded
+    character maps to in the current font of the given cairo context;
+    index is None if it can't be determined.
+    """
+
+    scaledFont = _getScaledFont( cairoContext )
+    if hasattr( scaledFont, "glyph_metrics" ):
+        allMetrics = scaledFont.glyph_metrics( charAsUtf8 )
+        if len( allMetrics ) == 1:
+            return allMetrics[0]
+
+    extents = cairoContext.text_extents( charAsUtf8 )
+    return ( _getGlyphIndex( scaledFont, charAsUtf8 ), ) + tuple( extents )
+
+
+def _getGlyphIndex( scaledFont, charAsUtf8 ):
+    """
+    Returns the index of the single glyph that the given UTF-8
+    encoded character maps to in the given scaled font, or None if
+    that can't be determined.
+    """
+
+    # Looking up glyph indices this way requires cairo 1.8 or later,
+    # and a version of pycairo that exposes it.
+    if not hasattr( scaledFont, "text_to_glyphs" ):
+        return None
+
+    glyphs = scaledFont.text_to_glyphs( 0, 0, charAsUtf8, False )
+    if len( glyphs ) != 1:
+        return None
+    index, x, y = glyphs[0]
+    if x != 0 or y != 0:
+        return None
+    return index
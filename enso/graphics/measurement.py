@@ -134,7 +134,7 @@ def convertUserSpaceToPoints( cairoContext ):
     scaleFactor = getPixelsPerInch() / 72.0
     cairoContext.scale( scaleFactor, scaleFactor )
 
-@memoized
+@memoized( maxsize = 512, policy = "clock" )
 def strToPoints( unitsStr ):
     """
     Converts from a string such as '2pt', '3in', '5pc', or '20px' into
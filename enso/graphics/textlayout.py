@@ -51,8 +51,24 @@
     on this can be found here:
 
       http://freetype.sourceforge.net/freetype2/docs/glyphs/index.html
+
+    Breaking the glyphs of a Block into lines is done natively by the
+    _linebreaker extension module if it's available; the Block then
+    keeps its glyphs in a single list, and each of its Lines refers
+    to a range of that list.
 """
 
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import array
+
+try:
+    from enso.graphics import _linebreaker
+except ImportError:
+    _linebreaker = None
+
 # ----------------------------------------------------------------------------
 # The Document Element
 # ----------------------------------------------------------------------------
@@ -150,8 +166,9 @@ class Block:
         self.maxLines = maxLines
         self.ellipsify = ellipsify
 
-        # Temporary list of glyphs that need to be laid out into
-        # lines.
+        # List of glyphs in the block; once the block is laid out,
+        # each of its lines is a range of this list, and the block's
+        # ellipsis glyph is appended to it if it's needed.
         self.__glyphs = []
 
         # List of lines in the block.
@@ -180,134 +197,87 @@ class Block:
         
         self.__glyphs.extend( glyphs )
 
-    def __addLine( self, line, isPartialLine = False ):
-        """
-        Private method that adds the given line to the block.
-        'isPartialLine' should be set to true if the line being added
-        is not full--i.e., if the line doesn't have enough characters
-        on it that it needs to be word-wrapped.
-        """
-        
-        if isPartialLine and self.textAlign == "justify":
-            # A partial line (e.g., the last line) of justified text
-            # shouldn't be justified (or else it'll be "force
-            # justify".
-            alignment = "left"
-        else:
-            alignment = self.textAlign
-        line.layout( alignment, self.width, self.lineHeight )
-        self.lines.append( line )
-
     def layout( self ):
         """
         Lays out the block. This method should be called before the
         block is drawn, yet after all glyphs have been added to the
         block.
         """
-        
-        currLineLength = 0
-        currWordStartIndex = 0
-        currWordLength = 0
-        currLine = Line()
-        for i in range( len(self.__glyphs) ):
-            assert( currLineLength >= currWordLength )
-
-            glyph = self.__glyphs[i]
-            advance = glyph.fontGlyph.advance
-
-            if currLineLength + advance > self.width:
-                # If we don't have *any* characters on this line yet,
-                # that means the glyph advance is greater than this
-                # block's width--we're in big trouble!
-                if currLineLength == 0:
-                    raise GlyphWiderThanBlockError(glyph)
-
-                # Time to make a new line.
-
-                if len( self.lines ) == self.maxLines-1:
-                    # We've hit the max # of lines!
-                    if not self.ellipsify:
-                        raise MaxLinesExceededError()
-                    else:
-                        # We'll put an ellipsis at the end of this
-                        # line and then break out of this loop,
-                        # ignoring the rest of the glyphs.
-                        currLine.addGlyphs(
-                            self.__glyphs[currWordStartIndex:i]
-                            )
-                        currWordLength = 0
-                        currLine.ellipsify( self.ellipsisGlyph,
-                                            self.width )
-                        break
-
-                # Determine whether our current line has a word in it.
-                currLineHasWord = (currLineLength != currWordLength)
-
-                # If our current line has no words in it, just add
-                # what we've got so far (not including the glyph we're
-                # looking at) and count it as a "word".
-                
-                # Alternatively, if this character is whitespace, then
-                # we're at the end of a word; we'll effectively
-                # replace the whitespace with a newline.
-                if not currLineHasWord or glyph.isWhitespace:
-                    currLine.addGlyphs(
-                        self.__glyphs[currWordStartIndex:i]
-                        )
-
-                    # If the current character we're looking at is
-                    # whitespace, pretend it doesn't exist because
-                    # we're at the end of a line.
-                    if glyph.isWhitespace:
-                        currWordStartIndex = i+1
-                        currWordLength = 0
-                    else:
-                        currWordStartIndex = i
-                        currWordLength = advance
-                else:
-                    # This character is part of a word.
-                    currWordLength += advance
-
-                # Now, create a new line.
-                self.__addLine( currLine )
-                currLineLength = currWordLength
-                currLine = Line()
-            elif glyph.isWhitespace:
-                # We've reached the end of our word, and the beginning
-                # of another.  Add this word, including this
-                # whitespace character, to the current line.
-                currLine.addGlyphs(
-                    self.__glyphs[currWordStartIndex:i+1]
-                    )
-                currLineLength += advance
-                currWordStartIndex = i+1
-                currWordLength = 0
-            else:
-                # We're still building a word.
-                currLineLength += advance
-                currWordLength += advance
 
-            assert( currLineLength >= currWordLength )
+        glyphs = self.__glyphs
+        status, badGlyph, lineSpans, positions = self.__breakLines(
+            [ glyph.fontGlyph.advance for glyph in glyphs ],
+            [ glyph.isWhitespace for glyph in glyphs ]
+            )
+        if status == LINE_BREAK_GLYPH_TOO_WIDE:
+            if badGlyph == len( glyphs ):
+                raise GlyphWiderThanBlockError( self.ellipsisGlyph )
+            raise GlyphWiderThanBlockError( glyphs[badGlyph] )
+        elif status == LINE_BREAK_TOO_MANY_LINES:
+            raise MaxLinesExceededError()
 
-        assert( currLineLength >= currWordLength )
+        if lineSpans and lineSpans[-1][3]:
+            # The ellipsis goes at the end of the last line; its
+            # position is the last one.
+            glyphs.append( self.ellipsisGlyph )
 
-        # Now that we're done looking through all the glyphs, we can
-        # safely add the last remaining word to the current line.
-        if currWordLength > 0:
-            currLine.addGlyphs(
-                self.__glyphs[currWordStartIndex:]
-                )
-
-        # If our current (i.e., last) line has anything on it, we're
-        # going to add it to the block.
-        if currLineLength > 0:
-            self.__addLine( currLine, isPartialLine = True )
+        self.lines = []
+        for start, end, isPartialLine, hasEllipsis in lineSpans:
+            if isPartialLine and self.textAlign == "justify":
+                # A partial line (e.g., the last line) of justified
+                # text shouldn't be justified (or else it'll be
+                # "force justify".
+                alignment = "left"
+            else:
+                alignment = self.textAlign
+            line = Line( glyphs, positions, start, end, hasEllipsis )
+            line.layout( alignment, self.width, self.lineHeight )
+            self.lines.append( line )
 
-        self.__glyphs = None
         self.height = self.marginTop + \
                       self.lineHeight * len(self.lines) + \
                       self.marginBottom
 
+    def measure( self, advances, isWhitespace ):
+        """
+        Returns the height that the block would have if glyphs with
+        the given advances and whitespace flags were added to it and
+        it were laid out, or None if laying it out would raise an
+        exception (e.g., a MaxLinesExceededError).
+
+        This is much faster than laying out the block, since it
+        doesn't need any Glyph objects, and no Line objects are made;
+        the block itself is left untouched.
+        """
+
+        status, badGlyph, lineSpans, positions = self.__breakLines(
+            advances, isWhitespace
+            )
+        if status != LINE_BREAK_OK:
+            return None
+        return self.marginTop + \
+               self.lineHeight * len(lineSpans) + \
+               self.marginBottom
+
+    def __breakLines( self, advances, isWhitespace ):
+        """
+        Breaks glyphs with the given advances and whitespace flags
+        (given as lists) into lines, using breakLines() with the
+        block's style, and returns its result.
+        """
+
+        if self.ellipsify and self.ellipsisGlyph != None:
+            ellipsisAdvance = self.ellipsisGlyph.fontGlyph.advance
+        else:
+            ellipsisAdvance = 0.0
+
+        return breakLines( array.array( "d", advances ),
+                           array.array( "B", isWhitespace ),
+                           self.width,
+                           self.maxLines,
+                           self.ellipsify,
+                           ellipsisAdvance )
+
     def draw( self, x, y, cairoContext ):
         """
         Draws the block with its upper-left corner at the given
@@ -337,6 +307,176 @@ class MaxLinesExceededError( Exception ):
     pass
 
 
+# ----------------------------------------------------------------------------
+# Line Breaking
+# ----------------------------------------------------------------------------
+
+# Possible statuses returned by breakLines(); these are the same as
+# the LineBreakStatus values of the _linebreaker extension module.
+LINE_BREAK_OK = 0
+LINE_BREAK_GLYPH_TOO_WIDE = 1
+LINE_BREAK_TOO_MANY_LINES = 2
+
+def _breakLinesInPython( advances, isWhitespace, width, maxLines,
+                         ellipsify, ellipsisAdvance ):
+    """
+    Breaks glyphs into lines no wider than the given width, given the
+    advance of each glyph as an array of doubles and whether each of
+    them is breaking whitespace as an array of bytes.
+
+    If maxLines is positive, at most that many lines are made: if
+    ellipsify is true, the last of them is truncated to make room for
+    an ellipsis with the given advance, and the rest of the glyphs
+    are dropped; otherwise, LINE_BREAK_TOO_MANY_LINES is returned.
+
+    Returns a ( status, badGlyph, lines, positions ) tuple.  If
+    status is LINE_BREAK_GLYPH_TOO_WIDE, badGlyph is the index of the
+    glyph that doesn't fit, which is the number of glyphs for the
+    ellipsis.  If status is LINE_BREAK_OK, lines is a list of
+    ( start, end, isPartial, hasEllipsis ) tuples, where a line is
+    made of the glyphs from start up to (but not including) end,
+    isPartial is whether the line wasn't word-wrapped, and
+    hasEllipsis is whether the ellipsis follows it; positions[i] is
+    the x-position of glyph i relative to the start of its line, and
+    the ellipsis' position comes last.
+
+    This is the pure Python implementation of breakLines().
+    """
+
+    numGlyphs = len( advances )
+    positions = [ 0.0 ] * ( numGlyphs + 1 )
+    lines = []
+
+    # The glyphs of the current line are those from lineStart up to
+    # (but not including) lineEnd, and are followed by those of the
+    # current word, which haven't been added to the line yet.
+    lineStart = 0
+    lineEnd = 0
+    cursorPos = 0.0
+    currLineLength = 0
+    currWordLength = 0
+    hasEllipsis = False
+    for i in range( numGlyphs ):
+        advance = advances[i]
+
+        if currLineLength + advance > width:
+            # If we don't have *any* characters on this line yet,
+            # that means the glyph advance is greater than the
+            # width--we're in big trouble!
+            if currLineLength == 0:
+                return ( LINE_BREAK_GLYPH_TOO_WIDE, i, [], [] )
+
+            # Time to make a new line.
+
+            if len( lines ) == maxLines-1:
+                # We've hit the max # of lines!
+                if not ellipsify:
+                    return ( LINE_BREAK_TOO_MANY_LINES, 0, [], [] )
+
+                # We'll put an ellipsis at the end of this line,
+                # removing glyphs until there's enough room for it,
+                # and then break out of this loop, ignoring the rest
+                # of the glyphs.
+                for j in range( lineEnd, i ):
+                    positions[j] = cursorPos
+                    cursorPos += advances[j]
+                lineEnd = i
+                currWordLength = 0
+                while cursorPos + ellipsisAdvance > width:
+                    if lineEnd == lineStart:
+                        return ( LINE_BREAK_GLYPH_TOO_WIDE, numGlyphs,
+                                 [], [] )
+                    lineEnd -= 1
+                    cursorPos = positions[lineEnd]
+                positions[numGlyphs] = cursorPos
+                hasEllipsis = True
+                break
+
+            # If our current line has no words in it besides the
+            # current one, just add what we've got so far (not
+            # including the glyph we're looking at) and count it as
+            # a "word".
+
+            # Alternatively, if this character is whitespace, then
+            # we're at the end of a word; we'll effectively replace
+            # the whitespace with a newline.
+            nextLineStart = lineEnd
+            if currLineLength == currWordLength or isWhitespace[i]:
+                for j in range( lineEnd, i ):
+                    positions[j] = cursorPos
+                    cursorPos += advances[j]
+                lineEnd = i
+
+                # If the current character we're looking at is
+                # whitespace, pretend it doesn't exist because we're
+                # at the end of a line.
+                if isWhitespace[i]:
+                    nextLineStart = i+1
+                    currWordLength = 0
+                else:
+                    nextLineStart = i
+                    currWordLength = advance
+            else:
+                # This character is part of a word.
+                currWordLength += advance
+
+            # Now, create a new line.
+            lines.append( _makeLineSpan( lineStart, lineEnd, False, False,
+                                         isWhitespace ) )
+            currLineLength = currWordLength
+            lineStart = nextLineStart
+            lineEnd = nextLineStart
+            cursorPos = 0.0
+        elif isWhitespace[i]:
+            # We've reached the end of our word, and the beginning
+            # of another.  Add this word, including this whitespace
+            # character, to the current line.
+            for j in range( lineEnd, i+1 ):
+                positions[j] = cursorPos
+                cursorPos += advances[j]
+            lineEnd = i+1
+            currLineLength += advance
+            currWordLength = 0
+        else:
+            # We're still building a word.
+            currLineLength += advance
+            currWordLength += advance
+
+    # Now that we're done looking through all the glyphs, we can
+    # safely add the last remaining word to the current line.
+    if currWordLength > 0:
+        for j in range( lineEnd, numGlyphs ):
+            positions[j] = cursorPos
+            cursorPos += advances[j]
+        lineEnd = numGlyphs
+
+    # If our current (i.e., last) line has anything on it, we're
+    # going to add it to the block.
+    if currLineLength > 0:
+        lines.append( _makeLineSpan( lineStart, lineEnd, True, hasEllipsis,
+                                     isWhitespace ) )
+
+    return ( LINE_BREAK_OK, 0, lines, positions )
+
+
+def _makeLineSpan( start, end, isPartial, hasEllipsis, isWhitespace ):
+    """
+    Returns the ( start, end, isPartial, hasEllipsis ) tuple for a
+    line made of the glyphs from start up to (but not including)
+    end, cutting off its trailing whitespace glyph, if it exists.
+    """
+
+    if not hasEllipsis and end - start > 1 and isWhitespace[end-1]:
+        end -= 1
+    return ( start, end, isPartial, hasEllipsis )
+
+
+if _linebreaker != None:
+    breakLines = _linebreaker.breakLines
+else:
+    breakLines = _breakLinesInPython
+
+
 # ----------------------------------------------------------------------------
 # The Line Element
 # ----------------------------------------------------------------------------
@@ -350,16 +490,23 @@ class Line:
     'CSS Pocket Reference', 2nd edition, pgs. 12-13.
     """
     
-    def __init__( self ):
+    def __init__( self, glyphs, positions, start, end, hasEllipsis ):
         """
-        Creates an empty line.
+        Creates a line made of the glyphs from start up to (but not
+        including) end in the given list of glyphs, which is shared
+        with the line's block; positions is the list of the
+        x-positions of those glyphs relative to the start of their
+        line.  If hasEllipsis is true, the line is followed by the
+        last glyph of the list, which is an ellipsis.
         """
         
-        self.glyphs = []
+        self.__glyphs = glyphs
+        self.__positions = positions
 
-        # Current cursor position at which next glyph will be placed
-        # on line.
-        self.__cursorPos = 0.0
+        # Indices of the line's glyphs in the list of glyphs.
+        self.__indices = range( start, end )
+        if hasEllipsis:
+            self.__indices.append( len( glyphs ) - 1 )
 
         # X-offset for alignment (left, right, centered, etc.).
         self.__alignOfs = 0.0
@@ -392,8 +539,8 @@ class Line:
 
     def layout( self, alignment, width, lineHeight ):
         """
-        Lays out the glyphs on the line; this should be called after
-        adding all glyphs to the line, but before drawing it.
+        Lays out the glyphs on the line; this should be called before
+        drawing it.
 
         Takes as parameters the alignment of the line ('left',
         'right', 'center', or 'justify'), the width of the line in
@@ -403,10 +550,9 @@ class Line:
         # Local variables xMin, xMax, yMin, and yMax are used here to
         # correspond to their values in this image:
         # http://freetype.sourceforge.net/freetype2/docs/glyphs/Image3.png
-        
-        # Cut off a trailing whitespace character, if it exists.
-        if len( self.glyphs ) > 1 and self.glyphs[-1].isWhitespace:
-            self.glyphs = self.glyphs[:-1]
+
+        glyphs = self.__glyphs
+        positions = self.__positions
 
         # Determine our bounding box.
         INFINITY = 999999999
@@ -418,11 +564,12 @@ class Line:
 
         # Calculate the line's bounding box relative to the baseline
         # origin of the line.
-        for glyph in self.glyphs:
-            glyphXMin = glyph.pos + glyph.fontGlyph.xMin
-            glyphXMax = glyph.pos + glyph.fontGlyph.xMax
-            glyphYMin = glyph.fontGlyph.yMin
-            glyphYMax = glyph.fontGlyph.yMax
+        for i in self.__indices:
+            fontGlyph = glyphs[i].fontGlyph
+            glyphXMin = positions[i] + fontGlyph.xMin
+            glyphXMax = positions[i] + fontGlyph.xMax
+            glyphYMin = fontGlyph.yMin
+            glyphYMax = fontGlyph.yMax
 
             if glyphXMin < xMin:
                 xMin = glyphXMin
@@ -446,8 +593,8 @@ class Line:
             # Next, figure out how much extra padding we need per
             # space character.
             spaceCount = 0
-            for glyph in self.glyphs:
-                if glyph.isWhitespace:
+            for i in self.__indices:
+                if glyphs[i].isWhitespace:
                     spaceCount += 1
             if spaceCount == 0:
                 # No spaces in this line!  We'll just have to
@@ -461,8 +608,8 @@ class Line:
             raise InvalidAlignmentError( alignment )
 
         # Determine some line metrics information.
-        self.ascent = max( [glyph.font.ascent for glyph in self.glyphs] )
-        self.descent = max( [glyph.font.descent for glyph in self.glyphs] )
+        self.ascent = max( [glyphs[i].font.ascent for i in self.__indices] )
+        self.descent = max( [glyphs[i].font.descent for i in self.__indices] )
 
         self.lineHeight = lineHeight
         self.externalLeading = ( self.lineHeight -
@@ -478,81 +625,65 @@ class Line:
         self.xMax = xMax + self.__alignOfs
         self.yMax = -yMin + self.distanceToBaseline
 
-    def addGlyphs( self, glyphs ):
-        """
-        Adds the given glyphs to the end of the line.
-        """
-        
-        if len( self.glyphs ) > 0:
-            lastGlyph = self.glyphs[-1]
-        else:
-            lastGlyph = None
-
-        for glyph in glyphs:
-            if lastGlyph:
-                # Perform kerning, if possible.
-                if ( glyph.font == lastGlyph.font ):
-                    kernDist = glyph.font.getKerningDistance(
-                        lastGlyph.char, glyph.char
-                        )
-                    self.__cursorPos += kernDist
-            glyph.pos = self.__cursorPos
-            self.__cursorPos += glyph.fontGlyph.advance
-            lastGlyph = glyph
-        self.glyphs.extend( glyphs )
-
-    def removeGlyph( self ):
-        """
-        Removes the last glyph from the line.
-        """
-
-        removedGlyph = self.glyphs.pop()
-        self.__cursorPos = removedGlyph.pos
-
-    def ellipsify( self, ellipsisGlyph, maxWidth ):
-        """
-        'Ellipsifies' this line by removing its current glyphs until
-        this line with the given ellipsis glyph appended is shorter
-        than the given maximum width.  Then, the ellipsis glyph is
-        appended to the line.
-        """
-        
-        ellipsisWidth = ellipsisGlyph.fontGlyph.advance
-
-        # Remove glyphs (if necessary) until there's enough room on
-        # this line for an ellipsis.
-        while self.__cursorPos + ellipsisWidth > maxWidth:
-            self.removeGlyph()
-
-        # Add the ellipsis to the end of this line.
-        self.addGlyphs( [ellipsisGlyph] )
-
     def draw( self, x, y, cairoContext ):
         """
         Draws the line to the given cairo context so that the top-left
         of the line's line box is at the given coordinates, in points.
+
+        Consecutive glyphs with the same font and color are drawn as
+        a single run, with one call to show_glyphs() if their glyph
+        indices are known.
         """
         
+        glyphs = self.__glyphs
+        positions = self.__positions
         y += self.distanceToBaseline
         spaceOfs = 0.0
         glyphX = 0.0
         currFont = None
-        for glyph in self.glyphs:
+        run = []
+        for i in self.__indices:
+            glyph = glyphs[i]
             glyphX = spaceOfs + \
                      self.__alignOfs + \
                      x + \
-                     glyph.pos
+                     positions[i]
 
             if not glyph.isWhitespace:
-                if currFont != glyph.font:
-                    currFont = glyph.font
-                    currFont.loadInto( cairoContext )
-                cairoContext.set_source_rgba( *glyph.color )
-                cairoContext.move_to( glyphX, y )
-
-                cairoContext.show_text( glyph.charAsUtf8 )
+                if run and ( glyph.font != run[0][0].font or
+                             glyph.color != run[0][0].color ):
+                    currFont = _drawRun( run, y, currFont, cairoContext )
+                    run = []
+                run.append( ( glyph, glyphX ) )
             else:
                 spaceOfs += self.__ofsPerSpace
+        if run:
+            _drawRun( run, y, currFont, cairoContext )
+
+
+def _drawRun( run, y, currFont, cairoContext ):
+    """
+    Draws a run of glyphs with the same font and color, given as a
+    list of ( glyph, x ) tuples, on the baseline at y; currFont is
+    the font currently loaded into the cairo context.  Returns the
+    font loaded into the cairo context afterwards.
+    """
+
+    firstGlyph = run[0][0]
+    if currFont != firstGlyph.font:
+        currFont = firstGlyph.font
+        currFont.loadInto( cairoContext )
+    cairoContext.set_source_rgba( *firstGlyph.color )
+
+    if None not in [ glyph.index for glyph, glyphX in run ]:
+        cairoContext.show_glyphs( [ ( glyph.index, glyphX, y )
+                                    for glyph, glyphX in run ] )
+    else:
+        # Some glyph indices aren't known, so draw the glyphs as text.
+        for glyph, glyphX in run:
+            cairoContext.move_to( glyphX, y )
+            cairoContext.show_text( glyph.charAsUtf8 )
+    return currFont
 
 
 class InvalidAlignmentError( Exception ):
@@ -583,12 +714,12 @@ class Glyph:
         
         self.fontGlyph = fontGlyph
         self.color = color
-        self.pos = 0.0
 
         # These are just copies of attributes from fontGlyph to make
         # their lookup easier.
         self.char = fontGlyph.char
         self.charAsUtf8 = fontGlyph.charAsUtf8
+        self.index = fontGlyph.index
         self.font = fontGlyph.font
 
         # Whether this glyph represents valid, breaking whitespace.
@@ -1,3 +1,5 @@
+import math
+
 import enso.providers
 
 from enso.graphics.measurement import pointsToPixels, pixelsToPoints
@@ -29,6 +31,25 @@ class TransparentWindow( object ):
     def update( self ):
         return self._impl.update()
 
+    def updateAnimation( self ):
+        # Present changes to the window's opacity, position and size
+        # only; the surface isn't presented again, so this is cheap
+        # enough to call on every frame of an animation.  If the
+        # surface has been marked dirty since the last update, or the
+        # backend can't change the window's opacity without redrawing
+        # it, this is the same as update().
+        return self._impl.updateAnimation()
+
+    def markDirty( self, x, y, width, height ):
+        # Mark the given rectangle as changed since the last update;
+        # if any rectangles are marked, update() only presents them.
+        # The rectangle is rounded outward to whole pixels.
+        left = int( math.floor( pointsToPixels( x ) ) )
+        top = int( math.floor( pointsToPixels( y ) ) )
+        right = int( math.ceil( pointsToPixels( x + width ) ) )
+        bottom = int( math.ceil( pointsToPixels( y + height ) ) )
+        return self._impl.markDirty( left, top, right - left, bottom - top )
+
     def setOpacity( self, opacity ):
         return self._impl.setOpacity( opacity )
 
@@ -38,20 +38,31 @@
     This module implements a high-level XML-based interface to the
     textlayout module.  It also provides a simple style mechanism that
     is heavily based on the Cascading Style Sheets (CSS) system.
+
+    Markup is parsed natively by the _xmlmarkup extension module if
+    it's available, which understands the simple subset of XML that
+    markup is usually written in; xml.sax is used for anything else.
 """
 
 # ----------------------------------------------------------------------------
 # Imports
 # ----------------------------------------------------------------------------
 
+import itertools
 import xml.sax
 import xml.sax.handler
 
 from enso.utils.memoize import memoized
+from enso.utils.lrucache import LruCache
 from enso.graphics import measurement
 from enso.graphics import textlayout
 from enso.graphics import font
 
+try:
+    from enso.graphics import _xmlmarkup
+except ImportError:
+    _xmlmarkup = None
+
 
 # ----------------------------------------------------------------------------
 # Constants
@@ -61,12 +72,30 @@ from enso.graphics import font
 # hefty file so we'll just define values here.
 NON_BREAKING_SPACE = u"\u00a0"
 
+# The character used to ellipsify blocks.
+ELLIPSIS = u"\u2026"
+
+# The maximum number of markup strings whose StyledRuns are kept by
+# xmlMarkupToDocument(), and the maximum number of distinct contents
+# of style registries that are remembered (see
+# StyleRegistry.getVersion()).
+MAX_CACHED_STYLED_RUNS = 256
+MAX_STYLE_VERSIONS = 256
+
+# Possible statuses returned by _xmlmarkup.parseMarkup(); these are
+# the same as the MarkupStatus values of the extension module.
+MARKUP_OK = 0
+MARKUP_UNKNOWN_ELEMENT = 1
+MARKUP_UNEXPECTED_ELEMENT = 2
+MARKUP_NO_STYLE = 3
+MARKUP_NOT_UNDERSTOOD = 4
+
 
 # ----------------------------------------------------------------------------
 # Utility functions
 # ----------------------------------------------------------------------------
 
-@memoized
+@memoized( maxsize = 256, policy = "clock" )
 def colorHashToRgba( colorHash ):
     """
     Converts the given HTML-style color hash (e.g., '#aabbcc') or
@@ -198,6 +227,10 @@ class StyleRegistry:
         
         self._styleDict = {}
 
+        # The version of the registry's current contents, or None if
+        # it hasn't been determined since they last changed.
+        self._version = None
+
     def __validateKeys( self, dict ):
         """
         Makes sure that the keys of dict are the names of valid style
@@ -240,6 +273,7 @@ class StyleRegistry:
         
         self.__validateKeys( properties )
         self._styleDict[ selector ] = properties
+        self._version = None
 
     def findMatch( self, selector ):
         """
@@ -281,6 +315,48 @@ class StyleRegistry:
 
         self.__validateKeys( properties )
         self._styleDict[ selector ].update( properties )
+        self._version = None
+
+    def getVersion( self ):
+        """
+        Returns the version of the registry's current contents, which
+        can be used as a key for caching anything derived from them.
+
+        Registries with the same contents have the same version, and
+        a registry gets back its old version if its contents are
+        updated back to what they were, so that (for instance)
+        updating the font size of a registry back and forth doesn't
+        invalidate what's been cached.
+
+        Examples:
+
+        >>> styles = StyleRegistry()
+        >>> styles.add( 'document', width = '1000pt' )
+        >>> version = styles.getVersion()
+        >>> styles.update( 'document', width = '500pt' )
+        >>> styles.getVersion() == version
+        False
+        >>> styles.update( 'document', width = '1000pt' )
+        >>> styles.getVersion() == version
+        True
+        """
+
+        if self._version == None:
+            contents = [ ( selector, tuple( sorted( properties.items() ) ) )
+                         for selector, properties in self._styleDict.items() ]
+            contents = tuple( sorted( contents ) )
+            self._version = _styleVersions.get( contents )
+            if self._version == None:
+                self._version = _styleVersionCounter.next()
+                _styleVersions[contents] = self._version
+        return self._version
+
+
+# Maps the contents of style registries to their versions; versions
+# are never reused, so if the contents of a registry are forgotten,
+# they just get a new version the next time they're seen.
+_styleVersions = LruCache( MAX_STYLE_VERSIONS )
+_styleVersionCounter = itertools.count()
         
         
 class InvalidPropertyError( Exception ):
@@ -396,60 +472,90 @@ class CascadingStyleStack:
         
         return self.__stack[-1][propertyName]
 
+    def getDocumentStyle( self ):
+        """
+        Returns the arguments for making a new textlayout.Document
+        with the current style, as a ( width, marginTop, marginBottom )
+        tuple.
+        """
+
+        return ( self._propertyToPoints("width"),
+                 self._propertyToPoints("margin_top"),
+                 self._propertyToPoints("margin_bottom") )
+
     def makeNewDocument( self ):
         """
         Makes a new document with the current style.
         """
 
-        document = textlayout.Document(
-            width = self._propertyToPoints("width"),
-            marginTop = self._propertyToPoints("margin_top"),
-            marginBottom = self._propertyToPoints("margin_bottom"),
-            )
+        return textlayout.Document( *self.getDocumentStyle() )
 
-        return document
+    def getBlockStyle( self ):
+        """
+        Returns the arguments for making a new textlayout.Block with
+        the current style, as a ( width, lineHeight, marginTop,
+        marginBottom, textAlign, maxLines, ellipsify ) tuple.
+        """
+
+        return ( self._propertyToPoints("width"),
+                 self._propertyToPoints("line_height"),
+                 self._propertyToPoints("margin_top"),
+                 self._propertyToPoints("margin_bottom"),
+                 self._property("text_align"),
+                 self._propertyToInt("max_lines"),
+                 self._propertyToBool("ellipsify") )
 
     def makeNewBlock( self ):
         """
         Makes a new block with the current style.
         """
 
-        block = textlayout.Block(
-            width = self._propertyToPoints("width"),
-            lineHeight = self._propertyToPoints("line_height"),
-            marginTop = self._propertyToPoints("margin_top"),
-            marginBottom = self._propertyToPoints("margin_bottom"),
-            textAlign = self._property("text_align"),
-            maxLines = self._propertyToInt("max_lines"),
-            ellipsify = self._propertyToBool("ellipsify")
-            )
-        
-        return block
+        return textlayout.Block( *self.getBlockStyle() )
     
-    def makeNewGlyphs( self, characters ):
+    def getFont( self ):
         """
-        Makes new glyphs with the current style.
+        Returns the font of the current style.
         """
 
-        glyphs = []
-        
-        fontObj = font.Font.get(
+        return font.Font.get(
             self._property( "font_family" ),
             self._propertyToPoints( "font_size" ),
             self._property( "font_style" ) == "italic"
             )
 
-        color = self._propertyToColor( "color" )
+    def getGlyphStyle( self ):
+        """
+        Returns the font and color of glyphs with the current style,
+        as a ( font, color ) tuple.
+        """
 
-        for char in characters:
-            fontGlyph = fontObj.getGlyph( char )
-            glyph = textlayout.Glyph(
-                fontGlyph,
-                color,
-                )
-            glyphs.append( glyph )
+        return ( self.getFont(), self._propertyToColor( "color" ) )
 
-        return glyphs
+    def makeNewGlyphs( self, characters ):
+        """
+        Makes new glyphs with the current style.
+        """
+
+        fontObj, color = self.getGlyphStyle()
+        return _makeGlyphs( characters, fontObj, color )
+
+
+def _makeGlyphs( characters, fontObj, color ):
+    """
+    Makes new glyphs for the given characters, with the given font
+    and color.
+    """
+
+    glyphs = []
+    for char in characters:
+        fontGlyph = fontObj.getGlyph( char )
+        glyph = textlayout.Glyph(
+            fontGlyph,
+            color,
+            )
+        glyphs.append( glyph )
+
+    return glyphs
 
 
 # ----------------------------------------------------------------------------
@@ -531,13 +637,188 @@ class XmlMarkupTagAliases:
         return self._aliases.has_key( name )
 
 
+# ----------------------------------------------------------------------------
+# Styled Markup
+# ----------------------------------------------------------------------------
+
+class StyledMarkup:
+    """
+    The result of parsing XML text layout markup: the text of the
+    markup, along with the styles that apply to each part of it.
+
+    Styles are referred to by their selectors in the style registry,
+    and aren't looked up until the markup is laid out, so the same
+    StyledMarkup can be laid out again after the style registry has
+    been updated (e.g., with a different font size).
+    """
+
+    def __init__( self, documentSelector ):
+        """
+        Creates styled markup for a document with the style of the
+        given selector, and no blocks.
+        """
+
+        self.documentSelector = documentSelector
+
+        # List of ( blockSelector, runs ) tuples, one for each block
+        # of the document.  Each run is a ( selectors, text ) tuple,
+        # where selectors is the tuple of the selectors of the inline
+        # elements that the run's text is in, outermost first.
+        self.blocks = []
+
+    def resolve( self, styleRegistry ):
+        """
+        Looks up the styles of the markup in the given style
+        registry, and returns the resulting StyledRuns.
+        """
+
+        style = CascadingStyleStack()
+        style.push( styleRegistry.findMatch( self.documentSelector ) )
+        styledRuns = StyledRuns( style.getDocumentStyle() )
+
+        for blockSelector, runs in self.blocks:
+            style.push( styleRegistry.findMatch( blockSelector ) )
+            blockStyle = style.getBlockStyle()
+            resolvedRuns = []
+            for text in _iterRuns( runs, style, styleRegistry ):
+                fontObj, color = style.getGlyphStyle()
+                resolvedRuns.append( ( fontObj, color, text ) )
+            ellipsisStyle = style.getGlyphStyle()
+            style.pop()
+
+            styledRuns.blocks.append(
+                ( blockStyle, ellipsisStyle, resolvedRuns )
+                )
+
+        style.pop()
+        return styledRuns
+
+    def toDocument( self, styleRegistry ):
+        """
+        Converts the markup into a textlayout.Document object that
+        has been fully laid out and is ready for rendering, using the
+        given style registry.
+        """
+
+        return self.resolve( styleRegistry ).toDocument()
+
+    def measure( self, styleRegistry ):
+        """
+        Returns the height of the textlayout.Document that
+        toDocument() would make using the given style registry, or
+        None if it would raise an exception because the markup
+        doesn't fit (e.g., if a block would exceed its maximum number
+        of lines).
+
+        This is much faster than toDocument(), since it only needs
+        the advances of the glyphs.
+        """
+
+        return self.resolve( styleRegistry ).measure()
+
+
+class StyledRuns:
+    """
+    StyledMarkup whose styles have been looked up in a style
+    registry: the text of each block, split into runs with the same
+    font and color, along with the style of each block.  A
+    textlayout.Document can be made from it without looking at the
+    style registry anymore.
+    """
+
+    def __init__( self, documentStyle ):
+        """
+        Creates styled runs for a document with the given style (as
+        returned by CascadingStyleStack.getDocumentStyle()), and no
+        blocks.
+        """
+
+        self.documentStyle = documentStyle
+
+        # List of ( blockStyle, ellipsisStyle, runs ) tuples, one for
+        # each block of the document; blockStyle is the block's style
+        # as returned by CascadingStyleStack.getBlockStyle(),
+        # ellipsisStyle is the ( font, color ) of its ellipsis glyph,
+        # and each run is a ( font, color, text ) tuple.
+        self.blocks = []
+
+    def toDocument( self ):
+        """
+        Makes a textlayout.Document object from the runs, which has
+        been fully laid out and is ready for rendering.
+        """
+
+        document = textlayout.Document( *self.documentStyle )
+
+        for blockStyle, ellipsisStyle, runs in self.blocks:
+            block = textlayout.Block( *blockStyle )
+            glyphs = []
+            for fontObj, color, text in runs:
+                glyphs.extend( _makeGlyphs( text, fontObj, color ) )
+            block.setEllipsisGlyph( _makeGlyphs( ELLIPSIS,
+                                                 *ellipsisStyle )[0] )
+            block.addGlyphs( glyphs )
+            document.addBlock( block )
+
+        document.layout()
+        return document
+
+    def measure( self ):
+        """
+        Returns the height of the textlayout.Document that
+        toDocument() would make, or None if it would raise an
+        exception because the runs don't fit (e.g., if a block would
+        exceed its maximum number of lines).
+
+        This is much faster than toDocument(), since it only needs
+        the advances of the glyphs.
+        """
+
+        document = textlayout.Document( *self.documentStyle )
+
+        blocksHeight = 0
+        for blockStyle, ellipsisStyle, runs in self.blocks:
+            block = textlayout.Block( *blockStyle )
+            advances = []
+            isWhitespace = []
+            for fontObj, color, text in runs:
+                for char in text:
+                    advances.append( fontObj.getGlyph( char ).advance )
+                    isWhitespace.append( char == " " )
+            block.setEllipsisGlyph( _makeGlyphs( ELLIPSIS,
+                                                 *ellipsisStyle )[0] )
+
+            blockHeight = block.measure( advances, isWhitespace )
+            if blockHeight == None:
+                return None
+            blocksHeight += blockHeight
+
+        return document.marginTop + blocksHeight + document.marginBottom
+
+
+def _iterRuns( runs, style, styleRegistry ):
+    """
+    Iterates through the text of the given runs, with the style of
+    each run pushed onto the given CascadingStyleStack while its text
+    is being processed.
+    """
+
+    for selectors, text in runs:
+        for selector in selectors:
+            style.push( styleRegistry.findMatch( selector ) )
+        yield text
+        for selector in selectors:
+            style.pop()
+
+
 # ----------------------------------------------------------------------------
 # XML Markup Content Handler
 # ----------------------------------------------------------------------------
 
 class _XmlMarkupHandler( xml.sax.handler.ContentHandler ):
     """
-    XML content handler for XML text layout markup.
+    XML content handler for XML text layout markup, which converts
+    it into StyledMarkup.
     """
     
     def __init__( self, styleRegistry, tagAliases=None ):
@@ -559,34 +840,29 @@ class _XmlMarkupHandler( xml.sax.handler.ContentHandler ):
         document.
         """
         
-        self.style = CascadingStyleStack()
-        self.document = None
-        self.block = None
-        self.glyphs = None
+        self.markup = None
+        self.runs = None
+
+        # Selectors of the currently open inline elements.
+        self.selectors = []
 
-    def _pushStyle( self, name, attrs ):
+    def _findSelector( self, name, attrs ):
         """
-        Sets the current style to the style defined by the "style"
-        attribute of the given tag.  If that style doesn't exist, we
-        use the style named by the tag.
+        Returns the selector of the style of the given tag: the style
+        named by its "style" attribute or, if that style doesn't
+        exist, the style named by the tag.
         """
 
-        styleDict = None
-
         styleAttr = attrs.get( "style", None )
-        if styleAttr:
-            styleDict = self.styleRegistry.findMatch( styleAttr )
-
-        if styleDict == None:
-            styleDict = self.styleRegistry.findMatch( name )
+        if styleAttr and self.styleRegistry.findMatch( styleAttr ) != None:
+            return styleAttr
 
-        if styleDict == None:
+        if self.styleRegistry.findMatch( name ) == None:
             raise ValueError, "No style found for: %s, %s" % (
                 name,
                 str( styleAttr )
                 )
-
-        self.style.push( styleDict )
+        return name
 
     def startElement( self, name, attrs ):
         """
@@ -594,22 +870,30 @@ class _XmlMarkupHandler( xml.sax.handler.ContentHandler ):
         """
         
         if name == "document":
-            self._pushStyle( name, attrs )
-            self.document = self.style.makeNewDocument()
+            if self.markup:
+                raise XmlMarkupUnexpectedElementError(
+                    "Document element encountered inside document element."
+                    )
+            self.markup = StyledMarkup( self._findSelector( name, attrs ) )
         elif name == "block":
-            if not self.document:
+            if not self.markup:
                 raise XmlMarkupUnexpectedElementError(
                     "Block element encountered outside of document element."
                     )
-            self._pushStyle( name, attrs )
-            self.block = self.style.makeNewBlock()
-            self.glyphs = []
+            if self.runs != None:
+                raise XmlMarkupUnexpectedElementError(
+                    "Block element encountered inside block element."
+                    )
+            self.runs = []
+            self.markup.blocks.append(
+                ( self._findSelector( name, attrs ), self.runs )
+                )
         elif name == "inline":
-            if not self.block:
+            if self.runs == None:
                 raise XmlMarkupUnexpectedElementError(
                     "Inline element encountered outside of block element."
                     )
-            self._pushStyle( name, attrs )
+            self.selectors.append( self._findSelector( name, attrs ) )
         elif self.tagAliases.has( name ):
             baseElement = self.tagAliases.get( name )
             self.startElement( baseElement, { "style" : name } )
@@ -622,19 +906,11 @@ class _XmlMarkupHandler( xml.sax.handler.ContentHandler ):
         """
         
         if name == "document":
-            self.style.pop()
-            self.document.layout()
+            pass
         elif name == "block":
-            ellipsisGlyph = self.style.makeNewGlyphs( u"\u2026" )[0]
-            self.block.setEllipsisGlyph( ellipsisGlyph )
-            
-            self.style.pop()
-            self.block.addGlyphs( self.glyphs )
-            self.document.addBlock( self.block )
-            self.block = None
-            self.glyphs = None
+            self.runs = None
         elif name == "inline":
-            self.style.pop()
+            self.selectors.pop()
         else:
             baseElement = self.tagAliases.get( name )
             self.endElement( baseElement )
@@ -644,8 +920,14 @@ class _XmlMarkupHandler( xml.sax.handler.ContentHandler ):
         Handles XML character data.
         """
 
-        if self.glyphs != None:
-            self.glyphs.extend( self.style.makeNewGlyphs(content) )
+        if self.runs != None:
+            selectors = tuple( self.selectors )
+            if self.runs and self.runs[-1][0] == selectors:
+                # The XML parser can split up character data, so
+                # merge it back into a single run.
+                self.runs[-1] = ( selectors, self.runs[-1][1] + content )
+            else:
+                self.runs.append( ( selectors, content ) )
         else:
             # Hopefully, the content is just whitespace...
             content = content.strip()
@@ -684,11 +966,25 @@ class XmlMarkupUnexpectedCharactersError( Exception ):
 # XML Markup to Document Conversion
 # ----------------------------------------------------------------------------
 
-def xmlMarkupToDocument( text, styleRegistry, tagAliases=None ):
+def parseXmlMarkup( text, styleRegistry, tagAliases=None ):
     """
-    Converts the given XML text into a textlayout.Document object that
-    has been fully laid out and is ready for rendering, using the
-    given style registry and tag alises.
+    Converts the given XML text into a StyledMarkup object, using
+    the given style registry and tag aliases.
+
+    Examples:
+
+    >>> styles = StyleRegistry()
+    >>> styles.add( 'document' )
+    >>> styles.add( 'block' )
+    >>> markup = parseXmlMarkup( '<document><block>Fish &amp;  chips'
+    ...                          '</block></document>', styles )
+    >>> markup.blocks
+    [(u'block', [((), u'Fish & chips')])]
+
+    >>> parseXmlMarkup( '<document><blok/></document>', styles )
+    Traceback (most recent call last):
+    ...
+    XmlMarkupUnknownElementError: blok
     """
 
     import re
@@ -702,7 +998,88 @@ def xmlMarkupToDocument( text, styleRegistry, tagAliases=None ):
     # doesn't recognize this one on its own, sadly).
     text = text.replace( "&nbsp;", NON_BREAKING_SPACE )
 
-    xmlMarkupHandler = _XmlMarkupHandler( styleRegistry, tagAliases )
     text = text.encode( "ascii", "xmlcharrefreplace" )
+
+    if _xmlmarkup != None:
+        markup = _parseXmlMarkupNatively( text, styleRegistry, tagAliases )
+        if markup != None:
+            return markup
+
+    xmlMarkupHandler = _XmlMarkupHandler( styleRegistry, tagAliases )
     xml.sax.parseString( text, xmlMarkupHandler )
-    return xmlMarkupHandler.document
+    return xmlMarkupHandler.markup
+
+
+def _parseXmlMarkupNatively( text, styleRegistry, tagAliases ):
+    """
+    Converts the given ASCII XML text into a StyledMarkup object
+    using the _xmlmarkup extension module, raising the same errors
+    as _XmlMarkupHandler would.
+
+    Returns None if the extension module doesn't understand the
+    text, in which case it should be parsed by xml.sax instead.
+    """
+
+    if tagAliases:
+        aliases = tagAliases._aliases
+    else:
+        aliases = {}
+
+    status, value = _xmlmarkup.parseMarkup( text,
+                                            aliases,
+                                            styleRegistry._styleDict )
+
+    if status == MARKUP_OK:
+        documentSelector, blocks = value
+        markup = StyledMarkup( documentSelector )
+        markup.blocks = blocks
+        return markup
+    elif status == MARKUP_UNKNOWN_ELEMENT:
+        raise XmlMarkupUnknownElementError( value )
+    elif status == MARKUP_UNEXPECTED_ELEMENT:
+        raise XmlMarkupUnexpectedElementError( value )
+    elif status == MARKUP_NO_STYLE:
+        name, styleAttr = value
+        raise ValueError, "No style found for: %s, %s" % (
+            name,
+            str( styleAttr )
+            )
+    else:
+        return None
+
+
+def xmlMarkupToDocument( text, styleRegistry, tagAliases=None ):
+    """
+    Converts the given XML text into a textlayout.Document object that
+    has been fully laid out and is ready for rendering, using the
+    given style registry and tag alises.
+
+    The same markup is laid out over and over again (e.g., every time
+    the quasimode is redrawn), so the StyledRuns it's converted to
+    are cached, for as long as the contents of the style registry
+    stay the same; tag aliases are assumed never to change once
+    they've been used.
+    """
+
+    key = ( text, styleRegistry.getVersion(), tagAliases )
+    styledRuns = _styledRunsCache.get( key )
+    if styledRuns == None:
+        markup = parseXmlMarkup( text, styleRegistry, tagAliases )
+        styledRuns = markup.resolve( styleRegistry )
+        _styledRunsCache[key] = styledRuns
+    return styledRuns.toDocument()
+
+
+def getCacheStatistics():
+    """
+    Returns the number of hits and misses of the cache of
+    xmlMarkupToDocument(), and the number of items in it, as a
+    ( hits, misses, size ) tuple.
+    """
+
+    return ( _styledRunsCache.hits,
+             _styledRunsCache.misses,
+             len( _styledRunsCache ) )
+
+
+_styledRunsCache = LruCache( MAX_CACHED_STYLED_RUNS )
@@ -156,7 +156,7 @@ class MiniMessageQueue:
             # The mouse has changed.
             miniWind = self.__visibleMessages[oldIndex]
             miniWind._wind.setOpacity( 255 )
-            miniWind._wind.update()
+            miniWind._wind.updateAnimation()
             self.__hideHelpMessage()
         if newIndex != None:
             miniWind = self.__visibleMessages[newIndex]
@@ -168,7 +168,7 @@ class MiniMessageQueue:
             self.__showHelpMessage( xPos, yPos, rounded )
 
             miniWind._wind.setOpacity( 0 )
-            miniWind._wind.update()
+            miniWind._wind.updateAnimation()
             
         self.__mouseoverIndex = newIndex
 
@@ -289,7 +289,7 @@ class MiniMessageQueue:
         if self.__changingIndex == self.__mouseoverIndex:
             miniWind = self.__visibleMessages[self.__changingIndex]
             miniWind._wind.setOpacity( 255 )
-            miniWind._wind.update()
+            miniWind._wind.updateAnimation()
             self.__hideHelpMessage()
             
         self.__status = self.VANISHING
@@ -371,7 +371,7 @@ class MiniMessageWindow( MessageWindow ):
         xPos, yPos = self.getPos()
         yPos += distance
         self.setPos( xPos, yPos )
-        self._wind.update()
+        self._wind.updateAnimation()
 
     def slideOut( self, distance ):
         if self.isFinishedVanishing:
@@ -387,7 +387,7 @@ class MiniMessageWindow( MessageWindow ):
             height -= distance
         self.setPos( xPos, yPos )
         self.setSize( width, height )
-        self._wind.update()
+        self._wind.updateAnimation()
 
     def fadeIn( self, fraction ):
         currFrac = self._wind.getOpacity() / 255.
@@ -396,7 +396,7 @@ class MiniMessageWindow( MessageWindow ):
             self.isFinishedAppearing = True
             return
         self._wind.setOpacity( int(currFrac*255) )
-        self._wind.update()
+        self._wind.updateAnimation()
 
     def __draw( self, msg, xPos, yPos ):
         width, height = MINI_WIND_SIZE
@@ -428,6 +428,7 @@ class MiniMessageWindow( MessageWindow ):
         cr.fill_preserve()
 
         doc.draw( xPos, yPos, cr )
+        self._wind.markDirty( 0, 0, width, height )
         
             
     def __layout( self, msg, width, height ):
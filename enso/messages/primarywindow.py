@@ -182,7 +182,7 @@ class PrimaryMsgWind( MessageWindow ):
         frac = timeLeft / float(ANIMATION_TIME)
         opacity = int( 255*frac )
         self._wind.setOpacity( opacity )
-        self._wind.update()
+        self._wind.updateAnimation()
 
 
     def waitTick ( self, msPassed ):
@@ -298,50 +298,95 @@ class PrimaryMsgWind( MessageWindow ):
 
         root = "<document>%s</document>"
 
-        for msgSize, capSize in reversed( SCALE[1:] ):
-            try:
-                msgDoc = layoutMessageXml(
-                    xmlMarkup = root % msgText,
+        # The XML is parsed only once, and only the size that's used
+        # is actually laid out.
+        msgXml = root % msgText
+        msgMarkup = parseMessageXml( msgXml )
+        if capText != None:
+            capXml = root % capText
+            capMarkup = parseMessageXml( capXml )
+        else:
+            capXml = None
+            capMarkup = None
+
+        # The larger the text, the less of it fits, so binary search
+        # the scale for the largest size at which it fits.
+        bestIndex = None
+        low = 1
+        high = len( SCALE ) - 1
+        while low <= high:
+            middle = ( low + high ) / 2
+            if self.__textFits( msgMarkup, capMarkup, SCALE[middle],
+                                width, height ):
+                bestIndex = middle
+                low = middle + 1
+            else:
+                high = middle - 1
+
+        if bestIndex != None:
+            msgSize, capSize = SCALE[bestIndex]
+            msgDoc = layoutMessageXml(
+                xmlMarkup = msgXml,
+                width = width,
+                height = height,
+                size = msgSize,
+                parsedMarkup = msgMarkup,
+                )
+            if capText != None:
+                capDoc = layoutMessageXml(
+                    xmlMarkup = capXml,
                     width = width,
-                    height = height,
-                    size = msgSize,
+                    height = height - msgDoc.height,
+                    size = capSize,
+                    parsedMarkup = capMarkup,
                     )
-                if capText != None:
-                    capDoc = layoutMessageXml(
-                        xmlMarkup = root % capText,
-                        width = width,
-                        height = height - msgDoc.height,
-                        size = capSize
-                        )
-                else:
-                    capDoc = None
-                return msgDoc, capDoc
-            except Exception:
-                # TODO: Lookup exact error.
-                pass
+            else:
+                capDoc = None
+            return msgDoc, capDoc
             
         # This time, ellipsify.
         msgSize, capSize = SCALE[0]
         msgDoc = layoutMessageXml(
-            xmlMarkup = root % msgText,
+            xmlMarkup = msgXml,
             width = width,
             height = height * .8,
             size = msgSize,
             ellipsify = "true",
+            parsedMarkup = msgMarkup,
             )
         if capText != None:
             capDoc = layoutMessageXml(
-                xmlMarkup = root % capText,
+                xmlMarkup = capXml,
                 width = width,
                 height = height * .2,
                 size = capSize,
                 ellipsify = "true",
+                parsedMarkup = capMarkup,
                 )
         else:
             capDoc = None
         return msgDoc, capDoc
 
 
+    def __textFits( self, msgMarkup, capMarkup, sizes, width, height ):
+        """
+        Determines whether the parsed message and caption (which can
+        be None) fit in width and height at the given ( msgSize,
+        capSize ) sizes, without laying them out.
+        """
+
+        msgSize, capSize = sizes
+        msgHeight = measureMessageXml( msgMarkup, width, msgSize, height )
+        if msgHeight == None:
+            return False
+        if capMarkup != None:
+            capHeight = measureMessageXml( capMarkup, width, capSize,
+                                           height - msgHeight )
+            if capHeight == None:
+                return False
+        return True
+
+
     def __setupBackground( self, width, height ):
         """
         Given a text region of width and height, sets the size of the
@@ -462,17 +507,11 @@ _tagAliases.add( "caption", baseElement = "block" )
 _tagAliases.add( "command", baseElement = "inline" )
 
 
-def layoutMessageXml( xmlMarkup, width, size, height, ellipsify="false",
-                      raiseLayoutExceptions=False ):
+def _setMessageStyle( width, size, height, ellipsify ):
     """
-    Lays out the xmlMarkup in a block that is width wide.
-
-    if raiseLayoutExceptions is False, then this function will
-    suppress any exceptions raised when parsing xmlMarkup and replace
-    it with a message that tells the end-user that the message was
-    broken, providing the end-user with as much of the original
-    message as possible.  If raiseLayoutExceptions is True, however,
-    any exceptions raised will be passed through to the caller.
+    Updates the master style registry for laying out a message in a
+    block that is width wide and height high, with the given font
+    size.
     """
 
     maxLines = int( height / (size*LINE_SPACING) )
@@ -485,21 +524,93 @@ def layoutMessageXml( xmlMarkup, width, size, height, ellipsify="false",
                     ellipsify = ellipsify,
                     )
 
+
+def _brokenMessageXml( xmlMarkup ):
+    """
+    Returns the XML of a message that tells the end-user that
+    xmlMarkup was broken, providing the end-user with as much of the
+    original message as possible.
+    """
+
+    return "<document><p>%s</p>%s</document>" % \
+           ( escape_xml( xmlMarkup.strip() ),
+             "<caption>from a broken message</caption>" )
+
+
+def parseMessageXml( xmlMarkup ):
+    """
+    Parses xmlMarkup for measureMessageXml() and layoutMessageXml();
+    this can be done once for laying out the same message at several
+    sizes.
+
+    If xmlMarkup can't be parsed, this function logs a warning and
+    parses a message that tells the end-user that the message was
+    broken instead, just like layoutMessageXml() does.
+    """
+
     try:
-        document = xmltextlayout.xmlMarkupToDocument(
+        return xmltextlayout.parseXmlMarkup(
             xmlMarkup,
             _styles,
             _tagAliases
             )
+    except Exception, e:
+        logging.warn( "Could not parse message text %s; got error %s"
+                      % ( xmlMarkup, e ) )
+        return xmltextlayout.parseXmlMarkup(
+            _brokenMessageXml( xmlMarkup ),
+            _styles,
+            _tagAliases
+            )
+
+
+def measureMessageXml( parsedMarkup, width, size, height ):
+    """
+    Returns the height of the document that layoutMessageXml() would
+    make from parsedMarkup (as returned by parseMessageXml()), or
+    None if it doesn't fit in a block that is width wide and height
+    high at the given size.  This is much faster than laying out the
+    document.
+    """
+
+    _setMessageStyle( width, size, height, "false" )
+    return parsedMarkup.measure( _styles )
+
+
+def layoutMessageXml( xmlMarkup, width, size, height, ellipsify="false",
+                      raiseLayoutExceptions=False, parsedMarkup=None ):
+    """
+    Lays out the xmlMarkup in a block that is width wide.
+
+    if raiseLayoutExceptions is False, then this function will
+    suppress any exceptions raised when parsing xmlMarkup and replace
+    it with a message that tells the end-user that the message was
+    broken, providing the end-user with as much of the original
+    message as possible.  If raiseLayoutExceptions is True, however,
+    any exceptions raised will be passed through to the caller.
+
+    If xmlMarkup has already been parsed by parseMessageXml(), the
+    result can be passed as parsedMarkup, so that it isn't parsed
+    again.
+    """
+
+    _setMessageStyle( width, size, height, ellipsify )
+
+    try:
+        if parsedMarkup == None:
+            parsedMarkup = xmltextlayout.parseXmlMarkup(
+                xmlMarkup,
+                _styles,
+                _tagAliases
+                )
+        document = parsedMarkup.toDocument( _styles )
     except Exception, e:
         if raiseLayoutExceptions:
             raise
         logging.warn( "Could not layout message text %s; got error %s"
                       % ( xmlMarkup, e ) )
         document = xmltextlayout.xmlMarkupToDocument(
-            "<document><p>%s</p>%s</document>" %
-                 ( escape_xml( xmlMarkup.strip() ),
-                   "<caption>from a broken message</caption>" ),
+            _brokenMessageXml( xmlMarkup ),
             _styles,
             _tagAliases
             )
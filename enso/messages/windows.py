@@ -169,6 +169,7 @@ class MessageWindow:
         cr = self._context
         cr.set_source_rgba( 0, 0, 0, 0 )
         cr.paint()
+        self._wind.markDirty( 0, 0, *self.__maxSize )
         
     
 def computeWidth( doc ):
@@ -30,6 +30,7 @@ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 """
 
+import array
 import logging
 from time import sleep
 
@@ -37,12 +38,26 @@ import gtk
 import cairo
 
 from enso.events import EventManager
+from enso.utils.damage import DamageRegion
+
+try:
+    from enso.platform.linux import _shapemask
+except ImportError:
+    _shapemask = None
+
+try:
+    from enso.platform.linux import _xshmimage
+except ImportError:
+    _xshmimage = None
 
 # Max opacity as used in Enso core (opacities will be converted to fit in 
 # [0;1] in this backend)
 MAX_OPACITY = 0xff
 # Enable Fake transparency when no the screen isn't composited?
 FAKE_TRANSPARENCY = False
+# Back window surfaces with MIT-SHM images, which the X server reads in place,
+# when the screen isn't composited?
+USE_SHM = True
 
 class TransparentWindow (object):
     '''TransparentWindow object, using a gtk.Window'''
@@ -73,8 +88,15 @@ gtk would do, for instance.'''
             self.__width = maxWidth
             self.__height = maxHeight
             self.__surface = None
+            self.__shm_image = None
             self.__opacity = 0xff
             self.__screen_composited = False
+            self.__shape_pixmap = None
+            self.__shape_mask = None
+            self.__shape_mask_size = None
+            self.__shape_threshold = None
+            self.__damage = DamageRegion ()
+            self.__full_update = True
             self.__eventMgr = EventManager.get ()
 
             self.set_app_paintable (True)
@@ -105,7 +127,13 @@ gtk would do, for instance.'''
         def do_expose_event (self, event):
             '''Handle expose events'''
             if event.window == self.window:
+                if self.__shm_image and not self.__screen_composited \
+                   and not FAKE_TRANSPARENCY \
+                   and self.put_shm_image (event.area):
+                    return
                 cr = self.window.cairo_create ()
+                cr.rectangle (*event.area)
+                cr.clip ()
                 self.draw_surface (cr)
 
         def draw_surface (self, cr):
@@ -117,13 +145,33 @@ gtk would do, for instance.'''
             if self.__surface:
                 cr.set_operator (cairo.OPERATOR_OVER)
                 cr.set_source_surface (self.__surface)
-                if not self.__screen_composited and not FAKE_TRANSPARENCY:
-                    cr.paint ()
-                else:
+                if self.__draws_opacity ():
                     cr.paint_with_alpha (float (self.__opacity) / MAX_OPACITY)
+                else:
+                    cr.paint ()
                 if not self.__screen_composited and FAKE_TRANSPARENCY:
                     self.draw_wallpaper (cr)
 
+        def put_shm_image (self, area):
+            '''Draw the given rectangle of the surface to the window straight
+from its MIT-SHM image ; what's outside the window's current size isn't
+drawn. Return False if the X server couldn't draw it'''
+            x, y, width, height = area
+            width = min (x + width, self.__width) - x
+            height = min (y + height, self.__height) - y
+            if width <= 0 or height <= 0:
+                return True
+            self.__surface.flush ()
+            try:
+                self.__shm_image.put (x, y, width, height)
+            except _xshmimage.error, e:
+                # The surface's pixels are still good, so it's drawn with
+                # Cairo from now on
+                logging.info ("Not using MIT-SHM: %s" % e)
+                self.__shm_image = None
+                return False
+            return True
+
         def draw_wallpaper (self, cr):
             '''Draw wallpaper below surface contents to fake transparency'''
             if not TransparentWindow._impl.__wallpaper_surface:
@@ -177,47 +225,194 @@ falling back to RGB''')
                 logging.warn ('''Switching to fake transparency mode, \
 please use a compositing manager to get proper blending.''')
                 self.__update_wallpaper_surface ()
-
-        def update_shape (self):
-            '''Update the window shape'''
-            pixmap = gtk.gdk.Pixmap (None, self.__width, self.__height, 1)
-            cr = pixmap.cairo_create ()
-            cr.rectangle (0, 0, self.__width, self.__height)
-            cr.clip ()
-            self.draw_surface (cr)
+            if hasattr (self, "set_opacity"):
+                if self.__uses_window_opacity ():
+                    self.set_opacity (float (self.__opacity) / MAX_OPACITY)
+                else:
+                    self.set_opacity (1.0)
+            self.__full_update = True
+
+        def __uses_window_opacity (self):
+            '''Return whether the opacity is the window's own (its
+_NET_WM_WINDOW_OPACITY property, which the compositing manager applies), so
+that changing it doesn't redraw anything'''
+            return self.__screen_composited and hasattr (self, "set_opacity")
+
+        def __draws_opacity (self):
+            '''Return whether the opacity is applied by draw_surface, so that
+changing it redraws the whole window'''
+            if self.__screen_composited:
+                return not self.__uses_window_opacity ()
+            return FAKE_TRANSPARENCY
+
+        def update_shape (self, rects = None):
+            '''Update the window shape, only within the given rectangles if
+any are given (and the window's size hasn't changed since the shape was last
+updated)'''
+            changed = self.__update_shape_mask (rects)
+            if changed is None:
+                pixmap = self.__draw_shape_pixmap (rects)
+            elif changed:
+                pixmap = gtk.gdk.bitmap_create_from_data (
+                    None, self.__shape_mask.tostring (),
+                    self.__maxWidth, self.__maxHeight)
+            else:
+                # The shape is the same as before
+                return
             if hasattr (self, "input_shape_combine_mask"):
                 self.input_shape_combine_mask (None, 0, 0)
                 self.input_shape_combine_mask (pixmap, 0, 0)
             if not self.__screen_composited:
                 self.shape_combine_mask (pixmap, 0, 0)
 
+        def __draw_shape_pixmap (self, rects):
+            '''Draw the window shape onto a 1-bit pixmap with Cairo, only
+within the given rectangles if possible, and return the pixmap'''
+            pixmap = self.__shape_pixmap
+            if rects is None or pixmap is None \
+               or pixmap.get_size () != (self.__width, self.__height):
+                pixmap = gtk.gdk.Pixmap (None, self.__width, self.__height, 1)
+                self.__shape_pixmap = pixmap
+                rects = [(0, 0, self.__width, self.__height)]
+            cr = pixmap.cairo_create ()
+            for rect in rects:
+                cr.rectangle (*rect)
+            cr.clip ()
+            self.draw_surface (cr)
+            return pixmap
+
+        def __get_shape_threshold (self):
+            '''Return the minimum alpha a pixel of the surface must have to
+be part of the window shape, as drawn by draw_surface on a 1-bit surface ;
+that's 256 if no pixel is opaque enough'''
+            if not self.__screen_composited and not FAKE_TRANSPARENCY:
+                return 0x80
+            if self.__opacity == 0:
+                return 0x100
+            if not self.__draws_opacity ():
+                return 0x80
+            return min ((0x80 * MAX_OPACITY + self.__opacity - 1) \
+                            / self.__opacity, 0x100)
+
+        def __update_shape_mask (self, rects):
+            '''Threshold the alpha of the surface into the shape mask with
+the native _shapemask module, only within the given rectangles if possible ;
+return whether the mask changed, or None if the mask can't be computed
+natively.  The mask covers the whole surface, rather than just the window, so
+that it needn't be computed again when the window is resized'''
+            if _shapemask is None or not self.__surface \
+               or not hasattr (self.__surface, "get_data"):
+                return None
+            size = (self.__maxWidth, self.__maxHeight)
+            threshold = self.__get_shape_threshold ()
+            stride = (self.__maxWidth + 7) / 8
+            changed = False
+            if self.__shape_mask_size != size \
+               or self.__shape_threshold != threshold:
+                if self.__shape_mask_size != size:
+                    self.__shape_mask = array.array ("B", [0]) \
+                                        * (stride * self.__maxHeight)
+                    self.__shape_mask_size = size
+                self.__shape_threshold = threshold
+                rects = None
+                changed = True
+            if rects is None:
+                rects = [(0, 0, self.__maxWidth, self.__maxHeight)]
+            self.__surface.flush ()
+            data = self.__surface.get_data ()
+            for x, y, width, height in rects:
+                if _shapemask.updateShapeMask (data,
+                                               self.__surface.get_stride (),
+                                               self.__shape_mask, stride,
+                                               x, y, width, height, threshold):
+                    changed = True
+            return changed
+
         def update (self):
-            '''Queue drawing when Enso core requests it'''
+            '''Queue drawing when Enso core requests it ; only the damaged
+rectangles are redrawn, unless nothing was marked dirty since the last update,
+in which case the whole window is'''
             if self.__surface:
-                self.update_shape ()
-                self.queue_draw ()
+                window_rect = (0, 0, self.__width, self.__height)
+                surface_rect = (0, 0, self.__maxWidth, self.__maxHeight)
+                if self.__full_update or self.__damage.isEmpty ():
+                    self.update_shape ()
+                    self.queue_draw ()
+                else:
+                    # The shape covers what's outside the window too
+                    self.update_shape (self.__damage.getRects (surface_rect))
+                    for rect in self.__damage.getRects (window_rect):
+                        self.queue_draw_area (*rect)
+            self.__damage.clear ()
+            self.__full_update = False
+
+        def updateAnimation (self):
+            '''Present changes to the window opacity, position and size only ;
+they've already been made to the window, and resizing exposes what needs
+drawing, so nothing is redrawn unless something was marked dirty or the
+opacity is drawn by draw_surface'''
+            if self.__full_update or not self.__damage.isEmpty ():
+                self.update ()
+
+        def markDirty (self, x, y, width, height):
+            '''Mark the given rectangle of the surface as changed, so that
+the next update redraws it'''
+            self.__damage.add (x, y, width, height)
 
         def makeCairoSurface (self):
             '''Prepare a Cairo Surface large enough for this window'''
             if not self.__surface:
-                self.__surface = cairo.ImageSurface (cairo.FORMAT_ARGB32,
-                                                     self.__maxWidth,
-                                                     self.__maxHeight)
+                self.__surface = self.__make_shm_surface ()
+                if not self.__surface:
+                    self.__surface = cairo.ImageSurface (cairo.FORMAT_ARGB32,
+                                                         self.__maxWidth,
+                                                         self.__maxHeight)
                 self.update_shape ()
                 self.show ()
             return self.__surface
 
+        def __make_shm_surface (self):
+            '''Make a Cairo Surface whose pixels are in an MIT-SHM image of
+this window, if the surface can be drawn to the window as is (i.e. the screen
+isn't composited) ; return None if it can't be made'''
+            if not USE_SHM or _xshmimage is None \
+               or self.__screen_composited or FAKE_TRANSPARENCY:
+                return None
+            self.realize ()
+            try:
+                image = _xshmimage.ShmImage (self.get_display ().get_name (),
+                                             self.window.xid,
+                                             self.__maxWidth,
+                                             self.__maxHeight)
+                surface = cairo.ImageSurface.create_for_data (
+                    image, cairo.FORMAT_ARGB32, image.width, image.height,
+                    image.stride)
+            except (_xshmimage.error, AttributeError, TypeError), e:
+                logging.info ("Not using MIT-SHM: %s" % e)
+                return None
+            self.__shm_image = image
+            return surface
+
         def setOpacity (self, opacity):
             '''Set window opacity and grab or ungrab the pointer according to
 the opacity level ; this is probably a FIXME cause it looks really ugly and
 might cause bad conflicts or race conditions in the future.'''
+            threshold = self.__get_shape_threshold ()
             self.__opacity = opacity
+            if self.__uses_window_opacity ():
+                self.set_opacity (float (self.__opacity) / MAX_OPACITY)
+            elif self.__draws_opacity ():
+                # The opacity applies to the whole window
+                self.__full_update = True
             # FIXME: I'm not clean
             if self.__opacity == MAX_OPACITY:
                 self.grab_pointer ()
             else:
                 self.ensure_pointer_ungrabbed ()
-            self.update ()
+            if self.__full_update:
+                self.update ()
+            elif self.__get_shape_threshold () != threshold:
+                self.update_shape ()
 
         def getOpacity (self):
             '''Get window opacity'''
@@ -239,10 +434,14 @@ might cause bad conflicts or race conditions in the future.'''
 
         def setSize (self, width, height):
             '''Resize window and update input shape'''
+            if (width, height) == (self.__width, self.__height):
+                return
             self.__width = width
             self.__height = height
             self.resize (self.__width, self.__height)
-            self.update_shape ()
+            # A natively computed shape covers the whole surface already
+            if self.__shape_mask is None:
+                self.update_shape ()
 
         def getWidth (self):
             '''Get window width'''
@@ -266,6 +465,7 @@ and destroy it.'''
             if self.__surface:
                 self.__surface.finish ()
                 self.__surface = None
+            self.__shm_image = None
             self.ensure_pointer_ungrabbed ()
             self.destroy ()
 
@@ -68,6 +68,7 @@ class TransparentWindow( object ):
         self.__height = maxHeight
         self._surface = None
         self.__opacity = 0xff
+        self.__needsDisplay = True
 
         rect = Foundation.NSMakeRect( self.__x,
                                       _convertY( self.__y, self.__height ),
@@ -93,6 +94,21 @@ class TransparentWindow( object ):
         if self._surface:
             self.__wind.makeKeyAndOrderFront_( objc.nil )
             self.__view.setNeedsDisplay_( objc.YES )
+            self.__needsDisplay = False
+
+    def updateAnimation( self ):
+        # The opacity is the window's alpha value, and the window
+        # moves with its contents, so the view needn't be redisplayed
+        # unless it's been drawn to since the last update.
+        if self.__needsDisplay:
+            self.update()
+        elif self._surface:
+            self.__wind.orderFront_( objc.nil )
+
+    def markDirty( self, x, y, width, height ):
+        # The whole view is redisplayed on every update, so all
+        # that's kept track of is whether anything has been drawn.
+        self.__needsDisplay = True
 
     def makeCairoSurface( self ):
         if not self._surface:
@@ -220,6 +220,11 @@ def layoutXmlLine( xml_data, styles, scale ):
     size allowed by scale (a list of font sizes).  If the text will
     not fit even at the smallest size of scale, then ellipsifies
     the text at that size.
+
+    The returned document remembers xml_data and the version of the
+    styles it was laid out with as its xmlData and styleVersion
+    attributes, which (along with the attributes set by
+    QuasimodeLayout) identify what it looks like.
     """
     
     document = None
@@ -253,6 +258,8 @@ def layoutXmlLine( xml_data, styles, scale ):
             )
         usedSize = scale[0]
     document.shrinkOffset = scale[-1] - usedSize
+    document.xmlData = xml_data
+    document.styleVersion = styles.getVersion()
     return document
 
 
@@ -260,30 +267,110 @@ def layoutXmlLine( xml_data, styles, scale ):
 # Layout Classes
 # ----------------------------------------------------------------------------
 
+# The kinds of lines in the quasimode window.
+_DESCRIPTION_LINE = 0
+_AUTOCOMPLETE_LINE = 1
+_SUGGESTION_LINE = 2
+
+
+def _computeWidth( doc ):
+    """
+    Returns the width of the widest line of text in the given
+    document.
+    """
+
+    lines = []
+    for b in doc.blocks:
+        lines.extend( b.lines )
+    if len( lines ) == 0:
+        return 0
+    return max( [ l.xMax for l in lines ] )
+
+
+def _getAppearance( doc ):
+    """
+    Returns a tuple of everything that determines what the given
+    laid out line looks like.
+    """
+
+    return ( doc.xmlData,
+             doc.styleVersion,
+             doc.shrinkOffset,
+             doc.ragWidth,
+             doc.roundUpperRight,
+             doc.roundLowerRight,
+             doc.background )
+
+
 class QuasimodeLayout:
     """
     Class for calculating and storing layout metrics of the quasimode
     window.
+
+    A QuasimodeLayout is meant to be kept from one redraw of the
+    quasimode window to the next: update() only lays out again the
+    lines whose text or styles have changed, and reports which lines
+    look different than they did before.
     """
 
     LINE_XML = "<document><line>%s</line></document>"
     
-    def __init__( self, quasimode ):
+    def __init__( self, quasimode = None ):
+        """
+        Creates a layout with no lines and, if a quasimode is given,
+        computes and stores the layout metrics for it.
+        """
+
+        self.newLines = []
+
+        # The indices of the lines that changed in the last update().
+        self.changedLines = []
+
+        # For each line, the ( xml_data, kind, isActive ) tuple it
+        # was laid out from; see __layoutLine().
+        self.__lineSources = []
+
+        # For each line, its width before its rag was smoothed.
+        self.__baseWidths = []
+
+        if quasimode != None:
+            self.update( quasimode )
+
+    def update( self, quasimode ):
         """
-        Computes and stores the layout metrics for the quasimode.
+        Updates the layout metrics to reflect the current state of
+        the quasimode, and returns the indices of the lines that need
+        to be redrawn, in order.
+
+        A line needs to be redrawn if it's new, or if its text, its
+        styles, its rag width or its rounded corners have changed.
         """
 
-        self.newLines = self.__newCreateLines( quasimode )
+        oldAppearances = [ _getAppearance( l ) for l in self.newLines ]
+
+        # Smoothing the rags and rounding the corners only involves
+        # the widths of the lines, which are remembered, so unlike
+        # laying out the lines themselves, it's cheap enough to
+        # always do for all of them.
+        self.__newCreateLines( quasimode )
+        self.__setBackgroundColors()
         self.__newSmoothRags()
         self.__newRoundCorners()
-        self.__setBackgroundColors()
-        
+
+        self.changedLines = []
+        for i in range( len(self.newLines) ):
+            if i >= len( oldAppearances ) or \
+               _getAppearance( self.newLines[i] ) != oldAppearances[i]:
+                self.changedLines.append( i )
+        return self.changedLines
+
     def __newCreateLines( self, quasimode ):
         """
-        LONGTERM TODO: Document this.
+        Lays out each line whose source has changed since the last
+        update, keeping the existing layouts of the others.
         """
     
-        lines = []
+        sources = []
 
         suggestionList = quasimode.getSuggestionList()
         description = suggestionList.getDescription()
@@ -291,11 +378,9 @@ class QuasimodeLayout:
         suggestions = suggestionList.getSuggestions()
         activeIndex = suggestionList.getActiveIndex()
 
-        lines.append( layoutXmlLine(
-            xml_data = self.LINE_XML % description, 
-            styles = retrieveDescriptionStyles(),
-            scale = DESCRIPTION_SCALE,
-            ) )
+        sources.append( ( self.LINE_XML % description,
+                          _DESCRIPTION_LINE,
+                          False ) )
 
         if len(suggestions[0].toXml()) == 0:
             text = suggestions[0].getSource()
@@ -303,21 +388,51 @@ class QuasimodeLayout:
         else:
             text = suggestions[0].toXml()
 
-        lines.append( layoutXmlLine(
-            xml_data = self.LINE_XML % text,
-            styles = retrieveAutocompleteStyles( active = (activeIndex==0) ),
-            scale = AUTOCOMPLETE_SCALE,
-            ) )
+        sources.append( ( self.LINE_XML % text,
+                          _AUTOCOMPLETE_LINE,
+                          activeIndex==0 ) )
 
         for index in range( 1, len(suggestions) ):
-            isActive = (activeIndex==index)
-            lines.append( layoutXmlLine(
-                xml_data = self.LINE_XML % suggestions[index].toXml(),
-                styles = retrieveSuggestionStyles( active = isActive ),
-                scale = SUGGESTION_SCALE,
-                ) )
-            
-        return lines
+            sources.append( ( self.LINE_XML % suggestions[index].toXml(),
+                              _SUGGESTION_LINE,
+                              activeIndex==index ) )
+
+        lines = []
+        baseWidths = []
+        for i in range( len(sources) ):
+            if i < len( self.__lineSources ) and \
+               sources[i] == self.__lineSources[i]:
+                lines.append( self.newLines[i] )
+                baseWidths.append( self.__baseWidths[i] )
+            else:
+                line = self.__layoutLine( *sources[i] )
+                lines.append( line )
+                baseWidths.append( _computeWidth( line ) )
+
+        self.newLines = lines
+        self.__lineSources = sources
+        self.__baseWidths = baseWidths
+
+    def __layoutLine( self, xml_data, kind, isActive ):
+        """
+        Lays out a line of the given kind from xml_data.
+        """
+
+        if kind == _DESCRIPTION_LINE:
+            styles = retrieveDescriptionStyles()
+            scale = DESCRIPTION_SCALE
+        elif kind == _AUTOCOMPLETE_LINE:
+            styles = retrieveAutocompleteStyles( active = isActive )
+            scale = AUTOCOMPLETE_SCALE
+        else:
+            styles = retrieveSuggestionStyles( active = isActive )
+            scale = SUGGESTION_SCALE
+
+        return layoutXmlLine(
+            xml_data = xml_data,
+            styles = styles,
+            scale = scale,
+            )
             
 
     def __setBackgroundColors( self ):
@@ -354,16 +469,8 @@ class QuasimodeLayout:
         # continue until all adjacent windows are either equal in
         # width or have widths greater than the constant.
 
-        def _computeWidth( doc ):
-            lines = []
-            for b in doc.blocks:
-                lines.extend( b.lines )
-            if len( lines ) == 0:
-                return 0
-            return max( [ l.xMax for l in lines ] )
-
-        for l in self.newLines:
-            l.ragWidth = _computeWidth( l )
+        for i in range( len(self.newLines) ):
+            self.newLines[i].ragWidth = self.__baseWidths[i]
             
         for i in range( MAX_CYCLES ):
             widths = [ l.ragWidth for l in self.newLines ]
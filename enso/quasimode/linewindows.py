@@ -35,6 +35,21 @@
 """
     A window class for drawing single lines of text in transparent
     windows.
+
+    Lines are rendered into surfaces of their own, which are kept in
+    a small cache shared by all the windows, keyed by everything that
+    determines what a line looks like.  A window whose line hasn't
+    changed isn't drawn again at all, and a line that moves to another
+    window (e.g., when the active suggestion changes and changes back)
+    is simply copied from its cached surface.  Only the columns of
+    pixels in which a line differs from the one it replaces are copied
+    to the window and marked as damaged, so that, e.g., typing a
+    character only presents the end of the line.
+
+    Lines can also be drawn into regions of one window shared by all
+    of them, a LineCompositor, rather than into windows of their own;
+    then only the compositor's window is updated, once for all the
+    lines drawn since its last update.
 """
 
 # ----------------------------------------------------------------------------
@@ -48,6 +63,19 @@ from enso.graphics.measurement import convertUserSpaceToPoints
 from enso.graphics.transparentwindow import TransparentWindow
 from enso.graphics import rounded_rect
 from enso.quasimode import layout
+from enso.utils.lrucache import LruCache
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The maximum number of rendered lines kept in the cache shared by
+# all TextWindows.
+MAX_CACHED_LINE_SURFACES = 16
+
+# The number of bytes per pixel of an ARGB32 surface.
+_BYTES_PER_PIXEL = 4
 
 
 # ----------------------------------------------------------------------------
@@ -74,6 +102,12 @@ class TextWindow:
         xPos, yPos = position
         self.__window = TransparentWindow( xPos, yPos, width, height )
         self.__context = self.__window.makeCairoContext()
+
+        # The content key (see _getContentKey()) and rendered surface
+        # of the line currently displayed by the window, or None if
+        # it's hidden.
+        self.__contentKey = None
+        self.__surface = None
         
 
     def getHeight( self ):
@@ -92,48 +126,38 @@ class TextWindow:
         window should reflect the drawn content.
         """
 
-        width = document.ragWidth + layout.L_MARGIN + layout.R_MARGIN
         height = self.__window.getMaxHeight()
-        cr = self.__context
+        key = _getContentKey( document, height )
+        if key == self.__contentKey:
+            return
 
-        # Clear the areas where the corners of the rounded rectangle will be.
+        width = document.ragWidth + layout.L_MARGIN + layout.R_MARGIN
+        windowWidth = min( self.__window.getMaxWidth(), width )
 
-        cr.save()
-        cr.set_source_rgba( 0, 0, 0, 0 )
-        cr.set_operator( cairo.OPERATOR_SOURCE )
-        cr.rectangle( width - rounded_rect.CORNER_RADIUS,
-                      height - rounded_rect.CORNER_RADIUS,
-                      rounded_rect.CORNER_RADIUS,
-                      rounded_rect.CORNER_RADIUS )
-        cr.rectangle( width - rounded_rect.CORNER_RADIUS,
-                      0,
-                      rounded_rect.CORNER_RADIUS,
-                      rounded_rect.CORNER_RADIUS )
-        cr.paint()
-
-        # Draw the background rounded rectangle.
-        corners = []
-        if document.roundUpperRight:
-            corners.append( rounded_rect.UPPER_RIGHT )
-        if document.roundLowerRight:
-            corners.append( rounded_rect.LOWER_RIGHT )
-
-        cr.set_source_rgba( *document.background )
-        rounded_rect.drawRoundedRect( context = cr,
-                                      rect = ( 0, 0, width, height ), 
-                                      softenedCorners = corners )
-        cr.fill_preserve()
-        cr.restore()
+        surface = _lineSurfaces.get( key )
+        if surface == None:
+            surface = _renderLine( document, width, height, windowWidth )
+            _lineSurfaces[key] = surface
 
-        # Next, draw the text.
-        document.draw( layout.L_MARGIN,
-                       document.shrinkOffset,
-                       self.__context )
+        # Copy the columns of the rendered line that differ from the
+        # displayed one to the window, pixel for pixel.
+        start, end = _getChangedColumns( self.__surface, surface )
+        isResized = self.__surface == None \
+                    or self.__surface.get_width() != surface.get_width()
+        self.__contentKey = key
+        self.__surface = surface
 
-        width = min( self.__window.getMaxWidth(), width )
-        height = min( self.__window.getMaxHeight(), height )
+        # A line that looks the same as the displayed one, e.g. one
+        # whose document only differs in its markup, leaves the window
+        # as it is; updating it with nothing marked dirty would
+        # present all of it.
+        if start == end and not isResized:
+            return
 
-        self.__window.setSize( width, height )
+        _copyColumns( self.__context, surface, start, end, 0 )
+        self.__window.markDirty( pixelsToPoints( start ), 0,
+                                 pixelsToPoints( end - start ), height )
+        self.__window.setSize( windowWidth, height )
         self.__window.update()
 
 
@@ -157,3 +181,378 @@ class TextWindow:
         self.__context.set_operator (cairo.OPERATOR_OVER)
 
         self.__window.update()
+        self.__contentKey = None
+        self.__surface = None
+
+
+# ----------------------------------------------------------------------------
+# LineCompositor Class
+# ----------------------------------------------------------------------------
+
+class LineCompositor:
+    """
+    Encapsulates a single transparent window into which several lines
+    of text are drawn, one below the other, by the CompositedTextWindow
+    objects made by addLine().  The window is sized to the lines that
+    are showing, and nothing that's drawn is presented until present()
+    is called.
+    """
+
+    def __init__( self, height ):
+        """
+        Creates the underlying TransparentWindow and Cairo context,
+        for lines that take up the given total height.
+
+        Height should be in points.
+        """
+
+        # Use the maximum width that we can, i.e., the desktop width.
+        width = graphics.getDesktopSize()[0]
+
+        self.__window = TransparentWindow( 0, 0, width, height )
+        self.__context = self.__window.makeCairoContext()
+
+        # The ( width, bottom ) extent of each line that is showing,
+        # in points, by line index; lines report their extents rather
+        # than being referred to, so that the window is destroyed as
+        # soon as its owner lets go of the compositor and its lines.
+        self.__extents = {}
+        self.__numLines = 0
+        self.__isDirty = False
+        
+
+    def addLine( self, height, top ):
+        """
+        Returns a new CompositedTextWindow for a line of the given
+        height, the given distance from the top of the window.
+
+        Height and top should be in points.
+        """
+
+        line = CompositedTextWindow( self, self.__numLines, height, top )
+        self.__numLines += 1
+        return line
+
+
+    def getMaxWidth( self ):
+        """
+        Returns the maximum width of a line, in points.
+        """
+
+        return self.__window.getMaxWidth()
+
+
+    def copyColumns( self, surface, start, end, top ):
+        """
+        Copies the given range of columns of pixels of the given
+        surface to the window, with its top the given number of
+        points from the top of the window.
+        """
+
+        y = int( pointsToPixels( top ) )
+        _copyColumns( self.__context, surface, start, end, y )
+        self.__markDirty( start, y, end - start, surface.get_height() )
+
+
+    def clearColumns( self, start, end, top, height ):
+        """
+        Clears the given range of columns of pixels, in the line of
+        the given height the given distance from the top of the
+        window, in points.
+        """
+
+        y = int( pointsToPixels( top ) )
+        height = max( int( pointsToPixels( height ) ), 1 )
+        cr = self.__context
+        cr.save()
+        cr.identity_matrix()
+        cr.set_operator( cairo.OPERATOR_CLEAR )
+        cr.rectangle( start, y, end - start, height )
+        cr.fill()
+        cr.restore()
+        self.__markDirty( start, y, end - start, height )
+
+
+    def setExtent( self, index, extent ):
+        """
+        Sets the ( width, bottom ) extent of the line with the given
+        index, in points, or None if it isn't showing.
+        """
+
+        if self.__extents.get( index ) == extent:
+            return
+        if extent == None:
+            del self.__extents[index]
+        else:
+            self.__extents[index] = extent
+        self.__isDirty = True
+
+
+    def present( self ):
+        """
+        Sizes the window to the lines that are showing, and presents
+        everything drawn since the last call, in a single update.
+        """
+
+        if not self.__isDirty:
+            return
+
+        width = 1
+        height = 1
+        for lineWidth, bottom in self.__extents.values():
+            width = max( width, lineWidth )
+            height = max( height, bottom )
+        self.__window.setSize( width, height )
+        self.__window.update()
+        self.__isDirty = False
+
+
+    def __markDirty( self, x, y, width, height ):
+        """
+        Marks the given rectangle of the window, in pixels, as changed.
+        """
+
+        if width <= 0 or height <= 0:
+            return
+        self.__window.markDirty( pixelsToPoints( x ), pixelsToPoints( y ),
+                                 pixelsToPoints( width ),
+                                 pixelsToPoints( height ) )
+        self.__isDirty = True
+
+
+class CompositedTextWindow:
+    """
+    Encapsulates the drawing of a single line of text into a region
+    of a LineCompositor's window; it's used just like a TextWindow,
+    except that what it draws is only presented by the compositor's
+    present().
+    """
+
+    def __init__( self, compositor, index, height, top ):
+        """
+        Made by LineCompositor.addLine().
+        """
+
+        self.__compositor = compositor
+        self.__index = index
+        self.__top = top
+
+        # Use the height that a window of the given height would
+        # really have, so that lines are rendered (and cached) the
+        # same way as for TextWindows.
+        self.__height = pixelsToPoints(
+            max( int( pointsToPixels( height ) ), 1 ) )
+
+        # The content key (see _getContentKey()) and rendered surface
+        # of the line currently displayed, or None if it's hidden.
+        self.__contentKey = None
+        self.__surface = None
+
+
+    def getHeight( self ):
+        """
+        Returns the height of the line, in points.
+        """
+        
+        return self.__height
+
+
+    def draw( self, document ):
+        """
+        Draws the text described by document.
+
+        At the end of this method, the compositor's next present()
+        will reflect the drawn content.
+        """
+
+        height = self.__height
+        key = _getContentKey( document, height )
+        if key == self.__contentKey:
+            return
+
+        compositor = self.__compositor
+        width = document.ragWidth + layout.L_MARGIN + layout.R_MARGIN
+        lineWidth = min( compositor.getMaxWidth(), width )
+
+        surface = _lineSurfaces.get( key )
+        if surface == None:
+            surface = _renderLine( document, width, height, lineWidth )
+            _lineSurfaces[key] = surface
+
+        # Copy the columns of the rendered line that differ from the
+        # displayed one, and clear whatever of the displayed one is
+        # past the end of the new one; unlike a TextWindow, the
+        # compositor's window may be wider than the line.
+        start, end = _getChangedColumns( self.__surface, surface )
+        compositor.copyColumns( surface, start, end, self.__top )
+        if self.__surface != None \
+           and self.__surface.get_width() > surface.get_width():
+            compositor.clearColumns( surface.get_width(),
+                                     self.__surface.get_width(),
+                                     self.__top, height )
+
+        compositor.setExtent( self.__index,
+                              ( lineWidth, self.__top + height ) )
+        self.__contentKey = key
+        self.__surface = surface
+
+
+    def hide( self ):
+        """
+        Clears the line's region of the window (making it disappear).
+        """
+
+        if self.__surface == None:
+            return
+
+        self.__compositor.clearColumns( 0, self.__surface.get_width(),
+                                        self.__top, self.__height )
+        self.__compositor.setExtent( self.__index, None )
+        self.__contentKey = None
+        self.__surface = None
+
+
+# ----------------------------------------------------------------------------
+# Rendered Lines
+# ----------------------------------------------------------------------------
+
+def _getContentKey( document, height ):
+    """
+    Returns a key that identifies what the given document looks like
+    when drawn in a window of the given height; see
+    layout.layoutXmlLine() for the attributes that go into it.
+    """
+
+    return ( document.xmlData,
+             document.styleVersion,
+             document.shrinkOffset,
+             document.ragWidth,
+             document.roundUpperRight,
+             document.roundLowerRight,
+             document.background,
+             height )
+
+
+def _renderLine( document, width, height, surfaceWidth ):
+    """
+    Renders the given document onto a background of the given width
+    and height, on a new surface that is surfaceWidth wide (which
+    crops the background if it's narrower), and returns the surface.
+    """
+
+    surface = cairo.ImageSurface(
+        cairo.FORMAT_ARGB32,
+        max( int( pointsToPixels( surfaceWidth ) ), 1 ),
+        max( int( pointsToPixels( height ) ), 1 )
+        )
+    cr = cairo.Context( surface )
+    convertUserSpaceToPoints( cr )
+
+    # Draw the background rounded rectangle; the surface starts out
+    # clear, so the corners it leaves out are transparent.
+    corners = []
+    if document.roundUpperRight:
+        corners.append( rounded_rect.UPPER_RIGHT )
+    if document.roundLowerRight:
+        corners.append( rounded_rect.LOWER_RIGHT )
+
+    cr.save()
+    cr.set_source_rgba( *document.background )
+    rounded_rect.drawRoundedRect( context = cr,
+                                  rect = ( 0, 0, width, height ), 
+                                  softenedCorners = corners )
+    cr.fill_preserve()
+    cr.restore()
+
+    # Next, draw the text.
+    document.draw( layout.L_MARGIN,
+                   document.shrinkOffset,
+                   cr )
+
+    return surface
+
+
+def _copyColumns( context, surface, start, end, y ):
+    """
+    Copies the given range of columns of pixels of the given surface
+    onto the given context's surface, pixel for pixel, with its top
+    the given number of pixels down.
+    """
+
+    cr = context
+    cr.save()
+    cr.identity_matrix()
+    cr.set_operator( cairo.OPERATOR_SOURCE )
+    cr.set_source_surface( surface, 0, y )
+    cr.rectangle( start, y, end - start, surface.get_height() )
+    cr.fill()
+    cr.restore()
+
+
+def _getChangedColumns( oldSurface, newSurface ):
+    """
+    Returns the range of columns of pixels of newSurface, as a
+    ( start, end ) tuple, outside of which it's the same as
+    oldSurface.  Columns past oldSurface's width count as changed, as
+    does the whole surface if oldSurface is None or if its height is
+    different; the range is empty if nothing has changed.
+    """
+
+    width = newSurface.get_width()
+    height = newSurface.get_height()
+    if oldSurface == None or oldSurface.get_height() != height:
+        return ( 0, width )
+
+    try:
+        oldData = oldSurface.get_data()
+        newData = newSurface.get_data()
+    except ( AttributeError, NotImplementedError ):
+        return ( 0, width )
+
+    oldStride = oldSurface.get_stride()
+    newStride = newSurface.get_stride()
+    commonWidth = min( oldSurface.get_width(), width )
+    rowLength = commonWidth * _BYTES_PER_PIXEL
+
+    # Both surfaces are ARGB32, so each row can be compared as a
+    # string of bytes.
+    start = commonWidth
+    end = 0
+    for row in range( height ):
+        oldRow = oldData[ row * oldStride : row * oldStride + rowLength ]
+        newRow = newData[ row * newStride : row * newStride + rowLength ]
+        if oldRow == newRow:
+            continue
+        prefix = _getCommonPrefixLength( oldRow, newRow )
+        suffix = _getCommonPrefixLength( oldRow[::-1], newRow[::-1] )
+        start = min( start, prefix / _BYTES_PER_PIXEL )
+        end = max( end, commonWidth - suffix / _BYTES_PER_PIXEL )
+
+    if width > commonWidth:
+        start = min( start, commonWidth )
+        end = width
+    if start >= end:
+        return ( 0, 0 )
+    return ( start, end )
+
+
+def _getCommonPrefixLength( string1, string2 ):
+    """
+    Returns the length of the longest common prefix of the two given
+    strings, which are the same length.
+    """
+
+    # Binary search, so that the comparisons are all done by string
+    # comparisons, in C.
+    low = 0
+    high = len( string1 )
+    while low < high:
+        middle = ( low + high + 1 ) / 2
+        if string1[:middle] == string2[:middle]:
+            low = middle
+        else:
+            high = middle - 1
+    return low
+
+
+_lineSurfaces = LruCache( MAX_CACHED_LINE_SURFACES )
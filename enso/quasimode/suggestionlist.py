@@ -43,9 +43,36 @@
 
 from enso import commands
 from enso.commands.suggestions import AutoCompletion
+from enso.commands.suggestions import selectBestSuggestions
 from enso import config
 
 
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The maximum number of earlier queries that are kept around so that
+# their results can be reused when the user backspaces.
+MAX_CACHED_QUERIES = 32
+
+
+# ----------------------------------------------------------------------------
+# Query Results
+# ----------------------------------------------------------------------------
+
+class _Query:
+    """
+    The results of querying the command manager for some user text.
+    """
+
+    def __init__( self, userText, suggestionGroups ):
+        self.userText = userText
+        self.suggestionGroups = suggestionGroups
+
+        # The auto-completion for userText, if it's been computed.
+        self.autoCompletion = None
+
+
 # ----------------------------------------------------------------------------
 # The SuggestionList Singleton
 # ----------------------------------------------------------------------------
@@ -108,6 +135,10 @@ class TheSuggestionList:
         # auto-completion attributes above need to be updated.
         self.__suggestionsDirty = False
 
+        # The results of the most recent queries to the command
+        # manager, each one for a prefix of the next one's user text.
+        self.__queries = []
+
 
     def getUserText( self ):
         return self.__userText
@@ -199,11 +230,53 @@ class TheSuggestionList:
         if len( userText ) < config.QUASIMODE_MIN_AUTOCOMPLETE_CHARS:
             autoCompletion = AutoCompletion( userText, "" )
         else:
-            autoCompletion = self.__cmdManager.autoComplete( userText )
-            if autoCompletion == None:
-                autoCompletion = AutoCompletion( userText, "" )
+            query = self.__getQuery( userText )
+            if query.autoCompletion == None:
+                autoCompletion = self.__cmdManager.autoComplete( userText )
+                if autoCompletion == None:
+                    autoCompletion = AutoCompletion( userText, "" )
+                query.autoCompletion = autoCompletion
+            autoCompletion = query.autoCompletion
                 
         return autoCompletion
+
+
+    def __getQuery( self, userText ):
+        """
+        Returns the results of querying the command manager for
+        userText, reusing earlier results whenever possible.
+
+        Most of the time, the user text has just been extended by a
+        character, in which case the previous suggestions only need to
+        be narrowed down; when the user backspaces, the results for
+        the shorter text are simply taken from the cache.  Either way,
+        this is only done if none of the command factories involved
+        has changed in the meantime.
+        """
+
+        queries = self.__queries
+
+        # Forget about the queries that aren't for a prefix of
+        # userText.
+        while len( queries ) > 0 and \
+                  not userText.startswith( queries[-1].userText ):
+            queries.pop()
+
+        if len( queries ) > 0 and \
+               self.__cmdManager.areSuggestionGroupsCurrent(
+                   queries[-1].suggestionGroups ):
+            if queries[-1].userText != userText:
+                groups = self.__cmdManager.refineSuggestionGroups(
+                    userText,
+                    queries[-1].suggestionGroups
+                    )
+                queries.append( _Query( userText, groups ) )
+                del queries[:-MAX_CACHED_QUERIES]
+        else:
+            groups = self.__cmdManager.retrieveSuggestionGroups( userText )
+            queries[:] = [ _Query( userText, groups ) ]
+
+        return queries[-1]
     
 
     def __findSuggestions( self, userText ):
@@ -220,39 +293,17 @@ class TheSuggestionList:
         if len( userText ) < config.QUASIMODE_MIN_AUTOCOMPLETE_CHARS:
             return [ self.__autoCompletion ]
 
-        suggestions = self.__cmdManager.retrieveSuggestions( userText )
-
-        # BEGIN: Performance-improving code.
-        # Eliminate most of the suggestions before sorting them.
-        threshold = 0.0
-        restrictedSuggestions = suggestions[:]
-        oldRestrictedSuggestions = restrictedSuggestions
-
-        # LONGTERM TODO: You may be able to optimize the algorithm
-        # even further in the following way: assuming that thresh(x)
-        # gives you the number of suggestions whose nearness is
-        # greater than x, first see if thresh( 0.5 ) >
-        # QUASIMODE_MAX_SUGGESTIONS; if so, see if thresh( 0.75 ) is,
-        # but if not, see if thresh( 0.25 ) is, and so forth.
-        while (len( restrictedSuggestions ) > 
-               config.QUASIMODE_MAX_SUGGESTIONS):
-            threshold += 0.05
-            oldRestrictedSuggestions = restrictedSuggestions
-            restrictedSuggestions = [ \
-                s for s in oldRestrictedSuggestions \
-                if s._nearness > threshold \
-                ]
-
-        # Use the second-to-last restricted suggestions, as
-        # the last restricted suggestions may actually have
-        # fewer than we want.
-        suggestions = oldRestrictedSuggestions
-        # END: Performance-improving code.
-        
-        # Because the Suggestion object implements __cmp__ to sort
-        # by nearness, we can simply sort the suggestions in place.
-        suggestions.sort()
-        suggestions = suggestions[:config.QUASIMODE_MAX_SUGGESTIONS]
+        query = self.__getQuery( userText )
+        candidates = self.__cmdManager.getCandidatesFromGroups(
+            query.suggestionGroups
+            )
+
+        # Only keep the nearest suggestions, nearest first.
+        suggestions = selectBestSuggestions(
+            userText,
+            candidates,
+            config.QUASIMODE_MAX_SUGGESTIONS
+            )
         
         # Make the auto-completion the 0th suggestion, and not listed
         # more than once.
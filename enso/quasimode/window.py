@@ -54,6 +54,13 @@
     there are actual separate transparent windows for each of them.
     This allows a performance tweak: only those windows that have text
     in them are actually drawn.
+
+    Alternatively, if config.QUASIMODE_COMPOSITOR is true, all the
+    lines are drawn into regions of a single window (see
+    linewindows.LineCompositor), which is presented once per update
+    of the display, for all the lines that changed; this trades the
+    per-window overhead of the window system for presenting the
+    transparent space to the right of the shorter lines.
 """
 
 # ----------------------------------------------------------------------------
@@ -62,7 +69,7 @@
 
 import time
 
-from enso.quasimode.linewindows import TextWindow
+from enso.quasimode.linewindows import TextWindow, LineCompositor
 from enso.quasimode.layout import QuasimodeLayout
 from enso.quasimode.layout import HEIGHT_FACTOR
 from enso.quasimode.layout import DESCRIPTION_SCALE
@@ -96,33 +103,72 @@ class TheQuasimodeWindow:
         # that window is.  Use a "top" variable to know how far down
         # the screen the top of the next window should start.
 
-        height = DESCRIPTION_SCALE[-1]*HEIGHT_FACTOR
-        self.__descriptionWindow = TextWindow(
-            height = height,
-            position = [ 0, 0 ],
-            )
-        top = height
+        descriptionHeight = DESCRIPTION_SCALE[-1]*HEIGHT_FACTOR
+        userTextHeight = AUTOCOMPLETE_SCALE[-1]*HEIGHT_FACTOR
+        suggestionHeight = SUGGESTION_SCALE[-1]*HEIGHT_FACTOR
+
+        # In compositor mode, the "windows" are lines of a single
+        # window, which is presented by __present().
+        self.__compositor = None
+        if config.QUASIMODE_COMPOSITOR:
+            self.__compositor = LineCompositor(
+                descriptionHeight + userTextHeight +
+                suggestionHeight * config.QUASIMODE_MAX_SUGGESTIONS
+                )
+
+        self.__descriptionWindow = self.__makeLineWindow(
+            descriptionHeight, 0 )
+        top = descriptionHeight
         
-        height = AUTOCOMPLETE_SCALE[-1]*HEIGHT_FACTOR
-        self.__userTextWindow = TextWindow(
-            height = height,
-            position = [ 0, top ],
-            )
-        top += height
+        self.__userTextWindow = self.__makeLineWindow( userTextHeight, top )
+        top += userTextHeight
     
         self.__suggestionWindows = []
         for i in range( config.QUASIMODE_MAX_SUGGESTIONS ):
-            height = SUGGESTION_SCALE[-1]*HEIGHT_FACTOR
-            self.__suggestionWindows.append( TextWindow(
-                height = height,
-                position = [ 0, top ],
-                ) )
-            top += height
+            self.__suggestionWindows.append( self.__makeLineWindow(
+                suggestionHeight, top ) )
+            top += suggestionHeight
 
         # The time, in float seconds since the epoch, when the last
         # drawing of the quasimode display started.
         self.__drawStart = 0
 
+        # The layout of the quasimode display, which is kept up to
+        # date by each update().
+        self.__layout = QuasimodeLayout()
+
+        # The number of suggestion windows that may be showing
+        # something, and the indices of the suggestion lines that
+        # were scheduled for drawing but haven't been drawn yet.
+        self.__numShownSuggestions = len( self.__suggestionWindows )
+        self.__undrawnSuggestions = {}
+        self.__suggestionsLeft = None
+
+
+    def __makeLineWindow( self, height, top ):
+        """
+        Returns a window for a line of the given height, the given
+        distance from the top of the screen.
+        """
+
+        if self.__compositor != None:
+            return self.__compositor.addLine( height, top )
+        return TextWindow(
+            height = height,
+            position = [ 0, top ],
+            )
+
+
+    def __present( self ):
+        """
+        Presents everything drawn since the last call, if the lines
+        are drawn by a compositor; otherwise, each line window has
+        already presented what it drew.
+        """
+
+        if self.__compositor != None:
+            self.__compositor.present()
+
 
     def update( self, quasimode, isFullRedraw ):
         """
@@ -139,38 +185,55 @@ class TheQuasimodeWindow:
         be scheduled for redraw later.
         """
 
-        # Instantiate a layout object, effectively laying out the
-        # quasimode display.
-        layout = QuasimodeLayout( quasimode )
+        # Update the layout of the quasimode display; only the lines
+        # that have changed since the last update need drawing.
+        layout = self.__layout
+        changedLines = layout.update( quasimode )
 
         self.__drawStart = time.time()
 
         newLines = layout.newLines
 
-        self.__descriptionWindow.draw( newLines[0] )
+        if 0 in changedLines:
+            self.__descriptionWindow.draw( newLines[0] )
 
-        suggestions = quasimode.getSuggestionList().getSuggestions()
-        if len( suggestions[0].toXml() ) == 0 \
-           and len( suggestions[0].getSource() ) == 0:
-            self.__userTextWindow.hide()
-        else:
-            self.__userTextWindow.draw( newLines[1] )
+        if 1 in changedLines:
+            suggestions = quasimode.getSuggestionList().getSuggestions()
+            if len( suggestions[0].toXml() ) == 0 \
+               and len( suggestions[0].getSource() ) == 0:
+                self.__userTextWindow.hide()
+            else:
+                self.__userTextWindow.draw( newLines[1] )
 
         suggestionLines = newLines[2:]
 
-        # We now need to hide all line windows.
+        # We now need to hide all line windows that aren't used
+        # anymore.
         for i in range( len( suggestionLines ),
-                        len( self.__suggestionWindows ) ):
+                        self.__numShownSuggestions ):
             self.__suggestionWindows[i].hide()
+        self.__numShownSuggestions = len( suggestionLines )
+
+        # Suggestions that were scheduled for drawing by the last
+        # update, but weren't drawn, still need to be.
+        indices = [ i for i in range( len(suggestionLines) )
+                    if i + 2 in changedLines or
+                    self.__undrawnSuggestions.has_key( i ) ]
+        self.__undrawnSuggestions = {}
+        for i in indices:
+            self.__undrawnSuggestions[i] = True
 
         self.__suggestionsLeft = _makeSuggestionIterator(
             suggestionLines,
-            self.__suggestionWindows
+            self.__suggestionWindows,
+            indices,
+            self.__undrawnSuggestions,
             )
 
         if isFullRedraw:
-            while self.continueDrawing( ignoreTimeElapsed = True ):
+            while self.__drawNextSuggestion( ignoreTimeElapsed = True ):
                 pass
+        self.__present()
 
 
     def continueDrawing( self, ignoreTimeElapsed = False ):
@@ -188,6 +251,19 @@ class TheQuasimodeWindow:
         called.
         """
 
+        if self.__drawNextSuggestion( ignoreTimeElapsed ):
+            self.__present()
+            return True
+        return False
+
+
+    def __drawNextSuggestion( self, ignoreTimeElapsed ):
+        """
+        Draws the next pending suggestion, if there is one and it's
+        time to; see continueDrawing().  Returns whether a suggestion
+        was drawn.
+        """
+
         if self.__suggestionsLeft:
             timeElapsed = time.time() - self.__drawStart
             if ( (not ignoreTimeElapsed) and 
@@ -209,22 +285,29 @@ class _SuggestionDrawer:
     suggestion.
     """
 
-    def __init__( self, line, suggestionWindow ):
+    def __init__( self, line, suggestionWindow, index, undrawnSuggestions ):
         self.__suggestionWindow = suggestionWindow
         self.__line = line
+        self.__index = index
+        self.__undrawnSuggestions = undrawnSuggestions
 
     def draw( self ):
         self.__suggestionWindow.draw( self.__line )
+        del self.__undrawnSuggestions[self.__index]
 
 
-def _makeSuggestionIterator( lines, suggestionWindows ):
+def _makeSuggestionIterator( lines, suggestionWindows, indices,
+                             undrawnSuggestions ):
     """
     Returns a generator that provides _SuggestionDrawer objects for
-    each suggestion in the given suggestion lines, allowing each
+    the suggestion lines with the given indices, allowing each
     suggestion line to be drawn to a respective suggestion window at a
-    later time.
+    later time.  Each index is removed from the undrawnSuggestions
+    dictionary once its line has been drawn.
     """
 
-    for i in range( len(lines) ):
+    for i in indices:
         yield _SuggestionDrawer( lines[i],
-                                 suggestionWindows[i] )
+                                 suggestionWindows[i],
+                                 i,
+                                 undrawnSuggestions )
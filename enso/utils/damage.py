@@ -0,0 +1,190 @@
+# Copyright (c) 2008, Humanized, Inc.
+# All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#    1. Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#
+#    2. Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#
+#    3. Neither the name of Enso nor the names of its contributors may
+#       be used to endorse or promote products derived from this
+#       software without specific prior written permission.
+# 
+# THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# ----------------------------------------------------------------------------
+#
+#   enso.utils.damage
+#
+# ----------------------------------------------------------------------------
+
+"""
+    Accumulates the damaged (i.e., changed) rectangles of a window
+    between updates, so that only they need to be presented.
+"""
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The maximum number of separate rectangles a DamageRegion keeps;
+# past that, they're all merged into their bounding rectangle.
+MAX_RECTS = 8
+
+
+# ----------------------------------------------------------------------------
+# Rectangle Functions
+# ----------------------------------------------------------------------------
+
+# Rectangles are ( x, y, width, height ) tuples, in whatever units
+# the caller uses.
+
+def isEmptyRect( rect ):
+    """
+    Returns whether the given rectangle covers no area.
+    """
+
+    return rect[2] <= 0 or rect[3] <= 0
+
+
+def unionRect( rect1, rect2 ):
+    """
+    Returns the bounding rectangle of the two given rectangles.
+    """
+
+    x = min( rect1[0], rect2[0] )
+    y = min( rect1[1], rect2[1] )
+    right = max( rect1[0] + rect1[2], rect2[0] + rect2[2] )
+    bottom = max( rect1[1] + rect1[3], rect2[1] + rect2[3] )
+    return ( x, y, right - x, bottom - y )
+
+
+def intersectRect( rect1, rect2 ):
+    """
+    Returns the intersection of the two given rectangles, which is
+    empty if they don't overlap.
+    """
+
+    x = max( rect1[0], rect2[0] )
+    y = max( rect1[1], rect2[1] )
+    right = min( rect1[0] + rect1[2], rect2[0] + rect2[2] )
+    bottom = min( rect1[1] + rect1[3], rect2[1] + rect2[3] )
+    return ( x, y, max( right - x, 0 ), max( bottom - y, 0 ) )
+
+
+def _touches( rect1, rect2 ):
+    """
+    Returns whether the two given rectangles overlap or touch.
+    """
+
+    return rect1[0] <= rect2[0] + rect2[2] \
+           and rect2[0] <= rect1[0] + rect1[2] \
+           and rect1[1] <= rect2[1] + rect2[3] \
+           and rect2[1] <= rect1[1] + rect1[3]
+
+
+# ----------------------------------------------------------------------------
+# Damage Region
+# ----------------------------------------------------------------------------
+
+class DamageRegion:
+    """
+    The union of the rectangles that have been damaged since the
+    region was last cleared.
+
+    Rectangles that overlap or touch are merged into their bounding
+    rectangle, so the region is kept as a short list of separate
+    rectangles; if it grows past maxRects, they're all merged into
+    one.  Either way, the region always covers at least the union of
+    the damaged rectangles.
+    """
+
+    def __init__( self, maxRects = MAX_RECTS ):
+        assert maxRects >= 1
+        self.__maxRects = maxRects
+        self.__rects = []
+
+    def add( self, x, y, width, height ):
+        """
+        Adds the given rectangle to the region; empty rectangles are
+        ignored.
+        """
+
+        rect = ( x, y, width, height )
+        if isEmptyRect( rect ):
+            return
+
+        # Merging two rectangles can make their union touch others,
+        # so keep merging until it doesn't.
+        merged = True
+        while merged:
+            merged = False
+            for i in range( len( self.__rects ) ):
+                if _touches( rect, self.__rects[i] ):
+                    rect = unionRect( rect, self.__rects.pop( i ) )
+                    merged = True
+                    break
+
+        self.__rects.append( rect )
+        if len( self.__rects ) > self.__maxRects:
+            self.__rects = [ self.getBounds() ]
+
+    def isEmpty( self ):
+        """
+        Returns whether nothing has been damaged.
+        """
+
+        return len( self.__rects ) == 0
+
+    def getRects( self, clipRect = None ):
+        """
+        Returns the list of the region's separate rectangles, each
+        clipped to clipRect if it's given (leaving out any that fall
+        outside it).
+        """
+
+        if clipRect == None:
+            return list( self.__rects )
+
+        rects = []
+        for rect in self.__rects:
+            rect = intersectRect( rect, clipRect )
+            if not isEmptyRect( rect ):
+                rects.append( rect )
+        return rects
+
+    def getBounds( self, clipRect = None ):
+        """
+        Returns the bounding rectangle of the region, clipped to
+        clipRect if it's given, or None if that leaves it empty.
+        """
+
+        rects = self.getRects( clipRect )
+        if len( rects ) == 0:
+            return None
+
+        bounds = rects[0]
+        for rect in rects[1:]:
+            bounds = unionRect( bounds, rect )
+        return bounds
+
+    def clear( self ):
+        """
+        Empties the region.
+        """
+
+        self.__rects = []
@@ -0,0 +1,176 @@
+# Copyright (c) 2008, Humanized, Inc.
+# All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#    1. Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#
+#    2. Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#
+#    3. Neither the name of Enso nor the names of its contributors may
+#       be used to endorse or promote products derived from this
+#       software without specific prior written permission.
+# 
+# THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# ----------------------------------------------------------------------------
+#
+#   enso.utils.lrucache
+#
+# ----------------------------------------------------------------------------
+
+"""
+    A dictionary-like cache of bounded size, which discards the least
+    recently used items first.
+"""
+
+# ----------------------------------------------------------------------------
+# LRU Cache
+# ----------------------------------------------------------------------------
+
+# Indices of the fields of a cache entry, which is a list of the
+# form [ previousEntry, nextEntry, key, value ].
+_PREV = 0
+_NEXT = 1
+_KEY = 2
+_VALUE = 3
+
+class LruCache:
+    """
+    Maps keys to values, like a dictionary, but holds at most a given
+    number of items; when a new item would exceed that number, the
+    least recently used item is discarded.  Both looking up and
+    storing an item count as using it.
+
+    The numbers of lookups that found their key and that didn't are
+    kept in the hits and misses attributes.
+
+      >>> cache = LruCache( 2 )
+      >>> cache["a"] = 1
+      >>> cache["b"] = 2
+      >>> cache["a"]
+      1
+      >>> cache["c"] = 3
+      >>> cache.has_key( "b" )
+      False
+      >>> cache.get( "b", "missing" )
+      'missing'
+      >>> cache["b"]
+      Traceback (most recent call last):
+      ...
+      KeyError: 'b'
+      >>> len( cache )
+      2
+      >>> ( cache.hits, cache.misses )
+      (1, 2)
+    """
+
+    def __init__( self, maxSize ):
+        """
+        Creates an empty cache that holds at most maxSize items.
+        """
+
+        assert maxSize > 0
+
+        self.__maxSize = maxSize
+
+        # The number of lookups that found their key, and of those that
+        # didn't.
+        self.hits = 0
+        self.misses = 0
+
+        # Maps each key to its entry; the entries also form a
+        # circular doubly-linked list, from the most recently used to
+        # the least recently used, starting and ending at __root.
+        self.__entries = {}
+        self.__root = []
+        self.__root[:] = [ self.__root, self.__root, None, None ]
+
+    def __len__( self ):
+        return len( self.__entries )
+
+    def has_key( self, key ):
+        """
+        Returns whether key is in the cache, without counting as a use
+        of it.
+        """
+
+        return self.__entries.has_key( key )
+
+    __contains__ = has_key
+
+    def __getitem__( self, key ):
+        entry = self.__entries.get( key )
+        if entry == None:
+            self.misses += 1
+            raise KeyError( key )
+        self.hits += 1
+        self.__moveToFront( entry )
+        return entry[_VALUE]
+
+    def get( self, key, default = None ):
+        """
+        Returns the value for key, or default if it isn't in the
+        cache.
+        """
+
+        entry = self.__entries.get( key )
+        if entry == None:
+            self.misses += 1
+            return default
+        self.hits += 1
+        self.__moveToFront( entry )
+        return entry[_VALUE]
+
+    def __setitem__( self, key, value ):
+        entry = self.__entries.get( key )
+        if entry != None:
+            entry[_VALUE] = value
+            self.__moveToFront( entry )
+            return
+
+        if len( self.__entries ) >= self.__maxSize:
+            # Discard the least recently used entry.
+            last = self.__root[_PREV]
+            self.__unlink( last )
+            del self.__entries[ last[_KEY] ]
+
+        root = self.__root
+        entry = [ root, root[_NEXT], key, value ]
+        root[_NEXT][_PREV] = entry
+        root[_NEXT] = entry
+        self.__entries[key] = entry
+
+    def clear( self ):
+        """
+        Removes every item from the cache.
+        """
+
+        self.__entries.clear()
+        self.__root[:] = [ self.__root, self.__root, None, None ]
+
+    def __unlink( self, entry ):
+        entry[_PREV][_NEXT] = entry[_NEXT]
+        entry[_NEXT][_PREV] = entry[_PREV]
+
+    def __moveToFront( self, entry ):
+        root = self.__root
+        if root[_NEXT] is not entry:
+            self.__unlink( entry )
+            entry[_PREV] = root
+            entry[_NEXT] = root[_NEXT]
+            root[_NEXT][_PREV] = entry
+            root[_NEXT] = entry
@@ -34,6 +34,11 @@
 
 """
     A memoizing decorator for caching the results of a function.
+
+    Memoized functions are implemented natively by the _memoize
+    extension module if it's available, in which case a call with
+    only positional arguments whose result is cached costs little
+    more than a dictionary lookup.
 """
 
 # ----------------------------------------------------------------------------
@@ -41,9 +46,48 @@
 # ----------------------------------------------------------------------------
 
 import inspect
+import sys
 
 from enso.utils.decorators import finalizeWrapper
 
+try:
+    from enso.utils import _memoize
+except ImportError:
+    _memoize = None
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# Cache policies; these are the same as the policies of the _memoize
+# extension module.
+_POLICY_UNBOUNDED = 0
+_POLICY_LRU = 1
+_POLICY_CLOCK = 2
+
+_POLICIES = {
+    "lru" : _POLICY_LRU,
+    "clock" : _POLICY_CLOCK,
+    }
+
+# Indices of the fields of an entry of a bounded cache, which is a
+# list of the form [ previousEntry, nextEntry, key, value, size,
+# referenced ].  The entries form a circular doubly-linked list:
+# for the "lru" policy, it goes from the most recently used entry to
+# the least recently used one; for the "clock" policy, it's the
+# clock, and referenced is the entry's reference bit.
+_PREV = 0
+_NEXT = 1
+_KEY = 2
+_VALUE = 3
+_SIZE = 4
+_REFERENCED = 5
+
+# The size, in bytes, assumed for objects whose size can't be
+# determined (in particular, before Python 2.6, any object).
+_DEFAULT_OBJECT_SIZE = 32
+
 
 # ----------------------------------------------------------------------------
 # Memoized Decorator
@@ -51,16 +95,180 @@ from enso.utils.decorators import finalizeWrapper
 
 _memoizedFunctions = []
 
+def _getSize( obj ):
+    """
+    Returns the approximate size of the given object in bytes, not
+    counting any objects it refers to.
+    """
+
+    try:
+        return sys.getsizeof( obj )
+    except ( AttributeError, TypeError ):
+        return _DEFAULT_OBJECT_SIZE
+
+
 class _MemoizedFunction:
     """
-    Encapsulates all information about a function that is memoized.
+    Encapsulates all information about a function that is memoized,
+    including its cache.
+
+    An unbounded cache maps argument tuples to results; a bounded
+    cache maps them to entries, which are described above.
     """
     
-    def __init__( self, function ):
+    def __init__( self, function, maxSize = None, policy = "lru" ):
+        assert maxSize == None or maxSize > 0
+        assert _POLICIES.has_key( policy ), \
+               "Unknown memoize policy: %s" % policy
+
         self.function = function
+        self.maxSize = maxSize
+        if maxSize == None:
+            self.policy = _POLICY_UNBOUNDED
+        else:
+            self.policy = _POLICIES[policy]
         self.cache = {}
+
+        # Statistics of the cache; hits answered by the native
+        # implementation of the memoized function are counted by it
+        # instead (see getStats()).
+        self.hits = 0
+        self.misses = 0
+        self.evictions = 0
+        self.memoryUsage = 0
+
+        # The native implementation of the memoized function, if any.
+        self.nativeFunction = None
+
+        # The root of the list of entries, and the clock's hand.
+        self.root = []
+        self.root[:] = [ self.root, self.root, None, None, 0, False ]
+        self.__hand = self.root
+
         _memoizedFunctions.append( self )
 
+    def call( self, args ):
+        """
+        Returns the result of the function for the given argument
+        tuple, calling the function only if it isn't cached.
+        """
+
+        if self.policy == _POLICY_UNBOUNDED:
+            try:
+                result = self.cache[args]
+            except KeyError:
+                return self.__add( args )
+            self.hits += 1
+            return result
+
+        entry = self.cache.get( args )
+        if entry == None:
+            return self.__add( args )
+
+        self.hits += 1
+        if self.policy == _POLICY_LRU:
+            self.__moveToFront( entry )
+        else:
+            entry[_REFERENCED] = True
+        return entry[_VALUE]
+
+    def getStats( self ):
+        """
+        Returns a dictionary of the statistics of the cache: the
+        numbers of hits, misses and evictions, the number of cached
+        results, and the approximate number of bytes that the cache
+        takes up.
+        """
+
+        hits = self.hits
+        if self.nativeFunction != None:
+            hits += self.nativeFunction.hits
+
+        return dict(
+            hits = hits,
+            misses = self.misses,
+            evictions = self.evictions,
+            size = len( self.cache ),
+            memoryUsage = self.memoryUsage,
+            )
+
+    def __add( self, args ):
+        """
+        Calls the function with the given arguments and caches the
+        result, evicting another result if the cache is full.
+        """
+
+        self.misses += 1
+        result = self.function( *args )
+        size = _getSize( args ) + _getSize( result )
+        for arg in args:
+            size += _getSize( arg )
+
+        if self.policy == _POLICY_UNBOUNDED:
+            if not self.cache.has_key( args ):
+                self.memoryUsage += size
+            self.cache[args] = result
+            return result
+
+        entry = self.cache.get( args )
+        if entry != None:
+            # The function cached its own result for these arguments
+            # (through a recursive call); replace it.
+            entry[_VALUE] = result
+            return result
+
+        if len( self.cache ) >= self.maxSize:
+            self.__evict()
+
+        if self.policy == _POLICY_LRU:
+            next = self.root[_NEXT]
+        else:
+            # New entries go just behind the clock's hand, so they're
+            # the last ones it gets to.
+            next = self.__hand
+        size += _getSize( self.root )
+        entry = [ next[_PREV], next, args, result, size, False ]
+        next[_PREV][_NEXT] = entry
+        next[_PREV] = entry
+        self.cache[args] = entry
+        self.memoryUsage += size
+        return result
+
+    def __evict( self ):
+        """
+        Discards one result from the cache, according to its policy.
+        """
+
+        if self.policy == _POLICY_LRU:
+            entry = self.root[_PREV]
+        else:
+            # Advance the clock's hand past the entries that have
+            # been referenced since it last passed them, clearing
+            # their reference bits.
+            entry = self.__hand
+            while entry is self.root or entry[_REFERENCED]:
+                entry[_REFERENCED] = False
+                entry = entry[_NEXT]
+            self.__hand = entry[_NEXT]
+
+        self.__unlink( entry )
+        del self.cache[ entry[_KEY] ]
+        self.memoryUsage -= entry[_SIZE]
+        self.evictions += 1
+
+    def __unlink( self, entry ):
+        entry[_PREV][_NEXT] = entry[_NEXT]
+        entry[_NEXT][_PREV] = entry[_PREV]
+
+    def __moveToFront( self, entry ):
+        root = self.root
+        if root[_NEXT] is not entry:
+            self.__unlink( entry )
+            entry[_PREV] = root
+            entry[_NEXT] = root[_NEXT]
+            root[_NEXT][_PREV] = entry
+            root[_NEXT] = entry
+
 
 def _generateArgWrapper( function, wrappedFunction ):
     """
@@ -179,7 +387,7 @@ def _generateArgWrapper( function, wrappedFunction ):
     return argWrapperGenerator( wrappedFunction )
 
 
-def memoized( function ):
+def memoized( function = None, maxsize = None, policy = "lru" ):
     """
     'Memoizes' the function, causing its results to be cached based on
     the called arguments.  When subsequent calls to function are made
@@ -237,29 +445,69 @@ def memoized( function ):
     (assuming that it should only be instantiated once) can be reused
     rather than re-instantiated (effectively providing the services of
     a flyweight pool).
+
+    By default, results are cached forever.  To bound the size of the
+    cache, give the maximum number of results to keep, and optionally
+    the policy that decides which result to discard when the cache is
+    full: "lru" (the least recently used result, the default) or
+    "clock" (an approximation of "lru" that makes cache hits cheaper).
+    For instance:
+
+      >>> @memoized( maxsize = 2 )
+      ... def double( a ):
+      ...   global timesCalled
+      ...   timesCalled += 1
+      ...   return a * 2
+      >>> timesCalled = 0
+      >>> [ double( i ) for i in [ 1, 2, 1, 3, 1, 2 ] ]
+      [2, 4, 2, 6, 2, 4]
+      >>> timesCalled
+      4
     """
 
-    mfWrap = _MemoizedFunction( function )
+    if function == None:
+        def decorator( function ):
+            return _makeMemoized( function, maxsize, policy )
+        return decorator
+
+    return _makeMemoized( function, maxsize, policy )
 
-    # For efficiency purposes, let's make it as easy to look up
-    # mfWrap.cache as possible.
-    cache = mfWrap.cache
+
+def _makeMemoized( function, maxsize, policy ):
+    """
+    Returns the memoized version of function; see memoized().
+    """
+
+    mfWrap = _MemoizedFunction( function, maxsize, policy )
 
     def memoizedFunctionWrapper( *args ):
-        # We're using a try-except clause here instead of testing
-        # whether the dictionary has a key because we believe that it
-        # is more efficient; it's preferable to speed up the most
-        # common scenario where a cached value already exists by
-        # simply assuming that it *does* exist.
-
-        try:
-            return cache[args]
-        except KeyError:
-            cache[args] = function( *args )
-            return cache[args]
+        return mfWrap.call( args )
     
     finalWrapper = _generateArgWrapper( function, memoizedFunctionWrapper )
 
+    if _memoize != None:
+        # The native function answers calls that pass all the
+        # arguments positionally from the cache, and passes all other
+        # calls on to finalWrapper.
+        args, varargs, varkw, defaults = inspect.getargspec( function )
+        if varargs == None:
+            maxArgs = len( args )
+        else:
+            maxArgs = -1
+        mfWrap.nativeFunction = _memoize.MemoizedFunction(
+            mfWrap.cache,
+            mfWrap.root,
+            mfWrap.policy,
+            len( args ),
+            maxArgs,
+            finalWrapper
+            )
+        finalWrapper = mfWrap.nativeFunction
+
+        # NOTE: doctest only looks for examples in the docstrings of
+        # Python functions, so it doesn't find this one's;
+        # tests/test_memoize.py runs them instead.
+
     return finalizeWrapper( function,
                             finalWrapper,
                             "Memoized" )
@@ -267,17 +515,32 @@ def memoized( function ):
 
 def getMemoizeStats():
     """
-    Returns a string describing the memoize usage dictionary.
+    Returns a string describing the memoize usage dictionary, followed
+    by the statistics of the cache of each memoized function.
     """
 
     STAT_STRING = \
         "Number of functions which used memoizing:  %(numFuncs)s\n" \
-        "Number of unique function values recorded: %(numValues)s"
+        "Number of unique function values recorded: %(numValues)s\n" \
+        "Approximate memory used by the caches:     %(memoryUsage)s bytes"
+
+    FUNCTION_STAT_STRING = \
+        "%(name)s: %(size)s values, %(hits)s hits, %(misses)s misses, " \
+        "%(evictions)s evictions, ~%(memoryUsage)s bytes"
+
+    allStats = [ i.getStats() for i in _memoizedFunctions ]
 
     info = STAT_STRING % dict(
         numFuncs = len( _memoizedFunctions ),
-        numValues = sum( [ len(i.cache.keys()) \
-                           for i in _memoizedFunctions ] ),
+        numValues = sum( [ stats["size"] for stats in allStats ] ),
+        memoryUsage = sum( [ stats["memoryUsage"] for stats in allStats ] ),
         )
 
-    return info
+    lines = [ info ]
+    for i in range( len(_memoizedFunctions) ):
+        function = _memoizedFunctions[i].function
+        stats = allStats[i]
+        stats["name"] = "%s.%s" % ( function.__module__, function.__name__ )
+        lines.append( FUNCTION_STAT_STRING % stats )
+
+    return "\n".join( lines )
@@ -34,9 +34,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 import sys, os, glob
 from stat import *
-from distutils.core import setup
+from distutils.core import setup, Extension
 from distutils.command.install import install as _install
 from distutils.command.install_data import install_data as _install_data
+from distutils.command.build_ext import build_ext as _build_ext
+from distutils.errors import CCompilerError, DistutilsExecError, \
+                             DistutilsPlatformError
 
 if sys.platform.startswith("win") or sys.platform == "darwin":
     # TODO: This script should work on OS X and Windows (see issue
@@ -48,6 +51,26 @@ if sys.platform.startswith("win") or sys.platform == "darwin":
 
 INSTALLED_FILES = "installed_files"
 
+# The errors that mean an extension module can't be built here (e.g.
+# there's no C++ compiler, or no Python or X11 headers).
+BUILD_EXT_ERRORS = (CCompilerError, DistutilsExecError, DistutilsPlatformError)
+
+class build_ext (_build_ext):
+    '''Builds the extension modules, skipping those that can't be built ;
+they're all optional, since each of them has a pure Python fallback.'''
+
+    def run (self):
+        try:
+            _build_ext.run (self)
+        except BUILD_EXT_ERRORS, e:
+            self.warn ("Not building the extension modules: %s" % e)
+
+    def build_extension (self, ext):
+        try:
+            _build_ext.build_extension (self, ext)
+        except BUILD_EXT_ERRORS, e:
+            self.warn ("Not building %s: %s" % (ext.name, e))
+
 class install (_install):
 
     def run (self):
@@ -159,6 +182,39 @@ if os.path.isdir (podir):
                 os.system (buildcmd % (name, name))
             data_files.append ((destpath % name, [mopath % name]))
 
+# Optional extension modules; each of them has a pure Python fallback.
+cxx_args = ["-std=c++98", "-fno-strict-aliasing"]
+ext_modules = [
+    Extension ("enso.commands._postfixindex",
+               ["src/core/PostfixIndex/PostfixIndex.cxx",
+                "src/core/PostfixIndex/postfixindexmodule.cxx"],
+               extra_compile_args = cxx_args),
+    Extension ("enso.commands._suggestionmarkup",
+               ["src/core/SuggestionMarkup/SuggestionMarkup.cxx",
+                "src/core/SuggestionMarkup/suggestionmarkupmodule.cxx"],
+               extra_compile_args = cxx_args),
+    Extension ("enso.graphics._linebreaker",
+               ["src/core/LineBreaker/LineBreaker.cxx",
+                "src/core/LineBreaker/linebreakermodule.cxx"],
+               extra_compile_args = cxx_args),
+    Extension ("enso.graphics._xmlmarkup",
+               ["src/core/XmlMarkup/XmlMarkup.cxx",
+                "src/core/XmlMarkup/xmlmarkupmodule.cxx"],
+               extra_compile_args = cxx_args),
+    Extension ("enso.utils._memoize",
+               ["src/core/Memoize/memoizemodule.cxx"],
+               extra_compile_args = cxx_args),
+    Extension ("enso.platform.linux._shapemask",
+               ["src/core/ShapeMask/ShapeMask.cxx",
+                "src/core/ShapeMask/shapemaskmodule.cxx"],
+               extra_compile_args = cxx_args),
+    Extension ("enso.platform.linux._xshmimage",
+               ["src/core/XShmImage/XShmImage.cxx",
+                "src/core/XShmImage/xshmimagemodule.cxx"],
+               libraries = ["X11", "Xext"],
+               extra_compile_args = cxx_args),
+    ]
+
 setup (
         name             = "Enso",
         version          = version,
@@ -183,8 +239,10 @@ setup (
                             "enso/quasimode",
                             "enso/utils",
                            ],
+        ext_modules      = ext_modules,
         scripts          = ["scripts/run_enso.py"],
         cmdclass         = {"uninstall" : uninstall,
                             "install" : install,
+                            "build_ext" : build_ext,
                             "install_data" : install_data}
      )
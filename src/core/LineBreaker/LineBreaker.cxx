@@ -0,0 +1,203 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Implementation file for the LineBreaker module.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include "LineBreaker.h"
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Appends the glyphs from line.end up to (but not including) end to
+ * the given line, positioning them from the given cursor position,
+ * which is advanced past them.
+ * ----------------------------------------------------------------------*/
+
+static void
+_addGlyphs( LineSpan &line,
+            double &cursor,
+            size_t end,
+            const double *advances,
+            std::vector<double> &positions )
+{
+    for ( size_t i = line.end; i < end; i++ )
+    {
+        positions[i] = cursor;
+        cursor += advances[i];
+    }
+    line.end = end;
+}
+
+/* ------------------------------------------------------------------------
+ * Appends the given line to lines, leaving out its trailing
+ * whitespace glyph (if any).
+ * ----------------------------------------------------------------------*/
+
+static void
+_finishLine( LineSpan line,
+             const unsigned char *isWhitespace,
+             std::vector<LineSpan> &lines )
+{
+    if ( !line.hasEllipsis &&
+         line.end - line.start > 1 &&
+         isWhitespace[line.end - 1] )
+        line.end--;
+
+    lines.push_back( line );
+}
+
+
+/* ***************************************************************************
+ * Public Functions
+ * **************************************************************************/
+
+LineBreakStatus
+breakLines( const double *advances,
+            const unsigned char *isWhitespace,
+            size_t numGlyphs,
+            double width,
+            long maxLines,
+            bool ellipsify,
+            double ellipsisAdvance,
+            std::vector<LineSpan> &lines,
+            std::vector<double> &positions,
+            size_t &badGlyph )
+{
+    /* The glyphs of the current line are in [line.start, line.end),
+     * and are followed by those of the current word, which start at
+     * line.end and haven't been added to the line yet. */
+    LineSpan line = { 0, 0, false, false };
+    double cursor = 0.0;
+    double lineLength = 0.0;
+    double wordLength = 0.0;
+
+    positions.assign( numGlyphs + 1, 0.0 );
+
+    for ( size_t i = 0; i < numGlyphs; i++ )
+    {
+        double advance = advances[i];
+
+        if ( lineLength + advance > width )
+        {
+            if ( lineLength == 0.0 )
+            {
+                badGlyph = i;
+                return LINE_BREAK_GLYPH_TOO_WIDE;
+            }
+
+            if ( (long) lines.size() == maxLines - 1 )
+            {
+                if ( !ellipsify )
+                    return LINE_BREAK_TOO_MANY_LINES;
+
+                /* Make room for the ellipsis at the end of this line,
+                 * and drop the rest of the glyphs. */
+                _addGlyphs( line, cursor, i, advances, positions );
+                wordLength = 0.0;
+                while ( cursor + ellipsisAdvance > width )
+                {
+                    if ( line.end == line.start )
+                    {
+                        badGlyph = numGlyphs;
+                        return LINE_BREAK_GLYPH_TOO_WIDE;
+                    }
+                    line.end--;
+                    cursor = positions[line.end];
+                }
+                positions[numGlyphs] = cursor;
+                line.hasEllipsis = true;
+                break;
+            }
+
+            /* If the line has no word on it besides the current one,
+             * the current word is broken here; if this glyph is
+             * whitespace, it ends the current word and is replaced
+             * by the line break.  Otherwise, the current word is
+             * moved to the next line. */
+            size_t nextStart = line.end;
+
+            if ( lineLength == wordLength || isWhitespace[i] )
+            {
+                _addGlyphs( line, cursor, i, advances, positions );
+                if ( isWhitespace[i] )
+                {
+                    nextStart = i + 1;
+                    wordLength = 0.0;
+                }
+                else
+                {
+                    nextStart = i;
+                    wordLength = advance;
+                }
+            }
+            else
+            {
+                wordLength += advance;
+            }
+
+            _finishLine( line, isWhitespace, lines );
+            lineLength = wordLength;
+            line.start = nextStart;
+            line.end = nextStart;
+            cursor = 0.0;
+        }
+        else if ( isWhitespace[i] )
+        {
+            /* The whitespace ends the current word, which is added
+             * to the line along with it. */
+            _addGlyphs( line, cursor, i + 1, advances, positions );
+            lineLength += advance;
+            wordLength = 0.0;
+        }
+        else
+        {
+            lineLength += advance;
+            wordLength += advance;
+        }
+    }
+
+    if ( wordLength > 0.0 )
+        _addGlyphs( line, cursor, numGlyphs, advances, positions );
+
+    if ( lineLength > 0.0 )
+    {
+        line.isPartial = true;
+        _finishLine( line, isWhitespace, lines );
+    }
+
+    return LINE_BREAK_OK;
+}
@@ -0,0 +1,136 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Header file for the LineBreaker module.
+ *
+ *   The LineBreaker module word-wraps the glyphs of a
+ *   enso.graphics.textlayout.Block into lines, and computes the
+ *   position of each glyph on its line.  It only needs the advance
+ *   of each glyph and whether it is (breaking) whitespace, which
+ *   the block passes as packed arrays.
+ *
+ *   The result is exactly that of the original, pure Python
+ *   implementation of Block.layout() (see
+ *   textlayout._breakLinesInPython()), down to the order in which
+ *   advances are added up, so that both implementations break
+ *   lines at the same places.
+ *
+ *   This module doesn't depend on Python; see linebreakermodule.cxx
+ *   for the Python bindings.
+ */
+
+#ifndef _LINEBREAKER_H_
+#define _LINEBREAKER_H_
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <cstddef>
+#include <vector>
+
+
+/* ***************************************************************************
+ * Type Definitions
+ * **************************************************************************/
+
+/* The outcome of breaking glyphs into lines.  These values are
+ * also used by enso.graphics.textlayout, so they must not change. */
+enum LineBreakStatus
+{
+    /* The glyphs were broken into lines. */
+    LINE_BREAK_OK = 0,
+
+    /* A glyph (or the ellipsis) is wider than the block. */
+    LINE_BREAK_GLYPH_TOO_WIDE = 1,
+
+    /* The glyphs need more than the maximum number of lines, and
+     * they can't be ellipsified. */
+    LINE_BREAK_TOO_MANY_LINES = 2
+};
+
+/* A line, as a range of glyphs. */
+struct LineSpan
+{
+    /* The glyphs on the line are those from start up to (but not
+     * including) end; a trailing whitespace glyph is left out. */
+    size_t start;
+    size_t end;
+
+    /* Whether the line isn't full, i.e., whether it's the last line
+     * of the block and wasn't word-wrapped. */
+    bool isPartial;
+
+    /* Whether the line is followed by an ellipsis, because the
+     * glyphs didn't fit in the maximum number of lines. */
+    bool hasEllipsis;
+};
+
+
+/* ***************************************************************************
+ * Function Declarations
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Breaks the given glyphs into lines no wider than the given width.
+ * ........................................................................
+ *
+ * There are numGlyphs glyphs; advances[i] is the advance of glyph
+ * i, and isWhitespace[i] is non-zero if it is breaking whitespace.
+ *
+ * If maxLines is positive, at most that many lines are made: if
+ * ellipsify is true, the last of them is truncated to make room for
+ * an ellipsis with the given advance, and the rest of the glyphs
+ * are dropped; otherwise, LINE_BREAK_TOO_MANY_LINES is returned.
+ *
+ * On success, the lines are appended to lines, and positions is
+ * set to numGlyphs + 1 values: positions[i] is the x-position of
+ * glyph i relative to the start of its line, and
+ * positions[numGlyphs] is that of the ellipsis, if any.  The
+ * positions of glyphs that aren't on any line are meaningless.
+ *
+ * If LINE_BREAK_GLYPH_TOO_WIDE is returned, badGlyph is set to the
+ * index of the glyph that's too wide, which is numGlyphs for the
+ * ellipsis.
+ *
+ * ----------------------------------------------------------------------*/
+
+LineBreakStatus
+breakLines( const double *advances,
+            const unsigned char *isWhitespace,
+            size_t numGlyphs,
+            double width,
+            long maxLines,
+            bool ellipsify,
+            double ellipsisAdvance,
+            std::vector<LineSpan> &lines,
+            std::vector<double> &positions,
+            size_t &badGlyph );
+
+#endif
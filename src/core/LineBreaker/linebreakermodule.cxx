@@ -0,0 +1,206 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Python bindings for the LineBreaker module.
+ *
+ *   This builds the enso.graphics._linebreaker extension module,
+ *   which is used by enso.graphics.textlayout when it's available.
+ *   See that module for documentation of the Python interface.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <Python.h>
+
+#include <new>
+
+#include "LineBreaker.h"
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+#if PY_VERSION_HEX < 0x02050000 && !defined( PY_SSIZE_T_MIN )
+typedef int Py_ssize_t;
+#endif
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Converts the given lines and positions to a list of
+ * (start, end, isPartial, hasEllipsis) tuples and a list of floats.
+ *
+ * Returns 0 and sets the Python error state on failure.
+ * ----------------------------------------------------------------------*/
+
+static int
+_toPython( const std::vector<LineSpan> &lines,
+           const std::vector<double> &positions,
+           PyObject **linesResult,
+           PyObject **positionsResult )
+{
+    *linesResult = PyList_New( (Py_ssize_t) lines.size() );
+    *positionsResult = PyList_New( (Py_ssize_t) positions.size() );
+    if ( *linesResult == NULL || *positionsResult == NULL )
+        goto error;
+
+    for ( size_t i = 0; i < lines.size(); i++ )
+    {
+        PyObject *line = Py_BuildValue( "(llii)",
+                                        (long) lines[i].start,
+                                        (long) lines[i].end,
+                                        (int) lines[i].isPartial,
+                                        (int) lines[i].hasEllipsis );
+        if ( line == NULL )
+            goto error;
+        PyList_SET_ITEM( *linesResult, (Py_ssize_t) i, line );
+    }
+
+    for ( size_t i = 0; i < positions.size(); i++ )
+    {
+        PyObject *position = PyFloat_FromDouble( positions[i] );
+        if ( position == NULL )
+            goto error;
+        PyList_SET_ITEM( *positionsResult, (Py_ssize_t) i, position );
+    }
+
+    return 1;
+
+error:
+    Py_XDECREF( *linesResult );
+    Py_XDECREF( *positionsResult );
+    return 0;
+}
+
+
+/* ***************************************************************************
+ * Module Functions
+ * **************************************************************************/
+
+static PyObject *
+linebreaker_breakLines( PyObject *self,
+                        PyObject *args )
+{
+    PyObject *advancesObject;
+    PyObject *isWhitespaceObject;
+    double width;
+    long maxLines;
+    int ellipsify;
+    double ellipsisAdvance;
+    const void *advances;
+    const void *isWhitespace;
+    Py_ssize_t advancesSize;
+    Py_ssize_t isWhitespaceSize;
+
+    if ( !PyArg_ParseTuple( args, "OOdlid:breakLines",
+                            &advancesObject, &isWhitespaceObject,
+                            &width, &maxLines, &ellipsify,
+                            &ellipsisAdvance ) )
+        return NULL;
+
+    if ( PyObject_AsReadBuffer( advancesObject, &advances,
+                                &advancesSize ) < 0 ||
+         PyObject_AsReadBuffer( isWhitespaceObject, &isWhitespace,
+                                &isWhitespaceSize ) < 0 )
+        return NULL;
+
+    size_t numGlyphs = (size_t) isWhitespaceSize;
+    if ( (size_t) advancesSize != numGlyphs * sizeof( double ) )
+    {
+        PyErr_SetString( PyExc_ValueError,
+                         "advances and isWhitespace differ in length" );
+        return NULL;
+    }
+
+    std::vector<LineSpan> lines;
+    std::vector<double> positions;
+    size_t badGlyph = 0;
+    LineBreakStatus status;
+
+    try
+    {
+        status = breakLines( (const double *) advances,
+                             (const unsigned char *) isWhitespace,
+                             numGlyphs,
+                             width,
+                             maxLines,
+                             ellipsify != 0,
+                             ellipsisAdvance,
+                             lines,
+                             positions,
+                             badGlyph );
+    }
+    catch ( std::bad_alloc & )
+    {
+        return PyErr_NoMemory();
+    }
+
+    if ( status != LINE_BREAK_OK )
+        return Py_BuildValue( "(il[][])", (int) status, (long) badGlyph );
+
+    PyObject *linesResult;
+    PyObject *positionsResult;
+
+    if ( !_toPython( lines, positions, &linesResult, &positionsResult ) )
+        return NULL;
+
+    return Py_BuildValue( "(iiNN)", (int) status, 0,
+                          linesResult, positionsResult );
+}
+
+
+/* ***************************************************************************
+ * Module Initialization
+ * **************************************************************************/
+
+static PyMethodDef linebreaker_methods[] = {
+    { "breakLines",
+      linebreaker_breakLines,
+      METH_VARARGS,
+      "breakLines(advances, isWhitespace, width, maxLines, ellipsify, "
+      "ellipsisAdvance) -> (status, badGlyph, lines, positions)\n\n"
+      "Breaks glyphs into lines, given their advances as an array of "
+      "doubles and their whitespace flags as an array of bytes." },
+    { NULL, NULL, 0, NULL }
+};
+
+PyMODINIT_FUNC
+init_linebreaker( void )
+{
+    Py_InitModule3( "enso.graphics._linebreaker",
+                    linebreaker_methods,
+                    "Native implementation of the line breaking "
+                    "used by enso.graphics.textlayout." );
+}
@@ -0,0 +1,395 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   The _memoize extension module.
+ *
+ *   This builds the enso.utils._memoize extension module, which is
+ *   used by enso.utils.memoize when it's available.  It provides the
+ *   callable objects that memoized functions are replaced with,
+ *   which return cached results directly from C when they're called
+ *   with only positional arguments, and otherwise pass the call on to
+ *   the Python implementation of the memoized function.  See that
+ *   module for documentation of the caches and their entries, which
+ *   are shared by both.
+ *
+ *   Unlike the other extension modules, there is no part of this one
+ *   that's independent of Python.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <Python.h>
+#include <structmember.h>
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+#if PY_VERSION_HEX < 0x02050000 && !defined( PY_SSIZE_T_MIN )
+typedef int Py_ssize_t;
+#endif
+
+
+/* ***************************************************************************
+ * Constants
+ * **************************************************************************/
+
+/* Cache policies; these are the same as the _POLICY_* values of
+ * enso.utils.memoize. */
+enum
+{
+    POLICY_UNBOUNDED = 0,
+    POLICY_LRU = 1,
+    POLICY_CLOCK = 2
+};
+
+/* Indices of the fields of the entries of bounded caches, which are
+ * lists of the form [ prev, next, key, value, size, referenced ]. */
+enum
+{
+    ENTRY_PREV = 0,
+    ENTRY_NEXT = 1,
+    ENTRY_VALUE = 3,
+    ENTRY_REFERENCED = 5,
+    ENTRY_LENGTH = 6
+};
+
+
+/* ***************************************************************************
+ * MemoizedFunction Type
+ * **************************************************************************/
+
+typedef struct
+{
+    PyObject_HEAD
+
+    /* The cache, which maps argument tuples to results (for
+     * unbounded caches) or to entries. */
+    PyObject *cache;
+
+    /* The root of the circular doubly-linked list of the entries of
+     * an LRU cache. */
+    PyObject *root;
+
+    /* One of the POLICY_* values. */
+    int policy;
+
+    /* The range of numbers of positional arguments that make up a
+     * complete argument tuple; maxArgs is -1 if there's no upper
+     * bound. */
+    int minArgs;
+    int maxArgs;
+
+    /* The Python implementation of the memoized function. */
+    PyObject *slowPath;
+
+    /* The object's __dict__. */
+    PyObject *dict;
+
+    /* The number of calls answered directly from the cache. */
+    long hits;
+} MemoizedFunction;
+
+/* ------------------------------------------------------------------------
+ * Sets the given item of the given list, which is assumed to be
+ * long enough, to a new reference to value.
+ * ----------------------------------------------------------------------*/
+
+static void
+_setItem( PyObject *list,
+          Py_ssize_t index,
+          PyObject *value )
+{
+    Py_INCREF( value );
+    PyList_SetItem( list, index, value );
+}
+
+/* ------------------------------------------------------------------------
+ * Moves the given entry of an LRU cache to the front of its list,
+ * like enso.utils.memoize._MemoizedFunction.__moveToFront().
+ *
+ * All the entries are referenced by the cache, so the borrowed
+ * references used here remain valid throughout.
+ * ----------------------------------------------------------------------*/
+
+static void
+_moveToFront( PyObject *root,
+              PyObject *entry )
+{
+    PyObject *first = PyList_GET_ITEM( root, ENTRY_NEXT );
+
+    if ( first == entry )
+        return;
+
+    PyObject *prev = PyList_GET_ITEM( entry, ENTRY_PREV );
+    PyObject *next = PyList_GET_ITEM( entry, ENTRY_NEXT );
+
+    _setItem( prev, ENTRY_NEXT, next );
+    _setItem( next, ENTRY_PREV, prev );
+    _setItem( entry, ENTRY_PREV, root );
+    _setItem( entry, ENTRY_NEXT, first );
+    _setItem( first, ENTRY_PREV, entry );
+    _setItem( root, ENTRY_NEXT, entry );
+}
+
+/* ------------------------------------------------------------------------
+ * Returns a borrowed reference to the cached result for the given
+ * arguments, or NULL if there is none (or if the cache's contents
+ * aren't what they should be).
+ * ----------------------------------------------------------------------*/
+
+static PyObject *
+_lookUp( MemoizedFunction *self,
+         PyObject *args )
+{
+    PyObject *item = PyDict_GetItem( self->cache, args );
+
+    if ( item == NULL || self->policy == POLICY_UNBOUNDED )
+        return item;
+
+    if ( !PyList_CheckExact( item ) ||
+         PyList_GET_SIZE( item ) != ENTRY_LENGTH )
+        return NULL;
+
+    if ( self->policy == POLICY_LRU )
+        _moveToFront( self->root, item );
+    else if ( PyList_GET_ITEM( item, ENTRY_REFERENCED ) != Py_True )
+        _setItem( item, ENTRY_REFERENCED, Py_True );
+
+    return PyList_GET_ITEM( item, ENTRY_VALUE );
+}
+
+static PyObject *
+MemoizedFunction_call( MemoizedFunction *self,
+                       PyObject *args,
+                       PyObject *kwargs )
+{
+    Py_ssize_t numArgs = PyTuple_GET_SIZE( args );
+
+    if ( ( kwargs == NULL || PyDict_Size( kwargs ) == 0 ) &&
+         numArgs >= self->minArgs &&
+         ( self->maxArgs < 0 || numArgs <= self->maxArgs ) )
+    {
+        PyObject *value = _lookUp( self, args );
+
+        if ( value != NULL )
+        {
+            self->hits++;
+            Py_INCREF( value );
+            return value;
+        }
+    }
+
+    return PyObject_Call( self->slowPath, args, kwargs );
+}
+
+/* ------------------------------------------------------------------------
+ * Binds the memoized function to an instance, like a Python function
+ * does when it's used as a method.
+ * ----------------------------------------------------------------------*/
+
+static PyObject *
+MemoizedFunction_descr_get( PyObject *self,
+                            PyObject *obj,
+                            PyObject *type )
+{
+    if ( obj == NULL || obj == Py_None )
+    {
+        Py_INCREF( self );
+        return self;
+    }
+
+    return PyMethod_New( self, obj, type );
+}
+
+static int
+MemoizedFunction_init( MemoizedFunction *self,
+                       PyObject *args,
+                       PyObject *kwargs )
+{
+    PyObject *cache;
+    PyObject *root;
+    int policy;
+    int minArgs;
+    int maxArgs;
+    PyObject *slowPath;
+
+    if ( !PyArg_ParseTuple( args, "O!OiiiO:MemoizedFunction",
+                            &PyDict_Type, &cache, &root, &policy,
+                            &minArgs, &maxArgs, &slowPath ) )
+        return -1;
+
+    if ( policy == POLICY_LRU && ( !PyList_CheckExact( root ) ||
+                                   PyList_GET_SIZE( root ) !=
+                                   ENTRY_LENGTH ) )
+    {
+        PyErr_SetString( PyExc_TypeError,
+                         "root must be an entry of an LRU cache" );
+        return -1;
+    }
+
+    if ( policy < POLICY_UNBOUNDED || policy > POLICY_CLOCK )
+    {
+        PyErr_SetString( PyExc_ValueError, "unknown cache policy" );
+        return -1;
+    }
+
+    Py_INCREF( cache );
+    Py_XDECREF( self->cache );
+    self->cache = cache;
+
+    Py_INCREF( root );
+    Py_XDECREF( self->root );
+    self->root = root;
+
+    Py_INCREF( slowPath );
+    Py_XDECREF( self->slowPath );
+    self->slowPath = slowPath;
+
+    self->policy = policy;
+    self->minArgs = minArgs;
+    self->maxArgs = maxArgs;
+    self->hits = 0;
+
+    return 0;
+}
+
+static int
+MemoizedFunction_traverse( MemoizedFunction *self,
+                           visitproc visit,
+                           void *arg )
+{
+    Py_VISIT( self->cache );
+    Py_VISIT( self->root );
+    Py_VISIT( self->slowPath );
+    Py_VISIT( self->dict );
+    return 0;
+}
+
+static int
+MemoizedFunction_clear( MemoizedFunction *self )
+{
+    Py_CLEAR( self->cache );
+    Py_CLEAR( self->root );
+    Py_CLEAR( self->slowPath );
+    Py_CLEAR( self->dict );
+    return 0;
+}
+
+static void
+MemoizedFunction_dealloc( MemoizedFunction *self )
+{
+    PyObject_GC_UnTrack( self );
+    MemoizedFunction_clear( self );
+    self->ob_type->tp_free( (PyObject *) self );
+}
+
+static PyMemberDef MemoizedFunction_members[] = {
+    { (char *) "hits", T_LONG, offsetof( MemoizedFunction, hits ), 0,
+      (char *) "The number of calls answered directly from the cache." },
+    { NULL, 0, 0, 0, NULL }
+};
+
+static PyTypeObject MemoizedFunctionType = {
+    PyObject_HEAD_INIT( NULL )
+    0,                                          /* ob_size */
+    "enso.utils._memoize.MemoizedFunction",     /* tp_name */
+    sizeof( MemoizedFunction ),                 /* tp_basicsize */
+    0,                                          /* tp_itemsize */
+    (destructor) MemoizedFunction_dealloc,      /* tp_dealloc */
+    0,                                          /* tp_print */
+    0,                                          /* tp_getattr */
+    0,                                          /* tp_setattr */
+    0,                                          /* tp_compare */
+    0,                                          /* tp_repr */
+    0,                                          /* tp_as_number */
+    0,                                          /* tp_as_sequence */
+    0,                                          /* tp_as_mapping */
+    0,                                          /* tp_hash */
+    (ternaryfunc) MemoizedFunction_call,        /* tp_call */
+    0,                                          /* tp_str */
+    PyObject_GenericGetAttr,                    /* tp_getattro */
+    PyObject_GenericSetAttr,                    /* tp_setattro */
+    0,                                          /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,    /* tp_flags */
+    "MemoizedFunction(cache, root, policy, minArgs, maxArgs, slowPath)\n\n"
+    "A memoized function, which looks up calls with only positional "
+    "arguments in cache, and passes other calls (and calls whose "
+    "results aren't cached) on to slowPath.",   /* tp_doc */
+    (traverseproc) MemoizedFunction_traverse,   /* tp_traverse */
+    (inquiry) MemoizedFunction_clear,           /* tp_clear */
+    0,                                          /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    0,                                          /* tp_iter */
+    0,                                          /* tp_iternext */
+    0,                                          /* tp_methods */
+    MemoizedFunction_members,                   /* tp_members */
+    0,                                          /* tp_getset */
+    0,                                          /* tp_base */
+    0,                                          /* tp_dict */
+    MemoizedFunction_descr_get,                 /* tp_descr_get */
+    0,                                          /* tp_descr_set */
+    offsetof( MemoizedFunction, dict ),         /* tp_dictoffset */
+    (initproc) MemoizedFunction_init,           /* tp_init */
+    0,                                          /* tp_alloc */
+    0,                                          /* tp_new */
+};
+
+
+/* ***************************************************************************
+ * Module Initialization
+ * **************************************************************************/
+
+static PyMethodDef memoize_methods[] = {
+    { NULL, NULL, 0, NULL }
+};
+
+PyMODINIT_FUNC
+init_memoize( void )
+{
+    PyObject *module;
+
+    MemoizedFunctionType.tp_new = PyType_GenericNew;
+    if ( PyType_Ready( &MemoizedFunctionType ) < 0 )
+        return;
+
+    module = Py_InitModule3( "enso.utils._memoize",
+                             memoize_methods,
+                             "Native implementation of the memoized "
+                             "functions of enso.utils.memoize." );
+    if ( module == NULL )
+        return;
+
+    Py_INCREF( &MemoizedFunctionType );
+    PyModule_AddObject( module, "MemoizedFunction",
+                        (PyObject *) &MemoizedFunctionType );
+}
@@ -0,0 +1,752 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*   Implementation file for the PostfixIndex module.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include "PostfixIndex.h"
+
+#include <algorithm>
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+#define SPACE ( (CodePoint) ' ' )
+
+/* Pads the trigrams taken from the last two characters of a
+ * postfix; it sorts after every real character. */
+#define END_OF_TEXT ( (CodePoint) 0xffffffff )
+
+
+/* ***************************************************************************
+ * Private Helper Functions and Classes
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Returns whether the given character is a "word" character, as
+ * defined by Python's non-unicode regular expressions.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+static bool
+_isWordChar( CodePoint character )
+{
+    return ( ( character >= 'a' && character <= 'z' ) ||
+             ( character >= 'A' && character <= 'Z' ) ||
+             ( character >= '0' && character <= '9' ) ||
+             character == '_' );
+}
+
+/* ------------------------------------------------------------------------
+ * Returns whether the given position of the given text is at a word
+ * boundary, as defined by the "\b" regular expression escape.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+static bool
+_isWordBoundary( const CodePointString &text,
+                 size_t position )
+{
+    bool before = ( position > 0 && _isWordChar( text[position - 1] ) );
+    bool after = ( position < text.size() && _isWordChar( text[position] ) );
+
+    return before != after;
+}
+
+/* ------------------------------------------------------------------------
+ * Returns the given text with each run of spaces collapsed into a
+ * single space.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+static CodePointString
+_collapseSpaces( const CodePointString &text )
+{
+    CodePointString result;
+
+    result.reserve( text.size() );
+    for ( size_t i = 0; i < text.size(); i++ )
+    {
+        if ( text[i] != SPACE || result.empty() || result.back() != SPACE )
+            result.push_back( text[i] );
+    }
+
+    return result;
+}
+
+/* ------------------------------------------------------------------------
+ * Orders the indices of a list of strings by the strings they refer
+ * to.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+class _IndirectStringLess
+{
+public:
+    _IndirectStringLess( const std::vector<CodePointString> &strings ) :
+        _strings( strings ) {}
+
+    bool operator()( size_t a, size_t b ) const
+    {
+        return _strings[a] < _strings[b];
+    }
+
+private:
+    const std::vector<CodePointString> &_strings;
+};
+
+
+/* ***************************************************************************
+ * MatchPattern Public Methods
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Compiles the given user text.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+MatchPattern::MatchPattern( const CodePointString &userText,
+                            const EquivalentChars &equivalentChars )
+{
+    for ( size_t i = 0; i < userText.size(); i++ )
+    {
+        CodePoint character = userText[i];
+
+        if ( character == SPACE )
+        {
+            /* Consecutive spaces in the user text must match at
+             * least as many consecutive spaces in the postfix. */
+            if ( !_tokens.empty() && _tokens.back().minSpaces > 0 )
+            {
+                _tokens.back().minSpaces++;
+            }
+            else
+            {
+                Token token;
+                token.alternatives.push_back( SPACE );
+                token.minSpaces = 1;
+                _tokens.push_back( token );
+            }
+        }
+        else
+        {
+            Token token;
+            EquivalentChars::const_iterator it;
+
+            it = equivalentChars.find( character );
+            if ( it != equivalentChars.end() && !it->second.empty() )
+            {
+                token.alternatives = it->second;
+                std::sort( token.alternatives.begin(),
+                           token.alternatives.end() );
+                token.alternatives.erase(
+                    std::unique( token.alternatives.begin(),
+                                 token.alternatives.end() ),
+                    token.alternatives.end() );
+            }
+            else
+            {
+                token.alternatives.push_back( character );
+            }
+            token.minSpaces = 0;
+            _tokens.push_back( token );
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Returns whether the pattern matches the given text at the given
+ * position.
+ * ........................................................................
+ *
+ * Since a run of spaces in the pattern is always followed by a
+ * character that can't be a space, it's safe to match runs of
+ * spaces greedily; no backtracking is ever needed.
+ *
+ * ----------------------------------------------------------------------*/
+
+bool
+MatchPattern::matchesAt( const CodePointString &text,
+                         size_t position ) const
+{
+    size_t length = text.size();
+
+    for ( size_t i = 0; i < _tokens.size(); i++ )
+    {
+        const Token &token = _tokens[i];
+
+        if ( token.minSpaces > 0 )
+        {
+            size_t spaces = 0;
+            while ( position < length && text[position] == SPACE )
+            {
+                position++;
+                spaces++;
+            }
+            if ( spaces < token.minSpaces )
+                return false;
+        }
+        else
+        {
+            if ( position >= length )
+                return false;
+
+            CodePoint character = text[position];
+            size_t j;
+            for ( j = 0; j < token.alternatives.size(); j++ )
+            {
+                if ( token.alternatives[j] == character )
+                    break;
+            }
+            if ( j == token.alternatives.size() )
+                return false;
+            position++;
+        }
+    }
+
+    return true;
+}
+
+/* ------------------------------------------------------------------------
+ * Returns the leftmost position, no earlier than start, at which the
+ * pattern matches the given text, or -1.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+int
+MatchPattern::search( const CodePointString &text,
+                      size_t start,
+                      bool wordStart ) const
+{
+    for ( size_t position = start; position <= text.size(); position++ )
+    {
+        if ( wordStart && !_isWordBoundary( text, position ) )
+            continue;
+        if ( matchesAt( text, position ) )
+            return (int) position;
+    }
+
+    return -1;
+}
+
+
+/* ***************************************************************************
+ * PostfixIndex Public Methods
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Builds the index for the given postfixes.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+PostfixIndex::PostfixIndex( const std::vector<CodePointString> &postfixes )
+{
+    for ( size_t i = 0; i < postfixes.size(); i++ )
+    {
+        if ( !postfixes[i].empty() )
+            _originalIndices.push_back( i );
+    }
+
+    std::stable_sort( _originalIndices.begin(),
+                      _originalIndices.end(),
+                      _IndirectStringLess( postfixes ) );
+
+    _postfixes.reserve( _originalIndices.size() );
+    for ( size_t id = 0; id < _originalIndices.size(); id++ )
+        _postfixes.push_back( postfixes[_originalIndices[id]] );
+
+    _buildTrigramIndex();
+}
+
+/* ------------------------------------------------------------------------
+ * Finds all postfixes that start with the given pattern.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+void
+PostfixIndex::findPrefixMatches( const MatchPattern &pattern,
+                                 std::vector<size_t> &results ) const
+{
+    std::vector<IdRange> found;
+    IdRange all;
+
+    all.begin = 0;
+    all.end = _postfixes.size();
+    _walkTrie( pattern, 0, all, 0, found );
+
+    /* The ranges found are disjoint, but they aren't necessarily in
+     * order, since equivalent characters are tried in the order of
+     * their alternatives rather than in the order of the postfixes. */
+    std::vector< std::pair<size_t, size_t> > ranges;
+    for ( size_t i = 0; i < found.size(); i++ )
+        ranges.push_back( std::make_pair( found[i].begin, found[i].end ) );
+    std::sort( ranges.begin(), ranges.end() );
+
+    for ( size_t i = 0; i < ranges.size(); i++ )
+    {
+        for ( size_t id = ranges[i].first; id < ranges[i].second; id++ )
+            results.push_back( id );
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Finds all postfixes that contain the given pattern.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+void
+PostfixIndex::findSubstringMatches( const MatchPattern &pattern,
+                                    bool wordStart,
+                                    std::vector<size_t> &results ) const
+{
+    std::vector<size_t> candidates;
+    bool allPostfixes;
+
+    _getCandidates( pattern, candidates, allPostfixes );
+
+    if ( allPostfixes )
+    {
+        for ( size_t id = 0; id < _postfixes.size(); id++ )
+        {
+            if ( pattern.search( _postfixes[id], 0, wordStart ) >= 0 )
+                results.push_back( id );
+        }
+    }
+    else
+    {
+        for ( size_t i = 0; i < candidates.size(); i++ )
+        {
+            size_t id = candidates[i];
+            if ( pattern.search( _postfixes[id], 0, wordStart ) >= 0 )
+                results.push_back( id );
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Returns the number of postfixes in the index.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+size_t
+PostfixIndex::size( void ) const
+{
+    return _postfixes.size();
+}
+
+/* ------------------------------------------------------------------------
+ * Maps an id back to the original position of its postfix.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+size_t
+PostfixIndex::originalIndex( size_t id ) const
+{
+    return _originalIndices[id];
+}
+
+
+/* ***************************************************************************
+ * PostfixIndex Private Methods
+ * **************************************************************************/
+
+bool
+PostfixIndex::Trigram::operator<( const Trigram &other ) const
+{
+    for ( int i = 0; i < 3; i++ )
+    {
+        if ( chars[i] != other.chars[i] )
+            return chars[i] < other.chars[i];
+    }
+    return false;
+}
+
+bool
+PostfixIndex::Trigram::operator==( const Trigram &other ) const
+{
+    return ( chars[0] == other.chars[0] &&
+             chars[1] == other.chars[1] &&
+             chars[2] == other.chars[2] );
+}
+
+/* ------------------------------------------------------------------------
+ * Builds the trigram inverted index.
+ * ........................................................................
+ *
+ * Trigrams are taken from the postfixes with their runs of spaces
+ * collapsed, so that a single space in the user text can be looked
+ * up no matter how many spaces it will eventually match.
+ *
+ * Every position of a postfix starts a trigram, padded with
+ * END_OF_TEXT if need be; this way, since the trigrams are sorted,
+ * the postfixes containing any one or two characters can also be
+ * looked up, as a contiguous range of trigrams.
+ *
+ * ----------------------------------------------------------------------*/
+
+void
+PostfixIndex::_buildTrigramIndex( void )
+{
+    std::vector< std::pair<Trigram, unsigned int> > entries;
+
+    for ( size_t id = 0; id < _postfixes.size(); id++ )
+    {
+        CodePointString text = _collapseSpaces( _postfixes[id] );
+
+        for ( size_t i = 0; i < text.size(); i++ )
+        {
+            Trigram trigram;
+            for ( size_t j = 0; j < 3; j++ )
+            {
+                if ( i + j < text.size() )
+                    trigram.chars[j] = text[i + j];
+                else
+                    trigram.chars[j] = END_OF_TEXT;
+            }
+            entries.push_back( std::make_pair( trigram, (unsigned int) id ) );
+        }
+    }
+
+    /* Sorting by (trigram, id) groups each trigram's postings
+     * together, in id order; a postfix that contains the same
+     * trigram more than once only needs to be listed once. */
+    std::sort( entries.begin(), entries.end() );
+    entries.erase( std::unique( entries.begin(), entries.end() ),
+                   entries.end() );
+
+    _postings.reserve( entries.size() );
+    for ( size_t i = 0; i < entries.size(); i++ )
+    {
+        if ( i == 0 || !( entries[i].first == entries[i - 1].first ) )
+        {
+            _trigrams.push_back( entries[i].first );
+            _postingStarts.push_back( i );
+        }
+        _postings.push_back( entries[i].second );
+    }
+    _postingStarts.push_back( entries.size() );
+}
+
+/* ------------------------------------------------------------------------
+ * Narrows down a trie node to one of its children.
+ * ........................................................................
+ *
+ * Given a range of ids whose postfixes all share the same prefix of
+ * the given length, returns the subrange whose postfixes continue
+ * with the given character.  Postfixes that end at the given depth
+ * sort first within the range, and the rest are sorted by their
+ * next character, so the subrange can be found by binary search.
+ *
+ * ----------------------------------------------------------------------*/
+
+PostfixIndex::IdRange
+PostfixIndex::_narrow( const IdRange &range,
+                       size_t depth,
+                       CodePoint character ) const
+{
+    IdRange result;
+    size_t low;
+    size_t high;
+
+    low = range.begin;
+    high = range.end;
+    while ( low < high )
+    {
+        size_t middle = low + ( high - low ) / 2;
+        const CodePointString &postfix = _postfixes[middle];
+        if ( postfix.size() <= depth || postfix[depth] < character )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    result.begin = low;
+
+    high = range.end;
+    while ( low < high )
+    {
+        size_t middle = low + ( high - low ) / 2;
+        if ( _postfixes[middle][depth] <= character )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    result.end = low;
+
+    return result;
+}
+
+/* ------------------------------------------------------------------------
+ * Recursively walks the implicit trie, collecting the ranges of ids
+ * whose postfixes start with the given pattern.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+void
+PostfixIndex::_walkTrie( const MatchPattern &pattern,
+                         size_t tokenIndex,
+                         const IdRange &range,
+                         size_t depth,
+                         std::vector<IdRange> &found ) const
+{
+    if ( range.begin >= range.end )
+        return;
+
+    if ( tokenIndex == pattern._tokens.size() )
+    {
+        found.push_back( range );
+        return;
+    }
+
+    const MatchPattern::Token &token = pattern._tokens[tokenIndex];
+
+    if ( token.minSpaces == 0 )
+    {
+        for ( size_t i = 0; i < token.alternatives.size(); i++ )
+        {
+            _walkTrie( pattern,
+                       tokenIndex + 1,
+                       _narrow( range, depth, token.alternatives[i] ),
+                       depth + 1,
+                       found );
+        }
+        return;
+    }
+
+    IdRange current = range;
+    for ( size_t i = 0; i < token.minSpaces; i++ )
+    {
+        current = _narrow( current, depth, SPACE );
+        depth++;
+        if ( current.begin >= current.end )
+            return;
+    }
+
+    if ( tokenIndex + 1 == pattern._tokens.size() )
+    {
+        /* Any further spaces are covered by the current range. */
+        found.push_back( current );
+        return;
+    }
+
+    /* The run of spaces may be longer than the minimum; the token
+     * following it can't match a space, so each extra space leads
+     * to a distinct set of postfixes. */
+    while ( current.begin < current.end )
+    {
+        _walkTrie( pattern, tokenIndex + 1, current, depth, found );
+        current = _narrow( current, depth, SPACE );
+        depth++;
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Uses the trigram index to find the ids of the postfixes that may
+ * contain the given pattern.
+ * ........................................................................
+ *
+ * If the pattern is empty, allPostfixes is set to true and
+ * candidates is left untouched.  Otherwise, candidates is filled
+ * with a sorted superset of the matching ids.
+ *
+ * ----------------------------------------------------------------------*/
+
+void
+PostfixIndex::_getCandidates( const MatchPattern &pattern,
+                              std::vector<size_t> &candidates,
+                              bool &allPostfixes ) const
+{
+    /* Each token of the pattern is a set of alternatives for a
+     * single character of the space-collapsed postfix. */
+    const std::vector<MatchPattern::Token> &tokens = pattern._tokens;
+
+    allPostfixes = tokens.empty();
+    if ( allPostfixes )
+        return;
+
+    if ( tokens.size() < 3 )
+    {
+        _getShortCandidates( pattern, candidates );
+        return;
+    }
+
+    /* For every trigram position in the pattern, find the posting
+     * lists of all the trigrams it could be. */
+    typedef std::vector< std::pair<size_t, size_t> > PostingRanges;
+    std::vector< std::pair<size_t, size_t> > positionsBySize;
+    std::vector<PostingRanges> positions( tokens.size() - 2 );
+
+    for ( size_t i = 0; i + 2 < tokens.size(); i++ )
+    {
+        size_t total = 0;
+        const CodePointString &a = tokens[i].alternatives;
+        const CodePointString &b = tokens[i + 1].alternatives;
+        const CodePointString &c = tokens[i + 2].alternatives;
+
+        for ( size_t x = 0; x < a.size(); x++ )
+            for ( size_t y = 0; y < b.size(); y++ )
+                for ( size_t z = 0; z < c.size(); z++ )
+                {
+                    Trigram trigram;
+                    trigram.chars[0] = a[x];
+                    trigram.chars[1] = b[y];
+                    trigram.chars[2] = c[z];
+
+                    std::vector<Trigram>::const_iterator it;
+                    it = std::lower_bound( _trigrams.begin(),
+                                           _trigrams.end(),
+                                           trigram );
+                    if ( it == _trigrams.end() || !( *it == trigram ) )
+                        continue;
+
+                    size_t index = it - _trigrams.begin();
+                    size_t start = _postingStarts[index];
+                    size_t end = _postingStarts[index + 1];
+                    positions[i].push_back( std::make_pair( start, end ) );
+                    total += end - start;
+                }
+
+        if ( total == 0 )
+            return;
+        positionsBySize.push_back( std::make_pair( total, i ) );
+    }
+
+    /* Start with the most selective position, and filter its
+     * postings through all the others. */
+    std::sort( positionsBySize.begin(), positionsBySize.end() );
+
+    const PostingRanges &first = positions[positionsBySize[0].second];
+    for ( size_t i = 0; i < first.size(); i++ )
+    {
+        for ( size_t j = first[i].first; j < first[i].second; j++ )
+            candidates.push_back( _postings[j] );
+    }
+    if ( first.size() > 1 )
+    {
+        std::sort( candidates.begin(), candidates.end() );
+        candidates.erase( std::unique( candidates.begin(),
+                                       candidates.end() ),
+                          candidates.end() );
+    }
+
+    for ( size_t p = 1; p < positionsBySize.size(); p++ )
+    {
+        const PostingRanges &ranges = positions[positionsBySize[p].second];
+        size_t kept = 0;
+
+        for ( size_t i = 0; i < candidates.size(); i++ )
+        {
+            for ( size_t r = 0; r < ranges.size(); r++ )
+            {
+                if ( std::binary_search(
+                         _postings.begin() + ranges[r].first,
+                         _postings.begin() + ranges[r].second,
+                         (unsigned int) candidates[i] ) )
+                {
+                    candidates[kept++] = candidates[i];
+                    break;
+                }
+            }
+        }
+        candidates.resize( kept );
+        if ( candidates.empty() )
+            return;
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Uses the trigram index to find the ids of the postfixes that may
+ * contain the given one- or two-character pattern.
+ * ........................................................................
+ *
+ * The trigrams starting with a given one or two characters form a
+ * contiguous range of the sorted trigrams; the union of their
+ * posting lists is collected through a bitmap, which is cheaper than
+ * merging them when there are many.
+ *
+ * ----------------------------------------------------------------------*/
+
+void
+PostfixIndex::_getShortCandidates( const MatchPattern &pattern,
+                                   std::vector<size_t> &candidates ) const
+{
+    const std::vector<MatchPattern::Token> &tokens = pattern._tokens;
+    const CodePointString &a = tokens[0].alternatives;
+    CodePointString b;
+    std::vector<bool> isCandidate( _postfixes.size(), false );
+
+    if ( tokens.size() > 1 )
+        b = tokens[1].alternatives;
+    else
+        b.push_back( END_OF_TEXT );
+
+    for ( size_t x = 0; x < a.size(); x++ )
+        for ( size_t y = 0; y < b.size(); y++ )
+        {
+            Trigram low;
+            Trigram high;
+
+            low.chars[0] = a[x];
+            high.chars[0] = a[x];
+            if ( tokens.size() > 1 )
+            {
+                low.chars[1] = b[y];
+                high.chars[1] = b[y];
+            }
+            else
+            {
+                low.chars[1] = 0;
+                high.chars[1] = END_OF_TEXT;
+            }
+            low.chars[2] = 0;
+            high.chars[2] = END_OF_TEXT;
+
+            size_t begin = std::lower_bound( _trigrams.begin(),
+                                             _trigrams.end(),
+                                             low ) - _trigrams.begin();
+            size_t end = std::upper_bound( _trigrams.begin(),
+                                           _trigrams.end(),
+                                           high ) - _trigrams.begin();
+
+            for ( size_t j = _postingStarts[begin];
+                  j < _postingStarts[end];
+                  j++ )
+                isCandidate[_postings[j]] = true;
+        }
+
+    for ( size_t id = 0; id < isCandidate.size(); id++ )
+    {
+        if ( isCandidate[id] )
+            candidates.push_back( id );
+    }
+}
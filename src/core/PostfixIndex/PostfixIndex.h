@@ -0,0 +1,275 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Header file for the PostfixIndex module.
+ *
+ *   The PostfixIndex module answers the queries that
+ *   enso.commands.factories.GenericPrefixFactory makes against its
+ *   list of postfixes on every keystroke, without needing to run a
+ *   regular expression over every postfix.
+ *
+ *   User text is compiled into a MatchPattern, which is a sequence
+ *   of character classes: each character of the user text matches
+ *   itself or any of its "equivalent characters" (e.g., "2" also
+ *   matches "@"), and each run of spaces in the user text matches a
+ *   run of at least as many spaces.  This is exactly the language
+ *   of the regular expressions produced by
+ *   enso.commands.matching.equivalizeChars().
+ *
+ *   The postfixes are kept sorted, which makes the sorted array an
+ *   implicit (and very compact) trie: the postfixes sharing any
+ *   given prefix form a contiguous range of it.  Prefix queries walk
+ *   this trie; substring queries use an inverted index of the
+ *   trigrams of each postfix to narrow down the candidates before
+ *   verifying them.  In both cases, results come out in sorted
+ *   order.
+ *
+ *   This module doesn't depend on Python; see postfixindexmodule.cxx
+ *   for the Python bindings.
+ */
+
+#ifndef _POSTFIXINDEX_H_
+#define _POSTFIXINDEX_H_
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+
+/* ***************************************************************************
+ * Type Definitions
+ * **************************************************************************/
+
+/* A single character.  Characters are compared by value only, which
+ * is the same ordering Python uses for unicode objects. */
+typedef unsigned int CodePoint;
+
+/* A string of characters. */
+typedef std::vector<CodePoint> CodePointString;
+
+/* Maps a character to the set of characters it is equivalent to
+ * (which should include the character itself). */
+typedef std::map<CodePoint, CodePointString> EquivalentChars;
+
+
+/* ***************************************************************************
+ * Class Declarations
+ * **************************************************************************/
+
+/* ===========================================================================
+ * MatchPattern class
+ * ...........................................................................
+ *
+ * A compiled form of some user text.
+ *
+ * =========================================================================*/
+
+class MatchPattern
+{
+public:
+
+    /* --------------------------------------------------------------------
+     * Constructor
+     * --------------------------------------------------------------------
+     *
+     * Compiles the given user text, using the given table of
+     * equivalent characters.
+     *
+     * ------------------------------------------------------------------*/
+
+    MatchPattern( const CodePointString &userText,
+                  const EquivalentChars &equivalentChars );
+
+    /* --------------------------------------------------------------------
+     * Returns whether the pattern matches the given text, starting
+     * at the given position.
+     * ------------------------------------------------------------------*/
+
+    bool
+    matchesAt( const CodePointString &text,
+               size_t position ) const;
+
+    /* --------------------------------------------------------------------
+     * Returns the leftmost position, no earlier than start, at which
+     * the pattern matches the given text, or -1 if there is none.
+     * ....................................................................
+     *
+     * If wordStart is true, only positions that are at a word
+     * boundary (as defined by the "\b" regular expression escape) are
+     * considered.
+     *
+     * ------------------------------------------------------------------*/
+
+    int
+    search( const CodePointString &text,
+            size_t start,
+            bool wordStart ) const;
+
+private:
+    friend class PostfixIndex;
+
+    /* A single element of the pattern: either a set of alternative
+     * characters matching exactly one character, or (when minSpaces
+     * is non-zero) a run of at least minSpaces spaces. */
+    struct Token
+    {
+        CodePointString alternatives;
+        size_t minSpaces;
+    };
+
+    std::vector<Token> _tokens;
+};
+
+
+/* ===========================================================================
+ * PostfixIndex class
+ * ...........................................................................
+ *
+ * An immutable, searchable collection of postfixes.
+ *
+ * Results are returned as "ids", which are the positions of the
+ * matching postfixes in sorted order; originalIndex() maps an id
+ * back to the position of the postfix in the list the index was
+ * constructed from.  Empty postfixes are never matched.
+ *
+ * =========================================================================*/
+
+class PostfixIndex
+{
+public:
+
+    /* ====================================================================
+     * Construction and Destruction
+     * ==================================================================*/
+
+    PostfixIndex( const std::vector<CodePointString> &postfixes );
+
+    /* ====================================================================
+     * Public Member Functions
+     * ==================================================================*/
+
+    /* --------------------------------------------------------------------
+     * Finds all postfixes that start with the given pattern.
+     * ------------------------------------------------------------------*/
+
+    void
+    findPrefixMatches( const MatchPattern &pattern,
+                       std::vector<size_t> &results ) const;
+
+    /* --------------------------------------------------------------------
+     * Finds all postfixes that contain the given pattern.
+     * ....................................................................
+     *
+     * If wordStart is true, the pattern must occur at a word
+     * boundary.
+     *
+     * ------------------------------------------------------------------*/
+
+    void
+    findSubstringMatches( const MatchPattern &pattern,
+                          bool wordStart,
+                          std::vector<size_t> &results ) const;
+
+    /* --------------------------------------------------------------------
+     * Returns the number of (non-empty) postfixes in the index.
+     * ------------------------------------------------------------------*/
+
+    size_t
+    size( void ) const;
+
+    /* --------------------------------------------------------------------
+     * Returns the position of the postfix with the given id in the
+     * list that the index was constructed from.
+     * ------------------------------------------------------------------*/
+
+    size_t
+    originalIndex( size_t id ) const;
+
+private:
+
+    /* A trigram of the (space-collapsed) text of a postfix. */
+    struct Trigram
+    {
+        CodePoint chars[3];
+
+        bool operator<( const Trigram &other ) const;
+        bool operator==( const Trigram &other ) const;
+    };
+
+    /* A contiguous range of ids: [begin, end). */
+    struct IdRange
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    void
+    _buildTrigramIndex( void );
+
+    IdRange
+    _narrow( const IdRange &range,
+             size_t depth,
+             CodePoint character ) const;
+
+    void
+    _walkTrie( const MatchPattern &pattern,
+               size_t tokenIndex,
+               const IdRange &range,
+               size_t depth,
+               std::vector<IdRange> &found ) const;
+
+    void
+    _getCandidates( const MatchPattern &pattern,
+                    std::vector<size_t> &candidates,
+                    bool &allPostfixes ) const;
+
+    void
+    _getShortCandidates( const MatchPattern &pattern,
+                         std::vector<size_t> &candidates ) const;
+
+    /* The non-empty postfixes, in sorted order. */
+    std::vector<CodePointString> _postfixes;
+
+    /* For each id, the index of the postfix in the original list. */
+    std::vector<size_t> _originalIndices;
+
+    /* The trigram inverted index: _trigrams is a sorted list of all
+     * distinct trigrams, and the ids of the postfixes containing
+     * _trigrams[i] are _postings[_postingStarts[i]] up to (but not
+     * including) _postings[_postingStarts[i+1]], in sorted order. */
+    std::vector<Trigram> _trigrams;
+    std::vector<size_t> _postingStarts;
+    std::vector<unsigned int> _postings;
+};
+
+#endif
@@ -0,0 +1,620 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*   Python bindings for the PostfixIndex module.
+ *
+ *   This builds the enso.commands._postfixindex extension module,
+ *   which is used by enso.commands.matching when it's available.
+ *   See that module for documentation of the Python interface.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <Python.h>
+
+#include <new>
+
+#include "PostfixIndex.h"
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+#if PY_VERSION_HEX < 0x02050000 && !defined( PY_SSIZE_T_MIN )
+typedef int Py_ssize_t;
+typedef inquiry lenfunc;
+#endif
+
+
+/* ***************************************************************************
+ * Type Definitions
+ * **************************************************************************/
+
+typedef struct {
+    PyObject_HEAD
+
+    /* The index itself. */
+    PostfixIndex *index;
+
+    /* The table of equivalent characters used to compile queries. */
+    EquivalentChars *equivalentChars;
+
+    /* A list of the postfix objects the index was built from, in
+     * their original order; query results are taken from here, so
+     * that the caller gets back the very same objects. */
+    PyObject *postfixes;
+} PostfixIndexObject;
+
+typedef struct {
+    PyObject_HEAD
+
+    /* The compiled user text. */
+    MatchPattern *pattern;
+
+    /* A buffer for the text being searched, kept around so that it
+     * doesn't need to be reallocated on every search. */
+    CodePointString *text;
+} MatcherObject;
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Converts a string or unicode object to a CodePointString.
+ * ........................................................................
+ *
+ * Returns 0 and sets the Python error state on failure.
+ *
+ * ----------------------------------------------------------------------*/
+
+static int
+_toCodePoints( PyObject *object,
+               CodePointString &result )
+{
+    PyObject *unicode = PyUnicode_FromObject( object );
+    if ( unicode == NULL )
+        return 0;
+
+    Py_UNICODE *data = PyUnicode_AS_UNICODE( unicode );
+    Py_ssize_t length = PyUnicode_GET_SIZE( unicode );
+
+    result.assign( data, data + length );
+
+    Py_DECREF( unicode );
+    return 1;
+}
+
+/* ------------------------------------------------------------------------
+ * Converts a string or unicode object to a CodePointString, the way
+ * the re module sees it.
+ * ........................................................................
+ *
+ * Unlike _toCodePoints(), this takes each byte of a string to be the
+ * character with the same value, rather than decoding it; this is
+ * how regular expressions compare strings to unicode objects.
+ *
+ * Returns 0 and sets the Python error state on failure.
+ *
+ * ----------------------------------------------------------------------*/
+
+static int
+_toCodePointsBytewise( PyObject *object,
+                       CodePointString &result )
+{
+    if ( PyString_Check( object ) )
+    {
+        const unsigned char *data;
+
+        data = (const unsigned char *) PyString_AS_STRING( object );
+        result.assign( data, data + PyString_GET_SIZE( object ) );
+        return 1;
+    }
+    else if ( PyUnicode_Check( object ) )
+    {
+        Py_UNICODE *data = PyUnicode_AS_UNICODE( object );
+
+        result.assign( data, data + PyUnicode_GET_SIZE( object ) );
+        return 1;
+    }
+
+    PyErr_SetString( PyExc_TypeError, "expected a string or unicode" );
+    return 0;
+}
+
+/* ------------------------------------------------------------------------
+ * Converts a dictionary mapping characters to strings of equivalent
+ * characters into an EquivalentChars table.
+ * ........................................................................
+ *
+ * Returns 0 and sets the Python error state on failure.
+ *
+ * ----------------------------------------------------------------------*/
+
+static int
+_toEquivalentChars( PyObject *dict,
+                    EquivalentChars &result )
+{
+    PyObject *key;
+    PyObject *value;
+    Py_ssize_t position = 0;
+
+    if ( !PyDict_Check( dict ) )
+    {
+        PyErr_SetString( PyExc_TypeError,
+                         "equivalent characters must be a dictionary" );
+        return 0;
+    }
+
+    while ( PyDict_Next( dict, &position, &key, &value ) )
+    {
+        CodePointString keyChars;
+        CodePointString valueChars;
+
+        if ( !_toCodePoints( key, keyChars ) ||
+             !_toCodePoints( value, valueChars ) )
+            return 0;
+
+        if ( keyChars.size() != 1 )
+        {
+            PyErr_SetString( PyExc_ValueError,
+                             "equivalent characters must be keyed by "
+                             "single characters" );
+            return 0;
+        }
+
+        result[keyChars[0]] = valueChars;
+    }
+
+    return 1;
+}
+
+/* ------------------------------------------------------------------------
+ * Runs a query against the index, returning a new list of the
+ * matching postfixes.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+#define PREFIX_QUERY        0
+#define SUBSTRING_QUERY     1
+#define WORD_START_QUERY    2
+
+static PyObject *
+_query( PostfixIndexObject *self,
+        PyObject *args,
+        int queryType )
+{
+    PyObject *userTextObject;
+    CodePointString userText;
+    std::vector<size_t> ids;
+
+    if ( !PyArg_ParseTuple( args, "O", &userTextObject ) )
+        return NULL;
+
+    if ( !_toCodePoints( userTextObject, userText ) )
+        return NULL;
+
+    try
+    {
+        MatchPattern pattern( userText, *self->equivalentChars );
+
+        if ( queryType == PREFIX_QUERY )
+            self->index->findPrefixMatches( pattern, ids );
+        else
+            self->index->findSubstringMatches(
+                pattern,
+                queryType == WORD_START_QUERY,
+                ids
+                );
+    }
+    catch ( std::bad_alloc & )
+    {
+        return PyErr_NoMemory();
+    }
+
+    PyObject *result = PyList_New( (Py_ssize_t) ids.size() );
+    if ( result == NULL )
+        return NULL;
+
+    for ( size_t i = 0; i < ids.size(); i++ )
+    {
+        size_t index = self->index->originalIndex( ids[i] );
+        PyObject *postfix = PyList_GET_ITEM( self->postfixes,
+                                             (Py_ssize_t) index );
+        Py_INCREF( postfix );
+        PyList_SET_ITEM( result, (Py_ssize_t) i, postfix );
+    }
+
+    return result;
+}
+
+
+/* ***************************************************************************
+ * PostfixIndex Type
+ * **************************************************************************/
+
+static PyObject *
+PostfixIndex_new( PyTypeObject *type,
+                  PyObject *args,
+                  PyObject *kwds )
+{
+    PyObject *postfixesObject;
+    PyObject *equivalentCharsObject;
+
+    if ( !PyArg_ParseTuple( args, "OO:PostfixIndex",
+                            &postfixesObject, &equivalentCharsObject ) )
+        return NULL;
+
+    PyObject *postfixes = PySequence_List( postfixesObject );
+    if ( postfixes == NULL )
+        return NULL;
+
+    PostfixIndex *index = NULL;
+    EquivalentChars *equivalentChars = NULL;
+
+    try
+    {
+        Py_ssize_t count = PyList_GET_SIZE( postfixes );
+        std::vector<CodePointString> strings( count );
+
+        for ( Py_ssize_t i = 0; i < count; i++ )
+        {
+            CodePointString &string = strings[i];
+
+            if ( !_toCodePoints( PyList_GET_ITEM( postfixes, i ), string ) )
+                goto error;
+
+            /* The regular expressions this replaces treat newlines
+             * as postfix separators; rather than emulating that,
+             * refuse such postfixes altogether. */
+            for ( size_t j = 0; j < string.size(); j++ )
+            {
+                if ( string[j] == '\n' )
+                {
+                    PyErr_SetString( PyExc_ValueError,
+                                     "postfixes can't contain newlines" );
+                    goto error;
+                }
+            }
+        }
+
+        equivalentChars = new EquivalentChars();
+        if ( !_toEquivalentChars( equivalentCharsObject, *equivalentChars ) )
+            goto error;
+
+        index = new PostfixIndex( strings );
+    }
+    catch ( std::bad_alloc & )
+    {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    {
+        PostfixIndexObject *self;
+
+        self = (PostfixIndexObject *) type->tp_alloc( type, 0 );
+        if ( self == NULL )
+            goto error;
+
+        self->index = index;
+        self->equivalentChars = equivalentChars;
+        self->postfixes = postfixes;
+        return (PyObject *) self;
+    }
+
+error:
+    delete index;
+    delete equivalentChars;
+    Py_DECREF( postfixes );
+    return NULL;
+}
+
+static void
+PostfixIndex_dealloc( PostfixIndexObject *self )
+{
+    delete self->index;
+    delete self->equivalentChars;
+    Py_XDECREF( self->postfixes );
+    self->ob_type->tp_free( (PyObject *) self );
+}
+
+static Py_ssize_t
+PostfixIndex_length( PostfixIndexObject *self )
+{
+    return (Py_ssize_t) self->index->size();
+}
+
+static PyObject *
+PostfixIndex_findPrefixMatches( PostfixIndexObject *self,
+                                PyObject *args )
+{
+    return _query( self, args, PREFIX_QUERY );
+}
+
+static PyObject *
+PostfixIndex_findSubstringMatches( PostfixIndexObject *self,
+                                   PyObject *args )
+{
+    return _query( self, args, SUBSTRING_QUERY );
+}
+
+static PyObject *
+PostfixIndex_findWordStartMatches( PostfixIndexObject *self,
+                                   PyObject *args )
+{
+    return _query( self, args, WORD_START_QUERY );
+}
+
+static PyMethodDef PostfixIndex_methods[] = {
+    { "findPrefixMatches",
+      (PyCFunction) PostfixIndex_findPrefixMatches,
+      METH_VARARGS,
+      "Returns a sorted list of the postfixes starting with userText." },
+    { "findSubstringMatches",
+      (PyCFunction) PostfixIndex_findSubstringMatches,
+      METH_VARARGS,
+      "Returns a sorted list of the postfixes containing userText." },
+    { "findWordStartMatches",
+      (PyCFunction) PostfixIndex_findWordStartMatches,
+      METH_VARARGS,
+      "Returns a sorted list of the postfixes containing userText "
+      "at a word boundary." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PySequenceMethods PostfixIndex_as_sequence = {
+    (lenfunc) PostfixIndex_length,      /* sq_length */
+};
+
+static PyTypeObject PostfixIndexType = {
+    PyObject_HEAD_INIT( NULL )
+    0,                                  /* ob_size */
+    "enso.commands._postfixindex.PostfixIndex", /* tp_name */
+    sizeof( PostfixIndexObject ),       /* tp_basicsize */
+    0,                                  /* tp_itemsize */
+    (destructor) PostfixIndex_dealloc,  /* tp_dealloc */
+    0,                                  /* tp_print */
+    0,                                  /* tp_getattr */
+    0,                                  /* tp_setattr */
+    0,                                  /* tp_compare */
+    0,                                  /* tp_repr */
+    0,                                  /* tp_as_number */
+    &PostfixIndex_as_sequence,          /* tp_as_sequence */
+    0,                                  /* tp_as_mapping */
+    0,                                  /* tp_hash */
+    0,                                  /* tp_call */
+    0,                                  /* tp_str */
+    0,                                  /* tp_getattro */
+    0,                                  /* tp_setattro */
+    0,                                  /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                 /* tp_flags */
+    "PostfixIndex(postfixes, equivalentChars)\n\n"
+    "An immutable, searchable index of a list of postfixes.", /* tp_doc */
+    0,                                  /* tp_traverse */
+    0,                                  /* tp_clear */
+    0,                                  /* tp_richcompare */
+    0,                                  /* tp_weaklistoffset */
+    0,                                  /* tp_iter */
+    0,                                  /* tp_iternext */
+    PostfixIndex_methods,               /* tp_methods */
+    0,                                  /* tp_members */
+    0,                                  /* tp_getset */
+    0,                                  /* tp_base */
+    0,                                  /* tp_dict */
+    0,                                  /* tp_descr_get */
+    0,                                  /* tp_descr_set */
+    0,                                  /* tp_dictoffset */
+    0,                                  /* tp_init */
+    0,                                  /* tp_alloc */
+    PostfixIndex_new,                   /* tp_new */
+};
+
+
+/* ***************************************************************************
+ * Matcher Type
+ * **************************************************************************/
+
+static PyObject *
+Matcher_new( PyTypeObject *type,
+             PyObject *args,
+             PyObject *kwds )
+{
+    PyObject *userTextObject;
+    PyObject *equivalentCharsObject;
+    CodePointString userText;
+    EquivalentChars equivalentChars;
+
+    if ( !PyArg_ParseTuple( args, "OO:Matcher",
+                            &userTextObject, &equivalentCharsObject ) )
+        return NULL;
+
+    MatchPattern *pattern = NULL;
+    CodePointString *text = NULL;
+
+    try
+    {
+        if ( !_toCodePointsBytewise( userTextObject, userText ) ||
+             !_toEquivalentChars( equivalentCharsObject, equivalentChars ) )
+            return NULL;
+
+        pattern = new MatchPattern( userText, equivalentChars );
+        text = new CodePointString();
+    }
+    catch ( std::bad_alloc & )
+    {
+        delete pattern;
+        return PyErr_NoMemory();
+    }
+
+    MatcherObject *self = (MatcherObject *) type->tp_alloc( type, 0 );
+    if ( self == NULL )
+    {
+        delete pattern;
+        delete text;
+        return NULL;
+    }
+
+    self->pattern = pattern;
+    self->text = text;
+    return (PyObject *) self;
+}
+
+static void
+Matcher_dealloc( MatcherObject *self )
+{
+    delete self->pattern;
+    delete self->text;
+    self->ob_type->tp_free( (PyObject *) self );
+}
+
+static PyObject *
+Matcher_search( MatcherObject *self,
+                PyObject *args )
+{
+    PyObject *textObject;
+    int start = 0;
+    int position;
+
+    if ( !PyArg_ParseTuple( args, "O|i:search", &textObject, &start ) )
+        return NULL;
+
+    try
+    {
+        if ( !_toCodePointsBytewise( textObject, *self->text ) )
+            return NULL;
+
+        /* Clamp the start position like the re module does. */
+        if ( start < 0 )
+            start = 0;
+        else if ( (size_t) start > self->text->size() )
+            start = (int) self->text->size();
+
+        position = self->pattern->search( *self->text,
+                                          (size_t) start,
+                                          false );
+    }
+    catch ( std::bad_alloc & )
+    {
+        return PyErr_NoMemory();
+    }
+
+    return PyInt_FromLong( position );
+}
+
+static PyMethodDef Matcher_methods[] = {
+    { "search",
+      (PyCFunction) Matcher_search,
+      METH_VARARGS,
+      "search(text[, start]) -> position\n\n"
+      "Returns the position of the first match of the user text in "
+      "text, at or after start, or -1." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyTypeObject MatcherType = {
+    PyObject_HEAD_INIT( NULL )
+    0,                                  /* ob_size */
+    "enso.commands._postfixindex.Matcher", /* tp_name */
+    sizeof( MatcherObject ),            /* tp_basicsize */
+    0,                                  /* tp_itemsize */
+    (destructor) Matcher_dealloc,       /* tp_dealloc */
+    0,                                  /* tp_print */
+    0,                                  /* tp_getattr */
+    0,                                  /* tp_setattr */
+    0,                                  /* tp_compare */
+    0,                                  /* tp_repr */
+    0,                                  /* tp_as_number */
+    0,                                  /* tp_as_sequence */
+    0,                                  /* tp_as_mapping */
+    0,                                  /* tp_hash */
+    0,                                  /* tp_call */
+    0,                                  /* tp_str */
+    0,                                  /* tp_getattro */
+    0,                                  /* tp_setattro */
+    0,                                  /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                 /* tp_flags */
+    "Matcher(userText, equivalentChars)\n\n"
+    "Searches text for user text, with the same semantics as the "
+    "postfix index.",                   /* tp_doc */
+    0,                                  /* tp_traverse */
+    0,                                  /* tp_clear */
+    0,                                  /* tp_richcompare */
+    0,                                  /* tp_weaklistoffset */
+    0,                                  /* tp_iter */
+    0,                                  /* tp_iternext */
+    Matcher_methods,                    /* tp_methods */
+    0,                                  /* tp_members */
+    0,                                  /* tp_getset */
+    0,                                  /* tp_base */
+    0,                                  /* tp_dict */
+    0,                                  /* tp_descr_get */
+    0,                                  /* tp_descr_set */
+    0,                                  /* tp_dictoffset */
+    0,                                  /* tp_init */
+    0,                                  /* tp_alloc */
+    Matcher_new,                        /* tp_new */
+};
+
+
+/* ***************************************************************************
+ * Module Initialization
+ * **************************************************************************/
+
+static PyMethodDef postfixindex_methods[] = {
+    { NULL, NULL, 0, NULL }
+};
+
+PyMODINIT_FUNC
+init_postfixindex( void )
+{
+    PyObject *module;
+
+    if ( PyType_Ready( &PostfixIndexType ) < 0 ||
+         PyType_Ready( &MatcherType ) < 0 )
+        return;
+
+    module = Py_InitModule3( "enso.commands._postfixindex",
+                             postfixindex_methods,
+                             "Native implementation of the postfix index "
+                             "used by enso.commands.matching." );
+    if ( module == NULL )
+        return;
+
+    Py_INCREF( &PostfixIndexType );
+    PyModule_AddObject( module, "PostfixIndex",
+                        (PyObject *) &PostfixIndexType );
+
+    Py_INCREF( &MatcherType );
+    PyModule_AddObject( module, "Matcher",
+                        (PyObject *) &MatcherType );
+}
@@ -0,0 +1,340 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Implementation file for the ShapeMask module.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include "ShapeMask.h"
+
+#include <stdint.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || \
+    ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+/* AVX2 code is compiled for a target of its own and only run if the
+ * processor supports it, which needs GCC 4.9 or later. */
+#if defined( USE_SSE2 ) && defined( __GNUC__ ) && \
+    ( defined( __x86_64__ ) || defined( __i386__ ) ) && \
+    ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define USE_AVX2
+#include <immintrin.h>
+#endif
+
+
+/* ***************************************************************************
+ * Type Definitions
+ * **************************************************************************/
+
+/* A function that thresholds numBytes * 8 pixels into numBytes
+ * bytes of a mask, returning whether any of them changed; see
+ * _thresholdBytesScalar(). */
+typedef bool (*ThresholdBytesFunction)( const uint32_t *pixels,
+                                        int numBytes,
+                                        int threshold,
+                                        unsigned char *mask );
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Returns the mask bits of the given number of pixels (at most 8),
+ * the first pixel being the least significant bit.
+ * ----------------------------------------------------------------------*/
+
+static inline unsigned int
+_thresholdBits( const uint32_t *pixels,
+                int numPixels,
+                int threshold )
+{
+    unsigned int bits = 0;
+
+    for ( int i = 0; i < numPixels; i++ )
+        if ( (int) ( pixels[i] >> 24 ) >= threshold )
+            bits |= 1u << i;
+
+    return bits;
+}
+
+/* ------------------------------------------------------------------------
+ * Stores the given byte in the mask, returning whether it changed.
+ * ----------------------------------------------------------------------*/
+
+static inline bool
+_storeByte( unsigned char *mask,
+            unsigned int bits )
+{
+    unsigned char byte = (unsigned char) bits;
+    bool changed = ( *mask != byte );
+
+    *mask = byte;
+    return changed;
+}
+
+/* ------------------------------------------------------------------------
+ * Thresholds numBytes * 8 pixels into numBytes bytes of the mask,
+ * one pixel at a time.  Returns whether any of the bytes changed.
+ * ----------------------------------------------------------------------*/
+
+static bool
+_thresholdBytesScalar( const uint32_t *pixels,
+                       int numBytes,
+                       int threshold,
+                       unsigned char *mask )
+{
+    bool changed = false;
+
+    for ( int i = 0; i < numBytes; i++ )
+        changed |= _storeByte( mask + i,
+                               _thresholdBits( pixels + i * 8, 8,
+                                               threshold ) );
+
+    return changed;
+}
+
+#ifdef USE_SSE2
+/* ------------------------------------------------------------------------
+ * Like _thresholdBytesScalar(), but 16 pixels at a time, with SSE2.
+ *
+ * The alpha of each 32-bit pixel is shifted down to its low byte,
+ * the pixels are packed into bytes (saturation can't kick in, since
+ * they're all below 256), and compared with the threshold; the
+ * comparison's most significant bits are then the mask's bits, in
+ * the right order.  The comparison is unsigned, as max(a, t) == a.
+ * ----------------------------------------------------------------------*/
+
+static bool
+_thresholdBytesSse2( const uint32_t *pixels,
+                     int numBytes,
+                     int threshold,
+                     unsigned char *mask )
+{
+    const __m128i thresholds = _mm_set1_epi8( (char) threshold );
+    bool changed = false;
+    int i = 0;
+
+    for ( ; i + 2 <= numBytes; i += 2 )
+    {
+        const __m128i *block = (const __m128i *) ( pixels + i * 8 );
+        __m128i a = _mm_srli_epi32( _mm_loadu_si128( block ), 24 );
+        __m128i b = _mm_srli_epi32( _mm_loadu_si128( block + 1 ), 24 );
+        __m128i c = _mm_srli_epi32( _mm_loadu_si128( block + 2 ), 24 );
+        __m128i d = _mm_srli_epi32( _mm_loadu_si128( block + 3 ), 24 );
+        __m128i alphas = _mm_packus_epi16( _mm_packs_epi32( a, b ),
+                                           _mm_packs_epi32( c, d ) );
+        __m128i isSet = _mm_cmpeq_epi8( _mm_max_epu8( alphas, thresholds ),
+                                        alphas );
+        unsigned int bits = (unsigned int) _mm_movemask_epi8( isSet );
+
+        changed |= _storeByte( mask + i, bits & 0xff );
+        changed |= _storeByte( mask + i + 1, bits >> 8 );
+    }
+
+    if ( i < numBytes )
+        changed |= _thresholdBytesScalar( pixels + i * 8, numBytes - i,
+                                          threshold, mask + i );
+
+    return changed;
+}
+#endif
+
+#ifdef USE_AVX2
+/* ------------------------------------------------------------------------
+ * Like _thresholdBytesSse2(), but 32 pixels at a time, with AVX2.
+ *
+ * AVX2 packs within each 128-bit lane, so the packed alphas come out
+ * in the order a0-3 b0-3 c0-3 d0-3 a4-7 b4-7 c4-7 d4-7 (where a is
+ * the first eight pixels, b the next eight and so on), and their
+ * groups of four have to be permuted back into order.
+ * ----------------------------------------------------------------------*/
+
+__attribute__(( target( "avx2" ) ))
+static bool
+_thresholdBytesAvx2( const uint32_t *pixels,
+                     int numBytes,
+                     int threshold,
+                     unsigned char *mask )
+{
+    const __m256i thresholds = _mm256_set1_epi8( (char) threshold );
+    const __m256i order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+    bool changed = false;
+    int i = 0;
+
+    for ( ; i + 4 <= numBytes; i += 4 )
+    {
+        const __m256i *block = (const __m256i *) ( pixels + i * 8 );
+        __m256i a = _mm256_srli_epi32( _mm256_loadu_si256( block ), 24 );
+        __m256i b = _mm256_srli_epi32( _mm256_loadu_si256( block + 1 ),
+                                       24 );
+        __m256i c = _mm256_srli_epi32( _mm256_loadu_si256( block + 2 ),
+                                       24 );
+        __m256i d = _mm256_srli_epi32( _mm256_loadu_si256( block + 3 ),
+                                       24 );
+        __m256i alphas = _mm256_packus_epi16( _mm256_packs_epi32( a, b ),
+                                              _mm256_packs_epi32( c, d ) );
+        alphas = _mm256_permutevar8x32_epi32( alphas, order );
+        __m256i isSet = _mm256_cmpeq_epi8(
+            _mm256_max_epu8( alphas, thresholds ),
+            alphas
+            );
+        unsigned int bits = (unsigned int) _mm256_movemask_epi8( isSet );
+
+        changed |= _storeByte( mask + i, bits & 0xff );
+        changed |= _storeByte( mask + i + 1, ( bits >> 8 ) & 0xff );
+        changed |= _storeByte( mask + i + 2, ( bits >> 16 ) & 0xff );
+        changed |= _storeByte( mask + i + 3, bits >> 24 );
+    }
+
+    if ( i < numBytes )
+        changed |= _thresholdBytesSse2( pixels + i * 8, numBytes - i,
+                                        threshold, mask + i );
+
+    return changed;
+}
+#endif
+
+/* ------------------------------------------------------------------------
+ * Returns the fastest implementation of byte thresholding that this
+ * processor supports.
+ * ----------------------------------------------------------------------*/
+
+static ThresholdBytesFunction
+_getThresholdBytesFunction( void )
+{
+#ifdef USE_AVX2
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) )
+        return _thresholdBytesAvx2;
+#endif
+#ifdef USE_SSE2
+    return _thresholdBytesSse2;
+#else
+    return _thresholdBytesScalar;
+#endif
+}
+
+/* ------------------------------------------------------------------------
+ * Updates the bits of the given mask byte that belong to the pixels
+ * from start up to (but not including) end, which are columns of
+ * the row within that byte.  Returns whether the byte changed.
+ * ----------------------------------------------------------------------*/
+
+static bool
+_updatePartialByte( const uint32_t *row,
+                    unsigned char *maskRow,
+                    int start,
+                    int end,
+                    int threshold )
+{
+    int byteIndex = start / 8;
+    int shift = start - byteIndex * 8;
+    unsigned int bitsMask = ( ( 1u << ( end - start ) ) - 1 ) << shift;
+    unsigned int bits = _thresholdBits( row + start, end - start,
+                                        threshold ) << shift;
+    unsigned char *byte = maskRow + byteIndex;
+
+    return _storeByte( byte, ( *byte & ~bitsMask ) | ( bits & bitsMask ) );
+}
+
+
+/* ***************************************************************************
+ * Public Functions
+ * **************************************************************************/
+
+bool
+updateShapeMask( const unsigned char *pixels,
+                 size_t pixelStride,
+                 unsigned char *mask,
+                 size_t maskStride,
+                 int x,
+                 int y,
+                 int width,
+                 int height,
+                 int threshold )
+{
+    static ThresholdBytesFunction thresholdBytes = 0;
+
+    if ( width <= 0 || height <= 0 )
+        return false;
+
+    if ( thresholdBytes == 0 )
+        thresholdBytes = _getThresholdBytesFunction();
+
+    /* The SIMD implementations compare bytes, so they can't handle
+     * a threshold of 256. */
+    ThresholdBytesFunction function = thresholdBytes;
+    if ( threshold < 0 )
+        threshold = 0;
+    else if ( threshold > 255 )
+        function = _thresholdBytesScalar;
+
+    /* The columns of whole bytes of the mask within the rectangle;
+     * the columns on either side of them, if any, are in partial
+     * bytes. */
+    int end = x + width;
+    int fullStart = ( x + 7 ) / 8 * 8;
+    int fullEnd = end / 8 * 8;
+    bool changed = false;
+
+    for ( int row = y; row < y + height; row++ )
+    {
+        const uint32_t *pixelRow =
+            (const uint32_t *) ( pixels + row * pixelStride );
+        unsigned char *maskRow = mask + row * maskStride;
+
+        if ( fullStart > fullEnd )
+        {
+            /* The rectangle lies within a single byte. */
+            changed |= _updatePartialByte( pixelRow, maskRow, x, end,
+                                           threshold );
+            continue;
+        }
+
+        if ( x < fullStart )
+            changed |= _updatePartialByte( pixelRow, maskRow, x, fullStart,
+                                           threshold );
+        changed |= function( pixelRow + fullStart,
+                             ( fullEnd - fullStart ) / 8,
+                             threshold,
+                             maskRow + fullStart / 8 );
+        if ( fullEnd < end )
+            changed |= _updatePartialByte( pixelRow, maskRow, fullEnd, end,
+                                           threshold );
+    }
+
+    return changed;
+}
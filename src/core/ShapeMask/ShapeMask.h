@@ -0,0 +1,96 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Header file for the ShapeMask module.
+ *
+ *   The ShapeMask module computes the shape mask of a transparent
+ *   window from the ARGB32 pixels of its surface: each bit of the
+ *   mask is set if the alpha of the corresponding pixel is at least
+ *   a given threshold.  The mask is packed in the X bitmap format,
+ *   i.e., each row starts on a byte boundary and the leftmost pixel
+ *   of each byte is its least significant bit, so that it can be
+ *   handed to gtk.gdk.bitmap_create_from_data() as is.
+ *
+ *   The mask is updated in place, one rectangle at a time, so that
+ *   only the damaged parts of a window need to be looked at, and
+ *   the caller is told whether any bits changed, so that it can
+ *   avoid setting the window's shape again when they didn't.
+ *
+ *   Sixteen pixels at a time are thresholded with SSE2 where it's
+ *   available, and 32 at a time with AVX2 where the processor
+ *   supports it.
+ *
+ *   This module doesn't depend on Python; see shapemaskmodule.cxx
+ *   for the Python bindings.
+ */
+
+#ifndef _SHAPEMASK_H_
+#define _SHAPEMASK_H_
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <cstddef>
+
+
+/* ***************************************************************************
+ * Function Declarations
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Updates the given rectangle of a shape mask from the alpha of the
+ * given pixels.
+ * ........................................................................
+ *
+ * pixels points to the first row of ARGB32 pixels, in native byte
+ * order, each row being pixelStride bytes long; mask points to the
+ * first row of the mask, each row being maskStride bytes long.  The
+ * rectangle, which is given in pixels, must lie within both.
+ *
+ * A bit is set if the alpha of its pixel is at least threshold,
+ * which ranges from 0 (every bit is set) to 256 (no bit is set).
+ * Bits outside the rectangle are left alone.
+ *
+ * Returns whether any bit of the mask changed.
+ *
+ * ----------------------------------------------------------------------*/
+
+bool
+updateShapeMask( const unsigned char *pixels,
+                 size_t pixelStride,
+                 unsigned char *mask,
+                 size_t maskStride,
+                 int x,
+                 int y,
+                 int width,
+                 int height,
+                 int threshold );
+
+#endif
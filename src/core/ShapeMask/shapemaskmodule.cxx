@@ -0,0 +1,142 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Python bindings for the ShapeMask module.
+ *
+ *   This builds the enso.platform.linux._shapemask extension module,
+ *   which is used by enso.platform.linux.graphics when it's
+ *   available.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <Python.h>
+
+#include "ShapeMask.h"
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+#if PY_VERSION_HEX < 0x02050000 && !defined( PY_SSIZE_T_MIN )
+typedef int Py_ssize_t;
+#endif
+
+
+/* ***************************************************************************
+ * Module Functions
+ * **************************************************************************/
+
+static PyObject *
+shapemask_updateShapeMask( PyObject *self,
+                           PyObject *args )
+{
+    PyObject *pixelsObject;
+    PyObject *maskObject;
+    int pixelStride;
+    int maskStride;
+    int x;
+    int y;
+    int width;
+    int height;
+    int threshold;
+    const void *pixels;
+    void *mask;
+    Py_ssize_t pixelsSize;
+    Py_ssize_t maskSize;
+
+    if ( !PyArg_ParseTuple( args, "OiOiiiiii:updateShapeMask",
+                            &pixelsObject, &pixelStride,
+                            &maskObject, &maskStride,
+                            &x, &y, &width, &height, &threshold ) )
+        return NULL;
+
+    if ( PyObject_AsReadBuffer( pixelsObject, &pixels, &pixelsSize ) < 0 ||
+         PyObject_AsWriteBuffer( maskObject, &mask, &maskSize ) < 0 )
+        return NULL;
+
+    if ( width <= 0 || height <= 0 )
+        Py_RETURN_FALSE;
+
+    /* Make sure that the rectangle lies within both buffers. */
+    long lastRow = (long) y + height - 1;
+    if ( x < 0 || y < 0 || pixelStride <= 0 || maskStride <= 0 ||
+         pixelStride % 4 != 0 ||
+         lastRow * pixelStride + ( (long) x + width ) * 4 >
+         (long) pixelsSize ||
+         lastRow * maskStride + ( (long) x + width + 7 ) / 8 >
+         (long) maskSize )
+    {
+        PyErr_SetString( PyExc_ValueError,
+                         "rectangle lies outside the pixels or the mask" );
+        return NULL;
+    }
+
+    bool changed;
+
+    Py_BEGIN_ALLOW_THREADS
+    changed = updateShapeMask( (const unsigned char *) pixels,
+                               (size_t) pixelStride,
+                               (unsigned char *) mask,
+                               (size_t) maskStride,
+                               x, y, width, height, threshold );
+    Py_END_ALLOW_THREADS
+
+    return PyBool_FromLong( changed );
+}
+
+
+/* ***************************************************************************
+ * Module Initialization
+ * **************************************************************************/
+
+static PyMethodDef shapemask_methods[] = {
+    { "updateShapeMask",
+      shapemask_updateShapeMask,
+      METH_VARARGS,
+      "updateShapeMask(pixels, pixelStride, mask, maskStride, x, y, "
+      "width, height, threshold) -> changed\n\n"
+      "Sets the bits of the given rectangle of a packed 1-bit mask (a "
+      "writable buffer) to whether the alpha of the corresponding "
+      "ARGB32 pixels is at least threshold, and returns whether any "
+      "of them changed." },
+    { NULL, NULL, 0, NULL }
+};
+
+PyMODINIT_FUNC
+init_shapemask( void )
+{
+    Py_InitModule3( "enso.platform.linux._shapemask",
+                    shapemask_methods,
+                    "Native computation of the shape masks of transparent "
+                    "windows, used by enso.platform.linux.graphics." );
+}
@@ -0,0 +1,152 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Implementation file for the SuggestionMarkup module.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include "SuggestionMarkup.h"
+
+#include <algorithm>
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+/* Separates the user text from the suggestion when they are
+ * concatenated; it never equals a real character. */
+#define SEPARATOR ( (CodePoint) 0xffffffff )
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Computes the Z-array of the given text: z[i] is the length of the
+ * longest common prefix of the text and its suffix starting at i.
+ * ----------------------------------------------------------------------*/
+
+static void
+_computeZArray( const CodePointString &text,
+                std::vector<size_t> &z )
+{
+    size_t length = text.size();
+    size_t left = 0;
+    size_t right = 0;
+
+    z.assign( length, 0 );
+    if ( length == 0 )
+        return;
+    z[0] = length;
+
+    for ( size_t i = 1; i < length; i++ )
+    {
+        size_t matched = 0;
+
+        /* Inside [left, right), the text repeats its prefix, so we
+         * know at least part of the answer already. */
+        if ( i < right )
+            matched = std::min( right - i, z[i - left] );
+
+        while ( i + matched < length && text[matched] == text[i + matched] )
+            matched++;
+
+        z[i] = matched;
+        if ( i + matched > right )
+        {
+            left = i;
+            right = i + matched;
+        }
+    }
+}
+
+
+/* ***************************************************************************
+ * Public Functions
+ * **************************************************************************/
+
+void
+findMatchingBlocks( const CodePointString &source,
+                    const CodePointString &suggestion,
+                    std::vector<MatchingBlock> &blocks )
+{
+    CodePointString text;
+    std::vector<size_t> z;
+    size_t sourceIndex = 0;
+    size_t suggestionIndex = 0;
+
+    while ( sourceIndex < source.size() &&
+            suggestionIndex < suggestion.size() )
+    {
+        /* z[patternLength + 1 + j] is the length of the longest
+         * prefix of the rest of the user text that occurs at
+         * position j of the rest of the suggestion. */
+        size_t patternLength = source.size() - sourceIndex;
+
+        text.assign( source.begin() + sourceIndex, source.end() );
+        text.push_back( SEPARATOR );
+        text.insert( text.end(),
+                     suggestion.begin() + suggestionIndex,
+                     suggestion.end() );
+        _computeZArray( text, z );
+
+        size_t bestLength = 0;
+        size_t bestPosition = 0;
+        for ( size_t i = patternLength + 1; i < text.size(); i++ )
+        {
+            if ( z[i] > bestLength )
+            {
+                bestLength = z[i];
+                bestPosition = i - patternLength - 1;
+            }
+        }
+
+        if ( bestLength == 0 )
+        {
+            /* Not even the first character occurs in the rest of the
+             * suggestion, so it's skipped. */
+            sourceIndex++;
+            continue;
+        }
+
+        MatchingBlock block;
+        block.sourceIndex = sourceIndex;
+        block.suggestionIndex = suggestionIndex + bestPosition;
+        block.length = bestLength;
+        blocks.push_back( block );
+
+        sourceIndex += bestLength;
+        suggestionIndex = block.suggestionIndex + bestLength;
+    }
+}
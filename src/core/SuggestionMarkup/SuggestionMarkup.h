@@ -0,0 +1,107 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Header file for the SuggestionMarkup module.
+ *
+ *   The SuggestionMarkup module aligns a suggestion with the user
+ *   text it was made for, which is what
+ *   enso.commands.suggestions.Suggestion needs in order to mark up
+ *   the suggestion (see Suggestion.toXml()) and to complete the user
+ *   text to the next word (see Suggestion.toNextWord()).
+ *
+ *   The alignment is greedy: the longest prefix of the user text
+ *   that occurs anywhere in the suggestion is matched to its first
+ *   occurrence there, and the process is repeated with what's left
+ *   of both strings; if not even the first character of the user
+ *   text occurs in the suggestion, it is skipped.
+ *
+ *   Each step is a single pass over both strings, using the
+ *   Z-array of their concatenation, rather than a substring search
+ *   for every prefix of the user text.
+ *
+ *   This module doesn't depend on Python; see
+ *   suggestionmarkupmodule.cxx for the Python bindings.
+ */
+
+#ifndef _SUGGESTIONMARKUP_H_
+#define _SUGGESTIONMARKUP_H_
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <cstddef>
+#include <vector>
+
+
+/* ***************************************************************************
+ * Type Definitions
+ * **************************************************************************/
+
+/* A single character.  Characters are compared by value only. */
+typedef unsigned int CodePoint;
+
+/* A string of characters. */
+typedef std::vector<CodePoint> CodePointString;
+
+/* A substring of the user text that was matched to a substring of
+ * the suggestion. */
+struct MatchingBlock
+{
+    /* The position of the substring in the user text. */
+    size_t sourceIndex;
+
+    /* The position of the substring in the suggestion. */
+    size_t suggestionIndex;
+
+    /* The length of the substring. */
+    size_t length;
+};
+
+
+/* ***************************************************************************
+ * Function Declarations
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Aligns the given suggestion with the given user text.
+ * ........................................................................
+ *
+ * Appends the matched substrings to blocks, in order; both their
+ * sourceIndex and their suggestionIndex increase from one block to
+ * the next, and blocks never overlap.
+ *
+ * ----------------------------------------------------------------------*/
+
+void
+findMatchingBlocks( const CodePointString &source,
+                    const CodePointString &suggestion,
+                    std::vector<MatchingBlock> &blocks );
+
+#endif
@@ -0,0 +1,184 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*   Python bindings for the SuggestionMarkup module.
+ *
+ *   This builds the enso.commands._suggestionmarkup extension module,
+ *   which is used by enso.commands.suggestions when it's available.
+ *   See that module for documentation of the Python interface.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <Python.h>
+
+#include <new>
+
+#include "SuggestionMarkup.h"
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+#if PY_VERSION_HEX < 0x02050000 && !defined( PY_SSIZE_T_MIN )
+typedef int Py_ssize_t;
+#endif
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Converts a pair of string or unicode objects to CodePointStrings,
+ * the way Python compares them.
+ * ........................................................................
+ *
+ * Two strings are compared byte by byte; otherwise, any string is
+ * decoded with the default encoding first, just as the "in"
+ * operator and the find() method would do.
+ *
+ * Returns 0 and sets the Python error state on failure.
+ *
+ * ----------------------------------------------------------------------*/
+
+static int
+_toCodePoints( PyObject *first,
+               PyObject *second,
+               CodePointString &firstResult,
+               CodePointString &secondResult )
+{
+    if ( PyString_Check( first ) && PyString_Check( second ) )
+    {
+        const unsigned char *data;
+
+        data = (const unsigned char *) PyString_AS_STRING( first );
+        firstResult.assign( data, data + PyString_GET_SIZE( first ) );
+        data = (const unsigned char *) PyString_AS_STRING( second );
+        secondResult.assign( data, data + PyString_GET_SIZE( second ) );
+        return 1;
+    }
+
+    PyObject *objects[2] = { first, second };
+    CodePointString *results[2] = { &firstResult, &secondResult };
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        PyObject *unicode = PyUnicode_FromObject( objects[i] );
+        if ( unicode == NULL )
+            return 0;
+
+        Py_UNICODE *data = PyUnicode_AS_UNICODE( unicode );
+        results[i]->assign( data, data + PyUnicode_GET_SIZE( unicode ) );
+
+        Py_DECREF( unicode );
+    }
+
+    return 1;
+}
+
+
+/* ***************************************************************************
+ * Module Functions
+ * **************************************************************************/
+
+static PyObject *
+suggestionmarkup_findMatchingBlocks( PyObject *self,
+                                     PyObject *args )
+{
+    PyObject *sourceObject;
+    PyObject *suggestionObject;
+    std::vector<MatchingBlock> blocks;
+
+    if ( !PyArg_ParseTuple( args, "OO:findMatchingBlocks",
+                            &sourceObject, &suggestionObject ) )
+        return NULL;
+
+    try
+    {
+        CodePointString source;
+        CodePointString suggestion;
+
+        if ( !_toCodePoints( sourceObject, suggestionObject,
+                             source, suggestion ) )
+            return NULL;
+
+        findMatchingBlocks( source, suggestion, blocks );
+    }
+    catch ( std::bad_alloc & )
+    {
+        return PyErr_NoMemory();
+    }
+
+    PyObject *result = PyList_New( (Py_ssize_t) blocks.size() );
+    if ( result == NULL )
+        return NULL;
+
+    for ( size_t i = 0; i < blocks.size(); i++ )
+    {
+        PyObject *block = Py_BuildValue( "(lll)",
+                                         (long) blocks[i].sourceIndex,
+                                         (long) blocks[i].suggestionIndex,
+                                         (long) blocks[i].length );
+        if ( block == NULL )
+        {
+            Py_DECREF( result );
+            return NULL;
+        }
+        PyList_SET_ITEM( result, (Py_ssize_t) i, block );
+    }
+
+    return result;
+}
+
+
+/* ***************************************************************************
+ * Module Initialization
+ * **************************************************************************/
+
+static PyMethodDef suggestionmarkup_methods[] = {
+    { "findMatchingBlocks",
+      suggestionmarkup_findMatchingBlocks,
+      METH_VARARGS,
+      "findMatchingBlocks(source, suggestion) -> list\n\n"
+      "Aligns suggestion with source, returning a list of "
+      "(sourceIndex, suggestionIndex, length) tuples." },
+    { NULL, NULL, 0, NULL }
+};
+
+PyMODINIT_FUNC
+init_suggestionmarkup( void )
+{
+    Py_InitModule3( "enso.commands._suggestionmarkup",
+                    suggestionmarkup_methods,
+                    "Native implementation of the suggestion alignment "
+                    "used by enso.commands.suggestions." );
+}
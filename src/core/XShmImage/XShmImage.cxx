@@ -0,0 +1,372 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Implementation file for the XShmImage module.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include "XShmImage.h"
+
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+
+/* ***************************************************************************
+ * Module Variables
+ * **************************************************************************/
+
+/* The connection to the display shared by all images, or NULL if it
+ * hasn't been opened yet. */
+static Display *_sharedDisplay = 0;
+
+/* The error handler that was in effect before _handleErrors() was
+ * installed, which handles the errors on all other connections. */
+static XErrorHandler _previousHandler = 0;
+
+/* Whether an X error occurred on the shared connection since this
+ * was last cleared. */
+static bool _errorOccurred = false;
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * X error handler that records that an error occurred on the shared
+ * connection, rather than exiting, which is what Xlib's default
+ * handler does; errors on other connections (e.g., GDK's) are passed
+ * on to the handler that was installed before.
+ * ----------------------------------------------------------------------*/
+
+static int
+_handleErrors( Display *display,
+               XErrorEvent *event )
+{
+    if ( display == _sharedDisplay )
+    {
+        _errorOccurred = true;
+        return 0;
+    }
+
+    if ( _previousHandler != 0 )
+        return _previousHandler( display, event );
+    return 0;
+}
+
+/* ------------------------------------------------------------------------
+ * Returns the connection to the display with the given name (or the
+ * default display if displayName is NULL) shared by all images,
+ * opening it and installing the error handler if it isn't open yet.
+ * ----------------------------------------------------------------------*/
+
+static Display *
+_getSharedDisplay( const char *displayName )
+{
+    if ( _sharedDisplay == 0 )
+    {
+        _sharedDisplay = XOpenDisplay( displayName );
+        if ( _sharedDisplay == 0 )
+            throw XShmImageError( "Couldn't open display." );
+        _previousHandler = XSetErrorHandler( _handleErrors );
+    }
+    else if ( strcmp( XDisplayName( displayName ),
+                      DisplayString( _sharedDisplay ) ) != 0 )
+    {
+        throw XShmImageError( "Images are already made for another "
+                              "display." );
+    }
+
+    return _sharedDisplay;
+}
+
+/* ------------------------------------------------------------------------
+ * Returns whether the given image's pixels are laid out like those
+ * of a Cairo ARGB32 (or RGB24) image surface.
+ * ----------------------------------------------------------------------*/
+
+static bool
+_hasCairoPixelFormat( XImage *image )
+{
+    const unsigned int one = 1;
+    int hostByteOrder =
+        *(const unsigned char *) &one == 1 ? LSBFirst : MSBFirst;
+
+    return image->bits_per_pixel == 32 &&
+        image->byte_order == hostByteOrder &&
+        image->red_mask == 0xff0000 &&
+        image->green_mask == 0x00ff00 &&
+        image->blue_mask == 0x0000ff &&
+        image->bytes_per_line % 4 == 0;
+}
+
+
+/* ***************************************************************************
+ * Public Class Methods
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Create an error with the given reason.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+XShmImageError::XShmImageError( const char *what ) :
+    _what( what )
+{
+}
+
+/* ------------------------------------------------------------------------
+ * Returns the reason for the error.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+const char *
+XShmImageError::what( void )
+{
+    return _what;
+}
+
+/* ------------------------------------------------------------------------
+ * This constructor makes the image and its shared memory segment.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+XShmImage::XShmImage( const char *displayName,
+                      unsigned long window,
+                      int width,
+                      int height ) :
+    _display( 0 ),
+    _window( (Window) window ),
+    _gc( 0 ),
+    _isAttached( false ),
+    _image( 0 )
+{
+    XWindowAttributes attributes;
+
+    _segment.shmid = -1;
+    _segment.shmaddr = (char *) -1;
+
+    if ( width < 1 || height < 1 )
+        throw XShmImageError( "Size out of range." );
+
+    _display = _getSharedDisplay( displayName );
+
+    if ( !XShmQueryExtension( _display ) )
+    {
+        _destroy();
+        throw XShmImageError( "MIT-SHM isn't supported." );
+    }
+
+    _errorOccurred = false;
+    if ( !XGetWindowAttributes( _display, _window, &attributes )
+         || _errorOccurred )
+    {
+        _destroy();
+        throw XShmImageError( "Couldn't get window attributes." );
+    }
+
+    _image = XShmCreateImage( _display, attributes.visual,
+                              attributes.depth, ZPixmap, 0, &_segment,
+                              width, height );
+    if ( _image == 0 )
+    {
+        _destroy();
+        throw XShmImageError( "Couldn't create image." );
+    }
+
+    if ( !_hasCairoPixelFormat( _image ) )
+    {
+        _destroy();
+        throw XShmImageError( "Unsupported pixel format." );
+    }
+
+    _segment.shmid = shmget( IPC_PRIVATE,
+                             _image->bytes_per_line * _image->height,
+                             IPC_CREAT | 0600 );
+    if ( _segment.shmid < 0 )
+    {
+        _destroy();
+        throw XShmImageError( "Couldn't create shared memory segment." );
+    }
+
+    _segment.shmaddr = (char *) shmat( _segment.shmid, 0, 0 );
+    if ( _segment.shmaddr == (char *) -1 )
+    {
+        _destroy();
+        throw XShmImageError( "Couldn't attach shared memory segment." );
+    }
+    _image->data = _segment.shmaddr;
+    _segment.readOnly = False;
+
+    /* The server can't attach the segment if it's on another host,
+     * which is only reported as an X error. */
+    _errorOccurred = false;
+    _isAttached = XShmAttach( _display, &_segment ) != 0;
+    XSync( _display, False );
+    if ( !_isAttached || _errorOccurred )
+    {
+        _isAttached = false;
+        _destroy();
+        throw XShmImageError( "X server couldn't attach shared memory." );
+    }
+
+    /* Now that both ends are attached, mark the segment for removal,
+     * so that it goes away once they detach, even if we crash. */
+    shmctl( _segment.shmid, IPC_RMID, 0 );
+
+    _gc = XCreateGC( _display, _window, 0, 0 );
+}
+
+
+/* ------------------------------------------------------------------------
+ * This destructor releases the image.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+XShmImage::~XShmImage( void )
+{
+    _destroy();
+}
+
+
+/* ------------------------------------------------------------------------
+ * Draws the given rectangle of the image to the window.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+void
+XShmImage::put( int x,
+                int y,
+                int width,
+                int height )
+{
+    if ( x < 0 )
+    {
+        width += x;
+        x = 0;
+    }
+    if ( y < 0 )
+    {
+        height += y;
+        y = 0;
+    }
+    if ( x + width > _image->width )
+        width = _image->width - x;
+    if ( y + height > _image->height )
+        height = _image->height - y;
+    if ( width <= 0 || height <= 0 )
+        return;
+
+    _errorOccurred = false;
+    XShmPutImage( _display, _window, _gc, _image, x, y, x, y,
+                  (unsigned int) width, (unsigned int) height, False );
+
+    /* Wait for the server to finish reading the pixels. */
+    XSync( _display, False );
+    if ( _errorOccurred )
+        throw XShmImageError( "X server couldn't draw image." );
+}
+
+
+unsigned char *
+XShmImage::getData( void )
+{
+    return (unsigned char *) _image->data;
+}
+
+
+int
+XShmImage::getStride( void )
+{
+    return _image->bytes_per_line;
+}
+
+
+int
+XShmImage::getWidth( void )
+{
+    return _image->width;
+}
+
+
+int
+XShmImage::getHeight( void )
+{
+    return _image->height;
+}
+
+
+/* ***************************************************************************
+ * Private Class Methods
+ * **************************************************************************/
+
+void
+XShmImage::_destroy( void )
+{
+    if ( _isAttached )
+    {
+        XShmDetach( _display, &_segment );
+        XSync( _display, False );
+        _isAttached = false;
+    }
+
+    if ( _image != 0 )
+    {
+        /* The data isn't XDestroyImage()'s to free. */
+        _image->data = 0;
+        XDestroyImage( _image );
+        _image = 0;
+    }
+
+    if ( _segment.shmaddr != (char *) -1 )
+    {
+        shmdt( _segment.shmaddr );
+        _segment.shmaddr = (char *) -1;
+    }
+
+    if ( _segment.shmid >= 0 )
+    {
+        shmctl( _segment.shmid, IPC_RMID, 0 );
+        _segment.shmid = -1;
+    }
+
+    if ( _gc != 0 )
+    {
+        XFreeGC( _display, _gc );
+        XFlush( _display );
+        _gc = 0;
+    }
+
+    /* The shared connection stays open for the next image. */
+    _display = 0;
+}
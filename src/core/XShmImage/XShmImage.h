@@ -0,0 +1,187 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Header file for the XShmImage module.
+ *
+ *   The XShmImage module offers a single eponymous class, an image
+ *   in a shared memory segment that an X server can read straight
+ *   from (using the MIT-SHM extension), for drawing the contents of
+ *   a window without sending its pixels over the X connection.
+ *
+ *   The image's pixels are 32-bit, in native byte order, with the
+ *   red, green and blue channels in the same places as in a Cairo
+ *   ARGB32 surface, so that a Cairo image surface can be made from
+ *   them; the alpha channel is ignored by the server.  An image can
+ *   only be made for windows whose visual has this pixel format.
+ *
+ *   All images share one connection to the display, which is
+ *   opened by the first image made and kept open from then on; the
+ *   X errors on it are recorded by an error handler of this module,
+ *   and turned into XShmImageErrors, rather than exiting the
+ *   process.  Since Xlib isn't made thread-safe, images must only be
+ *   used by one thread at a time.
+ *
+ *   This module doesn't depend on Python; see xshmimagemodule.cxx
+ *   for the Python bindings.
+ */
+
+#ifndef _XSHMIMAGE_H_
+#define _XSHMIMAGE_H_
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+
+/* ***************************************************************************
+ * Class Declarations
+ * **************************************************************************/
+
+/* ===========================================================================
+ * Exception classes
+ * ...........................................................................
+ * =========================================================================*/
+
+/* Exception thrown when a shared memory image can't be made, e.g.,
+ * because the X server doesn't support MIT-SHM or is on another
+ * host. */
+class XShmImageError
+{
+public:
+    /* Create an error with the given reason. */
+    XShmImageError( const char *what );
+
+    /* Returns the reason for the error. */
+    const char *
+    what( void );
+
+private:
+    const char *_what;
+};
+
+
+/* ===========================================================================
+ * XShmImage class
+ * ...........................................................................
+ *
+ * An image in shared memory, which can be drawn to a window.
+ *
+ * =========================================================================*/
+
+class XShmImage
+{
+public:
+
+    /* --------------------------------------------------------------------
+     * Constructor
+     * --------------------------------------------------------------------
+     *
+     * Makes an image of the given size, in pixels, for the window
+     * with the given ID on the given display (or the default display
+     * if displayName is NULL).  All images must be for the same
+     * display.
+     *
+     * If the image can't be made, an XShmImageError is thrown.
+     *
+     * ------------------------------------------------------------------*/
+
+    XShmImage( const char *displayName,
+               unsigned long window,
+               int width,
+               int height );
+
+    /* --------------------------------------------------------------------
+     * Destructor
+     * ------------------------------------------------------------------*/
+
+    ~XShmImage( void );
+
+    /* --------------------------------------------------------------------
+     * Draws the given rectangle of the image to the same place in the
+     * window.
+     * ....................................................................
+     *
+     * The rectangle is clipped to the image.  This waits until the X
+     * server has read the pixels, so that the image can be drawn on
+     * as soon as it returns.  If the server reports an error, e.g.,
+     * because the window has been destroyed, an XShmImageError is
+     * thrown.
+     *
+     * ------------------------------------------------------------------*/
+
+    void
+    put( int x,
+         int y,
+         int width,
+         int height );
+
+    /* Returns the image's pixels. */
+    unsigned char *
+    getData( void );
+
+    /* Returns the number of bytes per row of pixels. */
+    int
+    getStride( void );
+
+    int
+    getWidth( void );
+
+    int
+    getHeight( void );
+
+private:
+
+    /* Releases everything the image holds. */
+    void
+    _destroy( void );
+
+    /* The connection to the display shared by all images. */
+    Display *_display;
+
+    /* The window the image is drawn to. */
+    Window _window;
+
+    /* The graphics context used to draw the image. */
+    GC _gc;
+
+    /* The shared memory segment holding the pixels. */
+    XShmSegmentInfo _segment;
+
+    /* Whether the X server has attached the segment. */
+    bool _isAttached;
+
+    /* The image, whose data is the shared memory segment. */
+    XImage *_image;
+};
+
+#endif
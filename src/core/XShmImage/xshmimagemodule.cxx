@@ -0,0 +1,336 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Python bindings for the XShmImage module.
+ *
+ *   This builds the enso.platform.linux._xshmimage extension module,
+ *   which is used by enso.platform.linux.graphics when it's
+ *   available.  Its ShmImage objects support the (writable) buffer
+ *   interface, so that cairo.ImageSurface.create_for_data() can make
+ *   a surface of their pixels, which also keeps them alive for as
+ *   long as the surface is.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <Python.h>
+#include <structmember.h>
+
+#include <new>
+
+#include "XShmImage.h"
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+#if PY_VERSION_HEX < 0x02050000 && !defined( PY_SSIZE_T_MIN )
+typedef int Py_ssize_t;
+typedef inquiry lenfunc;
+typedef getreadbufferproc readbufferproc;
+typedef getwritebufferproc writebufferproc;
+typedef getsegcountproc segcountproc;
+typedef getcharbufferproc charbufferproc;
+#endif
+
+
+/* ***************************************************************************
+ * Module Variables
+ * **************************************************************************/
+
+/* The exception raised when an image can't be made. */
+static PyObject *_error = NULL;
+
+
+/* ***************************************************************************
+ * ShmImage Type
+ * **************************************************************************/
+
+typedef struct
+{
+    PyObject_HEAD
+
+    /* The image, or NULL if it hasn't been made. */
+    XShmImage *image;
+} ShmImage;
+
+static int
+ShmImage_init( ShmImage *self,
+               PyObject *args,
+               PyObject *kwargs )
+{
+    const char *displayName;
+    unsigned long window;
+    int width;
+    int height;
+
+    if ( !PyArg_ParseTuple( args, "zkii:ShmImage", &displayName, &window,
+                            &width, &height ) )
+        return -1;
+
+    if ( self->image != NULL )
+    {
+        PyErr_SetString( PyExc_TypeError, "ShmImage is already made" );
+        return -1;
+    }
+
+    try
+    {
+        self->image = new XShmImage( displayName, window, width, height );
+    }
+    catch ( XShmImageError &e )
+    {
+        PyErr_SetString( _error, e.what() );
+        return -1;
+    }
+    catch ( std::bad_alloc & )
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+ShmImage_dealloc( ShmImage *self )
+{
+    delete self->image;
+    self->ob_type->tp_free( (PyObject *) self );
+}
+
+/* ------------------------------------------------------------------------
+ * Returns the image, setting the Python error state and returning
+ * NULL if it hasn't been made.
+ * ----------------------------------------------------------------------*/
+
+static XShmImage *
+_getImage( ShmImage *self )
+{
+    if ( self->image == NULL )
+        PyErr_SetString( PyExc_ValueError, "ShmImage isn't made" );
+    return self->image;
+}
+
+static PyObject *
+ShmImage_put( ShmImage *self,
+              PyObject *args )
+{
+    int x;
+    int y;
+    int width;
+    int height;
+
+    if ( !PyArg_ParseTuple( args, "iiii:put", &x, &y, &width, &height ) )
+        return NULL;
+
+    XShmImage *image = _getImage( self );
+    if ( image == NULL )
+        return NULL;
+
+    /* The GIL is kept, since it's what keeps other threads from using
+     * the display connection shared by all images meanwhile. */
+    try
+    {
+        image->put( x, y, width, height );
+    }
+    catch ( XShmImageError &e )
+    {
+        PyErr_SetString( _error, e.what() );
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+ShmImage_getattr( ShmImage *self,
+                  void *closure )
+{
+    XShmImage *image = _getImage( self );
+    if ( image == NULL )
+        return NULL;
+
+    switch ( (long) closure )
+    {
+    case 0:
+        return PyInt_FromLong( image->getWidth() );
+    case 1:
+        return PyInt_FromLong( image->getHeight() );
+    default:
+        return PyInt_FromLong( image->getStride() );
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * The buffer interface, which exposes the image's pixels as a single
+ * segment.
+ * ----------------------------------------------------------------------*/
+
+static Py_ssize_t
+ShmImage_getbuffer( ShmImage *self,
+                    Py_ssize_t segment,
+                    void **data )
+{
+    if ( segment != 0 )
+    {
+        PyErr_SetString( PyExc_SystemError,
+                         "accessing non-existent buffer segment" );
+        return -1;
+    }
+
+    XShmImage *image = _getImage( self );
+    if ( image == NULL )
+        return -1;
+
+    *data = image->getData();
+    return (Py_ssize_t) image->getStride() * image->getHeight();
+}
+
+static Py_ssize_t
+ShmImage_getsegcount( ShmImage *self,
+                      Py_ssize_t *length )
+{
+    if ( length != NULL )
+        *length = self->image == NULL ? 0 :
+            (Py_ssize_t) self->image->getStride() * self->image->getHeight();
+    return 1;
+}
+
+static PyBufferProcs ShmImage_as_buffer = {
+    (readbufferproc) ShmImage_getbuffer,        /* bf_getreadbuffer */
+    (writebufferproc) ShmImage_getbuffer,       /* bf_getwritebuffer */
+    (segcountproc) ShmImage_getsegcount,        /* bf_getsegcount */
+    NULL,                                       /* bf_getcharbuffer */
+};
+
+static PyMethodDef ShmImage_methods[] = {
+    { "put", (PyCFunction) ShmImage_put, METH_VARARGS,
+      "put(x, y, width, height)\n\n"
+      "Draws the given rectangle of the image to the same place in "
+      "the window, and waits for the X server to finish reading it.  "
+      "Raises error if the X server can't draw it." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef ShmImage_getset[] = {
+    { (char *) "width", (getter) ShmImage_getattr, NULL,
+      (char *) "The width of the image, in pixels.", (void *) 0 },
+    { (char *) "height", (getter) ShmImage_getattr, NULL,
+      (char *) "The height of the image, in pixels.", (void *) 1 },
+    { (char *) "stride", (getter) ShmImage_getattr, NULL,
+      (char *) "The number of bytes per row of pixels.", (void *) 2 },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject ShmImageType = {
+    PyObject_HEAD_INIT( NULL )
+    0,                                          /* ob_size */
+    "enso.platform.linux._xshmimage.ShmImage",  /* tp_name */
+    sizeof( ShmImage ),                         /* tp_basicsize */
+    0,                                          /* tp_itemsize */
+    (destructor) ShmImage_dealloc,              /* tp_dealloc */
+    0,                                          /* tp_print */
+    0,                                          /* tp_getattr */
+    0,                                          /* tp_setattr */
+    0,                                          /* tp_compare */
+    0,                                          /* tp_repr */
+    0,                                          /* tp_as_number */
+    0,                                          /* tp_as_sequence */
+    0,                                          /* tp_as_mapping */
+    0,                                          /* tp_hash */
+    0,                                          /* tp_call */
+    0,                                          /* tp_str */
+    0,                                          /* tp_getattro */
+    0,                                          /* tp_setattro */
+    &ShmImage_as_buffer,                        /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                         /* tp_flags */
+    "ShmImage(displayName, window, width, height)\n\n"
+    "An image in X shared memory, for the window with the given ID "
+    "on the given display (None for the default one).  All images "
+    "share one connection to the display, so they must all be for "
+    "the same one.  Raises error if the image can't be "
+    "made.",                                    /* tp_doc */
+    0,                                          /* tp_traverse */
+    0,                                          /* tp_clear */
+    0,                                          /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    0,                                          /* tp_iter */
+    0,                                          /* tp_iternext */
+    ShmImage_methods,                           /* tp_methods */
+    0,                                          /* tp_members */
+    ShmImage_getset,                            /* tp_getset */
+    0,                                          /* tp_base */
+    0,                                          /* tp_dict */
+    0,                                          /* tp_descr_get */
+    0,                                          /* tp_descr_set */
+    0,                                          /* tp_dictoffset */
+    (initproc) ShmImage_init,                   /* tp_init */
+    0,                                          /* tp_alloc */
+    0,                                          /* tp_new */
+};
+
+
+/* ***************************************************************************
+ * Module Initialization
+ * **************************************************************************/
+
+static PyMethodDef xshmimage_methods[] = {
+    { NULL, NULL, 0, NULL }
+};
+
+PyMODINIT_FUNC
+init_xshmimage( void )
+{
+    PyObject *module;
+
+    ShmImageType.tp_new = PyType_GenericNew;
+    if ( PyType_Ready( &ShmImageType ) < 0 )
+        return;
+
+    module = Py_InitModule3( "enso.platform.linux._xshmimage",
+                             xshmimage_methods,
+                             "Images in X shared memory (MIT-SHM), used "
+                             "by enso.platform.linux.graphics." );
+    if ( module == NULL )
+        return;
+
+    _error = PyErr_NewException( (char *) "enso.platform.linux."
+                                 "_xshmimage.error", NULL, NULL );
+    if ( _error == NULL )
+        return;
+    Py_INCREF( _error );
+    PyModule_AddObject( module, "error", _error );
+
+    Py_INCREF( &ShmImageType );
+    PyModule_AddObject( module, "ShmImage", (PyObject *) &ShmImageType );
+}
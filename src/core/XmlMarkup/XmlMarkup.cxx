@@ -0,0 +1,776 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Implementation file for the XmlMarkup module.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include "XmlMarkup.h"
+
+
+/* ***************************************************************************
+ * Constants
+ * **************************************************************************/
+
+/* The maximum length of a chain of tag aliases that are aliases for
+ * other tag aliases. */
+static const int MAX_ALIAS_DEPTH = 32;
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Character classes of the subset of XML that's understood.
+ * ----------------------------------------------------------------------*/
+
+static bool
+_isSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool
+_isNameStart( char c )
+{
+    return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ||
+        c == '_' || c == ':';
+}
+
+static bool
+_isNameChar( char c )
+{
+    return _isNameStart( c ) || ( c >= '0' && c <= '9' ) ||
+        c == '-' || c == '.';
+}
+
+/* ------------------------------------------------------------------------
+ * Returns whether the given character may occur in an XML document.
+ * ----------------------------------------------------------------------*/
+
+static bool
+_isXmlChar( unsigned long c )
+{
+    return c == 0x9 || c == 0xA || c == 0xD ||
+        ( c >= 0x20 && c <= 0xD7FF ) ||
+        ( c >= 0xE000 && c <= 0xFFFD ) ||
+        ( c >= 0x10000 && c <= 0x10FFFF );
+}
+
+/* ------------------------------------------------------------------------
+ * Appends the given character to the given UTF-8 string.
+ * ----------------------------------------------------------------------*/
+
+static void
+_appendUtf8( unsigned long c,
+             std::string &text )
+{
+    if ( c < 0x80 )
+        text += (char) c;
+    else if ( c < 0x800 )
+    {
+        text += (char) ( 0xC0 | ( c >> 6 ) );
+        text += (char) ( 0x80 | ( c & 0x3F ) );
+    }
+    else if ( c < 0x10000 )
+    {
+        text += (char) ( 0xE0 | ( c >> 12 ) );
+        text += (char) ( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+        text += (char) ( 0x80 | ( c & 0x3F ) );
+    }
+    else
+    {
+        text += (char) ( 0xF0 | ( c >> 18 ) );
+        text += (char) ( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+        text += (char) ( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+        text += (char) ( 0x80 | ( c & 0x3F ) );
+    }
+}
+
+
+/* ***************************************************************************
+ * Class Declarations
+ * **************************************************************************/
+
+/* ===========================================================================
+ * _MarkupParser class
+ * ...........................................................................
+ *
+ * The state of a single call to parseMarkup().  The tokenizer
+ * methods return false if the markup isn't understood; the element
+ * and character data methods play the part of
+ * xmltextlayout._XmlMarkupHandler.
+ *
+ * =========================================================================*/
+
+class _MarkupParser
+{
+public:
+    _MarkupParser( const char *text,
+                   size_t length,
+                   const MarkupTagAliases &tagAliases,
+                   const MarkupSelectors &selectors,
+                   Markup &markup,
+                   MarkupError &error );
+
+    MarkupStatus
+    parse( void );
+
+private:
+    /* What an open element is, once tag aliases are resolved. */
+    enum ElementKind
+    {
+        DOCUMENT_ELEMENT,
+        BLOCK_ELEMENT,
+        INLINE_ELEMENT
+    };
+
+    /* An open element. */
+    struct OpenElement
+    {
+        std::string name;
+        ElementKind kind;
+    };
+
+    /* An attribute of a start tag. */
+    struct Attribute
+    {
+        std::string name;
+        std::string value;
+    };
+
+    /* Tokenizer */
+
+    bool
+    _parseName( std::string &name );
+
+    void
+    _skipSpaces( void );
+
+    bool
+    _parseReference( std::string &text );
+
+    bool
+    _parseAttributeValue( std::string &value );
+
+    bool
+    _parseStartTag( std::string &name,
+                    std::vector<Attribute> &attributes,
+                    bool &isEmpty );
+
+    bool
+    _parseEndTag( std::string &name );
+
+    bool
+    _parseText( std::string &text );
+
+    /* Elements and character data */
+
+    MarkupStatus
+    _findSelector( const std::string &name,
+                   const std::string *style,
+                   std::string &selector );
+
+    MarkupStatus
+    _startElement( const std::string &name,
+                   const std::string *style,
+                   int aliasDepth,
+                   ElementKind &kind );
+
+    void
+    _endElement( ElementKind kind );
+
+    MarkupStatus
+    _characters( const std::string &text );
+
+    const char *_position;
+    const char *_end;
+    const MarkupTagAliases &_tagAliases;
+    const MarkupSelectors &_selectors;
+    Markup &_markup;
+    MarkupError &_error;
+
+    std::vector<OpenElement> _openElements;
+    bool _hasDocument;
+    bool _inBlock;
+
+    /* The selectors of the currently open inline elements. */
+    std::vector<std::string> _inlineSelectors;
+};
+
+
+/* ***************************************************************************
+ * Class Definitions
+ * **************************************************************************/
+
+_MarkupParser::_MarkupParser( const char *text,
+                              size_t length,
+                              const MarkupTagAliases &tagAliases,
+                              const MarkupSelectors &selectors,
+                              Markup &markup,
+                              MarkupError &error ) :
+    _position( text ),
+    _end( text + length ),
+    _tagAliases( tagAliases ),
+    _selectors( selectors ),
+    _markup( markup ),
+    _error( error ),
+    _hasDocument( false ),
+    _inBlock( false )
+{
+}
+
+/* ===========================================================================
+ * Tokenizer
+ * =========================================================================*/
+
+bool
+_MarkupParser::_parseName( std::string &name )
+{
+    const char *start = _position;
+
+    if ( _position == _end || !_isNameStart( *_position ) )
+        return false;
+
+    while ( _position != _end && _isNameChar( *_position ) )
+        _position++;
+
+    name.assign( start, _position );
+    return true;
+}
+
+void
+_MarkupParser::_skipSpaces( void )
+{
+    while ( _position != _end && _isSpace( *_position ) )
+        _position++;
+}
+
+/* ------------------------------------------------------------------------
+ * Parses the character or predefined entity reference at the
+ * current position, which is just past its "&", and appends the
+ * character it stands for to text.
+ * ----------------------------------------------------------------------*/
+
+bool
+_MarkupParser::_parseReference( std::string &text )
+{
+    if ( _position != _end && *_position == '#' )
+    {
+        unsigned long c = 0;
+        unsigned long base = 10;
+        const char *digits;
+
+        _position++;
+        if ( _position != _end && *_position == 'x' )
+        {
+            base = 16;
+            _position++;
+        }
+
+        digits = _position;
+        while ( _position != _end && *_position != ';' )
+        {
+            char digit = *_position;
+            unsigned long value;
+
+            if ( digit >= '0' && digit <= '9' )
+                value = digit - '0';
+            else if ( base == 16 && digit >= 'a' && digit <= 'f' )
+                value = digit - 'a' + 10;
+            else if ( base == 16 && digit >= 'A' && digit <= 'F' )
+                value = digit - 'A' + 10;
+            else
+                return false;
+
+            c = c * base + value;
+            if ( c > 0x10FFFF )
+                return false;
+            _position++;
+        }
+
+        if ( _position == _end || _position == digits || !_isXmlChar( c ) )
+            return false;
+
+        _position++;
+        _appendUtf8( c, text );
+        return true;
+    }
+
+    std::string name;
+
+    if ( !_parseName( name ) || _position == _end || *_position != ';' )
+        return false;
+    _position++;
+
+    if ( name == "amp" )
+        text += '&';
+    else if ( name == "lt" )
+        text += '<';
+    else if ( name == "gt" )
+        text += '>';
+    else if ( name == "quot" )
+        text += '"';
+    else if ( name == "apos" )
+        text += '\'';
+    else
+        return false;
+
+    return true;
+}
+
+/* ------------------------------------------------------------------------
+ * Parses a quoted attribute value.  Values containing literal
+ * whitespace other than spaces are left to xml.sax, since XML
+ * normalizes it.
+ * ----------------------------------------------------------------------*/
+
+bool
+_MarkupParser::_parseAttributeValue( std::string &value )
+{
+    if ( _position == _end || ( *_position != '"' && *_position != '\'' ) )
+        return false;
+
+    char quote = *_position++;
+
+    while ( _position != _end && *_position != quote )
+    {
+        char c = *_position;
+
+        if ( c == '&' )
+        {
+            _position++;
+            if ( !_parseReference( value ) )
+                return false;
+        }
+        else if ( c == '<' || c < ' ' || c > '~' )
+            return false;
+        else
+        {
+            value += c;
+            _position++;
+        }
+    }
+
+    if ( _position == _end )
+        return false;
+
+    _position++;
+    return true;
+}
+
+/* ------------------------------------------------------------------------
+ * Parses the start tag at the current position, which is just past
+ * its "<".
+ * ----------------------------------------------------------------------*/
+
+bool
+_MarkupParser::_parseStartTag( std::string &name,
+                               std::vector<Attribute> &attributes,
+                               bool &isEmpty )
+{
+    if ( !_parseName( name ) )
+        return false;
+
+    while ( true )
+    {
+        const char *beforeSpaces = _position;
+
+        _skipSpaces();
+        if ( _position == _end )
+            return false;
+
+        if ( *_position == '>' )
+        {
+            _position++;
+            isEmpty = false;
+            return true;
+        }
+
+        if ( *_position == '/' )
+        {
+            _position++;
+            if ( _position == _end || *_position != '>' )
+                return false;
+            _position++;
+            isEmpty = true;
+            return true;
+        }
+
+        /* Attributes must be separated from what precedes them by
+         * whitespace. */
+        if ( _position == beforeSpaces )
+            return false;
+
+        Attribute attribute;
+
+        if ( !_parseName( attribute.name ) )
+            return false;
+        _skipSpaces();
+        if ( _position == _end || *_position != '=' )
+            return false;
+        _position++;
+        _skipSpaces();
+        if ( !_parseAttributeValue( attribute.value ) )
+            return false;
+
+        for ( size_t i = 0; i < attributes.size(); i++ )
+            if ( attributes[i].name == attribute.name )
+                return false;
+
+        attributes.push_back( attribute );
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Parses the end tag at the current position, which is just past
+ * its "</".
+ * ----------------------------------------------------------------------*/
+
+bool
+_MarkupParser::_parseEndTag( std::string &name )
+{
+    if ( !_parseName( name ) )
+        return false;
+
+    _skipSpaces();
+    if ( _position == _end || *_position != '>' )
+        return false;
+
+    _position++;
+    return true;
+}
+
+/* ------------------------------------------------------------------------
+ * Parses the character data up to the next tag or the end of the
+ * markup, if any.
+ * ----------------------------------------------------------------------*/
+
+bool
+_MarkupParser::_parseText( std::string &text )
+{
+    const char *start = _position;
+
+    while ( _position != _end && *_position != '<' )
+    {
+        char c = *_position;
+
+        if ( c == '&' )
+        {
+            _position++;
+            if ( !_parseReference( text ) )
+                return false;
+        }
+        else if ( c == '>' && _position - start >= 2 &&
+                  _position[-1] == ']' && _position[-2] == ']' )
+        {
+            /* "]]>" isn't allowed in character data. */
+            return false;
+        }
+        else if ( ( c < ' ' && c != '\t' && c != '\n' ) || c > '~' )
+        {
+            /* Carriage returns would need line end normalization,
+             * and anything else is either illegal or not ASCII. */
+            return false;
+        }
+        else
+        {
+            text += c;
+            _position++;
+        }
+    }
+
+    return true;
+}
+
+/* ===========================================================================
+ * Elements and Character Data
+ * =========================================================================*/
+
+/* ------------------------------------------------------------------------
+ * Finds the selector of the style of the given element: the style
+ * it asks for (if any) or, if that style doesn't exist, the style
+ * named by the element.
+ * ----------------------------------------------------------------------*/
+
+MarkupStatus
+_MarkupParser::_findSelector( const std::string &name,
+                              const std::string *style,
+                              std::string &selector )
+{
+    if ( style != NULL && !style->empty() && _selectors.count( *style ) )
+    {
+        selector = *style;
+        return MARKUP_OK;
+    }
+
+    if ( !_selectors.count( name ) )
+    {
+        _error.name = name;
+        _error.hasStyle = ( style != NULL );
+        if ( style != NULL )
+            _error.style = *style;
+        return MARKUP_NO_STYLE;
+    }
+
+    selector = name;
+    return MARKUP_OK;
+}
+
+MarkupStatus
+_MarkupParser::_startElement( const std::string &name,
+                              const std::string *style,
+                              int aliasDepth,
+                              ElementKind &kind )
+{
+    MarkupStatus status;
+    std::string selector;
+
+    if ( name == "document" )
+    {
+        if ( _hasDocument )
+        {
+            _error.name =
+                "Document element encountered inside document element.";
+            return MARKUP_UNEXPECTED_ELEMENT;
+        }
+        status = _findSelector( name, style, selector );
+        if ( status != MARKUP_OK )
+            return status;
+
+        _markup.documentSelector = selector;
+        _hasDocument = true;
+        kind = DOCUMENT_ELEMENT;
+    }
+    else if ( name == "block" )
+    {
+        if ( !_hasDocument )
+        {
+            _error.name =
+                "Block element encountered outside of document element.";
+            return MARKUP_UNEXPECTED_ELEMENT;
+        }
+        if ( _inBlock )
+        {
+            _error.name =
+                "Block element encountered inside block element.";
+            return MARKUP_UNEXPECTED_ELEMENT;
+        }
+        status = _findSelector( name, style, selector );
+        if ( status != MARKUP_OK )
+            return status;
+
+        _markup.blocks.push_back( MarkupBlock() );
+        _markup.blocks.back().selector = selector;
+        _inBlock = true;
+        kind = BLOCK_ELEMENT;
+    }
+    else if ( name == "inline" )
+    {
+        if ( !_inBlock )
+        {
+            _error.name =
+                "Inline element encountered outside of block element.";
+            return MARKUP_UNEXPECTED_ELEMENT;
+        }
+        status = _findSelector( name, style, selector );
+        if ( status != MARKUP_OK )
+            return status;
+
+        _inlineSelectors.push_back( selector );
+        kind = INLINE_ELEMENT;
+    }
+    else
+    {
+        MarkupTagAliases::const_iterator alias = _tagAliases.find( name );
+
+        if ( alias == _tagAliases.end() )
+        {
+            _error.name = name;
+            return MARKUP_UNKNOWN_ELEMENT;
+        }
+
+        /* A tag alias is its base element, styled by the alias'
+         * style; its own attributes are ignored. */
+        if ( aliasDepth == MAX_ALIAS_DEPTH )
+            return MARKUP_NOT_UNDERSTOOD;
+        return _startElement( alias->second, &name, aliasDepth + 1, kind );
+    }
+
+    return MARKUP_OK;
+}
+
+void
+_MarkupParser::_endElement( ElementKind kind )
+{
+    if ( kind == BLOCK_ELEMENT )
+        _inBlock = false;
+    else if ( kind == INLINE_ELEMENT )
+        _inlineSelectors.pop_back();
+}
+
+MarkupStatus
+_MarkupParser::_characters( const std::string &text )
+{
+    if ( text.empty() )
+        return MARKUP_OK;
+
+    if ( !_inBlock )
+    {
+        /* Whitespace is ignored here; anything else is left to
+         * xml.sax, which decides what it is. */
+        if ( text.find_first_not_of( ' ' ) != std::string::npos )
+            return MARKUP_NOT_UNDERSTOOD;
+        return MARKUP_OK;
+    }
+
+    std::vector<MarkupRun> &runs = _markup.blocks.back().runs;
+
+    if ( !runs.empty() && runs.back().selectors == _inlineSelectors )
+        runs.back().text += text;
+    else
+    {
+        runs.push_back( MarkupRun() );
+        runs.back().selectors = _inlineSelectors;
+        runs.back().text = text;
+    }
+
+    return MARKUP_OK;
+}
+
+/* ===========================================================================
+ * Parsing
+ * =========================================================================*/
+
+MarkupStatus
+_MarkupParser::parse( void )
+{
+    bool hasRoot = false;
+
+    while ( _position != _end )
+    {
+        MarkupStatus status;
+
+        if ( _openElements.empty() )
+        {
+            /* Only whitespace may surround the root element. */
+            _skipSpaces();
+            if ( _position == _end )
+                break;
+            if ( *_position != '<' )
+                return MARKUP_NOT_UNDERSTOOD;
+        }
+
+        if ( *_position != '<' )
+        {
+            std::string text;
+
+            if ( !_parseText( text ) )
+                return MARKUP_NOT_UNDERSTOOD;
+
+            status = _characters( text );
+            if ( status != MARKUP_OK )
+                return status;
+            continue;
+        }
+
+        _position++;
+        if ( _position != _end && *_position == '/' )
+        {
+            std::string name;
+
+            _position++;
+            if ( !_parseEndTag( name ) || _openElements.empty() ||
+                 _openElements.back().name != name )
+                return MARKUP_NOT_UNDERSTOOD;
+
+            _endElement( _openElements.back().kind );
+            _openElements.pop_back();
+            continue;
+        }
+
+        /* Comments, processing instructions, CDATA sections and
+         * DOCTYPEs all fail here. */
+        OpenElement element;
+        std::vector<Attribute> attributes;
+        bool isEmpty;
+
+        if ( !_parseStartTag( element.name, attributes, isEmpty ) )
+            return MARKUP_NOT_UNDERSTOOD;
+
+        if ( _openElements.empty() )
+        {
+            if ( hasRoot )
+                return MARKUP_NOT_UNDERSTOOD;
+            hasRoot = true;
+        }
+
+        const std::string *style = NULL;
+        for ( size_t i = 0; i < attributes.size(); i++ )
+            if ( attributes[i].name == "style" )
+                style = &attributes[i].value;
+
+        status = _startElement( element.name, style, 0, element.kind );
+        if ( status != MARKUP_OK )
+            return status;
+
+        if ( isEmpty )
+            _endElement( element.kind );
+        else
+            _openElements.push_back( element );
+    }
+
+    if ( !hasRoot || !_openElements.empty() )
+        return MARKUP_NOT_UNDERSTOOD;
+
+    return MARKUP_OK;
+}
+
+
+/* ***************************************************************************
+ * Public Functions
+ * **************************************************************************/
+
+MarkupStatus
+parseMarkup( const char *text,
+             size_t length,
+             const MarkupTagAliases &tagAliases,
+             const MarkupSelectors &selectors,
+             Markup &markup,
+             MarkupError &error )
+{
+    _MarkupParser parser( text, length, tagAliases, selectors,
+                          markup, error );
+
+    return parser.parse();
+}
@@ -0,0 +1,165 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Header file for the XmlMarkup module.
+ *
+ *   The XmlMarkup module parses the XML text layout markup of
+ *   enso.graphics.xmltextlayout into the structure of an
+ *   xmltextlayout.StyledMarkup object in a single pass, without the
+ *   overhead of xml.sax calling back into Python for every element
+ *   and every piece of text.
+ *
+ *   It only understands the small subset of XML that Enso's markup
+ *   is written in: elements, attributes, text, and character and
+ *   predefined entity references.  Anything else (comments,
+ *   processing instructions, CDATA sections, DOCTYPEs, non-ASCII
+ *   input) and anything that isn't well-formed makes it give up, in
+ *   which case xmltextlayout falls back to xml.sax, which either
+ *   handles it or reports the proper error.
+ *
+ *   The elements are interpreted exactly as
+ *   xmltextlayout._XmlMarkupHandler interprets them, and the same
+ *   errors are detected in the same order.
+ *
+ *   This module doesn't depend on Python; see xmlmarkupmodule.cxx
+ *   for the Python bindings.
+ */
+
+#ifndef _XMLMARKUP_H_
+#define _XMLMARKUP_H_
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+
+/* ***************************************************************************
+ * Type Definitions
+ * **************************************************************************/
+
+/* The outcome of parsing markup.  These values are also used by
+ * enso.graphics.xmltextlayout, so they must not change. */
+enum MarkupStatus
+{
+    /* The markup was parsed. */
+    MARKUP_OK = 0,
+
+    /* An element that is neither a document, block or inline
+     * element nor a tag alias was encountered; see
+     * xmltextlayout.XmlMarkupUnknownElementError. */
+    MARKUP_UNKNOWN_ELEMENT = 1,
+
+    /* An element was encountered where it isn't allowed; see
+     * xmltextlayout.XmlMarkupUnexpectedElementError. */
+    MARKUP_UNEXPECTED_ELEMENT = 2,
+
+    /* An element has no style in the style registry. */
+    MARKUP_NO_STYLE = 3,
+
+    /* The markup isn't in the subset of XML that this module
+     * understands, or isn't well-formed. */
+    MARKUP_NOT_UNDERSTOOD = 4
+};
+
+/* Maps tag aliases to the elements they are aliases for. */
+typedef std::map<std::string, std::string> MarkupTagAliases;
+
+/* The set of selectors of a style registry. */
+typedef std::set<std::string> MarkupSelectors;
+
+/* A run of text in a block. */
+struct MarkupRun
+{
+    /* The selectors of the inline elements the text is in,
+     * outermost first. */
+    std::vector<std::string> selectors;
+
+    /* The text, encoded in UTF-8. */
+    std::string text;
+};
+
+/* A block element. */
+struct MarkupBlock
+{
+    std::string selector;
+    std::vector<MarkupRun> runs;
+};
+
+/* Parsed markup. */
+struct Markup
+{
+    std::string documentSelector;
+    std::vector<MarkupBlock> blocks;
+};
+
+/* Details of a MARKUP_UNKNOWN_ELEMENT, MARKUP_UNEXPECTED_ELEMENT or
+ * MARKUP_NO_STYLE error. */
+struct MarkupError
+{
+    /* The name of the offending element, or the error message for
+     * MARKUP_UNEXPECTED_ELEMENT. */
+    std::string name;
+
+    /* For MARKUP_NO_STYLE, the style that the element asked for, if
+     * any. */
+    bool hasStyle;
+    std::string style;
+};
+
+
+/* ***************************************************************************
+ * Function Declarations
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Parses the given markup, using the given tag aliases and the
+ * selectors of the style registry.
+ * ........................................................................
+ *
+ * The markup is length bytes of ASCII text.  On success, the result
+ * is stored in markup; otherwise, the details of the error are
+ * stored in error, unless the markup wasn't understood.
+ *
+ * ----------------------------------------------------------------------*/
+
+MarkupStatus
+parseMarkup( const char *text,
+             size_t length,
+             const MarkupTagAliases &tagAliases,
+             const MarkupSelectors &selectors,
+             Markup &markup,
+             MarkupError &error );
+
+#endif
@@ -0,0 +1,364 @@
+/* -*-Mode:C++; c-basic-indent:4; c-basic-offset:4; indent-tabs-mode:nil-*- */
+/*
+Copyright (c) 2008, Humanized, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    3. Neither the name of Enso nor the names of its contributors may
+      be used to endorse or promote products derived from this
+      software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY Humanized, Inc. ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL Humanized, Inc. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*   Python bindings for the XmlMarkup module.
+ *
+ *   This builds the enso.graphics._xmlmarkup extension module, which
+ *   is used by enso.graphics.xmltextlayout when it's available.  See
+ *   that module for documentation of the Python interface.
+ */
+
+/* ***************************************************************************
+ * Include Files
+ * **************************************************************************/
+
+/* Makes "s#" store a Py_ssize_t length. */
+#define PY_SSIZE_T_CLEAN
+
+#include <Python.h>
+
+#include <new>
+
+#include "XmlMarkup.h"
+
+
+/* ***************************************************************************
+ * Macros
+ * **************************************************************************/
+
+#if PY_VERSION_HEX < 0x02050000 && !defined( PY_SSIZE_T_MIN )
+typedef int Py_ssize_t;
+#endif
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Converts the given Python string or ASCII unicode object to a
+ * std::string.
+ *
+ * Returns 0 if it's anything else.
+ * ----------------------------------------------------------------------*/
+
+static int
+_toString( PyObject *object,
+           std::string &result )
+{
+    if ( PyString_Check( object ) )
+    {
+        result.assign( PyString_AS_STRING( object ),
+                       (size_t) PyString_GET_SIZE( object ) );
+        return 1;
+    }
+
+    if ( PyUnicode_Check( object ) )
+    {
+        Py_UNICODE *chars = PyUnicode_AS_UNICODE( object );
+        Py_ssize_t size = PyUnicode_GET_SIZE( object );
+
+        result.resize( (size_t) size );
+        for ( Py_ssize_t i = 0; i < size; i++ )
+        {
+            if ( chars[i] >= 0x80 )
+                return 0;
+            result[(size_t) i] = (char) chars[i];
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------
+ * Converts the given dictionaries to the tag aliases and the
+ * selectors of the style registry.
+ *
+ * Returns 0 if any of their keys, or any of the base elements of the
+ * tag aliases, aren't strings.
+ * ----------------------------------------------------------------------*/
+
+static int
+_fromPython( PyObject *tagAliasesDict,
+             PyObject *stylesDict,
+             MarkupTagAliases &tagAliases,
+             MarkupSelectors &selectors )
+{
+    Py_ssize_t position = 0;
+    PyObject *key;
+    PyObject *value;
+    std::string name;
+    std::string baseElement;
+
+    while ( PyDict_Next( tagAliasesDict, &position, &key, &value ) )
+    {
+        if ( !_toString( key, name ) || !_toString( value, baseElement ) )
+            return 0;
+        tagAliases[name] = baseElement;
+    }
+
+    position = 0;
+    while ( PyDict_Next( stylesDict, &position, &key, &value ) )
+    {
+        if ( !_toString( key, name ) )
+            return 0;
+        selectors.insert( name );
+    }
+
+    return 1;
+}
+
+/* ------------------------------------------------------------------------
+ * Returns a new unicode object containing the given ASCII string.
+ * ----------------------------------------------------------------------*/
+
+static PyObject *
+_asciiToPython( const std::string &text )
+{
+    return PyUnicode_DecodeASCII( text.data(),
+                                  (Py_ssize_t) text.size(),
+                                  NULL );
+}
+
+/* ------------------------------------------------------------------------
+ * Converts the given run to a (selectors, text) tuple.
+ * ----------------------------------------------------------------------*/
+
+static PyObject *
+_runToPython( const MarkupRun &run )
+{
+    PyObject *selectors = PyTuple_New( (Py_ssize_t) run.selectors.size() );
+    if ( selectors == NULL )
+        return NULL;
+
+    for ( size_t i = 0; i < run.selectors.size(); i++ )
+    {
+        PyObject *selector = _asciiToPython( run.selectors[i] );
+        if ( selector == NULL )
+        {
+            Py_DECREF( selectors );
+            return NULL;
+        }
+        PyTuple_SET_ITEM( selectors, (Py_ssize_t) i, selector );
+    }
+
+    PyObject *text = PyUnicode_DecodeUTF8( run.text.data(),
+                                           (Py_ssize_t) run.text.size(),
+                                           NULL );
+    if ( text == NULL )
+    {
+        Py_DECREF( selectors );
+        return NULL;
+    }
+
+    return Py_BuildValue( "(NN)", selectors, text );
+}
+
+/* ------------------------------------------------------------------------
+ * Converts the given block to a (selector, runs) tuple.
+ * ----------------------------------------------------------------------*/
+
+static PyObject *
+_blockToPython( const MarkupBlock &block )
+{
+    PyObject *runs = PyList_New( (Py_ssize_t) block.runs.size() );
+    if ( runs == NULL )
+        return NULL;
+
+    for ( size_t i = 0; i < block.runs.size(); i++ )
+    {
+        PyObject *run = _runToPython( block.runs[i] );
+        if ( run == NULL )
+        {
+            Py_DECREF( runs );
+            return NULL;
+        }
+        PyList_SET_ITEM( runs, (Py_ssize_t) i, run );
+    }
+
+    PyObject *selector = _asciiToPython( block.selector );
+    if ( selector == NULL )
+    {
+        Py_DECREF( runs );
+        return NULL;
+    }
+
+    return Py_BuildValue( "(NN)", selector, runs );
+}
+
+/* ------------------------------------------------------------------------
+ * Converts the given markup to a (documentSelector, blocks) tuple.
+ * ----------------------------------------------------------------------*/
+
+static PyObject *
+_markupToPython( const Markup &markup )
+{
+    PyObject *blocks = PyList_New( (Py_ssize_t) markup.blocks.size() );
+    if ( blocks == NULL )
+        return NULL;
+
+    for ( size_t i = 0; i < markup.blocks.size(); i++ )
+    {
+        PyObject *block = _blockToPython( markup.blocks[i] );
+        if ( block == NULL )
+        {
+            Py_DECREF( blocks );
+            return NULL;
+        }
+        PyList_SET_ITEM( blocks, (Py_ssize_t) i, block );
+    }
+
+    PyObject *documentSelector = _asciiToPython( markup.documentSelector );
+    if ( documentSelector == NULL )
+    {
+        Py_DECREF( blocks );
+        return NULL;
+    }
+
+    return Py_BuildValue( "(NN)", documentSelector, blocks );
+}
+
+/* ------------------------------------------------------------------------
+ * Converts the given error to the value that goes with the given
+ * status.
+ * ----------------------------------------------------------------------*/
+
+static PyObject *
+_errorToPython( MarkupStatus status,
+                const MarkupError &error )
+{
+    switch ( status )
+    {
+    case MARKUP_UNKNOWN_ELEMENT:
+        return _asciiToPython( error.name );
+    case MARKUP_UNEXPECTED_ELEMENT:
+        return PyString_FromStringAndSize( error.name.data(),
+                                           (Py_ssize_t) error.name.size() );
+    case MARKUP_NO_STYLE:
+        if ( error.hasStyle )
+        {
+            PyObject *style = PyUnicode_DecodeUTF8(
+                error.style.data(),
+                (Py_ssize_t) error.style.size(),
+                NULL
+                );
+            if ( style == NULL )
+                return NULL;
+            return Py_BuildValue( "(NN)", _asciiToPython( error.name ),
+                                  style );
+        }
+        return Py_BuildValue( "(NO)", _asciiToPython( error.name ),
+                              Py_None );
+    default:
+        Py_INCREF( Py_None );
+        return Py_None;
+    }
+}
+
+
+/* ***************************************************************************
+ * Module Functions
+ * **************************************************************************/
+
+static PyObject *
+xmlmarkup_parseMarkup( PyObject *self,
+                       PyObject *args )
+{
+    const char *text;
+    Py_ssize_t length;
+    PyObject *tagAliasesDict;
+    PyObject *stylesDict;
+
+    if ( !PyArg_ParseTuple( args, "s#O!O!:parseMarkup",
+                            &text, &length,
+                            &PyDict_Type, &tagAliasesDict,
+                            &PyDict_Type, &stylesDict ) )
+        return NULL;
+
+    MarkupTagAliases tagAliases;
+    MarkupSelectors selectors;
+    Markup markup;
+    MarkupError error;
+    MarkupStatus status;
+
+    try
+    {
+        if ( !_fromPython( tagAliasesDict, stylesDict,
+                           tagAliases, selectors ) )
+            status = MARKUP_NOT_UNDERSTOOD;
+        else
+            status = parseMarkup( text,
+                                  (size_t) length,
+                                  tagAliases,
+                                  selectors,
+                                  markup,
+                                  error );
+    }
+    catch ( std::bad_alloc & )
+    {
+        return PyErr_NoMemory();
+    }
+
+    PyObject *value;
+
+    if ( status == MARKUP_OK )
+        value = _markupToPython( markup );
+    else
+        value = _errorToPython( status, error );
+
+    if ( value == NULL )
+        return NULL;
+
+    return Py_BuildValue( "(iN)", (int) status, value );
+}
+
+
+/* ***************************************************************************
+ * Module Initialization
+ * **************************************************************************/
+
+static PyMethodDef xmlmarkup_methods[] = {
+    { "parseMarkup",
+      xmlmarkup_parseMarkup,
+      METH_VARARGS,
+      "parseMarkup(text, tagAliases, styles) -> (status, value)\n\n"
+      "Parses XML text layout markup, given the dictionaries of a "
+      "set of tag aliases and a style registry." },
+    { NULL, NULL, 0, NULL }
+};
+
+PyMODINIT_FUNC
+init_xmlmarkup( void )
+{
+    Py_InitModule3( "enso.graphics._xmlmarkup",
+                    xmlmarkup_methods,
+                    "Native implementation of the XML markup parsing "
+                    "used by enso.graphics.xmltextlayout." );
+}
@@ -217,6 +217,67 @@ scaled_font_get_font_face (PycairoScaledFont *o)
 		   cairo_scaled_font_get_font_face (o->scaled_font)));
 }
 
+static PyObject *
+scaled_font_glyph_metrics (PycairoScaledFont *o, PyObject *args)
+{
+    char *utf8 = NULL;
+    int i, num_glyphs;
+    cairo_glyph_t *glyphs;
+    cairo_text_extents_t *extents;
+    cairo_status_t status;
+    PyObject *py_metrics = NULL;
+
+    if (!PyArg_ParseTuple (args, "et:ScaledFont.glyph_metrics",
+			   "utf-8", &utf8))
+	return NULL;
+
+    glyphs = NULL;
+    num_glyphs = 0;
+    status = cairo_scaled_font_text_to_glyphs (o->scaled_font, 0, 0,
+					       utf8, -1, &glyphs, &num_glyphs,
+					       NULL, NULL, NULL);
+    PyMem_Free (utf8);
+    RETURN_NULL_IF_CAIRO_ERROR(status);
+
+    extents = PyMem_Malloc ((num_glyphs + 1) * sizeof(cairo_text_extents_t));
+    if (extents == NULL) {
+	cairo_glyph_free (glyphs);
+	return PyErr_NoMemory();
+    }
+    for (i = 0; i < num_glyphs; i++) {
+	cairo_glyph_t origin_glyph = glyphs[i];
+	origin_glyph.x = 0.0;
+	origin_glyph.y = 0.0;
+	cairo_scaled_font_glyph_extents (o->scaled_font, &origin_glyph, 1,
+					 &extents[i]);
+    }
+    status = cairo_scaled_font_status (o->scaled_font);
+    if (status != CAIRO_STATUS_SUCCESS) {
+	Pycairo_Check_Status (status);
+	goto done;
+    }
+
+    py_metrics = PyList_New (num_glyphs);
+    if (py_metrics == NULL)
+	goto done;
+    for (i = 0; i < num_glyphs; i++) {
+	PyObject *py_item = Py_BuildValue (
+	    "(ldddddd)", (long) glyphs[i].index,
+	    extents[i].x_bearing, extents[i].y_bearing,
+	    extents[i].width, extents[i].height,
+	    extents[i].x_advance, extents[i].y_advance);
+	if (py_item == NULL) {
+	    Py_CLEAR (py_metrics);
+	    goto done;
+	}
+	PyList_SET_ITEM (py_metrics, i, py_item);
+    }
+ done:
+    cairo_glyph_free (glyphs);
+    PyMem_Free (extents);
+    return py_metrics;
+}
+
 static PyObject *
 scaled_font_text_extents (PycairoScaledFont *o, PyObject *obj)
 {
@@ -236,6 +297,80 @@ scaled_font_text_extents (PycairoScaledFont *o, PyObject *obj)
 			 extents.y_advance);
 }
 
+static PyObject *
+scaled_font_text_to_glyphs (PycairoScaledFont *o, PyObject *args)
+{
+    double x, y;
+    PyObject *obj, *py_glyphs, *py_clusters;
+    const char *utf8;
+    int with_clusters = 1;
+    int i, num_glyphs = 0, num_clusters = 0;
+    cairo_glyph_t *glyphs = NULL;
+    cairo_text_cluster_t *clusters = NULL;
+    cairo_text_cluster_flags_t cluster_flags = 0;
+    cairo_status_t status;
+
+    if (!PyArg_ParseTuple (args, "ddO|i:ScaledFont.text_to_glyphs",
+			   &x, &y, &obj, &with_clusters))
+	return NULL;
+
+    utf8 = __PyBaseString_AsUTF8 (obj);
+    if (utf8 == NULL) {
+	PyErr_SetString(PyExc_TypeError,
+		"ScaledFont.text_to_glyphs() argument must be a string or "
+		"unicode object");
+	return NULL;
+    }
+
+    status = cairo_scaled_font_text_to_glyphs (
+	o->scaled_font, x, y, utf8, -1, &glyphs, &num_glyphs,
+	with_clusters ? &clusters : NULL,
+	with_clusters ? &num_clusters : NULL,
+	with_clusters ? &cluster_flags : NULL);
+    RETURN_NULL_IF_CAIRO_ERROR(status);
+
+    py_glyphs = PyList_New (num_glyphs);
+    if (py_glyphs == NULL)
+	goto error;
+    for (i = 0; i < num_glyphs; i++) {
+	PyObject *py_item = Py_BuildValue ("(ldd)", (long) glyphs[i].index,
+					   glyphs[i].x, glyphs[i].y);
+	if (py_item == NULL) {
+	    Py_DECREF (py_glyphs);
+	    goto error;
+	}
+	PyList_SET_ITEM (py_glyphs, i, py_item);
+    }
+    cairo_glyph_free (glyphs);
+    glyphs = NULL;
+
+    if (!with_clusters)
+	return py_glyphs;
+
+    py_clusters = PyList_New (num_clusters);
+    if (py_clusters == NULL) {
+	Py_DECREF (py_glyphs);
+	goto error;
+    }
+    for (i = 0; i < num_clusters; i++) {
+	PyObject *py_item = Py_BuildValue ("(ii)", clusters[i].num_bytes,
+					   clusters[i].num_glyphs);
+	if (py_item == NULL) {
+	    Py_DECREF (py_glyphs);
+	    Py_DECREF (py_clusters);
+	    goto error;
+	}
+	PyList_SET_ITEM (py_clusters, i, py_item);
+    }
+    cairo_text_cluster_free (clusters);
+
+    return Py_BuildValue ("(NNi)", py_glyphs, py_clusters, cluster_flags);
+ error:
+    cairo_glyph_free (glyphs);
+    cairo_text_cluster_free (clusters);
+    return NULL;
+}
+
 static PyMethodDef scaled_font_methods[] = {
     /* methods never exposed in a language binding:
      * cairo_scaled_font_destroy()
@@ -250,7 +385,9 @@ static PyMethodDef scaled_font_methods[] = {
      */
     {"extents",       (PyCFunction)scaled_font_extents,       METH_NOARGS},
     {"get_font_face", (PyCFunction)scaled_font_get_font_face, METH_NOARGS},
+    {"glyph_metrics", (PyCFunction)scaled_font_glyph_metrics, METH_VARARGS},
     {"text_extents",  (PyCFunction)scaled_font_text_extents,  METH_O},
+    {"text_to_glyphs",(PyCFunction)scaled_font_text_to_glyphs,METH_VARARGS},
     {NULL, NULL, 0, NULL},
 };
 
@@ -63,6 +63,66 @@ ATOM TransparentWindow::_windowClass = 0;
 #define DESTROY_WINDOW    1
 
 
+/* ***************************************************************************
+ * Private Types
+ * **************************************************************************/
+
+/* UpdateLayeredWindowIndirect() and its UPDATELAYEREDWINDOWINFO
+ * structure only exist as of Windows Vista, and aren't declared for
+ * the version of Windows we target (see WinSdk.h), so we declare
+ * them here and look up the function at run time. */
+
+typedef struct
+{
+    DWORD cbSize;
+    HDC hdcDst;
+    const POINT *pptDst;
+    const SIZE *psize;
+    HDC hdcSrc;
+    const POINT *pptSrc;
+    COLORREF crKey;
+    const BLENDFUNCTION *pblend;
+    DWORD dwFlags;
+    const RECT *prcDirty;
+} UpdateLayeredWindowInfo;
+
+typedef BOOL (WINAPI *UpdateLayeredWindowIndirectProc)(
+    HWND hwnd,
+    const UpdateLayeredWindowInfo *pULWInfo
+    );
+
+
+/* ***************************************************************************
+ * Private Functions
+ * **************************************************************************/
+
+/* ------------------------------------------------------------------------
+ * Returns UpdateLayeredWindowIndirect(), or NULL if this version of
+ * Windows doesn't have it.
+ * ----------------------------------------------------------------------*/
+
+static UpdateLayeredWindowIndirectProc
+_getUpdateLayeredWindowIndirect( void )
+{
+    static bool lookedUp = false;
+    static UpdateLayeredWindowIndirectProc proc = NULL;
+
+    if ( !lookedUp )
+    {
+        HMODULE user32 = GetModuleHandle( "user32.dll" );
+
+        if ( user32 != NULL )
+            proc = (UpdateLayeredWindowIndirectProc) GetProcAddress(
+                user32,
+                "UpdateLayeredWindowIndirect"
+                );
+        lookedUp = true;
+    }
+
+    return proc;
+}
+
+
 /* ***************************************************************************
  * Public Class Methods
  * **************************************************************************/
@@ -107,7 +167,9 @@ TransparentWindow::TransparentWindow( int x,
     _maxHeight( maxHeight ),
     _currWidth( maxWidth ),
     _currHeight( maxHeight ),
-    _cairoSurface( 0 )
+    _cairoSurface( 0 ),
+    _isDirty( false ),
+    _needsFullUpdate( true )
 {
     int screenWidth;
     int screenHeight;
@@ -193,6 +255,10 @@ TransparentWindow::makeCairoSurface( void )
  * MSDN documentation on the UpdateLayeredWindow() function, and
  * follow its links to general documentation on Layered Windows.
  *
+ * If only part of the window has been marked as changed, it's
+ * updated with UpdateLayeredWindowIndirect() instead, which only
+ * copies that part of our bitmap.
+ *
  * ----------------------------------------------------------------------*/
 
 void
@@ -204,6 +270,9 @@ TransparentWindow::update( void )
     SIZE rectSize;
     BOOL result;
     HDC screenDc;
+    RECT windowRect;
+    RECT dirtyRect;
+    UpdateLayeredWindowIndirectProc updateIndirect;
 
     srcPoint.x = 0;
     srcPoint.y = 0;
@@ -221,20 +290,55 @@ TransparentWindow::update( void )
     bf.SourceConstantAlpha = _overallOpacity;
     bf.AlphaFormat = AC_SRC_ALPHA;
 
+    /* Work out whether only part of the bitmap needs copying. */
+    updateIndirect = NULL;
+    if ( _isDirty && !_needsFullUpdate )
+    {
+        SetRect( &windowRect, 0, 0, _currWidth, _currHeight );
+        if ( IntersectRect( &dirtyRect, &_dirtyRect, &windowRect ) &&
+             !EqualRect( &dirtyRect, &windowRect ) )
+            updateIndirect = _getUpdateLayeredWindowIndirect();
+    }
+    _isDirty = false;
+    _needsFullUpdate = false;
+
     screenDc = GetDC( NULL );
 
-    /* Copy our device context's bitmap to the transparent window. */
-    result = UpdateLayeredWindow(
-        _window,            /* hwnd */
-        screenDc,           /* hdcDst */
-        &destPoint,         /* pptDst */
-        &rectSize,          /* psize */
-        _hDC,               /* hdcSrc */
-        &srcPoint,          /* pptSrc */
-        0,                  /* crKey */
-        &bf,                /* pblend */
-        ULW_ALPHA           /* dwFlags */
-        );
+    if ( updateIndirect != NULL )
+    {
+        UpdateLayeredWindowInfo info;
+
+        info.cbSize = sizeof( info );
+        info.hdcDst = screenDc;
+        info.pptDst = &destPoint;
+        info.psize = &rectSize;
+        info.hdcSrc = _hDC;
+        info.pptSrc = &srcPoint;
+        info.crKey = 0;
+        info.pblend = &bf;
+        info.dwFlags = ULW_ALPHA;
+        info.prcDirty = &dirtyRect;
+
+        /* Copy the changed part of our device context's bitmap to the
+         * transparent window. */
+        result = updateIndirect( _window, &info );
+    }
+    else
+    {
+        /* Copy our device context's bitmap to the transparent
+         * window. */
+        result = UpdateLayeredWindow(
+            _window,            /* hwnd */
+            screenDc,           /* hdcDst */
+            &destPoint,         /* pptDst */
+            &rectSize,          /* psize */
+            _hDC,               /* hdcSrc */
+            &srcPoint,          /* pptSrc */
+            0,                  /* crKey */
+            &bf,                /* pblend */
+            ULW_ALPHA           /* dwFlags */
+            );
+    }
 
     if ( !result )
     {
@@ -260,6 +364,79 @@ TransparentWindow::update( void )
 }
 
 
+/* ------------------------------------------------------------------------
+ * Draw changes to the window's opacity and position to the screen.
+ * ........................................................................
+ *
+ * UpdateLayeredWindow() can be given no source device context when
+ * the contents of the window aren't changing, in which case only the
+ * window's position and SourceConstantAlpha change, and it keeps the
+ * bitmap that was last copied to it.
+ *
+ * ----------------------------------------------------------------------*/
+
+void
+TransparentWindow::updateAnimation( void )
+{
+    POINT destPoint;
+    BLENDFUNCTION bf;
+
+    if ( _isDirty || _needsFullUpdate )
+    {
+        update();
+        return;
+    }
+
+    destPoint.x = _x;
+    destPoint.y = _y;
+
+    bf.BlendOp = AC_SRC_OVER;
+    bf.BlendFlags = 0;
+    bf.SourceConstantAlpha = _overallOpacity;
+    bf.AlphaFormat = AC_SRC_ALPHA;
+
+    if ( !UpdateLayeredWindow( _window,         /* hwnd */
+                               NULL,            /* hdcDst */
+                               &destPoint,      /* pptDst */
+                               NULL,            /* psize */
+                               NULL,            /* hdcSrc */
+                               NULL,            /* pptSrc */
+                               0,               /* crKey */
+                               &bf,             /* pblend */
+                               ULW_ALPHA ) )    /* dwFlags */
+    {
+        /* Fall back to copying the whole bitmap, which also deals
+         * with any errors. */
+        update();
+    }
+}
+
+
+/* ------------------------------------------------------------------------
+ * Marks a rectangle of the window's surface as changed.
+ * ........................................................................
+ * ----------------------------------------------------------------------*/
+
+void
+TransparentWindow::markDirty( int x,
+                              int y,
+                              int width,
+                              int height )
+{
+    RECT rect;
+
+    if ( width <= 0 || height <= 0 )
+        return;
+
+    SetRect( &rect, x, y, x + width, y + height );
+    if ( _isDirty )
+        UnionRect( &_dirtyRect, &_dirtyRect, &rect );
+    else
+        _dirtyRect = rect;
+    _isDirty = true;
+}
+
+
 /* ------------------------------------------------------------------------
  * Sets the overall opacity of the window.
  * ........................................................................
@@ -342,6 +519,9 @@ TransparentWindow::setSize( int width,
         throw RangeError( "Size out of range." );
     }
 
+    if ( width != _currWidth || height != _currHeight )
+        _needsFullUpdate = true;
+
     _currWidth = width;
     _currHeight = height;
 }
@@ -178,6 +178,39 @@ public:
     void
     update( void );
 
+    /* --------------------------------------------------------------------
+     * Draw changes to the window's opacity and position to the screen.
+     * ....................................................................
+     *
+     * This method is for animating the window: unlike update(), it
+     * doesn't copy the window's surface to the screen again, so it's
+     * cheap enough to call on every frame.  If the surface has been
+     * marked as changed, or the window's size has changed, since the
+     * last update, it's the same as update().
+     *
+     * ------------------------------------------------------------------*/
+
+    void
+    updateAnimation( void );
+
+    /* --------------------------------------------------------------------
+     * Marks a rectangle of the window's surface as changed.
+     * ....................................................................
+     *
+     * The rectangle is given in pixels.  If any rectangles have been
+     * marked since the last call to TransparentWindow.update(), the
+     * next call only copies their bounding rectangle to the screen
+     * (where the system supports it); otherwise, it copies the whole
+     * window, as it would if the window's size had changed.
+     *
+     * ------------------------------------------------------------------*/
+
+    void
+    markDirty( int x,
+               int y,
+               int width,
+               int height );
+
 #ifndef SWIG
     /* --------------------------------------------------------------------
      * Returns a Cairo surface representing the window's surface.
@@ -365,6 +398,18 @@ private:
 
     /* A win32 handle to the transparent window's window class. */
     static ATOM _windowClass;
+
+    /* The bounding rectangle of the rectangles marked as changed
+     * since the last update; only meaningful if _isDirty is true. */
+    RECT _dirtyRect;
+
+    /* Whether any rectangles have been marked as changed since the
+     * last update. */
+    bool _isDirty;
+
+    /* Whether the next update must copy the whole window, because
+     * its size has changed since the last one. */
+    bool _needsFullUpdate;
 #endif
 };
 
@@ -893,6 +893,83 @@ _cairo_scaled_font_glyph_extents (cairo_scaled_font_t   *scaled_font,
     return scaled_font->backend->glyph_extents (scaled_font, glyphs, num_glyphs, extents);
 }
 
+/* HUMANIZED EDIT: Added cairo_scaled_font_glyph_metrics() and
+ * cairo_glyph_metrics_free(), which aren't part of cairo, so that
+ * the glyphs of a whole string and their metrics can be retrieved
+ * with a single call; cairo 1.0 has no public way to convert text
+ * to glyphs. */
+
+/**
+ * cairo_scaled_font_glyph_metrics:
+ * @scaled_font: a #cairo_scaled_font_t
+ * @utf8: a string of text, encoded in UTF-8
+ * @glyphs: pointer to return the array of glyphs for @utf8 in
+ * @extents: pointer to return the array of the extents of each
+ * glyph in
+ * @num_glyphs: pointer to return the number of glyphs in
+ *
+ * Converts @utf8 to glyphs, and gets the extents of each glyph on
+ * its own, as cairo_scaled_font_glyph_extents() would.  The arrays
+ * returned in @glyphs and @extents must be freed with
+ * cairo_glyph_metrics_free(), even if an error is returned.
+ *
+ * Return value: %CAIRO_STATUS_SUCCESS, or the error that occurred.
+ **/
+cairo_status_t
+cairo_scaled_font_glyph_metrics (cairo_scaled_font_t    *scaled_font,
+				 const char             *utf8,
+				 cairo_glyph_t         **glyphs,
+				 cairo_text_extents_t  **extents,
+				 int                    *num_glyphs)
+{
+    cairo_status_t status;
+    cairo_glyph_t origin_glyph;
+    int i;
+
+    *glyphs = NULL;
+    *extents = NULL;
+    *num_glyphs = 0;
+
+    status = _cairo_scaled_font_text_to_glyphs (scaled_font, utf8,
+						glyphs, num_glyphs);
+    if (status)
+	return status;
+
+    *extents = malloc ((*num_glyphs + 1) * sizeof (cairo_text_extents_t));
+    if (*extents == NULL)
+	return CAIRO_STATUS_NO_MEMORY;
+
+    for (i = 0; i < *num_glyphs; i++)
+    {
+	origin_glyph = (*glyphs)[i];
+	origin_glyph.x = 0.0;
+	origin_glyph.y = 0.0;
+	cairo_scaled_font_glyph_extents (scaled_font, &origin_glyph, 1,
+					 &(*extents)[i]);
+    }
+
+    return scaled_font->status;
+}
+
+/**
+ * cairo_glyph_metrics_free:
+ * @glyphs: an array of glyphs returned by
+ * cairo_scaled_font_glyph_metrics(), or %NULL
+ * @extents: an array of extents returned by
+ * cairo_scaled_font_glyph_metrics(), or %NULL
+ *
+ * Frees the arrays returned by cairo_scaled_font_glyph_metrics().
+ **/
+void
+cairo_glyph_metrics_free (cairo_glyph_t        *glyphs,
+			  cairo_text_extents_t *extents)
+{
+    if (glyphs)
+	free (glyphs);
+    if (extents)
+	free (extents);
+}
+
 
 cairo_status_t
 _cairo_scaled_font_glyph_bbox (cairo_scaled_font_t *scaled_font,
@@ -933,6 +933,20 @@ cairo_scaled_font_glyph_extents (cairo_scaled_font_t   *scaled_font,
 				 int                   num_glyphs,
 				 cairo_text_extents_t  *extents);
 
+/* HUMANIZED EDIT: These two functions aren't part of cairo; see
+ * cairo-font.c. */
+
+cairo_status_t
+cairo_scaled_font_glyph_metrics (cairo_scaled_font_t    *scaled_font,
+				 const char             *utf8,
+				 cairo_glyph_t         **glyphs,
+				 cairo_text_extents_t  **extents,
+				 int                    *num_glyphs);
+
+void
+cairo_glyph_metrics_free (cairo_glyph_t        *glyphs,
+			  cairo_text_extents_t *extents);
+
 /* Query functions */
 
 cairo_operator_t
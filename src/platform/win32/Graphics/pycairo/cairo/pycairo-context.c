@@ -35,6 +35,15 @@
 #endif
 #include "pycairo-private.h"
 
+/* The methods that rasterise (fill, mask, paint, show_glyphs, show_text,
+ * stroke and their variants) release the GIL while cairo draws, so that
+ * other threads, such as the one that listens for keystrokes, can run in
+ * the meantime.  Everything they hand to cairo is either a C value or an
+ * object referenced by the argument tuple or by the context itself, which
+ * the caller holds a reference to, so nothing can be freed under cairo.
+ * As with cairo itself, a context mustn't be used by two threads at once.
+ */
+
 /* PycairoContext_FromContext
  * Create a new PycairoContext from a cairo_t
  * ctx  - a cairo_t to 'wrap' into a Python object.
@@ -253,7 +262,9 @@ pycairo_device_to_user_distance (PycairoContext *o, PyObject *args)
 static PyObject *
 pycairo_fill (PycairoContext *o)
 {
+    Py_BEGIN_ALLOW_THREADS
     cairo_fill (o->ctx);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -272,7 +283,9 @@ pycairo_fill_extents (PycairoContext *o)
 static PyObject *
 pycairo_fill_preserve (PycairoContext *o)
 {
+    Py_BEGIN_ALLOW_THREADS
     cairo_fill_preserve (o->ctx);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -465,7 +478,9 @@ pycairo_mask (PycairoContext *o, PyObject *args)
     if (!PyArg_ParseTuple(args, "O!:Context.mask", &PycairoPattern_Type, &p))
 	return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     cairo_mask (o->ctx, p->pattern);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -481,7 +496,9 @@ pycairo_mask_surface (PycairoContext *o, PyObject *args)
 			   &PycairoSurface_Type, &s, &surface_x, &surface_y))
 	return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     cairo_mask_surface (o->ctx, s->surface, surface_x, surface_y);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -513,7 +530,9 @@ pycairo_new_path (PycairoContext *o)
 static PyObject *
 pycairo_paint (PycairoContext *o)
 {
+    Py_BEGIN_ALLOW_THREADS
     cairo_paint (o->ctx);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -527,7 +546,9 @@ pycairo_paint_with_alpha (PycairoContext *o, PyObject *args)
     if (!PyArg_ParseTuple (args, "d:Context.paint_with_alpha", &alpha))
 	return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     cairo_paint_with_alpha (o->ctx, alpha);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -951,6 +972,81 @@ pycairo_set_tolerance (PycairoContext *o, PyObject *args)
     Py_RETURN_NONE;
 }
 
+/* Converts a sequence of (index, x, y) glyph items to a newly
+ * allocated array of *num_glyphs glyphs, which the caller must free
+ * with PyMem_Free(); if *num_glyphs is negative or larger than the
+ * sequence, the whole sequence is converted.
+ */
+static cairo_glyph_t *
+_PyGlyphs_AsGlyphs (PyObject *py_object, int *num_glyphs)
+{
+    int length, i;
+    cairo_glyph_t *glyphs = NULL, *glyph;
+    PyObject *py_glyphs, *py_seq = NULL;
+
+    py_glyphs = PySequence_Fast (py_object, "glyphs must be a sequence");
+    if (py_glyphs == NULL)
+	return NULL;
+
+    length = PySequence_Fast_GET_SIZE(py_glyphs);
+    if (*num_glyphs < 0 || *num_glyphs > length)
+	*num_glyphs = length;
+
+    glyphs = PyMem_Malloc (*num_glyphs * sizeof(cairo_glyph_t));
+    if (glyphs == NULL) {
+	PyErr_NoMemory();
+	goto error;
+    }
+    for (i = 0, glyph = glyphs; i < *num_glyphs; i++, glyph++) {
+	PyObject *py_item = PySequence_Fast_GET_ITEM(py_glyphs, i);
+	py_seq = PySequence_Fast (py_item, "glyph items must be a sequence");
+	if (py_seq == NULL)
+	    goto error;
+	if (PySequence_Fast_GET_SIZE(py_seq) != 3) {
+	    PyErr_SetString(PyExc_ValueError,
+			    "each glyph item must be an (i,x,y) sequence");
+	    goto error;
+	}
+	glyph->index = PyInt_AsLong(PySequence_Fast_GET_ITEM(py_seq, 0));
+	glyph->x = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(py_seq, 1));
+	glyph->y = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(py_seq, 2));
+	if (PyErr_Occurred())
+	    goto error;
+	Py_DECREF(py_seq);
+	py_seq = NULL;
+    }
+    Py_DECREF(py_glyphs);
+    return glyphs;
+ error:
+    Py_DECREF(py_glyphs);
+    Py_XDECREF(py_seq);
+    PyMem_Free(glyphs);
+    return NULL;
+}
+
+static PyObject *
+pycairo_show_glyphs (PycairoContext *o, PyObject *args)
+{
+    int num_glyphs = -1;
+    cairo_glyph_t *glyphs;
+    PyObject *py_object;
+
+    if (!PyArg_ParseTuple (args, "O|i:Context.show_glyphs",
+			   &py_object, &num_glyphs))
+	return NULL;
+
+    glyphs = _PyGlyphs_AsGlyphs (py_object, &num_glyphs);
+    if (glyphs == NULL)
+	return NULL;
+    Py_BEGIN_ALLOW_THREADS
+    cairo_show_glyphs (o->ctx, glyphs, num_glyphs);
+    Py_END_ALLOW_THREADS
+    PyMem_Free (glyphs);
+    if (Pycairo_Check_Status (cairo_status (o->ctx)))
+	return NULL;
+    Py_RETURN_NONE;
+}
+
 static PyObject *
 pycairo_show_page (PycairoContext *o)
 {
@@ -968,7 +1064,9 @@ pycairo_show_text (PycairoContext *o, PyObject *args)
     if (!PyArg_ParseTuple(args, "s:Context.show_text", &utf8))
 	return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     cairo_show_text (o->ctx, utf8);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -977,7 +1075,9 @@ pycairo_show_text (PycairoContext *o, PyObject *args)
 static PyObject *
 pycairo_stroke (PycairoContext *o)
 {
+    Py_BEGIN_ALLOW_THREADS
     cairo_stroke (o->ctx);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -996,7 +1096,9 @@ pycairo_stroke_extents (PycairoContext *o)
 static PyObject *
 pycairo_stroke_preserve (PycairoContext *o)
 {
+    Py_BEGIN_ALLOW_THREADS
     cairo_stroke_preserve (o->ctx);
+    Py_END_ALLOW_THREADS
     if (Pycairo_Check_Status (cairo_status (o->ctx)))
 	return NULL;
     Py_RETURN_NONE;
@@ -1175,7 +1277,7 @@ static PyMethodDef pycairo_methods[] = {
     {"set_source_surface",(PyCFunction)pycairo_set_source_surface,
                                                              METH_VARARGS},
     {"set_tolerance",   (PyCFunction)pycairo_set_tolerance,  METH_VARARGS},
-    /* show_glyphs - undocumented */
+    {"show_glyphs",     (PyCFunction)pycairo_show_glyphs,    METH_VARARGS},
     {"show_page",       (PyCFunction)pycairo_show_page,      METH_NOARGS},
     {"show_text",       (PyCFunction)pycairo_show_text,      METH_VARARGS},
     {"stroke",          (PyCFunction)pycairo_stroke,         METH_NOARGS},
@@ -239,6 +239,49 @@ scaled_font_extents (PycairoScaledFont *o)
 			  e.max_x_advance, e.max_y_advance);
 }
 
+static PyObject *
+scaled_font_glyph_metrics (PycairoScaledFont *o, PyObject *args)
+{
+    char *utf8 = NULL;
+    int i, num_glyphs;
+    cairo_glyph_t *glyphs;
+    cairo_text_extents_t *extents;
+    cairo_status_t status;
+    PyObject *py_metrics = NULL;
+
+    if (!PyArg_ParseTuple (args, "et:ScaledFont.glyph_metrics",
+			   "utf-8", &utf8))
+	return NULL;
+
+    status = cairo_scaled_font_glyph_metrics (o->scaled_font, utf8,
+					      &glyphs, &extents,
+					      &num_glyphs);
+    PyMem_Free (utf8);
+    if (Pycairo_Check_Status (status)) {
+	cairo_glyph_metrics_free (glyphs, extents);
+	return NULL;
+    }
+
+    py_metrics = PyList_New (num_glyphs);
+    if (py_metrics == NULL)
+	goto done;
+    for (i = 0; i < num_glyphs; i++) {
+	PyObject *py_item = Py_BuildValue (
+	    "(ldddddd)", (long) glyphs[i].index,
+	    extents[i].x_bearing, extents[i].y_bearing,
+	    extents[i].width, extents[i].height,
+	    extents[i].x_advance, extents[i].y_advance);
+	if (py_item == NULL) {
+	    Py_CLEAR (py_metrics);
+	    goto done;
+	}
+	PyList_SET_ITEM (py_metrics, i, py_item);
+    }
+ done:
+    cairo_glyph_metrics_free (glyphs, extents);
+    return py_metrics;
+}
+
 static PyMethodDef scaled_font_methods[] = {
     /* methods never exposed in a language binding:
      * cairo_scaled_font_destroy()
@@ -246,6 +289,7 @@ static PyMethodDef scaled_font_methods[] = {
      */
     /* glyph_extents - undocumented */
     {"extents", (PyCFunction)scaled_font_extents, METH_NOARGS},
+    {"glyph_metrics", (PyCFunction)scaled_font_glyph_metrics, METH_VARARGS},
     {NULL, NULL, 0, NULL},
 };
 
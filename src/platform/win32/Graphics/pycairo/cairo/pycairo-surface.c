@@ -205,6 +205,7 @@ static PyObject *
 surface_write_to_png (PycairoSurface *o, PyObject *file)
 {
     FILE *fp;
+    int openedFile = 0;
     cairo_status_t status;
 
     if (PyObject_TypeCheck (file, &PyBaseString_Type)) {
@@ -213,6 +214,7 @@ surface_write_to_png (PycairoSurface *o, PyObject *file)
 	    PyErr_SetString(PyExc_IOError, "unable to open file for writing");
 	    return NULL;
 	}
+	openedFile = 1;
     } else if (PyObject_TypeCheck (file, &PyFile_Type)) {
 	fp = PyFile_AsFile(file);
 
@@ -222,9 +224,22 @@ surface_write_to_png (PycairoSurface *o, PyObject *file)
 			"which must be a filename (str) or file object");
 	return NULL;
     }
+    /* Release the GIL while the PNG is encoded and written.  A file
+     * object's use count keeps other threads from closing it meanwhile;
+     * no Python objects may be looked at until the GIL is taken back. */
+#if PY_VERSION_HEX >= 0x02060000
+    if (PyFile_Check (file))
+	PyFile_IncUseCount ((PyFileObject *)file);
+#endif
+    Py_BEGIN_ALLOW_THREADS
     status = cairo_surface_write_to_png_stream (o->surface, _write_func, fp);
-    if (PyObject_TypeCheck (file, &PyBaseString_Type))
+    if (openedFile)
     	fclose (fp);
+    Py_END_ALLOW_THREADS
+#if PY_VERSION_HEX >= 0x02060000
+    if (PyFile_Check (file))
+	PyFile_DecUseCount ((PyFileObject *)file);
+#endif
 
     if (Pycairo_Check_Status (status))
 	return NULL;
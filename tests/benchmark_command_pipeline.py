@@ -0,0 +1,437 @@
+"""
+    Per-keystroke latency benchmark for the command pipeline, i.e.,
+    everything that happens between the user typing a character in
+    the quasimode and the quasimode window having the marked-up
+    suggestions to draw: TheSuggestionList.setUserText(), the command
+    manager's autoComplete() and retrieveSuggestions(), and
+    Suggestion.toXml().
+
+    Synthetic command registries of several sizes are generated, each
+    a mix of simple commands and GenericPrefixFactory subclasses, and
+    a number of typing sessions are replayed against each one.  The
+    results are printed as JSON, so that they can be compared across
+    versions; for each registry size, they include:
+
+      registryMemoryBytes
+        How much the resident size of the process grew while building
+        the registry (and its indexes), or null if this can't be
+        measured on this platform.
+
+      latencyMs
+        The 50th and 99th percentile, maximum and mean time taken by
+        a keystroke, in milliseconds.
+
+      allocationsPerKeystroke
+        The mean and maximum number of objects allocated by a
+        keystroke and still alive at its end.  Python doesn't count
+        every allocation, so this is the growth in the number of
+        objects tracked by the garbage collector (i.e., containers
+        such as lists, tuples and instances), which is how much
+        garbage a keystroke leaves for the collector.
+
+    Run this from the tests directory, with the root of the source
+    tree on PYTHONPATH, e.g.:
+
+      PYTHONPATH=.. python benchmark_command_pipeline.py
+
+    Use --help for the options; in particular, --sessions replays
+    recorded typing sessions from a JSON file, which should contain a
+    list of strings, each one the characters typed in one session,
+    with "\\b" standing for a backspace.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import gc
+import imp
+import optparse
+import os
+import random
+import sys
+import time
+
+try:
+    import json
+except ImportError:
+    import simplejson as json
+
+import enso
+from enso.commands import matching
+from enso.commands import suggestions
+from enso.commands.manager import CommandManager
+from enso.commands.interfaces import CommandObject
+from enso.commands.factories import GenericPrefixFactory
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The default numbers of commands in the registries.
+DEFAULT_SIZES = [ 100, 10000, 100000 ]
+
+# The default number of times each typing session is replayed.
+DEFAULT_REPEAT = 3
+
+# The fraction of the commands that are produced by factories, rather
+# than registered as simple commands.
+FACTORY_FRACTION = 0.2
+
+# The command expressions of the factories, and the weights with
+# which their postfixes are distributed among them.
+FACTORIES = [
+    ( "open {file or url}", 5 ),
+    ( "go {window}", 2 ),
+    ( "learn as open {name}", 1 ),
+    ( "google {query}", 1 ),
+    ( "translate to {language}", 1 ),
+    ]
+
+# Words from which the names of commands and postfixes are made.
+WORDS = [
+    "my", "documents", "music", "pictures", "videos", "desktop", "home",
+    "report", "notes", "budget", "2008", "draft", "final", "new", "old",
+    "calculate", "define", "spellcheck", "quit", "close", "minimize",
+    "maximize", "window", "tab", "email", "mail", "to", "the", "of",
+    "firefox", "terminal", "editor", "calendar", "contacts", "project",
+    "enso", "python", "cairo", "screenshot", "upper", "lower", "case",
+    "title", "bold", "italic", "underline", "paste", "copy", "cut",
+    "undo", "redo", "sort", "lines", "words", "count", "weather",
+    "tomorrow", "today", "news", "map", "of", "wiki", "dictionary",
+    ]
+
+# The typing sessions replayed by default; "\b" is a backspace.
+DEFAULT_SESSIONS = [
+    "open my documents",
+    "calclate\b\b\b\bulate 2+2",
+    "go firefox",
+    "google the weather tomorrow",
+    "qiut\b\b\buit",
+    "open report 2008 fina",
+    "learn as open notes",
+    "translate to french",
+    "minimize window",
+    "spellcheck\b\b\b\b\b\b\b\b\b\bdefine cairo",
+    "upper case",
+    "open mu",
+    "zzzz\b\b\b\bclose tab",
+    ]
+
+
+# ----------------------------------------------------------------------------
+# Registry Generation
+# ----------------------------------------------------------------------------
+
+class ListFactory( GenericPrefixFactory ):
+    """
+    A factory with a fixed list of postfixes, like most of the
+    factories in a real registry.
+    """
+
+    UPDATE_INTERVAL = None
+
+    def __init__( self, prefix, helpText, postfixes ):
+        GenericPrefixFactory.__init__( self )
+        self.PREFIX = prefix
+        self.HELP_TEXT = helpText
+        self.setPostfixes( postfixes )
+
+    def _generateCommandObj( self, postfix ):
+        return CommandObject()
+
+
+def makeNames( count, rand ):
+    """
+    Returns a list of count distinct names made up of one to three
+    words.
+    """
+
+    names = {}
+    while len( names ) < count:
+        words = rand.sample( WORDS, rand.randint( 1, 3 ) )
+        name = " ".join( words )
+        if names.has_key( name ):
+            # Pad out names once the short ones run out, the way real
+            # registries end up with "report 2", "report 3", etc.
+            name = "%s %d" % ( name, len( names ) )
+        names[name] = None
+    return names.keys()
+
+
+def makeRegistry( size ):
+    """
+    Returns a CommandManager with size commands registered with it, a
+    fraction of them as postfixes of factories, and a dictionary
+    describing it.
+    """
+
+    rand = random.Random( size )
+    factoryCount = int( size * FACTORY_FRACTION )
+    commandCount = size - factoryCount
+
+    manager = CommandManager()
+    names = makeNames( commandCount, rand )
+    manager.registerCommands( [ ( name, CommandObject() )
+                                for name in names ] )
+
+    totalWeight = 0
+    for cmdName, weight in FACTORIES:
+        totalWeight += weight
+
+    for cmdName, weight in FACTORIES:
+        prefix, helpText = cmdName[:-1].split( "{" )
+        postfixes = makeNames( factoryCount * weight / totalWeight, rand )
+        manager.registerCommand( cmdName,
+                                 ListFactory( prefix, helpText, postfixes ) )
+
+    description = {
+        "commands" : size,
+        "commandObjects" : commandCount,
+        "factories" : len( FACTORIES ),
+        "factoryPostfixes" : factoryCount,
+        }
+    return manager, description
+
+
+# ----------------------------------------------------------------------------
+# Measurement
+# ----------------------------------------------------------------------------
+
+def getMemoryUsage():
+    """
+    Returns the resident size of the process in bytes, or None if it
+    can't be determined.
+    """
+
+    try:
+        statm = open( "/proc/self/statm" )
+    except IOError:
+        statm = None
+    if statm != None:
+        try:
+            pages = int( statm.read().split()[1] )
+        finally:
+            statm.close()
+        return pages * os.sysconf( "SC_PAGE_SIZE" )
+
+    try:
+        import resource
+    except ImportError:
+        return None
+    # This is the peak, rather than the current, size; ru_maxrss is
+    # in bytes on OS X and kilobytes elsewhere.
+    maxRss = resource.getrusage( resource.RUSAGE_SELF ).ru_maxrss
+    if sys.platform == "darwin":
+        return maxRss
+    return maxRss * 1024
+
+
+def loadSuggestionListClass():
+    """
+    Returns the TheSuggestionList class.  The enso.quasimode package
+    imports the graphics libraries, so the suggestionlist module is
+    loaded on its own.
+    """
+
+    path = os.path.join( os.path.dirname( enso.__file__ ),
+                         "quasimode", "suggestionlist.py" )
+    module = imp.load_source( "suggestionlist", path )
+    return module.TheSuggestionList
+
+
+def typeKey( suggestionList, key ):
+    """
+    Does everything the quasimode does when the user types key: sets
+    the new user text, and marks up the suggestions for display.
+    """
+
+    userText = suggestionList.getUserText()
+    if key == "\b":
+        userText = userText[:-1]
+    else:
+        userText += key
+    suggestionList.setUserText( userText )
+
+    suggestionList.getAutoCompletion()
+    for suggestion in suggestionList.getSuggestions():
+        suggestion.toXml()
+
+
+def replaySessions( suggestionList, sessions, repeat ):
+    """
+    Replays each typing session repeat times, returning a list of
+    the time taken by each keystroke and a list of the number of
+    objects allocated by each keystroke.
+    """
+
+    times = []
+    allocations = []
+
+    gc.collect()
+    gc.disable()
+    try:
+        for i in range( repeat ):
+            for session in sessions:
+                suggestionList.clearState()
+                for key in session:
+                    countBefore = gc.get_count()[0]
+                    start = time.time()
+                    typeKey( suggestionList, key )
+                    times.append( time.time() - start )
+                    allocations.append( gc.get_count()[0] - countBefore )
+                # Collect between sessions, so that no keystroke is
+                # charged for garbage left by the others.
+                gc.collect()
+    finally:
+        gc.enable()
+
+    return times, allocations
+
+
+def percentile( sortedValues, fraction ):
+    """
+    Returns the value below which the given fraction of the values
+    fall (using the nearest-rank method).
+    """
+
+    rank = int( fraction * len( sortedValues ) + 0.5 )
+    rank = min( max( rank, 1 ), len( sortedValues ) )
+    return sortedValues[rank - 1]
+
+
+def summarize( values, scale = 1 ):
+    """
+    Returns a dictionary of statistics of the given values, each
+    multiplied by scale.
+    """
+
+    values = [ value * scale for value in values ]
+    values.sort()
+    if len( values ) == 0:
+        return {}
+
+    total = 0
+    for value in values:
+        total += value
+
+    return {
+        "p50" : percentile( values, 0.50 ),
+        "p99" : percentile( values, 0.99 ),
+        "max" : values[-1],
+        "mean" : float( total ) / len( values ),
+        }
+
+
+def benchmark( size, sessions, repeat ):
+    """
+    Runs the benchmark against a registry with size commands,
+    returning a dictionary of results.
+    """
+
+    gc.collect()
+    memoryBefore = getMemoryUsage()
+    start = time.time()
+    manager, result = makeRegistry( size )
+    # The first query builds the indexes, which are part of the
+    # registry's footprint.
+    manager.retrieveSuggestions( "a" )
+    result["registrationSeconds"] = time.time() - start
+    gc.collect()
+    memoryAfter = getMemoryUsage()
+
+    if memoryBefore == None or memoryAfter == None:
+        result["registryMemoryBytes"] = None
+    else:
+        result["registryMemoryBytes"] = memoryAfter - memoryBefore
+
+    suggestionList = loadSuggestionListClass()( manager )
+    times, allocations = replaySessions( suggestionList, sessions, repeat )
+
+    result["keystrokes"] = len( times )
+    result["latencyMs"] = summarize( times, 1000 )
+    allocationStats = summarize( allocations )
+    result["allocationsPerKeystroke"] = {
+        "mean" : allocationStats.get( "mean" ),
+        "max" : allocationStats.get( "max" ),
+        }
+    return result
+
+
+def getVersion():
+    """
+    Returns the version of Enso in the source tree, or None.
+    """
+
+    path = os.path.join( os.path.dirname( enso.__file__ ), os.pardir,
+                         "VERSION" )
+    try:
+        versionFile = open( path )
+    except IOError:
+        return None
+    try:
+        version = versionFile.read().strip()
+    finally:
+        versionFile.close()
+    if "=" in version:
+        version = version.split( "=" )[1]
+    return version
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+def main( argv ):
+    parser = optparse.OptionParser( usage = "%prog [options]" )
+    parser.add_option( "--sizes", default = ",".join(
+        [ str( size ) for size in DEFAULT_SIZES ] ),
+                       help = "comma-separated registry sizes "
+                       "[default: %default]" )
+    parser.add_option( "--sessions", metavar = "FILE",
+                       help = "replay the typing sessions in FILE" )
+    parser.add_option( "--repeat", type = "int", default = DEFAULT_REPEAT,
+                       help = "times to replay each session "
+                       "[default: %default]" )
+    parser.add_option( "--output", metavar = "FILE",
+                       help = "write the results to FILE, rather than "
+                       "standard output" )
+    options, args = parser.parse_args( argv )
+
+    if options.sessions:
+        sessionsFile = open( options.sessions )
+        try:
+            sessions = json.load( sessionsFile )
+        finally:
+            sessionsFile.close()
+    else:
+        sessions = DEFAULT_SESSIONS
+
+    results = {
+        "version" : getVersion(),
+        "python" : sys.version.split()[0],
+        "platform" : sys.platform,
+        "time" : time.strftime( "%Y-%m-%dT%H:%M:%S" ),
+        "native" : {
+            "postfixIndex" : matching._postfixindex != None,
+            "suggestionMarkup" : suggestions._suggestionmarkup != None,
+            },
+        "sessions" : len( sessions ),
+        "repeat" : options.repeat,
+        "results" : [ benchmark( int( size ), sessions, options.repeat )
+                      for size in options.sizes.split( "," ) ],
+        }
+
+    text = json.dumps( results, indent = 2, sort_keys = True )
+    if options.output:
+        outputFile = open( options.output, "w" )
+        try:
+            outputFile.write( text + "\n" )
+        finally:
+            outputFile.close()
+    else:
+        print text
+
+if __name__ == "__main__":
+    main( sys.argv[1:] )
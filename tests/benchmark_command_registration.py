@@ -0,0 +1,97 @@
+"""
+    Benchmark for registering large numbers of commands with the
+    Command Manager.
+
+    Run this from the tests directory, with the root of the source
+    tree on PYTHONPATH, e.g.:
+
+      PYTHONPATH=.. python benchmark_command_registration.py [count]
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import random
+import sys
+import time
+
+from enso.commands.manager import CommandManager
+from enso.commands.interfaces import CommandObject
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The default number of commands to register.
+DEFAULT_COUNT = 50000
+
+# The number of commands to register one at a time, for comparison;
+# this takes time quadratic in the count, so it's kept small.
+SINGLE_COUNT = 5000
+
+
+# ----------------------------------------------------------------------------
+# Benchmark
+# ----------------------------------------------------------------------------
+
+def makeCommands( count ):
+    """
+    Returns a list of count ( cmdName, cmdObj ) pairs with distinct,
+    random names.
+    """
+
+    random.seed( 0 )
+    words = [ "open", "close", "google", "calculate", "my", "documents",
+              "music", "window", "report", "notes", "2008", "new" ]
+    commands = []
+    for i in range( count ):
+        name = "%s %d" % ( " ".join( random.sample( words, 3 ) ), i )
+        commands.append( ( name, CommandObject() ) )
+    return commands
+
+
+def timeIt( description, function, *args ):
+    """
+    Calls function with args, and prints how long it took.
+    """
+
+    start = time.time()
+    function( *args )
+    print "%-40s %8.3f s" % ( description, time.time() - start )
+
+
+def main( count ):
+    commands = makeCommands( count )
+    names = [ name for name, cmdObj in commands ]
+
+    manager = CommandManager()
+    timeIt( "registerCommands( %d )" % count,
+            manager.registerCommands, commands )
+    timeIt( "first query (builds the index)",
+            manager.retrieveSuggestions, "open" )
+    timeIt( "second query",
+            manager.retrieveSuggestions, "open" )
+    timeIt( "unregisterCommands( %d )" % count,
+            manager.unregisterCommands, names )
+
+    manager = CommandManager()
+    singleCount = min( count, SINGLE_COUNT )
+
+    def registerEach():
+        for name, cmdObj in commands[:singleCount]:
+            manager.registerCommand( name, cmdObj )
+
+    timeIt( "registerCommand() x %d" % singleCount, registerEach )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    if len( sys.argv ) > 1:
+        main( int( sys.argv[1] ) )
+    else:
+        main( DEFAULT_COUNT )
@@ -0,0 +1,201 @@
+"""
+    Frame rate benchmark for mini message animations on Linux, i.e.,
+    how many frames a second MiniMessageWindow.slideDown() and
+    MiniMessageWindow.fadeIn() can present, with and without the
+    MIT-SHM backing of the windows' surfaces.
+
+    Each frame moves or fades a mini message window a little, updates
+    it, and then handles GTK events and waits for the X server until
+    the frame has been presented.  The windows are only backed by
+    MIT-SHM if the screen isn't composited, so this is best run on a
+    bare X server such as Xvfb.
+
+    The results are printed as JSON; for each run, they include:
+
+      framesPerSecond
+        The number of frames of each animation presented a second.
+
+      shm
+        Whether the windows asked for an MIT-SHM backing (and whether
+        the _xshmimage module is available at all, in "shmAvailable").
+
+    Run this from the tests directory, with the root of the source
+    tree on PYTHONPATH, e.g.:
+
+      PYTHONPATH=.. xvfb-run -s "-screen 0 1024x768x24" \\
+          python benchmark_message_animation.py
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import optparse
+import sys
+import time
+
+try:
+    import json
+except ImportError:
+    import simplejson as json
+
+import gtk
+
+import enso.graphics
+import enso.messages
+import enso.platform.linux.graphics as linuxGraphics
+from enso.messages.miniwindows import MiniMessageWindow
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The default number of frames of each animation.
+DEFAULT_FRAMES = 500
+
+# The number of mini message windows animated at once.
+DEFAULT_WINDOWS = 3
+
+# The distance that a window slides down each frame, in points.
+SLIDE_DISTANCE = 1
+
+# The number of frames that a window takes to fade in fully.
+FADE_FRAMES = 50
+
+# The text of the mini messages.
+MINI_XML = "<p>The quick brown <command>fox</command> jumps</p>"
+
+
+# ----------------------------------------------------------------------------
+# Benchmark
+# ----------------------------------------------------------------------------
+
+def present():
+    """
+    Handles all pending GTK events, including the redrawing queued by
+    the windows' updates, and waits until the X server has handled
+    all of the resulting requests.
+    """
+
+    while gtk.events_pending():
+        gtk.main_iteration( False )
+    gtk.gdk.flush()
+
+
+def makeWindows( count ):
+    """
+    Returns the given number of mini message windows, made opaque and
+    presented.
+    """
+
+    windows = []
+    for index in range( count ):
+        msg = enso.messages.Message( fullXml = MINI_XML,
+                                     miniXml = MINI_XML,
+                                     isMini = True )
+        window = MiniMessageWindow( msg, 0, 0 )
+        window._wind.setOpacity( 255 )
+        windows.append( window )
+    present()
+    return windows
+
+
+def slideDown( windows, frames ):
+    """
+    Slides the given windows down for the given number of frames,
+    moving them back up whenever they get to the middle of the screen,
+    and returns the number of seconds taken.
+    """
+
+    maxY = enso.graphics.getDesktopSize()[1] / 2
+    start = time.time()
+    for frame in range( frames ):
+        for window in windows:
+            xPos, yPos = window.getPos()
+            if yPos + SLIDE_DISTANCE > maxY:
+                window.setPos( xPos, 0 )
+            window.slideDown( SLIDE_DISTANCE )
+        present()
+    return time.time() - start
+
+
+def fadeIn( windows, frames ):
+    """
+    Fades the given windows in for the given number of frames, making
+    them transparent again whenever they've appeared, and returns the
+    number of seconds taken.
+    """
+
+    fraction = 1.0 / FADE_FRAMES
+    start = time.time()
+    for frame in range( frames ):
+        for window in windows:
+            window.fadeIn( fraction )
+            if window.isFinishedAppearing:
+                window.isFinishedAppearing = False
+                window._wind.setOpacity( 0 )
+        present()
+    return time.time() - start
+
+
+def benchmark( frames, count, useShm ):
+    """
+    Animates the given number of windows for the given number of
+    frames, with their surfaces backed by MIT-SHM if useShm is true,
+    and returns a dictionary of results.
+    """
+
+    linuxGraphics.USE_SHM = useShm
+    windows = makeWindows( count )
+    try:
+        framesPerSecond = {}
+        for name, animate in [ ( "slideDown", slideDown ),
+                               ( "fadeIn", fadeIn ) ]:
+            seconds = animate( windows, frames )
+            framesPerSecond[name] = frames / max( seconds, 1e-9 )
+    finally:
+        for window in windows:
+            window._wind._impl.finish()
+        present()
+
+    return {
+        "shm" : useShm,
+        "framesPerSecond" : framesPerSecond,
+        }
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+def main( argv ):
+    parser = optparse.OptionParser( usage = "%prog [options]" )
+    parser.add_option( "--frames", type = "int", default = DEFAULT_FRAMES,
+                       help = "frames of each animation [default: %default]" )
+    parser.add_option( "--windows", type = "int", default = DEFAULT_WINDOWS,
+                       help = "windows animated at once "
+                       "[default: %default]" )
+    options, args = parser.parse_args( argv )
+
+    screen = gtk.gdk.screen_get_default()
+    composited = hasattr( screen, "is_composited" ) \
+                 and screen.is_composited()
+
+    results = {
+        "python" : sys.version.split()[0],
+        "platform" : sys.platform,
+        "time" : time.strftime( "%Y-%m-%dT%H:%M:%S" ),
+        "display" : gtk.gdk.display_get_default().get_name(),
+        "composited" : bool( composited ),
+        "shmAvailable" : linuxGraphics._xshmimage is not None,
+        "frames" : options.frames,
+        "windows" : options.windows,
+        "results" : [ benchmark( options.frames, options.windows, useShm )
+                      for useShm in [ False, True ] ],
+        }
+
+    print json.dumps( results, indent = 2, sort_keys = True )
+
+if __name__ == "__main__":
+    main( sys.argv[1:] )
@@ -0,0 +1,228 @@
+"""
+    Redraw benchmark for the quasimode window, comparing a window per
+    line with the single window of compositor mode (see
+    enso.config.QUASIMODE_COMPOSITOR).
+
+    Typing sessions are replayed against a small command registry,
+    redrawing the quasimode window the way the quasimode's timer
+    responder does: each keystroke updates the window, and each
+    following tick continues drawing the suggestion list, one
+    suggestion at a time, until it's all drawn.  After each update
+    and each tick, GTK events are handled and the X server is waited
+    for, so that presenting the window is part of the time measured.
+
+    The results are printed as JSON; for each mode, they include:
+
+      keystrokeMs
+        The 50th and 99th percentile, maximum and mean time taken by
+        a keystroke, from the update to the last suggestion being
+        drawn, in milliseconds.
+
+      tickMs
+        The same statistics for each update or tick on its own.
+
+    Run this from the tests directory, with the root of the source
+    tree on PYTHONPATH, under an X server, e.g.:
+
+      PYTHONPATH=.. xvfb-run -s "-screen 0 1024x768x24" \\
+          python benchmark_quasimode_redraw.py
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import optparse
+import sys
+import time
+
+try:
+    import json
+except ImportError:
+    import simplejson as json
+
+import gtk
+
+from enso import config
+from enso.commands.manager import CommandManager
+from enso.commands.interfaces import CommandObject
+from enso.quasimode.suggestionlist import TheSuggestionList
+from enso.quasimode.window import TheQuasimodeWindow
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The names of the commands in the registry.
+COMMANDS = [
+    "open", "open with", "open my documents", "open report",
+    "calculate", "go", "google", "quit", "learn as open", "translate",
+    "minimize", "maximize", "spellcheck", "define", "upper case",
+    "lower case", "close", "close tab", "paste", "copy",
+    ]
+
+# The typing sessions replayed; "\b" is a backspace.
+SESSIONS = [
+    "open my documents",
+    "calclate\b\b\b\bulate 2+2",
+    "go",
+    "google the weather",
+    "qiut\b\b\buit",
+    "open report",
+    "translate",
+    "close tab",
+    ]
+
+# The default number of times the sessions are replayed.
+DEFAULT_REPEAT = 5
+
+
+# ----------------------------------------------------------------------------
+# Benchmark
+# ----------------------------------------------------------------------------
+
+class FakeQuasimode:
+    """
+    Stands in for the quasimode, which is all that the quasimode
+    window needs it for.
+    """
+
+    def __init__( self, suggestionList ):
+        self.__suggestionList = suggestionList
+
+    def getSuggestionList( self ):
+        return self.__suggestionList
+
+
+def present():
+    """
+    Handles all pending GTK events, including the redrawing queued by
+    the windows' updates, and waits until the X server has handled
+    all of the resulting requests.
+    """
+
+    while gtk.events_pending():
+        gtk.main_iteration( False )
+    gtk.gdk.flush()
+
+
+def percentile( sortedValues, fraction ):
+    """
+    Returns the value below which the given fraction of the values
+    fall (using the nearest-rank method).
+    """
+
+    rank = int( fraction * len( sortedValues ) + 0.5 )
+    rank = min( max( rank, 1 ), len( sortedValues ) )
+    return sortedValues[rank - 1]
+
+
+def summarize( values, scale = 1 ):
+    """
+    Returns a dictionary of statistics of the given values, each
+    multiplied by scale.
+    """
+
+    values = [ value * scale for value in values ]
+    values.sort()
+    if len( values ) == 0:
+        return {}
+
+    total = 0
+    for value in values:
+        total += value
+
+    return {
+        "p50" : percentile( values, 0.50 ),
+        "p99" : percentile( values, 0.99 ),
+        "max" : values[-1],
+        "mean" : float( total ) / len( values ),
+        }
+
+
+def benchmark( compositor, repeat ):
+    """
+    Replays the typing sessions the given number of times, with the
+    quasimode window in compositor mode if compositor is true, and
+    returns a dictionary of results.
+    """
+
+    config.QUASIMODE_COMPOSITOR = compositor
+
+    manager = CommandManager()
+    manager.registerCommands( [ ( name, CommandObject() )
+                                for name in COMMANDS ] )
+    suggestionList = TheSuggestionList( manager )
+    quasimode = FakeQuasimode( suggestionList )
+    window = TheQuasimodeWindow()
+    window.update( quasimode, True )
+    present()
+
+    keystrokeTimes = []
+    tickTimes = []
+    for i in range( repeat ):
+        for session in SESSIONS:
+            suggestionList.setUserText( "" )
+            for key in session:
+                userText = suggestionList.getUserText()
+                if key == "\b":
+                    userText = userText[:-1]
+                else:
+                    userText += key
+                suggestionList.setUserText( userText )
+
+                keystrokeStart = time.time()
+                window.update( quasimode, False )
+                present()
+                tickTimes.append( time.time() - keystrokeStart )
+                while True:
+                    tickStart = time.time()
+                    drawn = window.continueDrawing( ignoreTimeElapsed = True )
+                    present()
+                    if not drawn:
+                        break
+                    tickTimes.append( time.time() - tickStart )
+                keystrokeTimes.append( time.time() - keystrokeStart )
+
+    del window
+    present()
+
+    return {
+        "compositor" : compositor,
+        "keystrokes" : len( keystrokeTimes ),
+        "keystrokeMs" : summarize( keystrokeTimes, 1000 ),
+        "tickMs" : summarize( tickTimes, 1000 ),
+        }
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+def main( argv ):
+    parser = optparse.OptionParser( usage = "%prog [options]" )
+    parser.add_option( "--repeat", type = "int", default = DEFAULT_REPEAT,
+                       help = "times the sessions are replayed "
+                       "[default: %default]" )
+    options, args = parser.parse_args( argv )
+
+    screen = gtk.gdk.screen_get_default()
+    composited = hasattr( screen, "is_composited" ) \
+                 and screen.is_composited()
+
+    results = {
+        "python" : sys.version.split()[0],
+        "platform" : sys.platform,
+        "time" : time.strftime( "%Y-%m-%dT%H:%M:%S" ),
+        "display" : gtk.gdk.display_get_default().get_name(),
+        "composited" : bool( composited ),
+        "maxSuggestions" : config.QUASIMODE_MAX_SUGGESTIONS,
+        "results" : [ benchmark( compositor, options.repeat )
+                      for compositor in [ False, True ] ],
+        }
+
+    print json.dumps( results, indent = 2, sort_keys = True )
+
+if __name__ == "__main__":
+    main( sys.argv[1:] )
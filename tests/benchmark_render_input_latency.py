@@ -0,0 +1,278 @@
+"""
+    Input latency benchmark for rendering, i.e., how long a keystroke
+    waits to be handled while another thread is drawing with cairo.
+
+    One thread rasterises large primary-message-sized images over and
+    over (filling, painting, masking, showing text and writing PNGs,
+    the operations that the cairo bindings draw with the GIL released),
+    while a second thread injects synthetic key events at a steady
+    rate and a third thread, standing in for the key listener, handles
+    them.  The latency of a key event is the time between its
+    injection and its handling.  Each run is first made without the
+    rendering thread, as a baseline.
+
+    The results are printed as JSON; for each run, they include:
+
+      latencyMs
+        The 50th and 99th percentile, maximum and mean latency of a
+        key event, in milliseconds.
+
+      framesRendered
+        The number of images that the rendering thread drew.
+
+    If the cairo bindings hold the GIL while they draw, a key event
+    can wait for a whole cairo operation, and the maximum latency is
+    about as long as the slowest one.
+
+    Run this from the tests directory, with the root of the source
+    tree on PYTHONPATH, e.g.:
+
+      PYTHONPATH=.. python benchmark_render_input_latency.py
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import optparse
+import os
+import Queue
+import sys
+import tempfile
+import threading
+import time
+
+try:
+    import json
+except ImportError:
+    import simplejson as json
+
+from enso import cairo
+
+
+# ----------------------------------------------------------------------------
+# Constants
+# ----------------------------------------------------------------------------
+
+# The default number of seconds that each run lasts.
+DEFAULT_DURATION = 5.0
+
+# The default number of key events injected per second.
+DEFAULT_RATE = 50
+
+# The size of the rendered images, in pixels; about the size of a
+# large primary message.
+IMAGE_WIDTH = 1024
+IMAGE_HEIGHT = 512
+
+# The text drawn onto the images.
+TEXT = "The quick brown fox jumps over the lazy dog"
+
+# The font size of the text, in pixels.
+FONT_SIZE = 48
+
+# The event that tells the key listener thread to stop.
+STOP_EVENT = None
+
+
+# ----------------------------------------------------------------------------
+# Threads
+# ----------------------------------------------------------------------------
+
+class Renderer( threading.Thread ):
+    """
+    Draws images until it's told to stop.
+    """
+
+    def __init__( self, pngPath ):
+        threading.Thread.__init__( self )
+        self.setDaemon( True )
+        self.__pngPath = pngPath
+        self.__stopped = threading.Event()
+        self.framesRendered = 0
+
+    def stop( self ):
+        self.__stopped.set()
+        self.join()
+
+    def run( self ):
+        mask = cairo.ImageSurface( cairo.FORMAT_A8, IMAGE_WIDTH,
+                                   IMAGE_HEIGHT )
+        maskContext = cairo.Context( mask )
+        maskContext.set_source_rgba( 0, 0, 0, 0.5 )
+        maskContext.paint()
+
+        while not self.__stopped.isSet():
+            self.renderFrame( mask )
+            self.framesRendered += 1
+
+    def renderFrame( self, mask ):
+        surface = cairo.ImageSurface( cairo.FORMAT_ARGB32, IMAGE_WIDTH,
+                                      IMAGE_HEIGHT )
+        context = cairo.Context( surface )
+
+        context.set_source_rgba( 0.5, 0.5, 0.5, 0.8 )
+        context.paint()
+
+        context.set_source_rgba( 0.2, 0.3, 0.4, 0.9 )
+        context.rectangle( 16, 16, IMAGE_WIDTH - 32, IMAGE_HEIGHT - 32 )
+        context.fill()
+
+        context.set_source_rgba( 1, 1, 1, 1 )
+        context.set_font_size( FONT_SIZE )
+        y = FONT_SIZE
+        while y < IMAGE_HEIGHT:
+            context.move_to( 0, y )
+            context.show_text( TEXT )
+            y += FONT_SIZE
+
+        context.set_source_rgba( 0, 0, 0, 1 )
+        context.mask_surface( mask, 0, 0 )
+
+        surface.write_to_png( self.__pngPath )
+
+
+class KeyListener( threading.Thread ):
+    """
+    Handles the key events in a queue, recording how long each one
+    waited, until it gets STOP_EVENT.
+    """
+
+    def __init__( self, events ):
+        threading.Thread.__init__( self )
+        self.setDaemon( True )
+        self.__events = events
+        self.latencies = []
+
+    def run( self ):
+        while True:
+            event = self.__events.get()
+            if event == STOP_EVENT:
+                break
+            self.latencies.append( time.time() - event["time"] )
+
+
+def injectKeyEvents( events, duration, rate ):
+    """
+    Puts a key event in the given queue rate times a second, for the
+    given number of seconds.
+    """
+
+    interval = 1.0 / rate
+    end = time.time() + duration
+    nextTime = time.time()
+    keycode = 0
+    while nextTime < end:
+        delay = nextTime - time.time()
+        if delay > 0:
+            time.sleep( delay )
+        events.put( { "event" : "keyDown",
+                      "keycode" : keycode,
+                      "time" : time.time() } )
+        keycode = ( keycode + 1 ) % 26
+        nextTime += interval
+    events.put( STOP_EVENT )
+
+
+# ----------------------------------------------------------------------------
+# Benchmark
+# ----------------------------------------------------------------------------
+
+def percentile( sortedValues, fraction ):
+    """
+    Returns the value below which the given fraction of the values
+    fall (using the nearest-rank method).
+    """
+
+    rank = int( fraction * len( sortedValues ) + 0.5 )
+    rank = min( max( rank, 1 ), len( sortedValues ) )
+    return sortedValues[rank - 1]
+
+
+def summarize( values, scale = 1 ):
+    """
+    Returns a dictionary of statistics of the given values, each
+    multiplied by scale.
+    """
+
+    values = [ value * scale for value in values ]
+    values.sort()
+    if len( values ) == 0:
+        return {}
+
+    total = 0
+    for value in values:
+        total += value
+
+    return {
+        "p50" : percentile( values, 0.50 ),
+        "p99" : percentile( values, 0.99 ),
+        "max" : values[-1],
+        "mean" : float( total ) / len( values ),
+        }
+
+
+def benchmark( duration, rate, render ):
+    """
+    Injects key events for the given number of seconds, rendering at
+    the same time if render is true, and returns a dictionary of
+    results.
+    """
+
+    events = Queue.Queue()
+    listener = KeyListener( events )
+    listener.start()
+
+    renderer = None
+    if render:
+        fd, pngPath = tempfile.mkstemp( ".png" )
+        os.close( fd )
+        renderer = Renderer( pngPath )
+        renderer.start()
+
+    try:
+        injectKeyEvents( events, duration, rate )
+        listener.join()
+    finally:
+        if renderer != None:
+            renderer.stop()
+            os.remove( pngPath )
+
+    result = {
+        "rendering" : render,
+        "keyEvents" : len( listener.latencies ),
+        "latencyMs" : summarize( listener.latencies, 1000 ),
+        }
+    if renderer != None:
+        result["framesRendered"] = renderer.framesRendered
+    return result
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+def main( argv ):
+    parser = optparse.OptionParser( usage = "%prog [options]" )
+    parser.add_option( "--duration", type = "float",
+                       default = DEFAULT_DURATION,
+                       help = "seconds that each run lasts "
+                       "[default: %default]" )
+    parser.add_option( "--rate", type = "int", default = DEFAULT_RATE,
+                       help = "key events per second [default: %default]" )
+    options, args = parser.parse_args( argv )
+
+    results = {
+        "python" : sys.version.split()[0],
+        "platform" : sys.platform,
+        "time" : time.strftime( "%Y-%m-%dT%H:%M:%S" ),
+        "cairo" : cairo.__name__,
+        "rate" : options.rate,
+        "results" : [ benchmark( options.duration, options.rate, render )
+                      for render in [ False, True ] ],
+        }
+
+    print json.dumps( results, indent = 2, sort_keys = True )
+
+if __name__ == "__main__":
+    main( sys.argv[1:] )
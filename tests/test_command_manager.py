@@ -6,12 +6,17 @@
 # Imports
 # ----------------------------------------------------------------------------
 
+import random
 import unittest
 import os
 
+from enso.commands.manager import CommandManager
 from enso.commands.manager import CommandObjectRegistry
 from enso.commands.manager import CommandAlreadyRegisteredError
+from enso.commands.manager import PrefixTrie
 from enso.commands.interfaces import CommandExpression
+from enso.commands.interfaces import CommandObject
+from enso.commands.factories import GenericPrefixFactory
 
 
 # ----------------------------------------------------------------------------
@@ -54,6 +59,280 @@ class RegistryTester( unittest.TestCase ):
     # TODO: Match testing.
     # TODO: Suggestion testing.
 
+
+
+# ----------------------------------------------------------------------------
+# Prefix Trie Unit Tests
+# ----------------------------------------------------------------------------
+
+class PrefixTrieTester( unittest.TestCase ):
+    def testAgainstMatches( self ):
+        # Compares the trie to CommandExpression.matches() on random
+        # prefixes and user text.
+        random.seed( 0 )
+
+        def randomString():
+            return "".join( [ random.choice( "ab " )
+                              for i in range( random.randint(0, 4) ) ] )
+
+        trie = PrefixTrie()
+        exprs = []
+        for i in range( 200 ):
+            if exprs and random.random() < 0.3:
+                expr = random.choice( exprs )
+                exprs.remove( expr )
+                trie.remove( expr.getPrefix(), expr )
+            else:
+                expr = CommandExpression( randomString() + "{arg}" )
+                exprs.append( expr )
+                trie.add( expr.getPrefix(), expr )
+
+            userText = randomString()
+            expected = [ e for e in exprs if e.matches( userText ) ]
+            found = trie.findCompatible( userText )
+            self.failUnlessEqual( len( found ), len( expected ) )
+            self.failUnlessEqual( set( found ), set( expected ) )
+
+    def testRemoveMissing( self ):
+        trie = PrefixTrie()
+        trie.add( "open ", 1 )
+        self.failUnlessRaises( ValueError, trie.remove, "open", 1 )
+        self.failUnlessRaises( ValueError, trie.remove, "close ", 1 )
+        trie.remove( "open ", 1 )
+        self.failUnlessEqual( trie.findCompatible( "" ), [] )
+
+
+# ----------------------------------------------------------------------------
+# Suggestion Refinement Unit Tests
+# ----------------------------------------------------------------------------
+
+class FakeFactory( GenericPrefixFactory ):
+    PREFIX = "open "
+    HELP_TEXT = "thing"
+
+    def __init__( self, postfixes ):
+        GenericPrefixFactory.__init__( self )
+        self.postfixes = postfixes
+
+    def update( self ):
+        self._postfixes = self.postfixes
+
+    def _generateCommandObj( self, postfix ):
+        return FakeCommand( postfix )
+
+class SuggestionRefinementTester( unittest.TestCase ):
+    COMMANDS = [ "open", "opera", "operate", "close", "copy 2 clipboard" ]
+    POSTFIXES = [ "my documents", "opera", "open office", "notes (2008)" ]
+
+    def setUp( self ):
+        self.manager = CommandManager()
+        for name in self.COMMANDS:
+            self.manager.registerCommand( name, CommandObject() )
+        self.factory = FakeFactory( self.POSTFIXES )
+        self.manager.registerCommand( "open {thing}", self.factory )
+
+    def tearDown( self ):
+        self.manager = None
+        self.factory = None
+
+    def _getTexts( self, groups ):
+        return self.manager.getCandidatesFromGroups( groups )
+
+    def testRefinement( self ):
+        for userText in [ "open notes (2008)", "copy 2@ clip" ]:
+            groups = self.manager.retrieveSuggestionGroups( userText[:1] )
+            for i in range( 2, len( userText ) + 1 ):
+                self.failUnless(
+                    self.manager.areSuggestionGroupsCurrent( groups )
+                    )
+                groups = self.manager.refineSuggestionGroups(
+                    userText[:i],
+                    groups
+                    )
+                expected = self.manager.retrieveSuggestionGroups(
+                    userText[:i]
+                    )
+                self.failUnlessEqual( self._getTexts( groups ),
+                                      self._getTexts( expected ) )
+
+    def testGenerations( self ):
+        groups = self.manager.retrieveSuggestionGroups( "op" )
+        self.failUnless( self.manager.areSuggestionGroupsCurrent( groups ) )
+
+        # Setting the same postfixes again doesn't change anything.
+        self.factory.postfixes = self.POSTFIXES[:]
+        self.failUnless( self.manager.areSuggestionGroupsCurrent( groups ) )
+
+        self.factory.postfixes = self.POSTFIXES + [ "opal" ]
+        self.failIf( self.manager.areSuggestionGroupsCurrent( groups ) )
+
+        groups = self.manager.retrieveSuggestionGroups( "op" )
+        self.manager.registerCommand( "opus", CommandObject() )
+        self.failIf( self.manager.areSuggestionGroupsCurrent( groups ) )
+
+        groups = self.manager.retrieveSuggestionGroups( "op" )
+        self.manager.unregisterCommand( "open {thing}" )
+        self.failIf( self.manager.areSuggestionGroupsCurrent( groups ) )
+
+
+class CountingFactory( FakeFactory ):
+    PREFIX = "close "
+
+    def __init__( self, postfixes ):
+        FakeFactory.__init__( self, postfixes )
+        self.updates = 0
+
+    def update( self ):
+        self.updates += 1
+        FakeFactory.update( self )
+
+class RoutingTester( unittest.TestCase ):
+    def testOnlyMatchingFactoriesUpdate( self ):
+        manager = CommandManager()
+        factory = CountingFactory( [ "window" ] )
+        manager.registerCommand( "close {thing}", factory )
+        manager.registerCommand( "open {thing}", FakeFactory( [ "file" ] ) )
+
+        manager.retrieveSuggestions( "open f" )
+        manager.autoComplete( "open f" )
+        self.failUnlessEqual( factory.updates, 0 )
+
+        texts = [ s.toText() for s in manager.retrieveSuggestions( "c" ) ]
+        self.failUnlessEqual( texts, [ "close ", "close window" ] )
+        self.failUnless( factory.updates > 0 )
+        self.failIfEqual( manager.getCommand( "close window" ), None )
+
+        manager.unregisterCommand( "close {thing}" )
+        self.failUnlessEqual( manager.retrieveSuggestions( "c" ), [] )
+
+
+class BatchRegistrationTester( unittest.TestCase ):
+    NAMES = [ "open", "opera", "close", "copy 2 clipboard" ]
+
+    def setUp( self ):
+        self.manager = CommandManager()
+        self.factory = FakeFactory( [ "file" ] )
+        self.commands = [ ( name, CommandObject() ) for name in self.NAMES ]
+        self.manager.registerCommands(
+            self.commands + [ ( "open {thing}", self.factory ) ]
+            )
+
+    def tearDown( self ):
+        self.manager = None
+
+    def _getTexts( self, userText ):
+        texts = [ s.toText()
+                  for s in self.manager.retrieveSuggestions( userText ) ]
+        texts.sort()
+        return texts
+
+    def testRegister( self ):
+        for name, cmdObj in self.commands:
+            self.failUnless( self.manager.getCommand( name ) is cmdObj )
+        self.failUnlessEqual( self._getTexts( "ope" ),
+                              [ "open", "open ", "open file", "opera" ] )
+
+    def testAlreadyRegistered( self ):
+        self.failUnlessRaises( CommandAlreadyRegisteredError,
+                               self.manager.registerCommands,
+                               [ ( "new", CommandObject() ),
+                                 ( "close", CommandObject() ) ] )
+        self.failUnlessRaises( CommandAlreadyRegisteredError,
+                               self.manager.registerCommands,
+                               [ ( "new", CommandObject() ),
+                                 ( "new", CommandObject() ) ] )
+        self.failUnlessEqual( self.manager.getCommand( "new" ), None )
+
+    def testUnregister( self ):
+        self.manager.unregisterCommands( [ "opera", "open {thing}",
+                                           "close" ] )
+        self.failUnlessEqual( self._getTexts( "ope" ), [ "open" ] )
+        self.failUnlessEqual( self._getTexts( "clo" ), [] )
+
+        self.failUnlessRaises( RuntimeError,
+                               self.manager.unregisterCommands,
+                               [ "open", "opera" ] )
+        self.failUnlessEqual( self._getTexts( "ope" ), [ "open" ] )
+
+    def testUnregisterTwice( self ):
+        # Unregistering a command twice at once fails without
+        # unregistering it at all.
+        self.failUnlessRaises( RuntimeError,
+                               self.manager.unregisterCommands,
+                               [ "open", "open" ] )
+        self.failUnlessEqual( self._getTexts( "ope" ),
+                              [ "open", "open ", "open file", "opera" ] )
+
+        self.manager.unregisterCommands( [ "open" ] )
+        self.manager.registerCommand( "open", CommandObject() )
+        self.failUnlessEqual( self._getTexts( "ope" ),
+                              [ "open", "open ", "open file", "opera" ] )
+
+    def testGetCommands( self ):
+        self.failUnless( self.manager.getCommands().has_key( "open {thing}" ) )
+        self.manager.unregisterCommands( [ "open {thing}" ] )
+        self.failIf( self.manager.getCommands().has_key( "open {thing}" ) )
+
+    def testRemovePostfixes( self ):
+        factory = PushingFactory( None )
+        factory._addPostfixes( [ "a", "b", "a", "c" ] )
+        factory._removePostfixes( [ "a", "c" ] )
+        self.failUnlessEqual( factory._postfixes, [ "b", "a" ] )
+        self.failUnlessRaises( ValueError, factory._removePostfixes,
+                               [ "b", "c" ] )
+        self.failUnlessEqual( factory._postfixes, [ "b", "a" ] )
+
+class PushingFactory( FakeFactory ):
+    UPDATE_INTERVAL = None
+
+    def update( self ):
+        raise AssertionError( "update() shouldn't be called." )
+
+class SlowPollingFactory( CountingFactory ):
+    UPDATE_INTERVAL = 1000
+
+class UpdatePolicyTester( unittest.TestCase ):
+    def _getTexts( self, factory, userText ):
+        return [ text for text, helpText
+                 in factory.retrieveCandidates( userText ) ]
+
+    def testPushing( self ):
+        factory = PushingFactory( None )
+        generation = factory.getGeneration()
+        self.failUnlessEqual( self._getTexts( factory, "open f" ), [] )
+
+        factory._addPostfix( "file" )
+        self.failIfEqual( factory.getGeneration(), generation )
+        generation = factory.getGeneration()
+        self.failUnlessEqual( self._getTexts( factory, "open f" ),
+                              [ "open file" ] )
+        self.failUnlessEqual( factory.getGeneration(), generation )
+
+        # Modifying the postfixes in place goes unnoticed until
+        # markChanged() is called.
+        factory._postfixes.append( "folder" )
+        self.failUnlessEqual( factory.getGeneration(), generation )
+        factory.markChanged()
+        self.failIfEqual( factory.getGeneration(), generation )
+        self.failUnlessEqual( self._getTexts( factory, "open f" ),
+                              [ "open file", "open folder" ] )
+
+    def testPolling( self ):
+        factory = SlowPollingFactory( [ "window" ] )
+        for userText in [ "c", "close", "close w" ]:
+            self.failUnlessEqual( self._getTexts( factory, "close w" ),
+                                  [ "close window" ] )
+            factory.getGeneration()
+            factory.autoComplete( userText )
+        self.failUnlessEqual( factory.updates, 1 )
+
+        # markChanged() makes the next query poll again.
+        factory.markChanged()
+        self._getTexts( factory, "close w" )
+        self.failUnlessEqual( factory.updates, 2 )
+        self._getTexts( factory, "close w" )
+        self.failUnlessEqual( factory.updates, 2 )
+
         
 # ----------------------------------------------------------------------------
 # Script
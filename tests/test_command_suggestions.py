@@ -6,6 +6,7 @@
 # Imports
 # ----------------------------------------------------------------------------
 
+import random
 import unittest
 
 from enso.commands import suggestions
@@ -92,7 +93,71 @@ class SuggestionBasicTests( unittest.TestCase ):
         # Make sure we can create empty AutoCompletions
         # We're checking to see whether errors get raised.
         suggestions.AutoCompletion( self.SOURCE, "" )
-    
+
+
+class SuggestionSelectionTests( unittest.TestCase ):
+    def _selectBySorting( self, source, candidates, maxCount ):
+        suggs = [ suggestions.Suggestion( source, text, helpText )
+                  for text, helpText in candidates ]
+        suggs.sort()
+        return suggs[:maxCount]
+
+    def testSelection( self ):
+        random.seed( 0 )
+        for i in range( 200 ):
+            source = "".join( [ random.choice( "abc" )
+                                for j in range( random.randint(1, 4) ) ] )
+            candidates = [
+                ( "".join( [ random.choice( "abc" )
+                             for j in range( random.randint(1, 6) ) ] ),
+                  random.choice( [ None, "help" ] ) )
+                for j in range( random.randint(0, 30) ) ]
+            for maxCount in [ 0, 1, 6, 50 ]:
+                expected = self._selectBySorting( source, candidates,
+                                                  maxCount )
+                selected = suggestions.selectBestSuggestions( source,
+                                                              candidates,
+                                                              maxCount )
+                self.failUnlessEqual(
+                    [ ( s.toText(), s.getHelpText() ) for s in selected ],
+                    [ ( s.toText(), s.getHelpText() ) for s in expected ]
+                    )
+
+
+class SuggestionMarkupTests( unittest.TestCase ):
+    def testNextWord( self ):
+        for source, text, nextWord in [ ( "fo", "foo bar", "foo " ),
+                                        ( "foo b", "foo bar", "foo bar" ),
+                                        ( "zzz", "defghi", "defghi" ),
+                                        ( "", "", "" ) ]:
+            sugg = suggestions.Suggestion( source, text )
+            self.failUnlessEqual( sugg.toNextWord(), nextWord )
+
+    def testEscaping( self ):
+        sugg = suggestions.Suggestion( "a<b", "a<b & c>" )
+        self.failUnlessEqual( sugg.toXml(), "a&lt;b<ins> &amp; c&gt;</ins>" )
+
+    def testUnicode( self ):
+        sugg = suggestions.Suggestion( u"caf\xe9", u"le caf\xe9" )
+        self.failUnlessEqual( sugg.toXml(), u"<ins>le </ins>caf\xe9" )
+        self.failUnless( isinstance( sugg.toXml(), unicode ) )
+        sugg = suggestions.Suggestion( "cafe", "le cafe" )
+        self.failUnless( isinstance( sugg.toXml(), str ) )
+
+    def testMatchingBlocks( self ):
+        # Compares findMatchingBlocks(), which may be native, to its
+        # pure Python implementation.
+        random.seed( 0 )
+        for i in range( 2000 ):
+            source = "".join( [ random.choice( "ab c" )
+                                for j in range( random.randint(0, 6) ) ] )
+            text = "".join( [ random.choice( "ab cd" )
+                              for j in range( random.randint(0, 10) ) ] )
+            self.failUnlessEqual(
+                suggestions.findMatchingBlocks( source, text ),
+                suggestions._findMatchingBlocksInPython( source, text )
+                )
+
 
 # ----------------------------------------------------------------------------
 # Script
@@ -0,0 +1,85 @@
+"""
+    Unit tests for enso.utils.damage.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import unittest
+
+from enso.utils.damage import DamageRegion
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+class DamageRegionTests( unittest.TestCase ):
+    def setUp( self ):
+        self.region = DamageRegion( maxRects = 3 )
+
+    def tearDown( self ):
+        self.region = None
+
+    def testStartsEmpty( self ):
+        self.failUnless( self.region.isEmpty() )
+        self.failUnlessEqual( self.region.getRects(), [] )
+        self.failUnlessEqual( self.region.getBounds(), None )
+
+    def testEmptyRectsAreIgnored( self ):
+        self.region.add( 10, 10, 0, 5 )
+        self.region.add( 10, 10, 5, -1 )
+        self.failUnless( self.region.isEmpty() )
+
+    def testSeparateRects( self ):
+        self.region.add( 0, 0, 10, 10 )
+        self.region.add( 50, 0, 10, 10 )
+        self.failUnlessEqual( self.region.getRects(),
+                              [ (0, 0, 10, 10), (50, 0, 10, 10) ] )
+        self.failUnlessEqual( self.region.getBounds(), (0, 0, 60, 10) )
+
+    def testOverlappingRectsAreMerged( self ):
+        self.region.add( 0, 0, 10, 10 )
+        self.region.add( 5, 5, 10, 10 )
+        self.failUnlessEqual( self.region.getRects(), [ (0, 0, 15, 15) ] )
+
+    def testAdjacentRectsAreMerged( self ):
+        self.region.add( 0, 0, 10, 10 )
+        self.region.add( 10, 0, 10, 10 )
+        self.failUnlessEqual( self.region.getRects(), [ (0, 0, 20, 10) ] )
+
+    def testMergesCascade( self ):
+        self.region.add( 0, 0, 10, 10 )
+        self.region.add( 30, 0, 10, 10 )
+        self.region.add( 5, 0, 30, 5 )
+        self.failUnlessEqual( self.region.getRects(), [ (0, 0, 40, 10) ] )
+
+    def testTooManyRectsAreMergedIntoBounds( self ):
+        for x in [ 0, 20, 40, 60 ]:
+            self.region.add( x, x, 5, 5 )
+        self.failUnlessEqual( self.region.getRects(), [ (0, 0, 65, 65) ] )
+
+    def testClipping( self ):
+        self.region.add( 0, 0, 10, 10 )
+        self.region.add( 50, 50, 10, 10 )
+        clipRect = ( 5, 5, 20, 20 )
+        self.failUnlessEqual( self.region.getRects( clipRect ),
+                              [ (5, 5, 5, 5) ] )
+        self.failUnlessEqual( self.region.getBounds( clipRect ),
+                              (5, 5, 5, 5) )
+        self.failUnlessEqual( self.region.getBounds( (100, 100, 5, 5) ),
+                              None )
+
+    def testClear( self ):
+        self.region.add( 0, 0, 10, 10 )
+        self.region.clear()
+        self.failUnless( self.region.isEmpty() )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,438 @@
+"""
+    Unit tests for enso.quasimode.linewindows, and for how the
+    quasimode window presents its lines in compositor mode, against
+    stand-ins for the platform's transparent windows and Cairo.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import os
+import sys
+import types
+import unittest
+
+import enso
+import enso.providers
+
+
+# ----------------------------------------------------------------------------
+# Stubs
+# ----------------------------------------------------------------------------
+
+# The width and height of the fake desktop, in pixels.
+DESKTOP_SIZE = ( 800, 600 )
+
+class FakeSurface:
+    """
+    An ARGB32 image surface whose pixels are all the same in each
+    column; it's described by a string with a character per column.
+    """
+
+    def __init__( self, columns, height ):
+        self.columns = columns
+        self.height = height
+
+    def get_width( self ):
+        return len( self.columns )
+
+    def get_height( self ):
+        return self.height
+
+    def get_stride( self ):
+        return len( self.columns ) * 4
+
+    def get_data( self ):
+        row = "".join( [ column * 4 for column in self.columns ] )
+        return row * self.height
+
+
+class FakeContext:
+    def __init__( self, surface ):
+        pass
+
+    def __getattr__( self, name ):
+        # Drawing is done by a real Cairo; here, it does nothing.
+        return lambda *args: None
+
+
+class FakeTransparentWindow:
+    """
+    Records the calls that present a transparent window, and the
+    window's size, all in pixels.
+    """
+
+    def __init__( self, xPos, yPos, width, height ):
+        self.maxWidth = width
+        self.maxHeight = height
+        self.width = width
+        self.height = height
+        self.calls = []
+
+    def makeCairoSurface( self ):
+        return None
+
+    def markDirty( self, x, y, width, height ):
+        self.calls.append( ( "markDirty", x, y, width, height ) )
+
+    def setSize( self, width, height ):
+        self.calls.append( ( "setSize", width, height ) )
+        self.width = width
+        self.height = height
+
+    def update( self ):
+        self.calls.append( ( "update", ) )
+
+    def getWidth( self ):
+        return self.width
+
+    def getHeight( self ):
+        return self.height
+
+    def getMaxWidth( self ):
+        return self.maxWidth
+
+    def getMaxHeight( self ):
+        return self.maxHeight
+
+
+def _stubModule( name, **attrs ):
+    module = types.ModuleType( name )
+    module.__dict__.update( attrs )
+    return module
+
+enso.providers._interfaces["graphics"] = _stubModule(
+    "fakegraphics",
+    getDesktopSize = lambda: DESKTOP_SIZE,
+    TransparentWindow = FakeTransparentWindow
+    )
+enso.providers._interfaces["cairo"] = _stubModule(
+    "fakecairo",
+    Context = FakeContext,
+    OPERATOR_CLEAR = 0,
+    OPERATOR_OVER = 2,
+    OPERATOR_SOURCE = 1
+    )
+
+# The quasimode package's __init__ imports the platform's input; only
+# the line windows' own modules are needed here.
+if not sys.modules.has_key( "enso.quasimode" ):
+    _package = _stubModule(
+        "enso.quasimode",
+        __path__ = [ os.path.join( os.path.dirname( enso.__file__ ),
+                                   "quasimode" ) ]
+        )
+    sys.modules["enso.quasimode"] = _package
+
+from enso import config
+from enso.graphics import measurement
+from enso.quasimode import layout
+from enso.quasimode import linewindows
+from enso.quasimode import window
+
+
+class FakeDocument:
+    """
+    Stands in for a laid out line of text; the attributes that go
+    into a line's content key are all that's looked at.
+    """
+
+    def __init__( self, xmlData, ragWidth ):
+        self.xmlData = xmlData
+        self.styleVersion = 0
+        self.shrinkOffset = 0
+        self.ragWidth = ragWidth
+        self.roundUpperRight = False
+        self.roundLowerRight = False
+        self.background = ( 0, 0, 0, 1 )
+
+
+def makeLine( xmlData, columns, height ):
+    """
+    Returns a document for a line of the given height whose rendering
+    is a FakeSurface with the given columns, putting the surface in
+    the cache of rendered lines so that it isn't rendered.
+    """
+
+    width = len( columns ) - layout.L_MARGIN - layout.R_MARGIN
+    document = FakeDocument( xmlData, width )
+    key = linewindows._getContentKey( document, height )
+    linewindows._lineSurfaces[key] = FakeSurface( columns, int( height ) )
+    return document
+
+
+class FakeSuggestion:
+    def toXml( self ):
+        return "open"
+
+    def getSource( self ):
+        return "open"
+
+
+class FakeSuggestionList:
+    def getSuggestions( self ):
+        return [ FakeSuggestion() ]
+
+
+class FakeQuasimode:
+    """
+    Stands in for the quasimode; the lines of its display, and which
+    of them changed, are set by the test, and handed to the quasimode
+    window by a FakeLayout.
+    """
+
+    def __init__( self ):
+        self.lines = []
+        self.changedLines = []
+
+    def getSuggestionList( self ):
+        return FakeSuggestionList()
+
+
+class FakeLayout:
+    def __init__( self ):
+        self.newLines = []
+
+    def update( self, quasimode ):
+        self.newLines = quasimode.lines
+        return quasimode.changedLines
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+class TextWindowTests( unittest.TestCase ):
+    def setUp( self ):
+        # Make points the same as pixels.
+        self.oldPpi = measurement.getPixelsPerInch()
+        measurement.setPixelsPerInch( 72 )
+
+        self.window = linewindows.TextWindow( 10, ( 0, 0 ) )
+        self.impl = self.window._TextWindow__window._impl
+
+    def tearDown( self ):
+        measurement.setPixelsPerInch( self.oldPpi )
+        self.window = None
+        self.impl = None
+
+    def testFirstDrawPresentsLine( self ):
+        self.window.draw( makeLine( "<a/>", "a" * 40, 10 ) )
+        self.failUnlessEqual( self.impl.calls,
+                              [ ( "markDirty", 0, 0, 40, 10 ),
+                                ( "setSize", 40, 10 ),
+                                ( "update", ) ] )
+
+    def testChangedColumnsArePresented( self ):
+        self.window.draw( makeLine( "<a/>", "a" * 40, 10 ) )
+        self.impl.calls = []
+        self.window.draw( makeLine( "<b/>", "a" * 30 + "b" * 10, 10 ) )
+        self.failUnlessEqual( self.impl.calls,
+                              [ ( "markDirty", 30, 0, 10, 10 ),
+                                ( "setSize", 40, 10 ),
+                                ( "update", ) ] )
+
+    def testSameKeyIsntDrawn( self ):
+        self.window.draw( makeLine( "<a/>", "a" * 40, 10 ) )
+        self.impl.calls = []
+        self.window.draw( makeLine( "<a/>", "a" * 40, 10 ) )
+        self.failUnlessEqual( self.impl.calls, [] )
+
+    def testSamePixelsArentPresented( self ):
+        # A line whose key differs, but whose rendering doesn't,
+        # mustn't update the window with nothing marked dirty, since
+        # that presents all of it.
+        self.window.draw( makeLine( "<a/>", "a" * 40, 10 ) )
+        self.impl.calls = []
+        self.window.draw( makeLine( "<b/>", "a" * 40, 10 ) )
+        self.failUnlessEqual( self.impl.calls, [] )
+
+        # The new line is the one displayed, though.
+        self.window.draw( makeLine( "<c/>", "a" * 30 + "c" * 10, 10 ) )
+        self.failUnlessEqual( self.impl.calls[0],
+                              ( "markDirty", 30, 0, 10, 10 ) )
+
+    def testShrunkenLineIsResized( self ):
+        self.window.draw( makeLine( "<a/>", "a" * 40, 10 ) )
+        self.impl.calls = []
+        self.window.draw( makeLine( "<b/>", "a" * 30, 10 ) )
+        self.failUnlessEqual( self.impl.calls[1:],
+                              [ ( "setSize", 30, 10 ),
+                                ( "update", ) ] )
+
+    def testHide( self ):
+        self.window.draw( makeLine( "<a/>", "a" * 40, 10 ) )
+        self.impl.calls = []
+        self.window.hide()
+        self.failUnlessEqual( self.impl.calls,
+                              [ ( "setSize", 1, 1 ),
+                                ( "update", ) ] )
+
+        # Drawing the same line again draws all of it.
+        self.impl.calls = []
+        self.window.draw( makeLine( "<a/>", "a" * 40, 10 ) )
+        self.failUnlessEqual( self.impl.calls[0],
+                              ( "markDirty", 0, 0, 40, 10 ) )
+
+
+class LineCompositorTests( unittest.TestCase ):
+    def setUp( self ):
+        self.oldPpi = measurement.getPixelsPerInch()
+        measurement.setPixelsPerInch( 72 )
+
+        self.compositor = linewindows.LineCompositor( 30 )
+        self.impl = self.compositor._LineCompositor__window._impl
+        self.lines = [ self.compositor.addLine( 10, 0 ),
+                       self.compositor.addLine( 20, 10 ) ]
+
+    def tearDown( self ):
+        measurement.setPixelsPerInch( self.oldPpi )
+        self.compositor = None
+        self.impl = None
+        self.lines = None
+
+    def drawLines( self, *columnsList ):
+        for i in range( len( columnsList ) ):
+            line = self.lines[i]
+            line.draw( makeLine( "<%d/>" % len( columnsList[i] ),
+                                 columnsList[i], line.getHeight() ) )
+
+    def testNothingIsPresentedUntilPresent( self ):
+        self.drawLines( "a" * 40, "b" * 50 )
+        self.failUnlessEqual( self.impl.calls,
+                              [ ( "markDirty", 0, 0, 40, 10 ),
+                                ( "markDirty", 0, 10, 50, 20 ) ] )
+        self.impl.calls = []
+        self.compositor.present()
+        self.failUnlessEqual( self.impl.calls,
+                              [ ( "setSize", 50, 30 ),
+                                ( "update", ) ] )
+
+        # There's nothing more to present.
+        self.impl.calls = []
+        self.compositor.present()
+        self.failUnlessEqual( self.impl.calls, [] )
+
+    def testShrunkenLine( self ):
+        self.drawLines( "a" * 40, "b" * 50 )
+        self.compositor.present()
+        self.impl.calls = []
+
+        # The end of the old line is cleared, and the window shrinks
+        # to the widest line.
+        self.drawLines( "a" * 40, "b" * 30 )
+        self.compositor.present()
+        self.failUnlessEqual( self.impl.calls,
+                              [ ( "markDirty", 30, 10, 20, 20 ),
+                                ( "setSize", 40, 30 ),
+                                ( "update", ) ] )
+
+    def testHiddenLine( self ):
+        self.drawLines( "a" * 40, "b" * 50 )
+        self.compositor.present()
+        self.impl.calls = []
+
+        self.lines[1].hide()
+        self.compositor.present()
+        self.failUnlessEqual( self.impl.calls,
+                              [ ( "markDirty", 0, 10, 50, 20 ),
+                                ( "setSize", 40, 10 ),
+                                ( "update", ) ] )
+
+        # Hiding it again does nothing.
+        self.impl.calls = []
+        self.lines[1].hide()
+        self.compositor.present()
+        self.failUnlessEqual( self.impl.calls, [] )
+
+    def testSamePixelsArentPresented( self ):
+        self.drawLines( "a" * 40, "b" * 50 )
+        self.compositor.present()
+        self.impl.calls = []
+
+        line = self.lines[0]
+        line.draw( makeLine( "<other/>", "a" * 40, line.getHeight() ) )
+        self.compositor.present()
+        self.failUnlessEqual( self.impl.calls, [] )
+
+
+class QuasimodeWindowTests( unittest.TestCase ):
+    def setUp( self ):
+        self.oldPpi = measurement.getPixelsPerInch()
+        measurement.setPixelsPerInch( 72 )
+        self.oldCompositor = config.QUASIMODE_COMPOSITOR
+        config.QUASIMODE_COMPOSITOR = True
+        self.oldLayout = window.QuasimodeLayout
+        window.QuasimodeLayout = FakeLayout
+
+        self.window = window.TheQuasimodeWindow()
+        compositor = self.window._TheQuasimodeWindow__compositor
+        self.impl = compositor._LineCompositor__window._impl
+        self.quasimode = FakeQuasimode()
+
+    def tearDown( self ):
+        measurement.setPixelsPerInch( self.oldPpi )
+        config.QUASIMODE_COMPOSITOR = self.oldCompositor
+        window.QuasimodeLayout = self.oldLayout
+        self.window = None
+        self.impl = None
+
+    def setLines( self, text ):
+        """
+        Makes the quasimode display the given text on its description
+        and user text lines, and each of its characters on a
+        suggestion line.
+        """
+
+        quasimodeWindow = self.window
+        windows = [ quasimodeWindow._TheQuasimodeWindow__descriptionWindow,
+                    quasimodeWindow._TheQuasimodeWindow__userTextWindow ]
+        windows.extend(
+            quasimodeWindow._TheQuasimodeWindow__suggestionWindows )
+        texts = [ text, text ] + list( text )
+
+        lines = []
+        for i in range( len( texts ) ):
+            lines.append( makeLine( texts[i], texts[i] * 20,
+                                    windows[i].getHeight() ) )
+        self.quasimode.lines = lines
+        self.quasimode.changedLines = range( len( lines ) )
+
+    def countUpdates( self ):
+        updates = [ call for call in self.impl.calls
+                    if call[0] == "update" ]
+        self.impl.calls = []
+        return len( updates )
+
+    def testOnePresentPerStep( self ):
+        self.setLines( "abc" )
+        self.window.update( self.quasimode, False )
+        self.failUnlessEqual( self.countUpdates(), 1 )
+
+        # Each suggestion drawn is presented on its own, once.
+        for i in range( 3 ):
+            self.failUnless(
+                self.window.continueDrawing( ignoreTimeElapsed = True ) )
+            self.failUnlessEqual( self.countUpdates(), 1 )
+        self.failIf( self.window.continueDrawing( ignoreTimeElapsed = True ) )
+        self.failUnlessEqual( self.countUpdates(), 0 )
+
+    def testFullRedrawPresentsOnce( self ):
+        self.setLines( "abc" )
+        self.window.update( self.quasimode, True )
+        self.failUnlessEqual( self.countUpdates(), 1 )
+
+        # Fewer suggestions hide the others, in the same present.
+        self.setLines( "de" )
+        self.window.update( self.quasimode, True )
+        self.failUnlessEqual( self.countUpdates(), 1 )
+        self.failIf( self.window.continueDrawing( ignoreTimeElapsed = True ) )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
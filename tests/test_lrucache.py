@@ -0,0 +1,83 @@
+"""
+    Unit tests for enso.utils.lrucache.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import unittest
+
+from enso.utils.lrucache import LruCache
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+class LruCacheTests( unittest.TestCase ):
+    def setUp( self ):
+        self.cache = LruCache( 3 )
+        for key in [ "a", "b", "c" ]:
+            self.cache[key] = key.upper()
+
+    def tearDown( self ):
+        self.cache = None
+
+    def _getKeys( self ):
+        return [ key for key in [ "a", "b", "c", "d" ]
+                 if self.cache.has_key( key ) ]
+
+    def testEviction( self ):
+        self.cache["d"] = "D"
+        self.failUnlessEqual( self._getKeys(), [ "b", "c", "d" ] )
+        self.failUnlessEqual( len( self.cache ), 3 )
+
+    def testLookupCountsAsUse( self ):
+        self.failUnlessEqual( self.cache["a"], "A" )
+        self.cache["d"] = "D"
+        self.failUnlessEqual( self._getKeys(), [ "a", "c", "d" ] )
+
+        self.failUnlessEqual( self.cache.get( "c" ), "C" )
+        self.cache["b"] = "B"
+        self.failUnlessEqual( self._getKeys(), [ "b", "c", "d" ] )
+
+    def testHasKeyDoesNotCountAsUse( self ):
+        self.failUnless( "a" in self.cache )
+        self.cache["d"] = "D"
+        self.failUnlessEqual( self._getKeys(), [ "b", "c", "d" ] )
+
+    def testStoreCountsAsUse( self ):
+        self.cache["a"] = "a"
+        self.cache["d"] = "D"
+        self.failUnlessEqual( self._getKeys(), [ "a", "c", "d" ] )
+        self.failUnlessEqual( self.cache["a"], "a" )
+
+    def testMissing( self ):
+        self.failUnlessRaises( KeyError, lambda: self.cache["d"] )
+        self.failUnlessEqual( self.cache.get( "d" ), None )
+        self.failUnlessEqual( self.cache.get( "d", 1 ), 1 )
+
+    def testHitsAndMisses( self ):
+        self.cache["a"]
+        self.cache.get( "b" )
+        self.cache.get( "d" )
+        self.failUnlessRaises( KeyError, lambda: self.cache["d"] )
+        self.failUnless( self.cache.has_key( "a" ) )
+        self.failUnlessEqual( ( self.cache.hits, self.cache.misses ),
+                              ( 2, 2 ) )
+
+    def testClear( self ):
+        self.cache.clear()
+        self.failUnlessEqual( len( self.cache ), 0 )
+        self.failUnlessEqual( self._getKeys(), [] )
+        self.cache["d"] = "D"
+        self.failUnlessEqual( self._getKeys(), [ "d" ] )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,169 @@
+"""
+    Tests for the enso.commands.matching module.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import random
+import re
+import unittest
+
+from enso.commands import matching
+from enso.commands.matching import makePostfixIndex
+from enso.commands.matching import RegexPostfixIndex
+from enso.commands.matching import RegexMatcher
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+POSTFIXES = [
+    "calculator",
+    "google",
+    "my documents",
+    "my  music",
+    "report (2008)",
+    "foo_bar",
+    "what's new",
+    "",
+    "Caps",
+    ]
+
+# Tuples of ( query method name, user text, expected matches ).
+CASES = [
+    ( "findPrefixMatches", "", [ "Caps", "calculator", "foo_bar",
+                                 "google", "my  music", "my documents",
+                                 "report (2008)", "what's new" ] ),
+    ( "findPrefixMatches", "my", [ "my  music", "my documents" ] ),
+    ( "findPrefixMatches", "my m", [ "my  music" ] ),
+    ( "findPrefixMatches", "my  d", [] ),
+    ( "findPrefixMatches", "c", [ "calculator" ] ),
+    ( "findPrefixMatches", "report 9", [ "report (2008)" ] ),
+    ( "findPrefixMatches", "foo-", [ "foo_bar" ] ),
+    ( "findPrefixMatches", "what'", [ "what's new" ] ),
+    ( "findSubstringMatches", "o", [ "calculator", "foo_bar", "google",
+                                     "my documents", "report (2008)" ] ),
+    ( "findSubstringMatches", "oo", [ "foo_bar", "google" ] ),
+    ( "findSubstringMatches", "y m", [ "my  music" ] ),
+    ( "findSubstringMatches", "2008", [ "report (2008)" ] ),
+    ( "findSubstringMatches", "9200", [ "report (2008)" ] ),
+    ( "findSubstringMatches", "x", [] ),
+    ( "findWordStartMatches", "doc", [ "my documents" ] ),
+    ( "findWordStartMatches", "ocu", [] ),
+    ( "findWordStartMatches", "bar", [] ),
+    ( "findWordStartMatches", "new", [ "what's new" ] ),
+    ( "findWordStartMatches", "s", [ "what's new" ] ),
+    ]
+
+class PostfixIndexTests( unittest.TestCase ):
+    def _testIndex( self, index ):
+        for methodName, userText, expected in CASES:
+            results = getattr( index, methodName )( userText )
+            self.failUnlessEqual( ( methodName, userText, results ),
+                                  ( methodName, userText, expected ) )
+
+    def testRegexIndex( self ):
+        self._testIndex( RegexPostfixIndex( POSTFIXES ) )
+
+    def testIndex( self ):
+        self._testIndex( makePostfixIndex( POSTFIXES ) )
+
+    def testNewlines( self ):
+        # A postfix containing a newline forces the use of the
+        # regular expression-based index, whatever it's given.
+        index = makePostfixIndex( POSTFIXES + [ "a\nb" ] )
+        self.failUnlessEqual( index.findPrefixMatches( "b" ), [ "b" ] )
+
+    def testAgainstRegexIndex( self ):
+        # Compares the index to the regular expression-based one on
+        # random postfixes and queries, made up of characters that
+        # exercise spaces, word boundaries and equivalent characters.
+        random.seed( 0 )
+        chars = "ab Ac_1!2@-;:'\"(9"
+
+        def randomString( maxLength ):
+            return "".join( [ random.choice( chars )
+                              for i in range( random.randint(0, maxLength) ) ] )
+
+        for i in range( 200 ):
+            postfixes = [ randomString( 10 ) for j in range( 20 ) ]
+            index = makePostfixIndex( postfixes )
+            regexIndex = RegexPostfixIndex( postfixes )
+            for j in range( 10 ):
+                userText = randomString( 4 )
+                for methodName in [ "findPrefixMatches",
+                                    "findSubstringMatches",
+                                    "findWordStartMatches" ]:
+                    self.failUnlessEqual(
+                        getattr( index, methodName )( userText ),
+                        getattr( regexIndex, methodName )( userText )
+                        )
+
+    def testEquivalizeChars( self ):
+        self.failUnlessEqual( matching.equivalizeChars( "a2 b" ),
+                              "a[2\\@][\\ ]+b" )
+        self.failUnlessEqual( matching.equivalizeChars( u"\xe9'" ),
+                              u"\\\xe9[\\'\\\"]" )
+
+
+class MatcherTests( unittest.TestCase ):
+    def testAgainstRegex( self ):
+        # Compares the matchers to regular expression searches on
+        # random text and user text.
+        random.seed( 0 )
+        chars = "ab Ac_1!2@-;:'\"(9"
+
+        def randomString( maxLength ):
+            return "".join( [ random.choice( chars )
+                              for i in range( random.randint(0, maxLength) ) ] )
+
+        for i in range( 2000 ):
+            userText = randomString( 4 )
+            text = randomString( 12 )
+            start = random.randint( -1, 14 )
+            if random.random() < 0.5:
+                text = unicode( text )
+
+            match = re.compile( matching.equivalizeChars( userText ) ).search(
+                text, start
+                )
+            if match == None:
+                expected = -1
+            else:
+                expected = match.start()
+
+            self.failUnlessEqual(
+                matching.getMatcher( userText ).search( text, start ),
+                expected
+                )
+            self.failUnlessEqual(
+                RegexMatcher( userText ).search( text, start ),
+                expected
+                )
+
+    def testNonAscii( self ):
+        # Like regular expressions, matchers compare the bytes of
+        # strings to the characters of unicode objects.
+        matcher = matching.getMatcher( u"\xe9" )
+        self.failUnlessEqual( matcher.search( "caf\xe9" ), 3 )
+        self.failUnlessEqual( matcher.search( u"caf\xe9" ), 3 )
+        self.failUnlessEqual( matcher.search( "cafe" ), -1 )
+
+    def testCaching( self ):
+        self.failUnless( matching.getMatcher( "abc" ) is
+                         matching.getMatcher( "abc" ) )
+        self.failUnless( matching.getRegex( "abc" ) is
+                         matching.getRegex( "abc" ) )
+        self.failIf( matching.getRegex( "abc" ) is
+                     matching.getRegex( "abc", "^%s" ) )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
@@ -6,8 +6,11 @@
 # Imports
 # ----------------------------------------------------------------------------
 
+import doctest
+import sys
 import unittest
 
+from enso.utils import memoize
 from enso.utils.memoize import memoized
 
 
@@ -81,6 +84,95 @@ class TestMemoize( unittest.TestCase ):
                 self.failUnlessEqual( self.something( t ), [t,1] )
                 self.failUnlessEqual( self.calledCount, called )
 
+    def _testBounded( self, policy, expectedCalls ):
+        calls = []
+        def double( a ):
+            calls.append( a )
+            return a * 2
+        double = memoized( maxsize = 2, policy = policy )( double )
+
+        for a in [ 1, 2, 1, 3, 1, 2 ]:
+            self.failUnlessEqual( double( a ), a * 2 )
+        self.failUnlessEqual( calls, expectedCalls )
+
+    def testLru( self ):
+        self._testBounded( "lru", [ 1, 2, 3, 2 ] )
+
+    def testClock( self ):
+        self._testBounded( "clock", [ 1, 2, 3, 2 ] )
+
+    def testBoundedKwargs( self ):
+        calls = []
+        def add( a, b = 1 ):
+            calls.append( ( a, b ) )
+            return a + b
+        add = memoized( maxsize = 1 )( add )
+
+        self.failUnlessEqual( add( 1 ), 2 )
+        self.failUnlessEqual( add( 1, 1 ), 2 )
+        self.failUnlessEqual( add( a = 1, b = 1 ), 2 )
+        self.failUnlessEqual( add( 2 ), 3 )
+        self.failUnlessEqual( add( 1 ), 2 )
+        self.failUnlessEqual( calls, [ (1, 1), (2, 1), (1, 1) ] )
+
+    def testStats( self ):
+        def square( a ):
+            return a * a
+        square = memoized( maxsize = 2 )( square )
+
+        for a in [ 1, 1, 2, 3, 3 ]:
+            square( a )
+
+        stats = memoize._memoizedFunctions[-1].getStats()
+        self.failUnlessEqual( stats["hits"], 2 )
+        self.failUnlessEqual( stats["misses"], 3 )
+        self.failUnlessEqual( stats["evictions"], 1 )
+        self.failUnlessEqual( stats["size"], 2 )
+        self.failUnless( stats["memoryUsage"] > 0 )
+        self.failUnless( ".square: 2 values" in memoize.getMemoizeStats() )
+
+
+class TestMemoizedDocstrings( unittest.TestCase ):
+    """
+    Runs the examples in the docstrings of memoized functions, which
+    doctest doesn't find by itself when the native memoize module is
+    in use, since the functions aren't Python functions.
+    """
+
+    # The modules with memoized functions that have examples.
+    MODULES = [
+        "enso.graphics.measurement",
+        "enso.graphics.xmltextlayout",
+        ]
+
+    def _runExamples( self, function, module ):
+        finder = doctest.DocTestFinder()
+        runner = doctest.DocTestRunner( verbose = False )
+        for test in finder.find( function, function.__name__,
+                                 module = module,
+                                 globs = module.__dict__.copy() ):
+            runner.run( test )
+        self.failUnlessEqual( runner.failures, 0 )
+
+    def testExamples( self ):
+        numTested = 0
+        for name in self.MODULES:
+            try:
+                __import__( name )
+            except ImportError:
+                # The module needs the platform's graphics.
+                continue
+            module = sys.modules[name]
+            functions = [ memoizedFunction.function
+                          for memoizedFunction in memoize._memoizedFunctions
+                          if memoizedFunction.function.__module__ == name ]
+            self.failIfEqual( functions, [] )
+            for function in functions:
+                self._runExamples( function, module )
+            numTested += 1
+        if numTested == 0:
+            self.skipTest( "None of the modules can be imported here." )
+
 
 # ----------------------------------------------------------------------------
 # Script
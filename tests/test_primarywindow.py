@@ -0,0 +1,275 @@
+"""
+    Tests for how the primary message window picks the size of a
+    message's text, with stand-ins for the platform's graphics and
+    for enso.graphics.font.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import logging
+import random
+import types
+import unittest
+
+import enso.providers
+
+
+# ----------------------------------------------------------------------------
+# Stubs
+# ----------------------------------------------------------------------------
+
+def _stubModule( name, **attrs ):
+    module = types.ModuleType( name )
+    module.__dict__.update( attrs )
+    return module
+
+enso.providers._interfaces["graphics"] = _stubModule(
+    "fakegraphics",
+    getDesktopSize = lambda: ( 800, 600 )
+    )
+enso.providers._interfaces["cairo"] = _stubModule( "fakecairo" )
+
+from enso.graphics import font
+from enso.messages import primarywindow
+
+
+class FakeFontGlyph:
+    def __init__( self, char, font, advance ):
+        self.char = char
+        self.charAsUtf8 = char.encode( "utf-8" )
+        self.index = None
+        self.font = font
+        self.advance = advance
+        self.xMin = 0.0
+        self.xMax = advance
+        self.yMin = -font.descent
+        self.yMax = font.ascent
+
+
+class FakeFont:
+    """
+    A font whose glyphs are half as wide as its size, except for
+    spaces, which are a quarter as wide.
+    """
+
+    _fonts = {}
+
+    def __init__( self, name, size, isItalic ):
+        self.size = size
+        self.ascent = size * .8
+        self.descent = size * .2
+
+    def get( cls, name, size, isItalic ):
+        key = ( name, size, isItalic )
+        if not cls._fonts.has_key( key ):
+            cls._fonts[key] = cls( name, size, isItalic )
+        return cls._fonts[key]
+    get = classmethod( get )
+
+    def getGlyph( self, char ):
+        if char == " ":
+            return FakeFontGlyph( char, self, self.size * .25 )
+        return FakeFontGlyph( char, self, self.size * .5 )
+
+font.Font = FakeFont
+
+
+class FakePrimaryMsgWind( primarywindow.PrimaryMsgWind ):
+    """
+    A primary message window that has no real window, and can only
+    lay out text.
+    """
+
+    def __init__( self ):
+        pass
+
+    def layoutText( self, msgText, capText, width, height ):
+        return self._PrimaryMsgWind__layoutText( msgText, capText,
+                                                 width, height )
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+# The size of the area that the primary message window lays text out
+# in, on the fake desktop.
+WIDTH = primarywindow.PRIM_MSG_WIDTH - 2*primarywindow.PRIM_MSG_MARGIN
+HEIGHT = primarywindow.MAX_MSG_HEIGHT - 2*primarywindow.PRIM_MSG_MARGIN
+
+ROOT = "<document>%s</document>"
+
+def makeMessage( numWords, numCaptionWords = None ):
+    """
+    Returns the text and caption text of a message with the given
+    number of words, and a caption with the given number of words if
+    it isn't None.
+    """
+
+    msgText = "<p>%s</p>" % " ".join( [ "word" ] * numWords )
+    if numCaptionWords == None:
+        capText = None
+    else:
+        capText = "<caption>%s</caption>" % \
+                  " ".join( [ "caption" ] * numCaptionWords )
+    return msgText, capText
+
+
+def layOutAtSize( text, width, height, size ):
+    """
+    Returns the height of the given text laid out at the given size,
+    or None if it doesn't fit.
+    """
+
+    try:
+        return primarywindow.layoutMessageXml(
+            xmlMarkup = ROOT % text,
+            width = width,
+            height = height,
+            size = size,
+            raiseLayoutExceptions = True
+            ).height
+    except Exception:
+        return None
+
+
+def pickSizesLinearly( msgText, capText, width, height ):
+    """
+    Returns the sizes that the primary message window used to pick
+    for the given text, laying it out at each size, largest first,
+    until it fits; the smallest sizes are used (ellipsified) if it
+    fits at none of them.
+    """
+
+    for msgSize, capSize in reversed( primarywindow.SCALE[1:] ):
+        try:
+            msgDoc = primarywindow.layoutMessageXml(
+                xmlMarkup = ROOT % msgText,
+                width = width,
+                height = height,
+                size = msgSize,
+                )
+            if capText != None:
+                primarywindow.layoutMessageXml(
+                    xmlMarkup = ROOT % capText,
+                    width = width,
+                    height = height - msgDoc.height,
+                    size = capSize
+                    )
+            return ( msgSize, capSize )
+        except Exception:
+            pass
+    return primarywindow.SCALE[0]
+
+
+def captionHasNoRoom( msgText, capText, width, height ):
+    """
+    Returns whether, at a size at which the given text fits, it
+    leaves the caption no room for even one line, in which case the
+    caption's maximum number of lines isn't enforced.
+    """
+
+    if capText == None:
+        return False
+    for msgSize, capSize in primarywindow.SCALE[1:]:
+        msgHeight = layOutAtSize( msgText, width, height, msgSize )
+        if msgHeight != None and \
+           int( ( height - msgHeight ) /
+                ( capSize * primarywindow.LINE_SPACING ) ) <= 0:
+            return True
+    return False
+
+
+class SizeTests( unittest.TestCase ):
+    def setUp( self ):
+        self.window = FakePrimaryMsgWind()
+        self.sizesUsed = []
+        self.layoutMessageXml = primarywindow.layoutMessageXml
+        primarywindow.layoutMessageXml = self.recordingLayoutMessageXml
+
+        # Laying out text that doesn't fit logs warnings.
+        logging.disable( logging.WARNING )
+
+    def tearDown( self ):
+        primarywindow.layoutMessageXml = self.layoutMessageXml
+        logging.disable( logging.NOTSET )
+
+    def recordingLayoutMessageXml( self, **kwargs ):
+        self.sizesUsed.append( ( kwargs["size"],
+                                 kwargs.get( "ellipsify", "false" ) ) )
+        return self.layoutMessageXml( **kwargs )
+
+    def pickSizes( self, msgText, capText, width = WIDTH, height = HEIGHT ):
+        """
+        Returns the sizes that the primary message window picks for
+        the given text, checking that it lays out nothing else.
+        """
+
+        self.sizesUsed = []
+        self.window.layoutText( msgText, capText, width, height )
+        if capText == None:
+            self.failUnlessEqual( len( self.sizesUsed ), 1 )
+            msgSize, ellipsify = self.sizesUsed[0]
+            capSize = dict( primarywindow.SCALE )[msgSize]
+        else:
+            ( msgSize, ellipsify ), ( capSize, capEllipsify ) = \
+                self.sizesUsed
+            self.failUnlessEqual( ellipsify, capEllipsify )
+        self.failUnlessEqual( ellipsify == "true",
+                              msgSize == primarywindow.SCALE[0][0] )
+        return ( msgSize, capSize )
+
+    def failUnlessSameSizes( self, msgText, capText, width = WIDTH,
+                             height = HEIGHT ):
+        sizes = self.pickSizes( msgText, capText, width, height )
+        self.failUnlessEqual(
+            ( msgText, capText, width, height, sizes ),
+            ( msgText, capText, width, height,
+              pickSizesLinearly( msgText, capText, width, height ) )
+            )
+        return sizes
+
+    def testShortMessage( self ):
+        for capWords in [ None, 1 ]:
+            self.failUnlessEqual(
+                self.failUnlessSameSizes( *makeMessage( 3, capWords ) ),
+                ( 30, 18 )
+                )
+
+    def testOverflowingMessage( self ):
+        # Lay out more and more words, until the message only fits
+        # at the smaller sizes, and then at none of them.
+        sizes = []
+        for numWords in range( 0, 300, 10 ):
+            for capWords in [ None, 1, 10 ]:
+                msgText, capText = makeMessage( numWords, capWords )
+                if not captionHasNoRoom( msgText, capText, WIDTH, HEIGHT ):
+                    size = self.failUnlessSameSizes( msgText, capText )
+                    if size not in sizes:
+                        sizes.append( size )
+        self.failUnlessEqual( sizes, list( reversed( primarywindow.SCALE ) ) )
+
+    def testRandomMessages( self ):
+        random.seed( 0 )
+        numCompared = 0
+        for i in range( 150 ):
+            msgText, capText = makeMessage(
+                random.randint( 0, 300 ),
+                random.choice( [ None, random.randint( 0, 50 ) ] )
+                )
+            width = random.choice( [ WIDTH, 300, 100 ] )
+            height = random.choice( [ HEIGHT, 200, 100 ] )
+            if not captionHasNoRoom( msgText, capText, width, height ):
+                self.failUnlessSameSizes( msgText, capText, width, height )
+                numCompared += 1
+        self.failUnless( numCompared > 120 )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,263 @@
+"""
+    Unit tests for QuasimodeLayout.update(), which only lays out the
+    quasimode's lines that have changed, and reports the lines that
+    look different.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import os
+import re
+import sys
+import types
+import unittest
+
+import enso
+import enso.providers
+
+
+# ----------------------------------------------------------------------------
+# Stubs
+# ----------------------------------------------------------------------------
+
+def _stubModule( name, **attrs ):
+    module = types.ModuleType( name )
+    module.__dict__.update( attrs )
+    return module
+
+enso.providers._interfaces["graphics"] = _stubModule(
+    "fakegraphics",
+    getDesktopSize = lambda: ( 800, 600 )
+    )
+enso.providers._interfaces["cairo"] = _stubModule( "fakecairo" )
+
+# The quasimode package's __init__ imports the platform's input; only
+# the layout module is needed here.
+if not sys.modules.has_key( "enso.quasimode" ):
+    _package = _stubModule(
+        "enso.quasimode",
+        __path__ = [ os.path.join( os.path.dirname( enso.__file__ ),
+                                   "quasimode" ) ]
+        )
+    sys.modules["enso.quasimode"] = _package
+
+from enso.quasimode import layout
+
+
+class FakeLine:
+    def __init__( self, xMax ):
+        self.xMax = xMax
+
+
+class FakeBlock:
+    def __init__( self, lines ):
+        self.lines = lines
+
+
+class FakeDocument:
+    """
+    Stands in for a laid out line, which is as wide as the number
+    that is its text.
+    """
+
+    def __init__( self, xmlData, styleVersion ):
+        width = int( re.search( r"\d+", xmlData ).group() )
+        self.blocks = [ FakeBlock( [ FakeLine( width ) ] ) ]
+        self.xmlData = xmlData
+        self.styleVersion = styleVersion
+        self.shrinkOffset = 0
+
+
+class FakeSuggestion:
+    def __init__( self, width ):
+        self.width = width
+
+    def toXml( self ):
+        return str( self.width )
+
+    def getSource( self ):
+        return str( self.width )
+
+
+class FakeSuggestionList:
+    def __init__( self, description, widths, activeIndex ):
+        self.description = description
+        self.suggestions = [ FakeSuggestion( width ) for width in widths ]
+        self.activeIndex = activeIndex
+
+    def getDescription( self ):
+        return self.description
+
+    def getSuggestions( self ):
+        return self.suggestions
+
+    def getActiveIndex( self ):
+        return self.activeIndex
+
+
+class FakeQuasimode:
+    """
+    Stands in for the quasimode; its description line is as wide as
+    the given number, and each of its suggestion lines is as wide as
+    the corresponding given width.
+    """
+
+    def __init__( self, widths, activeIndex = 0, description = "100" ):
+        self.suggestionList = FakeSuggestionList( description, widths,
+                                                  activeIndex )
+
+    def getSuggestionList( self ):
+        return self.suggestionList
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+class QuasimodeLayoutTests( unittest.TestCase ):
+    def setUp( self ):
+        self.laidOut = []
+        self.layoutXmlLine = layout.layoutXmlLine
+        layout.layoutXmlLine = self.fakeLayoutXmlLine
+
+    def tearDown( self ):
+        layout.layoutXmlLine = self.layoutXmlLine
+
+    def fakeLayoutXmlLine( self, xml_data, styles, scale ):
+        self.laidOut.append( xml_data )
+        return FakeDocument( xml_data, styles.getVersion() )
+
+    def makeLayout( self, widths, activeIndex = 0 ):
+        quasimodeLayout = layout.QuasimodeLayout()
+        changedLines = quasimodeLayout.update(
+            FakeQuasimode( widths, activeIndex )
+            )
+        self.failUnlessEqual( changedLines, range( len( widths ) + 1 ) )
+        self.laidOut = []
+        return quasimodeLayout
+
+    def getAppearances( self, quasimodeLayout ):
+        return [ layout._getAppearance( line )
+                 for line in quasimodeLayout.newLines ]
+
+    def failUnlessCorrectChanges( self, quasimodeLayout, quasimode ):
+        """
+        Updates the given layout for the given quasimode, checks that
+        the lines it reports are exactly those that look different
+        from the way they did, and that they look the way a new
+        layout would make them look; returns the reported lines.
+        """
+
+        oldAppearances = self.getAppearances( quasimodeLayout )
+        changedLines = quasimodeLayout.update( quasimode )
+        newAppearances = self.getAppearances( quasimodeLayout )
+
+        expected = [ i for i in range( len( newAppearances ) )
+                     if i >= len( oldAppearances ) or
+                     newAppearances[i] != oldAppearances[i] ]
+        self.failUnlessEqual( changedLines, expected )
+
+        laidOut = list( self.laidOut )
+        self.failUnlessEqual( newAppearances,
+                              self.getAppearances(
+                                  layout.QuasimodeLayout( quasimode ) ) )
+        self.laidOut = laidOut
+        return changedLines
+
+    def testUnchangedNotLaidOutAgain( self ):
+        quasimodeLayout = self.makeLayout( [ 200, 300, 400 ] )
+        oldLines = list( quasimodeLayout.newLines )
+
+        changedLines = quasimodeLayout.update(
+            FakeQuasimode( [ 200, 300, 400 ] )
+            )
+        self.failUnlessEqual( changedLines, [] )
+        self.failUnlessEqual( self.laidOut, [] )
+        for line, oldLine in zip( quasimodeLayout.newLines, oldLines ):
+            self.failUnless( line is oldLine )
+
+    def testActiveIndexChange( self ):
+        quasimodeLayout = self.makeLayout( [ 200, 300, 400, 500 ] )
+
+        changedLines = self.failUnlessCorrectChanges(
+            quasimodeLayout, FakeQuasimode( [ 200, 300, 400, 500 ], 2 )
+            )
+        # The autocompletion line was active, and the second
+        # suggestion's line is; only they are laid out again.
+        self.failUnlessEqual( changedLines, [ 1, 3 ] )
+        self.failUnlessEqual( self.laidOut,
+                              [ quasimodeLayout.LINE_XML % "200",
+                                quasimodeLayout.LINE_XML % "400" ] )
+
+    def testNeighbourRagChange( self ):
+        quasimodeLayout = self.makeLayout( [ 200, 300, 400 ] )
+
+        # The first suggestion's line becomes nearly as wide as the
+        # autocompletion line, so the rags of the two are smoothed,
+        # widening the autocompletion line.
+        changedLines = self.failUnlessCorrectChanges(
+            quasimodeLayout, FakeQuasimode( [ 200, 202, 400 ] )
+            )
+        self.failUnlessEqual( changedLines, [ 1, 2 ] )
+        self.failUnlessEqual( quasimodeLayout.newLines[1].ragWidth, 202 )
+        self.failUnlessEqual( self.laidOut,
+                              [ quasimodeLayout.LINE_XML % "202" ] )
+
+    def testNeighbourCornerChange( self ):
+        quasimodeLayout = self.makeLayout( [ 200, 300, 400 ] )
+
+        # The first suggestion's line becomes narrower than the
+        # autocompletion line, which gets a rounded lower corner.
+        changedLines = self.failUnlessCorrectChanges(
+            quasimodeLayout, FakeQuasimode( [ 200, 150, 400 ] )
+            )
+        self.failUnlessEqual( changedLines, [ 1, 2 ] )
+        self.failUnless( quasimodeLayout.newLines[1].roundLowerRight )
+        self.failUnlessEqual( self.laidOut,
+                              [ quasimodeLayout.LINE_XML % "150" ] )
+
+        # The second suggestion's line, which was wider than the
+        # first one's and still is, isn't reported.
+        changedLines = self.failUnlessCorrectChanges(
+            quasimodeLayout, FakeQuasimode( [ 200, 160, 400 ] )
+            )
+        self.failUnlessEqual( changedLines, [ 2 ] )
+
+    def testSuggestionCountChange( self ):
+        quasimodeLayout = self.makeLayout( [ 200, 300 ] )
+
+        # New lines are reported, as is the line that was last, and
+        # had its lower corner rounded because of that.
+        changedLines = self.failUnlessCorrectChanges(
+            quasimodeLayout, FakeQuasimode( [ 200, 300, 350, 400 ] )
+            )
+        self.failUnlessEqual( changedLines, [ 2, 3, 4 ] )
+        self.failUnlessEqual( self.laidOut,
+                              [ quasimodeLayout.LINE_XML % "350",
+                                quasimodeLayout.LINE_XML % "400" ] )
+        self.failUnlessEqual( len( quasimodeLayout.newLines ), 5 )
+
+        # Removed lines aren't reported; the line that's now last is.
+        self.laidOut = []
+        changedLines = self.failUnlessCorrectChanges(
+            quasimodeLayout, FakeQuasimode( [ 200, 300, 350 ] )
+            )
+        self.failUnlessEqual( changedLines, [ 3 ] )
+        self.failUnlessEqual( self.laidOut, [] )
+        self.failUnlessEqual( len( quasimodeLayout.newLines ), 4 )
+
+        changedLines = self.failUnlessCorrectChanges(
+            quasimodeLayout, FakeQuasimode( [ 200 ] )
+            )
+        self.failUnlessEqual( changedLines, [ 1 ] )
+        self.failUnlessEqual( len( quasimodeLayout.newLines ), 2 )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
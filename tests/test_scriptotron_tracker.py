@@ -0,0 +1,257 @@
+"""
+    Tests for the reloading of scriptotron commands by
+    ScriptCommandTracker.registerNewCommands().
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import logging
+import os
+import sys
+import types
+import unittest
+
+import enso
+from enso.commands.manager import CommandAlreadyRegisteredError
+
+
+# ----------------------------------------------------------------------------
+# Stubs
+# ----------------------------------------------------------------------------
+
+# The scriptotron package, and its tracebacks and ensoapi modules,
+# import the platform's input, selection and graphics; stand-ins are
+# put in their places, so that the tracker can be tested anywhere.
+
+def _stubModule( name, **attrs ):
+    module = types.ModuleType( name )
+    module.__dict__.update( attrs )
+    sys.modules[name] = module
+    return module
+
+def _safetyNetted( func ):
+    return func
+
+class _EnsoApi:
+    pass
+
+if not sys.modules.has_key( "enso.contrib.scriptotron" ):
+    import enso.contrib
+    _package = _stubModule(
+        "enso.contrib.scriptotron",
+        __path__ = [ os.path.join( os.path.dirname( enso.__file__ ),
+                                   "contrib", "scriptotron" ) ]
+        )
+    _package.tracebacks = _stubModule( "enso.contrib.scriptotron.tracebacks",
+                                       safetyNetted = _safetyNetted,
+                                       TracebackCommand = object )
+    _package.ensoapi = _stubModule( "enso.contrib.scriptotron.ensoapi",
+                                    EnsoApi = _EnsoApi )
+
+from enso.contrib.scriptotron import cmdretriever
+from enso.contrib.scriptotron.tracker import ScriptCommandTracker
+
+
+class FakeEventManager:
+    def registerResponder( self, responder, eventName ):
+        pass
+
+    def removeResponder( self, responder ):
+        pass
+
+
+class FakeCommandManager:
+    """
+    Records the commands registered with it, and the calls made to
+    register and unregister them; like the real one, registering a
+    batch of commands registers none of them if any clashes.
+    """
+
+    def __init__( self, otherCommands = () ):
+        self.commands = {}
+        for cmdExpr in otherCommands:
+            self.commands[cmdExpr] = None
+        self.calls = []
+
+    def registerCommand( self, cmdExpr, cmd ):
+        self.calls.append( ( "register", cmdExpr ) )
+        if self.commands.has_key( cmdExpr ):
+            raise CommandAlreadyRegisteredError()
+        self.commands[cmdExpr] = cmd
+
+    def registerCommands( self, commands ):
+        cmdExprs = [ cmdExpr for cmdExpr, cmd in commands ]
+        self.calls.append( ( "registerMany", sorted( cmdExprs ) ) )
+        for cmdExpr in cmdExprs:
+            if self.commands.has_key( cmdExpr ):
+                raise CommandAlreadyRegisteredError()
+        for cmdExpr, cmd in commands:
+            self.commands[cmdExpr] = cmd
+
+    def unregisterCommands( self, cmdExprs ):
+        self.calls.append( ( "unregisterMany", sorted( cmdExprs ) ) )
+        for cmdExpr in cmdExprs:
+            del self.commands[cmdExpr]
+
+
+class WarningCatcher( logging.Handler ):
+    def __init__( self ):
+        logging.Handler.__init__( self, logging.WARNING )
+        self.messages = []
+
+    def emit( self, record ):
+        self.messages.append( record.getMessage() )
+
+
+def makeInfos( source ):
+    """
+    Returns the command infos of the commands defined by the given
+    script source code.
+    """
+
+    scriptGlobals = {}
+    exec source in scriptGlobals
+    return cmdretriever.getCommandsFromObjects( scriptGlobals )
+
+
+SCRIPT = """
+def cmd_hello( ensoapi ):
+    "Says hello."
+
+def cmd_open( ensoapi, thing ):
+    pass
+
+def cmd_pick( ensoapi, fruit ):
+    pass
+cmd_pick.valid_args = [ "apple", "pear" ]
+"""
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+class TrackerTests( unittest.TestCase ):
+    def setUp( self ):
+        self.cmdMgr = FakeCommandManager()
+        self.tracker = ScriptCommandTracker( self.cmdMgr,
+                                             FakeEventManager() )
+        self.tracker.registerNewCommands( makeInfos( SCRIPT ) )
+        self.cmdMgr.calls = []
+
+        self.warnings = WarningCatcher()
+        logging.getLogger().addHandler( self.warnings )
+
+    def tearDown( self ):
+        logging.getLogger().removeHandler( self.warnings )
+
+    def testRegistered( self ):
+        self.failUnlessEqual( sorted( self.cmdMgr.commands.keys() ),
+                              [ "hello", "open {thing}", "pick {fruit}" ] )
+
+    def testUnchangedKeepsAdapter( self ):
+        oldCommands = self.cmdMgr.commands.copy()
+        infos = makeInfos( SCRIPT )
+        self.tracker.registerNewCommands( infos )
+
+        # Nothing is unregistered or registered...
+        self.failUnlessEqual( self.cmdMgr.calls,
+                              [ ( "unregisterMany", [] ),
+                                ( "registerMany", [] ) ] )
+        # ...and each adapter is kept, with its new function.
+        for info in infos:
+            cmd = self.cmdMgr.commands[info["cmdExpr"]]
+            self.failUnless( cmd is oldCommands[info["cmdExpr"]] )
+            self.failUnless( cmd.func is info["func"] )
+
+    def testChangedIsReregistered( self ):
+        changes = [
+            # The description.
+            SCRIPT.replace( '"Says hello."', '"Says hi."' ),
+            # The help.
+            SCRIPT + "\ncmd_open.help = 'Opens a thing.'\n",
+            ]
+        for source in changes:
+            self.tracker.registerNewCommands( makeInfos( SCRIPT ) )
+            self.cmdMgr.calls = []
+            oldCommands = self.cmdMgr.commands.copy()
+            self.tracker.registerNewCommands( makeInfos( source ) )
+            self.failUnlessEqual( len( self.cmdMgr.calls ), 2 )
+            unregistered = self.cmdMgr.calls[0][1]
+            self.failUnlessEqual( self.cmdMgr.calls[1],
+                                  ( "registerMany", unregistered ) )
+            self.failUnlessEqual( len( unregistered ), 1 )
+            cmdExpr = unregistered[0]
+            self.failIf( self.cmdMgr.commands[cmdExpr]
+                         is oldCommands[cmdExpr] )
+
+        # Renaming the argument changes the command expression, so
+        # it's a removal and an addition.
+        self.cmdMgr.calls = []
+        source = SCRIPT.replace( "thing", "place" )
+        self.tracker.registerNewCommands( makeInfos( source ) )
+        self.failUnlessEqual( self.cmdMgr.calls,
+                              [ ( "unregisterMany", [ "open {thing}" ] ),
+                                ( "registerMany", [ "open {place}" ] ) ] )
+
+    def testRemovedIsUnregistered( self ):
+        source = SCRIPT.replace( "def cmd_hello", "def hello" )
+        self.tracker.registerNewCommands( makeInfos( source ) )
+        self.failUnlessEqual( self.cmdMgr.calls,
+                              [ ( "unregisterMany", [ "hello" ] ),
+                                ( "registerMany", [] ) ] )
+        self.failIf( self.cmdMgr.commands.has_key( "hello" ) )
+
+    def testDuplicatesAreWarnedAbout( self ):
+        source = SCRIPT + """
+def cmd_greet( ensoapi, person ):
+    pass
+cmd_greet.name = "hello {person}"
+
+def cmd_greet_again( ensoapi, person ):
+    pass
+cmd_greet_again.name = "hello {person}"
+"""
+        infos = makeInfos( source )
+        self.failUnlessEqual( len( [ info for info in infos
+                                     if info["cmdExpr"] == "hello {person}" ] ),
+                              2 )
+        self.tracker.registerNewCommands( infos )
+        self.failUnlessEqual( self.warnings.messages,
+                              [ "Command already registered: hello {person}" ] )
+        self.failUnless( self.cmdMgr.commands.has_key( "hello {person}" ) )
+
+    def testOneAtATimeFallback( self ):
+        # A command registered by something other than the tracker
+        # makes the batch fail; the other new commands are still
+        # registered, one at a time.
+        cmdMgr = FakeCommandManager( otherCommands = [ "open {thing}" ] )
+        tracker = ScriptCommandTracker( cmdMgr, FakeEventManager() )
+        tracker.registerNewCommands( makeInfos( SCRIPT ) )
+
+        self.failUnlessEqual( cmdMgr.calls[0][0], "unregisterMany" )
+        self.failUnlessEqual( cmdMgr.calls[1][0], "registerMany" )
+        self.failUnlessEqual( sorted( cmdMgr.calls[2:] ),
+                              [ ( "register", "hello" ),
+                                ( "register", "open {thing}" ),
+                                ( "register", "pick {fruit}" ) ] )
+        self.failUnlessEqual( self.warnings.messages,
+                              [ "Command already registered: open {thing}" ] )
+        self.failUnless( cmdMgr.commands["open {thing}"] is None )
+        self.failIfEqual( cmdMgr.commands["hello"], None )
+
+        # The clashing command isn't tracked, so a reload tries to
+        # register it again rather than unregistering the other one.
+        cmdMgr.calls = []
+        tracker.registerNewCommands( makeInfos( SCRIPT ) )
+        self.failUnlessEqual( cmdMgr.calls[0], ( "unregisterMany", [] ) )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,101 @@
+"""
+    Unit tests for the enso.platform.linux._shapemask extension
+    module, which are skipped if it isn't built.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import array
+import random
+import unittest
+
+try:
+    from enso.platform.linux import _shapemask
+except ImportError:
+    _shapemask = None
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+def _updateShapeMaskInPython( pixels, pixelStride, mask, maskStride,
+                              x, y, width, height, threshold ):
+    for row in range( y, y + height ):
+        for column in range( x, x + width ):
+            alpha = ord( pixels[row * pixelStride + column * 4 + 3] )
+            index = row * maskStride + column / 8
+            bit = 1 << ( column % 8 )
+            if alpha >= threshold:
+                mask[index] |= bit
+            else:
+                mask[index] &= ~bit & 0xff
+
+
+class ShapeMaskTests( unittest.TestCase ):
+    def testAgainstPython( self ):
+        # Compares the extension module to the Python implementation
+        # above on random pixels, rectangles and thresholds; the
+        # widths are enough to exercise all the SIMD paths.
+        if _shapemask == None:
+            return
+
+        random.seed( 0 )
+        alphas = [ 0, 1, 127, 128, 129, 254, 255 ]
+        for i in range( 200 ):
+            maskWidth = random.randint( 1, 150 )
+            maskHeight = random.randint( 1, 4 )
+            pixelStride = maskWidth * 4 + random.choice( [ 0, 4, 64 ] )
+            maskStride = ( maskWidth + 7 ) / 8 + random.choice( [ 0, 1 ] )
+
+            # Only the alpha bytes of ARGB32 pixels (in little-endian
+            # byte order) matter.
+            pixels = "".join( [ chr( random.choice( alphas ) )
+                                for j in range( pixelStride * maskHeight ) ] )
+            initialMask = [ random.randint( 0, 255 )
+                            for j in range( maskStride * maskHeight ) ]
+            x = random.randint( 0, maskWidth - 1 )
+            y = random.randint( 0, maskHeight - 1 )
+            width = random.randint( 1, maskWidth - x )
+            height = random.randint( 1, maskHeight - y )
+            threshold = random.choice( [ 0, 1, 128, 255, 256,
+                                         random.randint( 0, 256 ) ] )
+
+            expected = array.array( "B", initialMask )
+            _updateShapeMaskInPython( pixels, pixelStride,
+                                      expected, maskStride,
+                                      x, y, width, height, threshold )
+            mask = array.array( "B", initialMask )
+            changed = _shapemask.updateShapeMask( pixels, pixelStride,
+                                                  mask, maskStride,
+                                                  x, y, width, height,
+                                                  threshold )
+            self.failUnlessEqual( mask, expected )
+            self.failUnlessEqual( changed, mask.tolist() != initialMask )
+
+            # Updating the mask again changes nothing.
+            self.failIf( _shapemask.updateShapeMask( pixels, pixelStride,
+                                                     mask, maskStride,
+                                                     x, y, width, height,
+                                                     threshold ) )
+
+    def testRectangleOutsideBuffers( self ):
+        if _shapemask == None:
+            return
+
+        pixels = "\0" * 32
+        mask = array.array( "B", [ 0 ] )
+        self.failUnlessRaises( ValueError, _shapemask.updateShapeMask,
+                               pixels, 32, mask, 1, 4, 0, 5, 1, 128 )
+        self.failUnlessRaises( ValueError, _shapemask.updateShapeMask,
+                               pixels, 32, mask, 1, 0, 1, 1, 1, 128 )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
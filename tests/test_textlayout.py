@@ -0,0 +1,282 @@
+"""
+    Tests for the breaking of blocks into lines, by the _linebreaker
+    extension module and by its pure Python equivalent; the tests of
+    the extension module are skipped if it isn't built.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import array
+import random
+import types
+import unittest
+
+import enso.providers
+
+# The graphics package imports the platform's graphics and Cairo,
+# which line breaking doesn't need.
+enso.providers._interfaces.setdefault( "graphics",
+                                       types.ModuleType( "fakegraphics" ) )
+enso.providers._interfaces.setdefault( "cairo",
+                                       types.ModuleType( "fakecairo" ) )
+
+from enso.graphics import textlayout
+
+
+# ----------------------------------------------------------------------------
+# Stubs
+# ----------------------------------------------------------------------------
+
+class FakeFont:
+    def __init__( self, ascent, descent ):
+        self.ascent = ascent
+        self.descent = descent
+
+
+class FakeFontGlyph:
+    """
+    A font glyph whose ink starts xMin points after its origin and
+    ends xMax points after it.
+    """
+
+    def __init__( self, char, font, advance, xMin, xMax ):
+        self.char = char
+        self.charAsUtf8 = char.encode( "utf-8" )
+        self.index = None
+        self.font = font
+        self.advance = advance
+        self.xMin = xMin
+        self.xMax = xMax
+        self.yMin = -font.descent
+        self.yMax = font.ascent
+
+
+SMALL_FONT = FakeFont( 8.0, 2.0 )
+BIG_FONT = FakeFont( 12.0, 4.0 )
+
+# The advances of the glyphs made by makeGlyphs().
+ADVANCES = {
+    " " : 3.0,
+    "i" : 2.0,
+    "m" : 9.0,
+    "W" : 40.0,
+    }
+
+def makeGlyphs( text, font = SMALL_FONT ):
+    """
+    Returns Glyphs for the given text; glyphs not in ADVANCES are 5
+    points wide.
+    """
+
+    glyphs = []
+    for char in text:
+        advance = ADVANCES.get( char, 5.0 )
+        if char == " ":
+            xMin, xMax = 0.0, 0.0
+        else:
+            xMin, xMax = 0.5, advance - 1.0
+        fontGlyph = FakeFontGlyph( char, font, advance, xMin, xMax )
+        glyphs.append( textlayout.Glyph( fontGlyph, ( 0, 0, 0, 1 ) ) )
+    return glyphs
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+TEXTS = [
+    "",
+    " ",
+    "hello",
+    "hello there",
+    "hello there, how are you today?",
+    "a  b   c    d",
+    "mmmmmmmmmmmmmmmmmmmmmmmmmmmmmmmm",
+    "mmmmmmmmmmmmm mmmmmmmmm iiii mmmmmmmmmmmmmmmmmmm",
+    "i i i i i i i i i i i i i i i i i i i i i i i i i i i",
+    "  leading and trailing spaces  ",
+    "a W b",
+    "W",
+    ]
+
+def layOut( glyphs, width, maxLines, ellipsify, textAlign, ellipsis,
+            breakLines ):
+    """
+    Lays out a Block of the given glyphs, using the given line
+    breaking function, and returns its height and the span, bounding
+    box and metrics of each of its lines, or the class and argument
+    of the error raised.
+    """
+
+    oldBreakLines = textlayout.breakLines
+    textlayout.breakLines = breakLines
+    try:
+        block = textlayout.Block( width = width,
+                                  lineHeight = 20.0,
+                                  marginTop = 1.0,
+                                  marginBottom = 2.0,
+                                  textAlign = textAlign,
+                                  maxLines = maxLines,
+                                  ellipsify = ellipsify )
+        block.setEllipsisGlyph( ellipsis )
+        block.addGlyphs( glyphs )
+        try:
+            block.layout()
+        except ( textlayout.GlyphWiderThanBlockError,
+                 textlayout.MaxLinesExceededError ), e:
+            return ( e.__class__, e.args )
+    finally:
+        textlayout.breakLines = oldBreakLines
+
+    lines = [ ( line._Line__indices, line.xMin, line.xMax, line.yMin,
+                line.yMax, line.ascent, line.descent,
+                line.distanceToBaseline )
+              for line in block.lines ]
+    return ( block.height, lines )
+
+
+class LineBreakerTests( unittest.TestCase ):
+    def setUp( self ):
+        self.ellipsis = makeGlyphs( "...", BIG_FONT )[0]
+
+    def layOut( self, text, width, maxLines = 0, ellipsify = False,
+                textAlign = "left", ellipsis = None ):
+        if ellipsis == None:
+            ellipsis = self.ellipsis
+        return layOut( makeGlyphs( text ), width, maxLines, ellipsify,
+                       textAlign, ellipsis, textlayout._breakLinesInPython )
+
+    def testUnlimitedLines( self ):
+        height, lines = self.layOut( "hello there", 30.0 )
+        self.failUnlessEqual( height, 1.0 + 2*20.0 + 2.0 )
+        self.failUnlessEqual( [ line[0] for line in lines ],
+                              [ range( 0, 5 ), range( 6, 11 ) ] )
+        # Each line is left-aligned on the ink of its first glyph.
+        self.failUnlessEqual( [ line[1:3] for line in lines ],
+                              [ ( 0.0, 23.5 ), ( 0.0, 23.5 ) ] )
+
+    def testOneLine( self ):
+        self.failUnlessEqual( self.layOut( "hello there", 30.0,
+                                           maxLines = 1 ),
+                              ( textlayout.MaxLinesExceededError, () ) )
+        height, lines = self.layOut( "hello there", 28.0, maxLines = 1,
+                                     ellipsify = True )
+        self.failUnlessEqual( height, 1.0 + 20.0 + 2.0 )
+        # The ellipsis, which is the last glyph, replaces the last
+        # glyph of the line to make room for itself.
+        self.failUnlessEqual( lines[0][0], [ 0, 1, 2, 3, 11 ] )
+        # It's in a bigger font than the rest of the line.
+        self.failUnlessEqual( lines[0][5:7], ( 12.0, 4.0 ) )
+
+    def testManyLines( self ):
+        text = "i i i i i i i i i"
+        height, lines = self.layOut( text, 10.0, maxLines = 3,
+                                     ellipsify = True )
+        self.failUnlessEqual( len( lines ), 3 )
+        self.failUnlessEqual( lines[-1][0][-1], len( text ) )
+        height, lines = self.layOut( text, 10.0, maxLines = 5 )
+        self.failUnlessEqual( len( lines ), 5 )
+
+    def testJustifiedPartialLine( self ):
+        height, lines = self.layOut( "hello there you", 60.0,
+                                     textAlign = "justify" )
+        self.failUnlessEqual( [ line[0] for line in lines ],
+                              [ range( 0, 11 ), range( 12, 15 ) ] )
+        # Full lines stretch to the width of the block, less the
+        # left bearing of their first glyph...
+        self.failUnlessEqual( lines[0][1:3], ( 0.0, 59.5 ) )
+        # ...but the last, partial line is left-aligned.
+        self.failUnlessEqual( lines[1][1:3], ( 0.0, 13.5 ) )
+
+    def testGlyphTooWide( self ):
+        # Only a glyph that starts a line is checked.
+        glyphs = makeGlyphs( "aaa W" )
+        result = layOut( glyphs, 16.0, 0, False, "left", self.ellipsis,
+                         textlayout._breakLinesInPython )
+        self.failUnlessEqual( result,
+                              ( textlayout.GlyphWiderThanBlockError,
+                                ( glyphs[4], ) ) )
+
+    def testEllipsisTooWide( self ):
+        ellipsis = makeGlyphs( "W", BIG_FONT )[0]
+        self.failUnlessEqual( self.layOut( "hello there", 30.0,
+                                           maxLines = 1, ellipsify = True,
+                                           ellipsis = ellipsis ),
+                              ( textlayout.GlyphWiderThanBlockError,
+                                ( ellipsis, ) ) )
+
+
+class NativeLineBreakerTests( unittest.TestCase ):
+    """
+    Tests that the _linebreaker module breaks lines exactly as
+    _breakLinesInPython() does.
+    """
+
+    def setUp( self ):
+        if textlayout._linebreaker == None:
+            self.skipTest( "The _linebreaker module isn't built." )
+        self.ellipses = [ makeGlyphs( char, BIG_FONT )[0]
+                          for char in ".mW" ]
+
+    def failUnlessSameBreaks( self, advances, isWhitespace, width,
+                              maxLines, ellipsify, ellipsisAdvance ):
+        args = ( array.array( "d", advances ),
+                 array.array( "B", isWhitespace ),
+                 width, maxLines, ellipsify, ellipsisAdvance )
+        status, badGlyph, lineSpans, positions = \
+                textlayout._linebreaker.breakLines( *args )
+        lineSpans = [ ( start, end, bool( isPartial ), bool( hasEllipsis ) )
+                      for start, end, isPartial, hasEllipsis in lineSpans ]
+        self.failUnlessEqual(
+            ( args, ( status, badGlyph, lineSpans, list( positions ) ) ),
+            ( args, textlayout._breakLinesInPython( *args ) )
+            )
+
+    def testRandomBreaks( self ):
+        random.seed( 0 )
+        for i in range( 3000 ):
+            numGlyphs = random.randint( 0, 40 )
+            advances = [ random.choice( [ 0.0, 1.0, 2.5, 3.0, 5.0, 9.0,
+                                          25.0 ] )
+                         for j in range( numGlyphs ) ]
+            isWhitespace = [ random.random() < 0.2
+                             for j in range( numGlyphs ) ]
+            self.failUnlessSameBreaks(
+                advances, isWhitespace,
+                width = random.choice( [ 5.0, 10.0, 24.0, 30.0, 100.0 ] ),
+                maxLines = random.choice( [ 0, 1, 2, 3, 10 ] ),
+                ellipsify = random.random() < 0.5,
+                ellipsisAdvance = random.choice( [ 0.0, 3.0, 9.0, 40.0 ] )
+                )
+
+    def testLayout( self ):
+        for text in TEXTS:
+            for width in [ 8.0, 10.0, 30.0, 45.0, 200.0 ]:
+                for maxLines in [ 0, 1, 2, 5 ]:
+                    for ellipsify in [ False, True ]:
+                        for textAlign in [ "left", "right", "center",
+                                           "justify" ]:
+                            for ellipsis in self.ellipses:
+                                self.failUnlessSameLayout(
+                                    text, width, maxLines, ellipsify,
+                                    textAlign, ellipsis
+                                    )
+
+    def failUnlessSameLayout( self, text, *args ):
+        glyphs = makeGlyphs( text )
+        self.failUnlessEqual(
+            ( text, args,
+              layOut( glyphs, *args + ( textlayout._linebreaker.breakLines, ) ) ),
+            ( text, args,
+              layOut( glyphs, *args + ( textlayout._breakLinesInPython, ) ) )
+            )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,261 @@
+"""
+    Tests for the _xmlmarkup extension module, which are skipped if it
+    isn't built: markup parsed by it must give the same StyledMarkup,
+    or raise the same errors, as markup parsed by xml.sax.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import random
+import types
+import unittest
+
+import enso.providers
+
+# xmltextlayout only needs the platform's graphics and Cairo for
+# laying out documents, not for parsing markup.
+enso.providers._interfaces.setdefault( "graphics",
+                                       types.ModuleType( "fakegraphics" ) )
+enso.providers._interfaces.setdefault( "cairo",
+                                       types.ModuleType( "fakecairo" ) )
+
+from enso.graphics import xmltextlayout
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+def makeStyles():
+    styles = xmltextlayout.StyleRegistry()
+    for selector in [ "document", "block", "inline", "p", "em",
+                      "caption" ]:
+        styles.add( selector )
+    return styles
+
+def makeTagAliases():
+    tagAliases = xmltextlayout.XmlMarkupTagAliases()
+    tagAliases.add( "p", baseElement = "block" )
+    tagAliases.add( "em", baseElement = "inline" )
+    tagAliases.add( "caption", baseElement = "block" )
+    tagAliases.add( "page", baseElement = "document" )
+    # An alias whose name has no style of its own.
+    tagAliases.add( "plain", baseElement = "inline" )
+    # An alias for something that isn't an element.
+    tagAliases.add( "bogus", baseElement = "nothing" )
+    # Aliases for each other.
+    tagAliases.add( "ping", baseElement = "pong" )
+    tagAliases.add( "pong", baseElement = "ping" )
+    return tagAliases
+
+# Markup that exercises each part of the parser; each is parsed as
+# is, and inside a document and block element.
+CASES = [
+    # Tag aliases.
+    "<document><p>Hi <em>there</em></p><caption>x</caption></document>",
+    "<page><p>x</p></page>",
+    "<document><p><plain>x</plain></p></document>",
+    "<document><p><bogus>x</bogus></p></document>",
+    "<document><p><ping>x</ping></p></document>",
+    "<document><p>x</p></document><ping/>",
+    # Missing and empty style= targets.
+    "<document><p><inline style='caption'>x</inline></p></document>",
+    "<document><p><inline style='nope'>x</inline></p></document>",
+    "<document><p><inline style=''>x</inline></p></document>",
+    "<document style='nope'><block style=''>x</block></document>",
+    "<document><blok style='caption'>x</blok></document>",
+    # Nested and misplaced document and block elements.
+    "<document><document/></document>",
+    "<document><page/></document>",
+    "<document><p><p>x</p></p></document>",
+    "<document><p><block/></p></document>",
+    "<block>x</block>",
+    "<document><inline>x</inline></document>",
+    "<document><em>x</em></document>",
+    "<p>x</p>",
+    # Character and entity references.
+    "<document><p>&amp;&lt;&gt;&quot;&apos;</p></document>",
+    "<document><p>&#65;&#x42;&#x263a;&#169;</p></document>",
+    "<document><p>a&nbsp;b &nbsp; c</p></document>",
+    u"<document><p>caf\xe9 \u263a</p></document>",
+    "<document><p>&bogus;</p></document>",
+    "<document><p>&#xZZ;</p></document>",
+    "<document><p>& x</p></document>",
+    "<document><p a='&amp;&#65;'>x</p></document>",
+    # ]]>, carriage returns and tabs.
+    "<document><p>a ]]> b</p></document>",
+    "<document><p>a]]b]>c</p></document>",
+    "<document>\r\n<p>a\rb\r\nc</p>\r</document>",
+    "<document>\t<p>a\tb</p>\t</document>",
+    "<document\t><p\nstyle\r=\t'caption'>x</p\t></document >",
+    # Comments, CDATA sections and processing instructions.
+    "<document><!-- a comment --><p>x</p></document>",
+    "<document><p><![CDATA[a < b]]></p></document>",
+    "<?xml version='1.0'?><document><p>x</p></document>",
+    "<document><p>x<?pi data?></p></document>",
+    "<!DOCTYPE document><document><p>x</p></document>",
+    # Duplicate attributes and mismatched end tags.
+    "<document><p style='caption' style='caption'>x</p></document>",
+    "<document><p a='1' a='2'>x</p></document>",
+    "<document><p>x</em></document>",
+    "<document><p>x</document>",
+    "<document><p>x</p>",
+    "<document><p>x</p></document></document>",
+    # Text outside blocks.
+    "<document>  <p>x</p>  </document>",
+    "<document>x<p>y</p></document>",
+    "<document><p>x</p>y</document>",
+    "x<document/>",
+    "<document/>x",
+    "",
+    "   ",
+    ]
+
+# Pieces of markup that random markup is made of; the odd ones,
+# which the native parser mostly leaves to xml.sax, are used less
+# often.
+FRAGMENTS = [
+    "<document>", "</document>", "<document/>", "<page>", "</page>",
+    "<block>", "</block>", "<p>", "</p>", "<p/>", "<caption>",
+    "</caption>", "<inline>", "</inline>", "<em>", "</em>", "<em/>",
+    "<plain>", "</plain>", "<bogus>", "</bogus>",
+    "<inline style='caption'>", "<inline style='nope'>",
+    "<block style=''>", "<foo>", "</foo>", "x", "hello", " ", "  ",
+    "a b", "&amp;", "&lt;", "&#65;", "&#x263a;", "&nbsp;", "\r", "\t",
+    "\n", u"\xe9", ">", "'",
+    ]
+
+ODD_FRAGMENTS = [
+    "<ping>", "<p a='1' a='1'>", "&bogus;", "&", "]]>", "<!-- c -->",
+    "<![CDATA[c]]>", "<?pi?>", "<",
+    ]
+
+TAGS = [ "document", "page", "block", "p", "caption", "inline", "em",
+         "plain", "bogus", "foo" ]
+
+STYLE_ATTRIBUTES = [ "", "", "", " style='caption'", " style='em'",
+                     " style='nope'", " style=''" ]
+
+TEXT = [ "x", "hello ", " a b ", "&amp;", "&#x263a;", "&nbsp;", "\t",
+         u"\xe9" ]
+
+def makeRandomElement( depth ):
+    """
+    Returns a well-formed random element, nested at most the given
+    depth.
+    """
+
+    tag = random.choice( TAGS )
+    content = []
+    for i in range( random.randint( 0, 3 ) ):
+        if depth > 0 and random.random() < 0.5:
+            content.append( makeRandomElement( depth - 1 ) )
+        else:
+            content.append( random.choice( TEXT ) )
+    return "<%s%s>%s</%s>" % ( tag, random.choice( STYLE_ATTRIBUTES ),
+                               "".join( content ), tag )
+
+
+class XmlMarkupTests( unittest.TestCase ):
+    def setUp( self ):
+        if xmltextlayout._xmlmarkup == None:
+            self.skipTest( "The _xmlmarkup module isn't built." )
+        self.nativeModule = xmltextlayout._xmlmarkup
+        self.styles = makeStyles()
+        self.tagAliases = makeTagAliases()
+
+    def tearDown( self ):
+        xmltextlayout._xmlmarkup = self.nativeModule
+
+    def parse( self, text, nativeModule ):
+        """
+        Parses the given markup, with the given _xmlmarkup module (or
+        None for xml.sax), and returns the resulting document
+        selector and blocks, or the class and message of the error
+        raised.
+        """
+
+        xmltextlayout._xmlmarkup = nativeModule
+        try:
+            markup = xmltextlayout.parseXmlMarkup( text, self.styles,
+                                                   self.tagAliases )
+        except RuntimeError, e:
+            # Alias cycles recurse until Python gives up, in a place
+            # that depends on the stack.
+            return ( "RuntimeError", )
+        except Exception, e:
+            return ( e.__class__, unicode( e ) )
+        return ( markup.documentSelector, markup.blocks )
+
+    def failUnlessSameMarkup( self, text ):
+        self.failUnlessEqual(
+            ( text, self.parse( text, self.nativeModule ) ),
+            ( text, self.parse( text, None ) )
+            )
+
+    def testCases( self ):
+        for text in CASES:
+            self.failUnlessSameMarkup( text )
+            self.failUnlessSameMarkup( "<document><p>%s</p></document>"
+                                       % text )
+
+    def testRandomMarkup( self ):
+        random.seed( 0 )
+        for i in range( 3000 ):
+            fragments = []
+            for j in range( random.randint( 0, 8 ) ):
+                if random.random() < 0.05:
+                    fragments.append( random.choice( ODD_FRAGMENTS ) )
+                else:
+                    fragments.append( random.choice( FRAGMENTS ) )
+            text = "".join( fragments )
+            if random.random() < 0.5:
+                text = "<document><p>%s</p></document>" % text
+            self.failUnlessSameMarkup( text )
+
+    def testRandomElements( self ):
+        random.seed( 0 )
+        for i in range( 3000 ):
+            blocks = [ makeRandomElement( 3 )
+                       for j in range( random.randint( 0, 3 ) ) ]
+            self.failUnlessSameMarkup( "<document>%s</document>"
+                                       % "".join( blocks ) )
+
+    def testFallsBackToSax( self ):
+        # What the native parser doesn't understand is left to
+        # xml.sax.
+        for text in [
+            "<document><!-- c --><p>x</p></document>",
+            "<document><p><![CDATA[x]]></p></document>",
+            "<?xml version='1.0'?><document><p>x</p></document>",
+            "<document><p>x<?pi?></p></document>",
+            "<document><p a='1' a='2'>x</p></document>",
+            "<document><p>x</em></document>",
+            "<document><p>x</p>",
+            ]:
+            self.failUnlessEqual(
+                ( text, xmltextlayout._parseXmlMarkupNatively(
+                    text, self.styles, self.tagAliases ) ),
+                ( text, None )
+                )
+
+    def testNative( self ):
+        markup = xmltextlayout._parseXmlMarkupNatively(
+            "<document><p>a <em>b</em> &amp;</p></document>",
+            self.styles, self.tagAliases
+            )
+        self.failUnlessEqual( markup.documentSelector, "document" )
+        self.failUnlessEqual( markup.blocks,
+                              [ ( "p", [ ( (), "a " ),
+                                         ( ( "em", ), "b" ),
+                                         ( (), " &" ) ] ) ] )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,322 @@
+"""
+    Tests for the measuring of markup and for the caching of laid out
+    markup by enso.graphics.xmltextlayout, with a stand-in for
+    enso.graphics.font whose glyph metrics are made up, so that no
+    real fonts are needed.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import random
+import types
+import unittest
+
+import enso.providers
+
+enso.providers._interfaces.setdefault( "graphics",
+                                       types.ModuleType( "fakegraphics" ) )
+enso.providers._interfaces.setdefault( "cairo",
+                                       types.ModuleType( "fakecairo" ) )
+
+from enso.graphics import font
+from enso.graphics import textlayout
+from enso.graphics import xmltextlayout
+from enso.utils.lrucache import LruCache
+
+
+# ----------------------------------------------------------------------------
+# Stubs
+# ----------------------------------------------------------------------------
+
+class FakeFontGlyph:
+    def __init__( self, char, font, advance ):
+        self.char = char
+        self.charAsUtf8 = char.encode( "utf-8" )
+        self.index = None
+        self.font = font
+        self.advance = advance
+        self.xMin = advance * .1
+        self.xMax = advance * .9
+        self.yMin = -font.descent
+        self.yMax = font.ascent
+
+
+class FakeFont:
+    """
+    A font whose glyphs are as wide as a fixed fraction of its size,
+    which depends on the character.
+    """
+
+    # The advances of glyphs, as fractions of their font's size;
+    # those of other characters are .5.
+    ADVANCES = {
+        " " : .25,
+        "i" : .3,
+        "m" : .9,
+        "W" : 1.0,
+        }
+
+    _fonts = {}
+
+    def __init__( self, name, size, isItalic ):
+        self.name = name
+        self.size = size
+        self.isItalic = isItalic
+        self.ascent = size * .8
+        self.descent = size * .2
+        self.__glyphs = {}
+
+    def get( cls, name, size, isItalic ):
+        key = ( name, size, isItalic )
+        if not cls._fonts.has_key( key ):
+            cls._fonts[key] = cls( name, size, isItalic )
+        return cls._fonts[key]
+    get = classmethod( get )
+
+    def getGlyph( self, char ):
+        if not self.__glyphs.has_key( char ):
+            advance = self.size * self.ADVANCES.get( char, .5 )
+            if self.isItalic:
+                advance *= 1.1
+            self.__glyphs[char] = FakeFontGlyph( char, self, advance )
+        return self.__glyphs[char]
+
+font.Font = FakeFont
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+def makeStyles():
+    styles = xmltextlayout.StyleRegistry()
+    styles.add( "document",
+                font_family = "Gentium",
+                font_style = "normal",
+                font_size = "20pt",
+                line_height = "24pt",
+                width = "200pt",
+                margin_top = "3pt",
+                margin_bottom = "4pt",
+                max_lines = "0",
+                ellipsify = "false",
+                text_align = "left",
+                color = "#ffffff" )
+    styles.add( "p", margin_top = "1pt", margin_bottom = "2pt" )
+    styles.add( "caption", font_style = "italic", color = "#669900",
+                margin_top = "0pt", margin_bottom = "0pt" )
+    styles.add( "command", color = "#669900" )
+    return styles
+
+TAG_ALIASES = xmltextlayout.XmlMarkupTagAliases()
+TAG_ALIASES.add( "p", baseElement = "block" )
+TAG_ALIASES.add( "caption", baseElement = "block" )
+TAG_ALIASES.add( "command", baseElement = "inline" )
+
+WORDS = [ "a", "hi", "hello", "there", "iiii", "mmmmmmm", "W",
+          "supercalifragilistic", "WWWWWWWWWW", u"caf\xe9" ]
+
+def makeRandomXml():
+    """
+    Returns the XML of a random message, made of paragraphs and
+    captions of random words.
+    """
+
+    blocks = []
+    for i in range( random.randint( 0, 3 ) ):
+        words = []
+        for j in range( random.randint( 0, 30 ) ):
+            word = random.choice( WORDS )
+            if random.random() < .1:
+                word = "<command>%s</command>" % word
+            words.append( word )
+        tag = random.choice( [ "p", "caption" ] )
+        blocks.append( "<%s>%s</%s>" % ( tag, " ".join( words ), tag ) )
+    return "<document>%s</document>" % "".join( blocks )
+
+
+def setRandomStyle( styles ):
+    styles.update( "document",
+                   font_size = "%dpt" % random.choice( [ 12, 20, 30 ] ),
+                   line_height = "%dpt" % random.choice( [ 14, 24, 36 ] ),
+                   width = "%dpt" % random.choice( [ 10, 50, 100, 200,
+                                                    400 ] ),
+                   max_lines = str( random.choice( [ 0, 1, 2, 4 ] ) ),
+                   ellipsify = random.choice( [ "true", "false" ] ),
+                   text_align = random.choice( [ "left", "right", "center",
+                                                 "justify" ] ) )
+
+
+class MeasureTests( unittest.TestCase ):
+    """
+    Tests that measuring markup gives the height of the document that
+    laying it out makes, without laying it out.
+    """
+
+    def setUp( self ):
+        self.styles = makeStyles()
+
+    def getLayoutHeight( self, laidOut ):
+        """
+        Returns the height of the document made by the given
+        function, or None if it raises an exception because the
+        document doesn't fit.
+        """
+
+        try:
+            return laidOut().height
+        except ( textlayout.GlyphWiderThanBlockError,
+                 textlayout.MaxLinesExceededError ):
+            return None
+
+    def failUnlessMeasured( self, xml ):
+        styles = self.styles
+        markup = xmltextlayout.parseXmlMarkup( xml, styles, TAG_ALIASES )
+        height = self.getLayoutHeight( lambda: markup.toDocument( styles ) )
+        self.failUnlessEqual( ( xml, markup.measure( styles ) ),
+                              ( xml, height ) )
+
+        styledRuns = markup.resolve( styles )
+        self.failUnlessEqual(
+            ( xml, styledRuns.measure() ),
+            ( xml, self.getLayoutHeight( styledRuns.toDocument ) )
+            )
+        return height
+
+    def testMeasure( self ):
+        xml = "<document><p>hello there</p><caption>hi</caption></document>"
+        height = self.failUnlessMeasured( xml )
+        # The document's margins, the line and margins of its
+        # paragraph, and the line of its caption.
+        self.failUnlessEqual( height, 3 + ( 1 + 24 + 2 ) + 24 + 4 )
+
+        # At this width, the paragraph takes two lines.
+        self.styles.update( "document", width = "60pt" )
+        self.failUnlessEqual( self.failUnlessMeasured( xml ),
+                              3 + ( 1 + 2*24 + 2 ) + 24 + 4 )
+
+    def testDoesntFit( self ):
+        xml = "<document><p>hello there</p></document>"
+        self.styles.update( "document", width = "60pt", max_lines = "1" )
+        self.failUnlessEqual( self.failUnlessMeasured( xml ), None )
+
+        # When ellipsified, it fits.
+        self.styles.update( "document", ellipsify = "true" )
+        self.failUnlessEqual( self.failUnlessMeasured( xml ),
+                              3 + ( 1 + 24 + 2 ) + 4 )
+
+        # A glyph wider than the block doesn't fit.
+        self.styles.update( "document", width = "15pt" )
+        self.failUnlessEqual(
+            self.failUnlessMeasured( "<document><p>W</p></document>" ),
+            None
+            )
+
+    def testRandomMarkup( self ):
+        random.seed( 0 )
+        for i in range( 1000 ):
+            setRandomStyle( self.styles )
+            self.failUnlessMeasured( makeRandomXml() )
+
+
+class CacheTests( unittest.TestCase ):
+    """
+    Tests for the versions of style registries, and for the cache of
+    xmlMarkupToDocument() that they're part of the keys of.
+    """
+
+    XML = "<document><p>hello <command>there</command></p></document>"
+
+    def setUp( self ):
+        self.styledRunsCache = xmltextlayout._styledRunsCache
+        xmltextlayout._styledRunsCache = LruCache(
+            xmltextlayout.MAX_CACHED_STYLED_RUNS
+            )
+
+    def tearDown( self ):
+        xmltextlayout._styledRunsCache = self.styledRunsCache
+
+    def layOut( self, styles ):
+        """
+        Lays out XML with the given styles, and returns the size of
+        the font of its first glyph, and whether the StyledRuns it
+        was made from were cached.
+        """
+
+        hits, misses, size = xmltextlayout.getCacheStatistics()
+        document = xmltextlayout.xmlMarkupToDocument( self.XML, styles,
+                                                      TAG_ALIASES )
+        newHits, newMisses, newSize = xmltextlayout.getCacheStatistics()
+        self.failUnlessEqual( newHits + newMisses, hits + misses + 1 )
+        self.failUnlessEqual( newSize, size + newMisses - misses )
+
+        line = document.blocks[0].lines[0]
+        return ( line.ascent / .8, newHits > hits )
+
+    def testVersions( self ):
+        styles = makeStyles()
+        version = styles.getVersion()
+        self.failUnlessEqual( styles.getVersion(), version )
+
+        styles.update( "document", font_size = "30pt" )
+        newVersion = styles.getVersion()
+        self.failIfEqual( newVersion, version )
+
+        # Updating a registry back to its old contents gives it back
+        # its old version.
+        styles.update( "document", font_size = "20pt" )
+        self.failUnlessEqual( styles.getVersion(), version )
+        styles.update( "document", font_size = "30pt" )
+        self.failUnlessEqual( styles.getVersion(), newVersion )
+
+        # Registries with the same contents have the same version;
+        # adding a style changes it.
+        otherStyles = makeStyles()
+        self.failUnlessEqual( otherStyles.getVersion(), version )
+        otherStyles.add( "unused" )
+        self.failIfEqual( otherStyles.getVersion(), version )
+        self.failIfEqual( otherStyles.getVersion(), newVersion )
+
+    def testCache( self ):
+        styles = makeStyles()
+        self.failUnlessEqual( self.layOut( styles ), ( 20, False ) )
+        self.failUnlessEqual( self.layOut( styles ), ( 20, True ) )
+        self.failUnlessEqual( xmltextlayout.getCacheStatistics(),
+                              ( 1, 1, 1 ) )
+
+        # Updating any style invalidates what's cached.
+        styles.update( "document", font_size = "30pt" )
+        self.failUnlessEqual( self.layOut( styles ), ( 30, False ) )
+        styles.update( "command", color = "#000000" )
+        self.failUnlessEqual( self.layOut( styles ), ( 30, False ) )
+        styles.update( "command", color = "#669900" )
+        self.failUnlessEqual( self.layOut( styles ), ( 30, True ) )
+
+        # So does adding one.
+        styles.add( "unused" )
+        self.failUnlessEqual( self.layOut( styles ), ( 30, False ) )
+
+        # Updating the styles back to what they were makes what was
+        # cached for them valid again.
+        otherStyles = makeStyles()
+        self.failUnlessEqual( self.layOut( otherStyles ), ( 20, True ) )
+        otherStyles.update( "document", font_size = "30pt" )
+        self.failUnlessEqual( self.layOut( otherStyles ), ( 30, True ) )
+
+        self.failUnlessEqual( xmltextlayout.getCacheStatistics(),
+                              ( 4, 4, 4 ) )
+
+    def testSharedEntries( self ):
+        # Registries with the same contents share cache entries.
+        self.failUnlessEqual( self.layOut( makeStyles() ), ( 20, False ) )
+        self.failUnlessEqual( self.layOut( makeStyles() ), ( 20, True ) )
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()
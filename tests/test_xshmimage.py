@@ -0,0 +1,133 @@
+"""
+    Unit tests for the enso.platform.linux._xshmimage extension
+    module, which are skipped if it isn't built; the tests that need
+    an X server (e.g. Xvfb) are also skipped if there's no DISPLAY or
+    pygtk.
+"""
+
+# ----------------------------------------------------------------------------
+# Imports
+# ----------------------------------------------------------------------------
+
+import os
+import unittest
+
+try:
+    from enso.platform.linux import _xshmimage
+except ImportError:
+    _xshmimage = None
+
+
+# ----------------------------------------------------------------------------
+# Unit Tests
+# ----------------------------------------------------------------------------
+
+def _makeGtkWindow( width, height ):
+    """
+    Returns a realized gtk.Window of the given size, or None if there's
+    no X server or pygtk to make one with.
+    """
+
+    if not os.environ.get( "DISPLAY" ):
+        return None
+    try:
+        import gtk
+    except ImportError:
+        return None
+
+    window = gtk.Window( gtk.WINDOW_POPUP )
+    window.set_default_size( width, height )
+    window.realize()
+    return window
+
+
+class XShmImageTests( unittest.TestCase ):
+    def setUp( self ):
+        if _xshmimage == None:
+            self.skipTest( "The _xshmimage module isn't built." )
+
+    def makeImage( self, width, height ):
+        """
+        Returns a gtk.Window of the given size and a ShmImage for it,
+        skipping the test if they can't be made.
+        """
+
+        window = _makeGtkWindow( width, height )
+        if window == None:
+            self.skipTest( "There's no X server or pygtk." )
+
+        try:
+            image = _xshmimage.ShmImage( window.get_display().get_name(),
+                                         window.window.xid, width, height )
+        except _xshmimage.error, e:
+            # No MIT-SHM, or a visual that isn't cairo's ARGB32.
+            window.destroy()
+            self.skipTest( "Can't make a ShmImage: %s" % e )
+        return window, image
+
+    def testNoDisplay( self ):
+        # An image that can't be made raises the module's error, so
+        # that graphics can fall back to an ordinary image surface.
+        self.failUnlessRaises( _xshmimage.error, _xshmimage.ShmImage,
+                               "enso-test-no-such-display:0", 0, 16, 16 )
+
+    def testBadSize( self ):
+        self.failUnlessRaises( _xshmimage.error, _xshmimage.ShmImage,
+                               None, 0, 0, 16 )
+
+    def testCairoSurface( self ):
+        # The image's pixels can be drawn on with cairo in place, and
+        # put onto the window.
+        window, image = self.makeImage( 64, 32 )
+
+        from enso import cairo
+
+        self.failUnlessEqual( image.width, 64 )
+        self.failUnlessEqual( image.height, 32 )
+        self.failUnless( image.stride >= 64 * 4 )
+
+        surface = cairo.ImageSurface.create_for_data(
+            image, cairo.FORMAT_ARGB32, image.width, image.height,
+            image.stride )
+        context = cairo.Context( surface )
+        context.set_source_rgba( 1, 0, 0, 1 )
+        context.paint()
+        surface.flush()
+
+        pixel = str( buffer( image )[:4] )
+        self.failUnlessEqual( pixel, "\x00\x00\xff\xff" )
+
+        image.put( 0, 0, 64, 32 )
+        # Rectangles are clipped to the image.
+        image.put( -8, -8, 128, 128 )
+        image.put( 100, 100, 8, 8 )
+
+        surface.finish()
+        window.destroy()
+
+    def testDestroyedWindow( self ):
+        # X errors, e.g. from drawing to a window that's gone, are
+        # raised rather than ending the process.
+        window, image = self.makeImage( 16, 16 )
+
+        import gtk
+
+        window.destroy()
+        gtk.gdk.flush()
+        self.failUnlessRaises( _xshmimage.error, image.put, 0, 0, 16, 16 )
+
+    def testOtherDisplay( self ):
+        # All images share one connection to the display.
+        window, image = self.makeImage( 16, 16 )
+        self.failUnlessRaises( _xshmimage.error, _xshmimage.ShmImage,
+                               "enso-test-no-such-display:0",
+                               window.window.xid, 16, 16 )
+        window.destroy()
+
+
+# ----------------------------------------------------------------------------
+# Script
+# ----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    unittest.main()